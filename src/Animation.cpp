@@ -0,0 +1,262 @@
+#include "Animation.h"
+#include "Scheduler.h"
+#include "Clock.h"
+#include "Debug.h"
+
+TFT_eSPI* animTft = nullptr;
+uint8_t animTaskHandle = NO_TASK;
+TFT_eSprite* animSprites[ANIM_MAX];
+Animation animations[ANIM_MAX];
+uint64_t animNextTick = 0;       // clockMillis of the next step, 0 when stopped
+AnimStats animFrameStats;
+
+void animBegin(TFT_eSPI* tft, const uint8_t task) {
+  animTft = tft;
+  animTaskHandle = task;
+  for (uint8_t i = 0; i < ANIM_MAX; i++) {
+    animSprites[i] = new TFT_eSprite(tft);
+    animSprites[i]->setColorDepth(1);
+  }
+}
+
+bool animActive() {
+  for (uint8_t i = 0; i < ANIM_MAX; i++) {
+    if (animations[i].type != ANIM_NONE) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void animStop(const int8_t id) {
+  if ((id < 0) || (id >= ANIM_MAX) || (animations[id].type == ANIM_NONE)) {
+    return;
+  }
+  animations[id].type = ANIM_NONE;
+  animSprites[id]->deleteSprite();
+  if (!animActive()) {
+    taskStop(animTaskHandle);
+    animNextTick = 0;
+  }
+}
+
+void animStopAll() {
+  for (uint8_t i = 0; i < ANIM_MAX; i++) {
+    animStop(i);
+  }
+}
+
+// Without a slot or sprite the text still has to show: the last frame,
+// straight to the screen. A marquee that doesn't fit shows its start
+void drawFinalFrame(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const char* text, const uint8_t font,
+                    const uint16_t fg, const uint16_t bg) {
+  int16_t textWidth = animTft->textWidth(text,font);
+  animTft->fillRect(x,y,w,h,bg);
+  animTft->setTextColor(fg);
+  animTft->drawString(text,x + max(0,(w - textWidth) / 2),y + (h - animTft->fontHeight(font)) / 2,font);
+}
+
+// claims a slot and its sprite, -1 when there is no room
+int8_t animStart(const AnimType type, const int16_t x, const int16_t y, const int16_t w, const int16_t h,
+                 const char* text, const uint8_t font, const uint16_t fg, const uint16_t bg) {
+
+  if (animTft == nullptr) {
+    dPrintf(F("Animation before animBegin, not drawn: %s\n"),text);
+    return -1;
+  }
+
+  int8_t id = -1;
+  for (uint8_t i = 0; (i < ANIM_MAX) && (id < 0); i++) {
+    if (animations[i].type == ANIM_NONE) {
+      id = i;
+    }
+  }
+  if ((id < 0) || (animSprites[id]->createSprite(w,h) == nullptr)) {
+    dPrintf(F("No room for animation, drawn still: %s\n"),text);
+    drawFinalFrame(x,y,w,h,text,font,fg,bg);
+    return -1;
+  }
+
+  Animation& anim = animations[id];
+  anim = Animation();
+  anim.type = type;
+  anim.x = x; anim.y = y; anim.w = w; anim.h = h;
+  strlcpy(anim.text,text,sizeof(anim.text));
+  anim.font = font;
+  anim.fg = fg; anim.bg = bg; anim.from = fg;
+  anim.textWidth = animTft->textWidth(anim.text,font);
+  anim.step = 0;
+  anim.started = false;
+  anim.steps = 0;
+  anim.onFirstFrame = nullptr;
+
+  if (animNextTick == 0) {
+    animNextTick = clockMillis();
+    taskWakeNow(animTaskHandle);
+  }
+  return id;
+
+}
+
+uint32_t durationSteps(const uint32_t durationMs) {
+  return max((uint32_t)1,durationMs / ANIM_FRAME_MS);
+}
+
+int8_t animMarquee(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const char* text, const uint8_t font,
+                   const uint16_t fg, const uint16_t bg) {
+  int8_t id = animStart(ANIM_MARQUEE,x,y,w,h,text,font,fg,bg);
+  if ((id >= 0) && (animations[id].textWidth <= w)) {
+    animations[id].steps = 1;    // fits, one frame and done
+  }
+  return id;
+}
+
+int8_t animFade(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const char* text, const uint8_t font,
+                const uint16_t from, const uint16_t to, const uint16_t bg, const uint32_t durationMs) {
+  int8_t id = animStart(ANIM_FADE,x,y,w,h,text,font,to,bg);
+  if (id >= 0) {
+    animations[id].from = from;
+    animations[id].steps = durationSteps(durationMs);
+  }
+  return id;
+}
+
+int8_t animSlide(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const char* text, const uint8_t font,
+                 const uint16_t fg, const uint16_t bg, const uint32_t durationMs) {
+  int8_t id = animStart(ANIM_SLIDE,x,y,w,h,text,font,fg,bg);
+  if (id >= 0) {
+    animations[id].steps = durationSteps(durationMs);
+  }
+  return id;
+}
+
+int8_t animFlash(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const char* text, const uint8_t font,
+                 const uint16_t fg, const uint16_t bg, const uint32_t durationMs, void (*onFirstFrame)()) {
+  int8_t id = animStart(ANIM_FLASH,x,y,w,h,text,font,fg,bg);
+  if (id >= 0) {
+    animations[id].steps = durationSteps(durationMs);
+    animations[id].onFirstFrame = onFirstFrame;
+  }
+  else if (onFirstFrame && (animTft != nullptr)) {
+    onFirstFrame();     // the still frame is up
+  }
+  return id;
+}
+
+// one frame of one animation into its sprite, then out to the screen
+void drawAnimation(const uint8_t id) {
+
+  Animation& anim = animations[id];
+  TFT_eSprite* sprite = animSprites[id];
+  bool last = (anim.steps > 0) && (anim.step + 1 >= anim.steps);
+  int16_t textY = (anim.h - animTft->fontHeight(anim.font)) / 2;
+  int16_t centreX = (anim.w - anim.textWidth) / 2;
+
+  // 1 is foreground and 0 background, the real colours are set at the push
+  sprite->fillSprite(0);
+  sprite->setTextColor(1);
+
+  switch (anim.type) {
+    case ANIM_MARQUEE: {
+      if (anim.textWidth <= anim.w) {
+        sprite->drawString(anim.text,centreX,textY,anim.font);
+      }
+      else {
+        // hold at the start for a moment, then scroll left and wrap around
+        uint32_t moving = (anim.step > ANIM_MARQUEE_HOLD) ? anim.step - ANIM_MARQUEE_HOLD : 0;
+        int16_t offset = moving % (anim.textWidth + ANIM_MARQUEE_GAP);
+        sprite->drawString(anim.text,-offset,textY,anim.font);
+        sprite->drawString(anim.text,anim.textWidth + ANIM_MARQUEE_GAP - offset,textY,anim.font);
+      }
+      sprite->setBitmapColor(anim.fg,anim.bg);
+      break;
+    }
+    case ANIM_FADE: {
+      sprite->drawString(anim.text,centreX,textY,anim.font);
+      uint8_t alpha = last ? 255 : (anim.step * 255) / anim.steps;
+      sprite->setBitmapColor(animTft->alphaBlend(alpha,anim.fg,anim.from),anim.bg);
+      break;
+    }
+    case ANIM_SLIDE: {
+      int16_t startX = anim.w;
+      int16_t x = last ? centreX : startX - (int32_t)(startX - centreX) * anim.step / anim.steps;
+      sprite->drawString(anim.text,x,textY,anim.font);
+      sprite->setBitmapColor(anim.fg,anim.bg);
+      break;
+    }
+    case ANIM_FLASH: {
+      sprite->drawString(anim.text,centreX,textY,anim.font);
+      bool inverted = !last && (((anim.step / ANIM_FLASH_STEPS) % 2) == 0);
+      sprite->setBitmapColor(inverted ? anim.bg : anim.fg,inverted ? anim.fg : anim.bg);
+      break;
+    }
+    default:
+      return;
+  }
+
+  sprite->pushSprite(anim.x,anim.y);
+
+  if (!anim.started && anim.onFirstFrame) {
+    anim.onFirstFrame();
+  }
+
+}
+
+// Anim task. Draws every running animation at the step it should be at now and
+// sleeps until the next ANIM_FRAME_MS boundary
+void animRun() {
+
+  if (animNextTick == 0) {
+    return;
+  }
+
+  uint64_t now = clockMillis();
+  uint32_t late = (now > animNextTick) ? now - animNextTick : 0;
+  uint32_t steps = 1 + late / ANIM_FRAME_MS;
+  animFrameStats.skipped += steps - 1;
+  animFrameStats.maxLateMs = max(animFrameStats.maxLateMs,late);
+
+  uint64_t renderStart = clockMicros();
+  for (uint8_t i = 0; i < ANIM_MAX; i++) {
+    Animation& anim = animations[i];
+    if (anim.type == ANIM_NONE) {
+      continue;
+    }
+    if (anim.started) {
+      anim.step += steps;
+      if ((anim.steps > 0) && (anim.step >= anim.steps)) {
+        anim.step = anim.steps - 1;    // always land on the last frame
+      }
+    }
+    drawAnimation(i);
+    anim.started = true;
+    if ((anim.steps > 0) && (anim.step + 1 >= anim.steps)) {
+      animStop(i);
+    }
+  }
+  uint32_t renderUs = clockMicros() - renderStart;
+  animFrameStats.frames++;
+  animFrameStats.totalRenderUs += renderUs;
+  animFrameStats.maxRenderUs = max(animFrameStats.maxRenderUs,renderUs);
+
+  if (!animActive()) {
+    return;     // nothing left, the task stays asleep until the next start
+  }
+
+  animNextTick += (uint64_t)steps * ANIM_FRAME_MS;
+  now = clockMillis();
+  taskWakeIn(animTaskHandle,(animNextTick > now) ? animNextTick - now : 0);
+
+}
+
+const AnimStats& animStats() {
+  return animFrameStats;
+}
+
+void animPrintStats() {
+  if (animFrameStats.frames == 0) {
+    return;
+  }
+  dPrintf(F("Animation: %d frames, %d skipped, max late %d ms, render avg %d us max %d us\n"),animFrameStats.frames,animFrameStats.skipped,
+          animFrameStats.maxLateMs,(uint32_t)(animFrameStats.totalRenderUs / animFrameStats.frames),animFrameStats.maxRenderUs);
+}
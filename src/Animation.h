@@ -0,0 +1,77 @@
+#ifndef ANIMATION
+#define ANIMATION
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+/*  Small animation engine. Every animation owns a window on the screen and
+    never draws outside it. Each frame is drawn into a 1 bit sprite the size of
+    the window and pushed in one go, so only that rectangle is sent to the
+    display and there is no flicker.
+
+    All animations step together on a fixed ANIM_FRAME_MS timestep run by the
+    anim task. A late frame doesn't slow the animation down, the skipped steps
+    are counted and the next frame is drawn where it should be by now. With
+    nothing running the task isn't scheduled at all and the sprite is freed.
+
+      marquee  text scrolls through the window, or is drawn once if it fits
+      fade     text colour goes from one colour to another
+      slide    text moves in from the right edge to the centre
+      flash    text swaps foreground and background every ANIM_FLASH_STEPS
+
+    Anything that repaints the whole screen should call animStopAll() first.
+    When there is no free slot or no memory for the sprite, the text is drawn
+    once as it would look at the end, and the start returns -1. animBegin()
+    has to run before the first screen that uses them.
+*/
+
+const uint16_t ANIM_FRAME_MS = 40;          // 25 fps
+const uint8_t ANIM_MAX = 4;
+const uint8_t ANIM_TEXT_SIZE = 48;
+const uint8_t ANIM_MARQUEE_GAP = 24;        // pixels between the end of the text and its next pass
+const uint8_t ANIM_MARQUEE_HOLD = 25;       // steps to wait before scrolling starts
+const uint8_t ANIM_FLASH_STEPS = 3;
+
+enum AnimType : uint8_t {ANIM_NONE,ANIM_MARQUEE,ANIM_FADE,ANIM_SLIDE,ANIM_FLASH};
+
+typedef struct {
+  AnimType type = ANIM_NONE;
+  int16_t x, y, w, h;             // the window
+  char text[ANIM_TEXT_SIZE];
+  uint8_t font;
+  uint16_t fg, bg;
+  uint16_t from;                  // fade start colour
+  int16_t textWidth;
+  uint32_t step;                  // steps since the start
+  bool started;                   // first frame is on screen
+  uint32_t steps;                 // length, 0 runs until stopped
+  void (*onFirstFrame)();
+} Animation;
+
+typedef struct {
+  uint32_t frames = 0;
+  uint32_t skipped = 0;           // steps dropped because a frame came late
+  uint32_t maxLateMs = 0;
+  uint64_t totalRenderUs = 0;
+  uint32_t maxRenderUs = 0;
+} AnimStats;
+
+void animBegin(TFT_eSPI* tft, const uint8_t task);
+void animRun();
+
+int8_t animMarquee(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const char* text, const uint8_t font,
+                   const uint16_t fg, const uint16_t bg);
+int8_t animFade(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const char* text, const uint8_t font,
+                const uint16_t from, const uint16_t to, const uint16_t bg, const uint32_t durationMs);
+int8_t animSlide(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const char* text, const uint8_t font,
+                 const uint16_t fg, const uint16_t bg, const uint32_t durationMs);
+int8_t animFlash(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const char* text, const uint8_t font,
+                 const uint16_t fg, const uint16_t bg, const uint32_t durationMs, void (*onFirstFrame)());
+
+void animStop(const int8_t id);
+void animStopAll();
+bool animActive();
+const AnimStats& animStats();
+void animPrintStats();
+
+#endif
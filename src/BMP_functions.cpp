@@ -2,8 +2,11 @@
 
 // Bodmers BMP image rendering function
 #include "BMP_functions.h"
+#include "Debug.h"
 
-bool drawBmp(TFT_eSPI* tft, const char *filename, int16_t x, int16_t y) {
+// the screen or a sprite
+template <typename Target>
+bool drawBmpTo(Target* tft, const char *filename, int16_t x, int16_t y) {
 
   if ((x >= tft->width()) || (y >= tft->height())) return false;
 
@@ -13,8 +16,7 @@ bool drawBmp(TFT_eSPI* tft, const char *filename, int16_t x, int16_t y) {
 
   if (!bmpFS)
   {
-    Serial.print("File not found: ");
-    Serial.println(filename);
+    dPrintf(F("File not found: %s\n"),filename);
     return false;
   }
 
@@ -64,13 +66,21 @@ bool drawBmp(TFT_eSPI* tft, const char *filename, int16_t x, int16_t y) {
       //Serial.print("Loaded in "); Serial.print(millis() - startTime);
       //Serial.println(" ms");
     }
-    else Serial.println("BMP format not recognized.");
+    else dPrintln(F("BMP format not recognized."));
   }
   bmpFS.close();
 
   return true;
 }
 
+bool drawBmp(TFT_eSPI* tft, const char *filename, int16_t x, int16_t y) {
+  return drawBmpTo(tft,filename,x,y);
+}
+
+bool drawBmp(TFT_eSprite* sprite, const char *filename, int16_t x, int16_t y) {
+  return drawBmpTo(sprite,filename,x,y);
+}
+
 // These read 16- and 32-bit types from the SD card file.
 // BMP data is stored little-endian, Arduino is little-endian too.
 // May need to reverse subscript order if porting elsewhere.
@@ -6,6 +6,7 @@
 #include <LittleFS.h>
 
 bool drawBmp(TFT_eSPI* tft, const char *filename, int16_t x, int16_t y);
+bool drawBmp(TFT_eSprite* sprite, const char *filename, int16_t x, int16_t y);    // pushImage isn't virtual
 uint16_t read16(fs::File &f);
 uint32_t read32(fs::File &f);
 
@@ -0,0 +1,75 @@
+#include <LittleFS.h>
+#include "Bench.h"
+#include "Clock.h"
+#include "Debug.h"
+
+typedef struct {
+  const char* name;
+  BenchCase run;
+  uint16_t iterations;
+} BenchEntry;
+
+BenchEntry benchCases[BENCH_MAX_CASES];
+uint8_t numBenchCases = 0;
+uint64_t benchStartUs = 0;
+uint64_t benchElapsedUs = 0;
+
+bool benchAdd(const char* name, BenchCase run, const uint16_t iterations) {
+  if (numBenchCases >= BENCH_MAX_CASES) {
+    return false;
+  }
+  benchCases[numBenchCases++] = {name,run,iterations};
+  return true;
+}
+
+void benchStart() {
+  benchStartUs = clockMicros();
+}
+
+void benchStop() {
+  benchElapsedUs += clockMicros() - benchStartUs;
+}
+
+bool benchLoad(const char* path, String& text) {
+  fs::File file = LittleFS.open(path,"r");
+  if (!file) {
+    return false;
+  }
+  text.reserve(file.size());
+  text = file.readString();
+  file.close();
+  return text.length() > 0;
+}
+
+void benchRun(const char* prefix) {
+  uint8_t ran = 0;
+  dPrintf(F("BENCH,case,iterations,best_ns,mean_ns\n"));
+  for (uint8_t i = 0; i < numBenchCases; i++) {
+    BenchEntry& entry = benchCases[i];
+    if (strncmp(entry.name,prefix,strlen(prefix)) != 0) {
+      continue;
+    }
+
+    uint64_t bestUs = UINT64_MAX;
+    uint64_t totalUs = 0;
+    bool ok = true;
+    for (uint8_t run = 0; ok && (run < BENCH_RUNS); run++) {
+      benchElapsedUs = 0;
+      logMute(true);
+      ok = entry.run(entry.iterations);
+      logMute(false);
+      bestUs = min(bestUs,benchElapsedUs);
+      totalUs += benchElapsedUs;
+      yield();
+    }
+    if (!ok) {
+      dPrintf(F("# %s: can't run, fixture or memory missing\n"),entry.name);
+      continue;
+    }
+
+    dPrintf(F("BENCH,%s,%d,%d,%d\n"),entry.name,entry.iterations,(uint32_t)(bestUs * 1000 / entry.iterations),
+            (uint32_t)(totalUs * 1000 / ((uint32_t)entry.iterations * BENCH_RUNS)));
+    ran++;
+  }
+  dPrintf(F("# %d cases\n"),ran);
+}
@@ -0,0 +1,37 @@
+#ifndef BENCH
+#define BENCH
+
+#include <Arduino.h>
+
+/*  Microbenchmarks of the parse, render and layout hot paths, run on the
+    board itself from the serial console ("bench [name prefix]"). A case does
+    its own setup (usually loading a fixture from /bench/ on LittleFS). Then
+    it runs its step "iterations" times between benchStart() and benchStop().
+    Every case is run BENCH_RUNS times. One line per case:
+      BENCH,<name>,<iterations>,<best ns per step>,<mean ns per step>
+    A case that can't run (fixture missing, no memory) prints a comment line
+    and no BENCH line.
+
+    Logging is muted while a case runs. Cases that log pay for making the
+    record, which is then dropped (LogBuffer.h).
+
+    tools/bench_compare.py checks a captured log against the stored baseline
+    and exits non zero when a case got slower than its threshold, or has no
+    recorded time. The pure cases (parseDateTime, gameStatsChanged,
+    copyGameData, scoreLayout, teamName) also run natively in test/test_bench,
+    with their own baseline, so they can be checked without a board.
+*/
+
+const uint8_t BENCH_MAX_CASES = 24;
+const uint8_t BENCH_RUNS = 5;
+
+typedef bool (*BenchCase)(const uint16_t iterations);    // false if it can't run
+
+bool benchAdd(const char* name, BenchCase run, const uint16_t iterations);
+void benchStart();
+void benchStop();
+void benchRun(const char* prefix);
+
+bool benchLoad(const char* path, String& text);     // a whole fixture file
+
+#endif
@@ -0,0 +1,15 @@
+#include "Clock.h"
+
+uint64_t clockOffsetUs = 0;    // time the system timer missed, added by clockAdvanceUs
+
+uint64_t clockMicros() {
+  return micros64() + clockOffsetUs;
+}
+
+uint64_t clockMillis() {
+  return clockMicros() / 1000;
+}
+
+void clockAdvanceUs(const uint64_t us) {
+  clockOffsetUs += us;
+}
@@ -0,0 +1,19 @@
+#ifndef MONOTONIC_CLOCK
+#define MONOTONIC_CLOCK
+
+#include <Arduino.h>
+
+/*  Monotonic clock for timers and deadlines. Built on the core's 64 bit
+    micros64() plus the time the system timer stood still during light sleep
+    (see Power.cpp). At 64 bits it doesn't wrap, unlike millis() which rolls
+    over after 49.7 days, so plain comparisons and subtractions are safe.
+
+    micros64() isn't in IRAM so don't call these from an ISR. ISRs keep using
+    32 bit millis() differences which are rollover safe on their own.
+*/
+
+uint64_t clockMicros();
+uint64_t clockMillis();
+void clockAdvanceUs(const uint64_t us);
+
+#endif
@@ -0,0 +1,128 @@
+#include "Console.h"
+#include "Scheduler.h"
+#include "Debug.h"
+
+uint8_t logLevel = LOG_NORMAL;
+
+typedef struct {
+  const char* name;
+  const char* help;
+  ConsoleHandler handler;
+} ConsoleCommand;
+
+ConsoleCommand consoleCommands[CONSOLE_MAX_COMMANDS];
+uint8_t numConsoleCommands = 0;
+uint8_t consoleTaskHandle = NO_TASK;
+char consoleLine[CONSOLE_LINE_SIZE + 1];
+uint8_t consoleLength = 0;
+uint32_t consoleMinHeap = 0xFFFFFFFF;
+
+void consoleHelp(const char* args) {
+  for (uint8_t i = 0; i < numConsoleCommands; i++) {
+    dPrintf(F("  %-10s %s\n"),consoleCommands[i].name,consoleCommands[i].help);
+  }
+}
+
+void consoleHeap(const char* args) {
+  dPrintf(F("Heap free %d, fragmentation %d%%, max block %d, lowest free %d\n"),ESP.getFreeHeap(),
+          ESP.getHeapFragmentation(),ESP.getMaxFreeBlockSize(),consoleMinHeap);
+}
+
+void consoleLog(const char* args) {
+  char words[2][8] = {"",""};
+  sscanf(args,"%7s %7s",words[0],words[1]);
+  for (uint8_t i = 0; i < 2; i++) {
+    if (strcmp(words[i],"verbose") == 0) {
+      logLevel = LOG_VERBOSE;
+    }
+    else if (strcmp(words[i],"normal") == 0) {
+      logLevel = LOG_NORMAL;
+    }
+    else if (strcmp(words[i],"text") == 0) {
+      logBinary(false);
+    }
+    else if (strcmp(words[i],"binary") == 0) {
+      logBinary(true);
+    }
+    else if (words[i][0] != '\0') {
+      dPrintf(F("Unknown log setting: %s\n"),words[i]);
+    }
+  }
+  dPrintf(F("Log level: %s, output: %s%s\n"),(logLevel == LOG_VERBOSE) ? "verbose" : "normal",logIsBinary() ? "binary" : "text",
+          (LOG_COMPILE_LEVEL < LOG_VERBOSE) ? " (verbose not compiled in)" : "");
+}
+
+void consoleBegin(const uint8_t task) {
+  consoleTaskHandle = task;
+  consoleAdd("help","list commands",consoleHelp);
+  consoleAdd("heap","heap telemetry",consoleHeap);
+  consoleAdd("log","[normal|verbose] [text|binary] show or set logging",consoleLog);
+}
+
+bool consoleAdd(const char* name, const char* help, ConsoleHandler handler) {
+  if (numConsoleCommands >= CONSOLE_MAX_COMMANDS) {
+    dPrintf(F("No room for console command: %s\n"),name);
+    return false;
+  }
+  consoleCommands[numConsoleCommands++] = {name,help,handler};
+  return true;
+}
+
+// called every pass of loop(), has to stay cheap
+void consoleCheck() {
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < consoleMinHeap) {
+    consoleMinHeap = freeHeap;
+  }
+  if (Serial.available() && !taskScheduled(consoleTaskHandle)) {
+    taskWakeNow(consoleTaskHandle);
+  }
+}
+
+void consoleExecute(char* line) {
+
+  char* name = line;
+  while (*name == ' ') {
+    name++;
+  }
+  if (*name == '\0') {
+    return;
+  }
+
+  char* args = name;
+  while ((*args != ' ') && (*args != '\0')) {
+    args++;
+  }
+  if (*args != '\0') {
+    *args++ = '\0';
+    while (*args == ' ') {
+      args++;
+    }
+  }
+
+  for (uint8_t i = 0; i < numConsoleCommands; i++) {
+    if (strcmp(name,consoleCommands[i].name) == 0) {
+      consoleCommands[i].handler(args);
+      return;
+    }
+  }
+  dPrintf(F("Unknown command: %s (try help)\n"),name);
+
+}
+
+// Console task. Takes whatever has arrived and runs each complete line
+void consoleRun() {
+
+  while (Serial.available()) {
+    char c = Serial.read();
+    if ((c == '\r') || (c == '\n')) {
+      consoleLine[consoleLength] = '\0';
+      consoleLength = 0;
+      consoleExecute(consoleLine);
+    }
+    else if (consoleLength < CONSOLE_LINE_SIZE) {
+      consoleLine[consoleLength++] = c;
+    }
+  }
+
+}
@@ -0,0 +1,33 @@
+#ifndef CONSOLE
+#define CONSOLE
+
+#include <Arduino.h>
+
+/*  Line based serial console. Type a command and press enter in the monitor,
+    "help" lists what is there. Commands are added with consoleAdd() and get the
+    rest of the line after the name, with leading spaces removed.
+
+    Nothing runs while the serial port is quiet: loop() calls consoleCheck(),
+    which only wakes the console task once a character is waiting. Input that
+    arrives during forced light sleep is lost, so send a blank line first to
+    wake the device if the first command gets no answer.
+
+    Built in:
+      help                 list commands
+      heap                 free heap, fragmentation, largest block and the lowest free heap seen
+      log [normal|verbose] [text|binary]
+                           show or set logging, verbose adds the raw JSON of every query.
+                           Binary output is for tools/log_decode.py (LogBuffer.h)
+*/
+
+const uint8_t CONSOLE_LINE_SIZE = 64;
+const uint8_t CONSOLE_MAX_COMMANDS = 16;
+
+typedef void (*ConsoleHandler)(const char* args);
+
+void consoleBegin(const uint8_t task);
+bool consoleAdd(const char* name, const char* help, ConsoleHandler handler);
+void consoleCheck();
+void consoleRun();
+
+#endif
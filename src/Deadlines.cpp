@@ -0,0 +1,157 @@
+#include "Deadlines.h"
+#include "Clock.h"
+#include "Debug.h"
+
+// {connect, first byte, total} ms, at most DEADLINE_MAX_MS but for the next
+// game, which reads up to a week of schedule
+EndpointDeadlines endpointDeadlines[ENDPOINT_COUNT] = {
+  {5000,8000,30000},    // ENDPOINT_NEXT_GAME
+  {3000,4000,5000},     // ENDPOINT_CURRENT_GAME
+  {4000,5000,8000}      // ENDPOINT_SCOREBOARD
+};
+
+EndpointStats endpointCounters[ENDPOINT_COUNT];
+
+const char* const ENDPOINT_NAMES[ENDPOINT_COUNT] = {"next","game","board"};
+const char* const DEADLINE_NAMES[] = {"none","connect","first byte","total"};
+
+uint8_t deadlineBucket(const uint32_t ms) {
+  uint8_t bucket = 0;
+  while ((bucket < DEADLINE_BUCKETS - 1) && (ms > DEADLINE_BUCKET_MS[bucket])) {
+    bucket++;
+  }
+  return bucket;
+}
+
+void countBucket(uint16_t* histogram, const uint32_t ms) {
+  uint8_t bucket = deadlineBucket(ms);
+  if (histogram[bucket] < 0xFFFF) {
+    histogram[bucket]++;
+  }
+}
+
+DeadlineStream::DeadlineStream(Client& client, const Endpoint endpoint) : _client(client), _endpoint(endpoint) {
+  setTimeout(0);    // our reads do the waiting, timedRead() only tries once
+}
+
+DeadlineStream::~DeadlineStream() {
+  if (!_prepared) {
+    return;     // never sent
+  }
+  EndpointStats& stats = endpointCounters[_endpoint];
+  uint32_t elapsed = clockMillis() - _start;
+
+  stats.requests++;
+  stats.bytes += _bytes;
+  stats.stallMs += _stallMs;
+  stats.maxStallMs = max(stats.maxStallMs,_stallMs);
+  countBucket(stats.histogram,elapsed);
+
+  if (_expired != DEADLINE_NONE) {
+    stats.timeouts[_expired]++;
+    countBucket(stats.timeoutHistogram,elapsed);
+    dPrintf(F("%s request: %s deadline hit after %d ms, %d bytes, %d ms stalled\n"),ENDPOINT_NAMES[_endpoint],
+            DEADLINE_NAMES[_expired],elapsed,_bytes,_stallMs);
+  }
+}
+
+// the request starts here
+void DeadlineStream::prepare(HTTPClient& httpClient) {
+  _start = clockMillis();
+  _prepared = true;
+  httpClient.setTimeout(endpointDeadlines[_endpoint].connectMs);
+}
+
+// HTTPClient gives up on its own timeout, we only tell a slow failure from a refused one
+void DeadlineStream::responded(const int httpResult) {
+  bool timedOut = (httpResult == HTTPC_ERROR_CONNECTION_FAILED) || (httpResult == HTTPC_ERROR_READ_TIMEOUT);
+  if (timedOut && (clockMillis() - _start >= endpointDeadlines[_endpoint].connectMs)) {
+    _expired = DEADLINE_CONNECT;
+  }
+}
+
+// true once a byte is there, false at a deadline or the end of the body
+bool DeadlineStream::wait() {
+  if (_expired != DEADLINE_NONE) {
+    return false;
+  }
+  const EndpointDeadlines& deadlines = endpointDeadlines[_endpoint];
+  uint64_t waitStart = clockMillis();
+  while (true) {
+    uint64_t elapsed = clockMillis() - _start;
+    if (elapsed >= deadlines.totalMs) {
+      _expired = DEADLINE_TOTAL;
+      break;
+    }
+    if (_client.available() > 0) {
+      break;
+    }
+    if ((_bytes == 0) && (elapsed >= deadlines.firstByteMs)) {
+      _expired = DEADLINE_FIRST_BYTE;
+      break;
+    }
+    if (!_client.connected()) {
+      break;
+    }
+    delay(1);
+  }
+  _stallMs += clockMillis() - waitStart;
+  return (_expired == DEADLINE_NONE) && (_client.available() > 0);
+}
+
+int DeadlineStream::available() {
+  return (_expired == DEADLINE_NONE) ? _client.available() : 0;
+}
+
+int DeadlineStream::read() {
+  if (!wait()) {
+    return -1;
+  }
+  _bytes++;
+  return _client.read();
+}
+
+int DeadlineStream::peek() {
+  return wait() ? _client.peek() : -1;
+}
+
+const char* endpointName(const Endpoint endpoint) {
+  return ENDPOINT_NAMES[endpoint];
+}
+
+int8_t endpointFind(const char* name) {
+  for (uint8_t i = 0; i < ENDPOINT_COUNT; i++) {
+    if (strcmp(name,ENDPOINT_NAMES[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const EndpointStats& endpointStats(const Endpoint endpoint) {
+  return endpointCounters[endpoint];
+}
+
+void deadlinePrintStats() {
+  for (uint8_t i = 0; i < ENDPOINT_COUNT; i++) {
+    EndpointStats& stats = endpointCounters[i];
+    if (stats.requests == 0) {
+      continue;
+    }
+    dPrintf(F("Endpoint %s: %d requests, timeouts connect %d first byte %d total %d, %d bytes, stalled %d ms (max %d)\n"),
+            ENDPOINT_NAMES[i],stats.requests,stats.timeouts[DEADLINE_CONNECT],stats.timeouts[DEADLINE_FIRST_BYTE],
+            stats.timeouts[DEADLINE_TOTAL],stats.bytes,stats.stallMs,stats.maxStallMs);
+    for (uint8_t h = 0; h < 2; h++) {
+      uint16_t* histogram = h ? stats.timeoutHistogram : stats.histogram;
+      dPrint(h ? F("  timeouts ms:") : F("  requests ms:"));
+      for (uint8_t b = 0; b < DEADLINE_BUCKETS; b++) {
+        if (b < DEADLINE_BUCKETS - 1) {
+          dPrintf(F(" <=%d:%d"),DEADLINE_BUCKET_MS[b],histogram[b]);
+        }
+        else {
+          dPrintf(F(" more:%d\n"),histogram[b]);
+        }
+      }
+    }
+  }
+}
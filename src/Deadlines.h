@@ -0,0 +1,95 @@
+#ifndef DEADLINES
+#define DEADLINES
+
+#include <Arduino.h>
+#include <ESP8266HTTPClient.h>
+
+/*  Deadlines for the score API requests. With the default stream timeouts a
+    stalled server could hold the loop, and the buttons, for as long as it
+    kept trickling bytes. Each endpoint type gets three limits:
+      connect     TCP connect, and each wait for the response headers
+                  (HTTPClient's own timeout)
+      first byte  from the start of the request to the first body byte
+      total       from the start of the request to the last body byte
+    The body is read through a DeadlineStream in place of the WiFiClient:
+
+      DeadlineStream stream(wifiClient,ENDPOINT_SCOREBOARD);
+      stream.prepare(httpClient);           // before GET, starts the clock
+      ... httpClient.begin(wifiClient,url); httpResult = httpClient.GET(); ...
+      stream.responded(httpResult);
+      ... wifiClient.find() etc. become stream.find() etc. ...
+
+    Once a deadline passes, every read fails straight away, so find(),
+    findUntil() and deserializeJson() all return quickly.
+
+    A request runs inside its task and holds the scheduler until it's done:
+    the screen doesn't animate, and presses are only handled afterwards.
+    The polled endpoints are therefore capped at DEADLINE_MAX_MS. A slow
+    response times out and is tried again on the next poll. The next game
+    query is exempt. It runs about once per game, behind "Fetching next
+    game...", and reads days of schedule. Cutting it short would only mean
+    asking again, so it gets the time a full transfer needs. A timeout is
+    reported as an error, not as "no next game". The stream counts
+    bytes and the time spent waiting for them (stall). When it goes out of
+    scope, the request is added to its endpoint's stats. Request times and
+    the time at which timeouts hit go in two histograms, with upper bounds
+    DEADLINE_BUCKET_MS.
+*/
+
+enum Endpoint : uint8_t {ENDPOINT_NEXT_GAME,ENDPOINT_CURRENT_GAME,ENDPOINT_SCOREBOARD,ENDPOINT_COUNT};
+enum DeadlineKind : uint8_t {DEADLINE_NONE,DEADLINE_CONNECT,DEADLINE_FIRST_BYTE,DEADLINE_TOTAL};
+
+const uint16_t DEADLINE_MAX_MS = 8000;   // the longest a polled request may freeze the UI
+const uint8_t DEADLINE_BUCKETS = 8;
+const uint16_t DEADLINE_BUCKET_MS[DEADLINE_BUCKETS - 1] = {250,500,1000,2000,4000,8000,16000};   // the last is open
+
+typedef struct {
+  uint16_t connectMs;
+  uint16_t firstByteMs;
+  uint16_t totalMs;
+} EndpointDeadlines;
+
+typedef struct {
+  uint32_t requests;
+  uint32_t timeouts[4];           // by DeadlineKind, [0] unused
+  uint32_t bytes;
+  uint32_t stallMs;
+  uint32_t maxStallMs;            // in one request
+  uint16_t histogram[DEADLINE_BUCKETS];
+  uint16_t timeoutHistogram[DEADLINE_BUCKETS];
+} EndpointStats;
+
+extern EndpointDeadlines endpointDeadlines[ENDPOINT_COUNT];   // can be changed at runtime
+
+class DeadlineStream : public Stream {
+  public:
+    DeadlineStream(Client& client, const Endpoint endpoint);
+    ~DeadlineStream();
+
+    void prepare(HTTPClient& httpClient);
+    void responded(const int httpResult);
+    DeadlineKind expired() const { return _expired; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override { return _client.write(c); }
+
+  private:
+    bool wait();
+
+    Client& _client;
+    Endpoint _endpoint;
+    uint64_t _start = 0;
+    bool _prepared = false;
+    uint32_t _bytes = 0;
+    uint32_t _stallMs = 0;
+    DeadlineKind _expired = DEADLINE_NONE;
+};
+
+const char* endpointName(const Endpoint endpoint);
+int8_t endpointFind(const char* name);    // -1 if none
+const EndpointStats& endpointStats(const Endpoint endpoint);
+void deadlinePrintStats();
+
+#endif
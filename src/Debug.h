@@ -0,0 +1,32 @@
+#ifndef DEBUG_OUTPUT
+#define DEBUG_OUTPUT
+
+#include <Arduino.h>
+#include "LogBuffer.h"
+
+// every translation unit logs through the same buffer (LogBuffer.h).
+// Formats are F() strings
+#define dBegin(baud) Serial.begin(baud)
+#define dPrint(text) logWrite(LOG_LITERAL,(PGM_P)(text))
+#define dPrintln(text) logWrite(LOG_LITERAL | LOG_NEWLINE,(PGM_P)(text))
+#define dPrintf(format,...) logWrite(0,(PGM_P)(format),##__VA_ARGS__)
+
+// runtime verbosity, set from the serial console (Console.h)
+enum LogLevel : uint8_t {LOG_NORMAL,LOG_VERBOSE};
+extern uint8_t logLevel;
+
+// Verbose logging is compiled in up to LOG_COMPILE_LEVEL (0 normal, 1
+// verbose). -DLOG_COMPILE_LEVEL=0 leaves the calls and their strings out
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 1
+#endif
+
+#if LOG_COMPILE_LEVEL >= 1
+#define dVerbosef(format,...) do { if (logLevel >= LOG_VERBOSE) { dPrintf(format,##__VA_ARGS__); } } while (0)
+#define dVerboseJson(doc) do { if (logLevel >= LOG_VERBOSE) { LogPrint out; serializeJson(doc,out); out.write('\n'); } } while (0)
+#else
+#define dVerbosef(format,...) do {} while (0)
+#define dVerboseJson(doc) do {} while (0)
+#endif
+
+#endif
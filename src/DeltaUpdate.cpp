@@ -0,0 +1,192 @@
+#include <ESP8266HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <Updater.h>
+#include "DeltaUpdate.h"
+#include "TlsSessions.h"
+#include "Clock.h"
+#include "Debug.h"
+
+const uint16_t DELTA_BUFFER_SIZE = 256;
+const uint16_t DELTA_STREAM_TIMEOUT_MS = 10000;
+
+uint32_t deltaRead32(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void md5ToHex(const uint8_t* md5, char* hex) {
+  for (uint8_t i = 0; i < 16; i++) {
+    sprintf(hex + (i * 2),"%02x",md5[i]);
+  }
+}
+
+bool readPatch(Stream& stream, uint8_t* buffer, const size_t length, UpdateStats& stats) {
+  size_t got = stream.readBytes(buffer,length);
+  stats.bytesDownloaded += got;
+  return got == length;
+}
+
+// old image bytes, optionally with patch bytes added
+bool writeFromOld(uint32_t oldOffset, uint32_t length, const uint8_t* diff, uint8_t* buffer) {
+  while (length > 0) {
+    uint16_t chunk = min(length,(uint32_t)DELTA_BUFFER_SIZE);
+    if (!ESP.flashRead(oldOffset,buffer,chunk)) {
+      return false;
+    }
+    if (diff) {
+      for (uint16_t i = 0; i < chunk; i++) {
+        buffer[i] += diff[i];
+      }
+      diff += chunk;
+    }
+    if (Update.write(buffer,chunk) != chunk) {
+      return false;
+    }
+    oldOffset += chunk;
+    length -= chunk;
+  }
+  return true;
+}
+
+bool applyAdd(Stream& stream, uint32_t oldOffset, uint32_t length, UpdateStats& stats) {
+
+  uint8_t diff[DELTA_BUFFER_SIZE];
+  uint8_t buffer[DELTA_BUFFER_SIZE];
+
+  while (length > 0) {
+    uint8_t control;
+    if (!readPatch(stream,&control,1,stats)) {
+      return false;
+    }
+    uint8_t run = (control < 0x80) ? control + 1 : control - 0x7F;
+    if (run > length) {
+      return false;
+    }
+    if (control < 0x80) {
+      if (!readPatch(stream,diff,run,stats) || !writeFromOld(oldOffset,run,diff,buffer)) {
+        return false;
+      }
+    }
+    else if (!writeFromOld(oldOffset,run,nullptr,buffer)) {
+      return false;
+    }
+    oldOffset += run;
+    length -= run;
+  }
+  return true;
+}
+
+bool applyInsert(Stream& stream, uint32_t length, UpdateStats& stats) {
+  uint8_t buffer[DELTA_BUFFER_SIZE];
+  while (length > 0) {
+    uint16_t chunk = min(length,(uint32_t)DELTA_BUFFER_SIZE);
+    if (!readPatch(stream,buffer,chunk,stats) || (Update.write(buffer,chunk) != chunk)) {
+      return false;
+    }
+    length -= chunk;
+  }
+  return true;
+}
+
+DeltaResult deltaUpdate(const String& url, const char* newMD5, UpdateStats& stats, DeltaProgress onProgress) {
+
+  uint64_t startTime = clockMillis();
+  stats = UpdateStats();
+
+  HTTPClient httpClient;
+  WiFiClientSecure wificlient;
+  wificlient.setInsecure();
+
+  dPrintf(F("Delta URL: %s\n"),url.c_str());
+  TlsRequest tls = tlsBegin(wificlient,url);
+  httpClient.begin(wificlient,url);
+  int httpCode = httpClient.GET();
+  tlsEnd(tls,wificlient);
+  if (httpCode != 200) {
+    dPrintf(F("No delta available (HTTP %d)\n"),httpCode);
+    httpClient.end();
+    return DELTA_NOT_AVAILABLE;
+  }
+
+  int patchSize = httpClient.getSize();
+  Stream& stream = httpClient.getStream();
+  stream.setTimeout(DELTA_STREAM_TIMEOUT_MS);
+
+  uint8_t header[4 + 4 + 4 + 16 + 16];
+  if (!readPatch(stream,header,sizeof(header),stats) || (deltaRead32(header) != DELTA_MAGIC)) {
+    dPrintf(F("Bad delta header\n"));
+    httpClient.end();
+    return DELTA_NOT_AVAILABLE;
+  }
+
+  uint32_t oldSize = deltaRead32(header + 4);
+  uint32_t newSize = deltaRead32(header + 8);
+  char oldMD5[33];
+  char patchMD5[33];
+  md5ToHex(header + 12,oldMD5);
+  md5ToHex(header + 28,patchMD5);
+
+  if ((oldSize != ESP.getSketchSize()) || (ESP.getSketchMD5() != oldMD5)) {
+    dPrintf(F("Delta is for another build: %s\n"),oldMD5);
+    httpClient.end();
+    return DELTA_NOT_AVAILABLE;
+  }
+
+  // the patch can say anything, only the manifest is signed
+  if (strcmp(patchMD5,newMD5) != 0) {
+    dPrintf(F("Delta builds %s, the manifest has %s\n"),patchMD5,newMD5);
+    httpClient.end();
+    return DELTA_NOT_AVAILABLE;
+  }
+
+  if (!Update.begin(newSize,U_FLASH)) {
+    dPrintf(F("Update.begin failed: %d\n"),Update.getError());
+    httpClient.end();
+    return DELTA_FAILED;
+  }
+  Update.setMD5(newMD5);
+
+  bool ok = true;
+  bool done = false;
+  uint8_t op[9];
+  uint8_t buffer[DELTA_BUFFER_SIZE];
+  while (ok && !done) {
+    if (!readPatch(stream,op,1,stats)) {
+      ok = false;
+      break;
+    }
+    switch (op[0]) {
+      case DELTA_COPY:
+        ok = readPatch(stream,op + 1,8,stats) && writeFromOld(deltaRead32(op + 1),deltaRead32(op + 5),nullptr,buffer);
+        break;
+      case DELTA_ADD:
+        ok = readPatch(stream,op + 1,8,stats) && applyAdd(stream,deltaRead32(op + 1),deltaRead32(op + 5),stats);
+        break;
+      case DELTA_INSERT:
+        ok = readPatch(stream,op + 1,4,stats) && applyInsert(stream,deltaRead32(op + 1),stats);
+        break;
+      case DELTA_END:
+        done = true;
+        break;
+      default:
+        dPrintf(F("Bad delta op: %d\n"),op[0]);
+        ok = false;
+    }
+    if (onProgress && (patchSize > 0)) {
+      onProgress(stats.bytesDownloaded,patchSize);
+    }
+  }
+  httpClient.end();
+
+  stats.imageSize = newSize;
+  stats.elapsedMs = clockMillis() - startTime;
+
+  // end() checks the size and MD5 and only then arms the new image. A short
+  // patch fails here too, which also resets Update for the full image fallback
+  if (!Update.end()) {
+    dPrintf(F("Delta update failed (patch %s, error %d)\n"),ok ? "complete" : "broken",Update.getError());
+    return DELTA_FAILED;
+  }
+
+  dPrintf(F("Delta update OK: %d bytes downloaded for a %d byte image in %d ms\n"),stats.bytesDownloaded,stats.imageSize,stats.elapsedMs);
+  return DELTA_OK;
+}
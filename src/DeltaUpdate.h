@@ -0,0 +1,42 @@
+#ifndef DELTA_UPDATE
+#define DELTA_UPDATE
+
+#include <Arduino.h>
+
+/*  Binary delta firmware updates. Instead of the whole image the server has a
+    patch from the running build to the new one (tools/fw_delta.py makes them).
+    The patch is streamed in and applied against the current image in flash,
+    the result goes to the OTA area through Update like a normal image.
+
+    Patch format, all numbers little endian:
+      header:  "TFTD" u32 oldSize u32 newSize u8[16] oldMD5 u8[16] newMD5
+      ops:     0x01 COPY   u32 oldOffset u32 length
+               0x02 ADD    u32 oldOffset u32 length, then runs until length
+                           bytes are produced. Run control byte c:
+                             c <  0x80: c+1 bytes follow, each added to old
+                             c >= 0x80: c-0x7F bytes unchanged from old
+               0x03 INSERT u32 length, then length literal bytes
+               0x00 END
+
+    The old image has to match oldSize/oldMD5 exactly. newMD5 has to be the
+    one in the signed manifest, Update.end() checks the new image against it.
+    Anything else means use the full image.
+*/
+
+const uint32_t DELTA_MAGIC = 0x44544654;     // "TFTD"
+
+enum DeltaOp {DELTA_END = 0x00, DELTA_COPY = 0x01, DELTA_ADD = 0x02, DELTA_INSERT = 0x03};
+enum DeltaResult {DELTA_OK,DELTA_NOT_AVAILABLE,DELTA_FAILED};
+
+typedef struct {
+  uint32_t bytesDownloaded = 0;
+  uint32_t imageSize = 0;
+  uint32_t elapsedMs = 0;
+  uint16_t retries = 0;
+} UpdateStats;
+
+typedef void (*DeltaProgress)(uint32_t done, uint32_t total);
+
+DeltaResult deltaUpdate(const String& url, const char* newMD5, UpdateStats& stats, DeltaProgress onProgress);
+
+#endif
@@ -0,0 +1,297 @@
+#include <WiFiUdp.h>
+#include "DnsCache.h"
+#include "Scheduler.h"
+#include "Power.h"
+#include "Clock.h"
+#include "Debug.h"
+
+typedef struct {
+  char host[TLS_HOST_LENGTH];
+  IPAddress ip;
+  bool known = false;         // ip holds an address, maybe expired
+  uint64_t expires = 0;       // clockMillis
+  uint64_t lastUsed = 0;
+  uint16_t queryID = 0;       // of the query in flight, 0 for none
+  uint64_t querySent = 0;
+} DnsEntry;
+
+WiFiUDP dnsUdp;
+uint8_t dnsTaskHandle = NO_TASK;
+bool dnsStarted = false;
+bool dnsPending = false;      // parsePacket already took a reply
+DnsEntry dnsEntries[DNS_CACHE_SIZE];
+uint8_t dnsPacket[DNS_PACKET_SIZE];
+DnsStats dnsCounters;
+
+void dnsBegin(const uint8_t task) {
+  dnsTaskHandle = task;
+}
+
+bool dnsStart() {
+  if (!dnsStarted && (WiFi.status() == WL_CONNECTED)) {
+    dnsStarted = dnsUdp.begin(DNS_LOCAL_PORT);
+  }
+  return dnsStarted;
+}
+
+// called every pass of loop(), has to stay cheap
+void dnsCheck() {
+  if (dnsStarted && !dnsPending && (dnsUdp.parsePacket() > 0)) {
+    dnsPending = true;
+    taskWakeNow(dnsTaskHandle);
+  }
+}
+
+int8_t dnsFind(const char* host) {
+  for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+    if (strcmp(dnsEntries[i].host,host) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// a new host takes the entry used longest ago
+DnsEntry& dnsEntry(const char* host) {
+  int8_t index = dnsFind(host);
+  if (index >= 0) {
+    return dnsEntries[index];
+  }
+  index = 0;
+  for (uint8_t i = 1; i < DNS_CACHE_SIZE; i++) {
+    if (dnsEntries[i].lastUsed < dnsEntries[index].lastUsed) {
+      index = i;
+    }
+  }
+  dnsEntries[index] = DnsEntry();
+  strlcpy(dnsEntries[index].host,host,sizeof(dnsEntries[index].host));
+  return dnsEntries[index];
+}
+
+// A query for an A record, recursion desired
+bool dnsSend(DnsEntry& entry) {
+  if (!dnsStart()) {
+    return false;
+  }
+  uint16_t id = random(1,0x10000);
+  uint16_t size = 0;
+  const uint8_t header[12] = {(uint8_t)(id >> 8),(uint8_t)id,0x01,0x00,0,1,0,0,0,0,0,0};
+  memcpy(dnsPacket,header,sizeof(header));
+  size = sizeof(header);
+
+  const char* label = entry.host;
+  while (*label) {
+    const char* dot = strchr(label,'.');
+    uint8_t length = dot ? dot - label : strlen(label);
+    if ((length == 0) || (length > 63) || (size + length + 6 > DNS_PACKET_SIZE)) {
+      return false;
+    }
+    dnsPacket[size++] = length;
+    memcpy(dnsPacket + size,label,length);
+    size += length;
+    label += length + (dot ? 1 : 0);
+  }
+  const uint8_t question[5] = {0,0,1,0,1};     // end of name, type A, class IN
+  memcpy(dnsPacket + size,question,sizeof(question));
+  size += sizeof(question);
+
+  dnsUdp.beginPacket(WiFi.dnsIP(0),DNS_PORT);
+  dnsUdp.write(dnsPacket,size);
+  if (!dnsUdp.endPacket()) {
+    return false;
+  }
+  entry.queryID = id;
+  entry.querySent = clockMillis();
+  return true;
+}
+
+// past a name at pos, labels or a compression pointer. 0 if it runs off the end
+uint16_t dnsSkipName(const uint16_t size, uint16_t pos) {
+  while (pos < size) {
+    uint8_t length = dnsPacket[pos];
+    if (length == 0) {
+      return pos + 1;
+    }
+    if ((length & 0xC0) == 0xC0) {
+      return pos + 2;
+    }
+    pos += length + 1;
+  }
+  return 0;
+}
+
+uint32_t dnsRead32(const uint16_t pos) {
+  return ((uint32_t)dnsPacket[pos] << 24) | ((uint32_t)dnsPacket[pos + 1] << 16) | (dnsPacket[pos + 2] << 8) | dnsPacket[pos + 3];
+}
+
+// Takes the reply parsePacket found. Returns the entry it answered, -1 if none.
+// The TTL is the lowest along the CNAME chain
+int8_t dnsReceive() {
+  dnsPending = false;
+  int size = dnsUdp.read(dnsPacket,sizeof(dnsPacket));
+  if ((size < 12) || ((dnsPacket[2] & 0x80) == 0)) {
+    return -1;
+  }
+  uint16_t id = (dnsPacket[0] << 8) | dnsPacket[1];
+  int8_t index = -1;
+  for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+    if ((dnsEntries[i].queryID != 0) && (dnsEntries[i].queryID == id)) {
+      index = i;
+    }
+  }
+  if (index < 0) {
+    return -1;
+  }
+  DnsEntry& entry = dnsEntries[index];
+  entry.queryID = 0;
+  if ((dnsPacket[3] & 0x0F) != 0) {
+    dPrintf(F("DNS %s: error %d\n"),entry.host,dnsPacket[3] & 0x0F);
+    return -1;
+  }
+
+  uint16_t answers = (dnsPacket[6] << 8) | dnsPacket[7];
+  uint16_t pos = dnsSkipName(size,12) + 4;
+  uint32_t ttl = DNS_MAX_TTL_S;
+  for (uint16_t i = 0; (i < answers) && (pos > 4); i++) {
+    pos = dnsSkipName(size,pos);
+    if ((pos == 0) || (pos + 10 > size)) {
+      break;
+    }
+    uint16_t type = (dnsPacket[pos] << 8) | dnsPacket[pos + 1];
+    ttl = min(ttl,dnsRead32(pos + 4));
+    uint16_t length = (dnsPacket[pos + 8] << 8) | dnsPacket[pos + 9];
+    pos += 10;
+    if ((type == 1) && (length == 4) && (pos + 4 <= size)) {
+      ttl = constrain(ttl,DNS_MIN_TTL_S,DNS_MAX_TTL_S);
+      entry.ip = IPAddress(dnsPacket[pos],dnsPacket[pos + 1],dnsPacket[pos + 2],dnsPacket[pos + 3]);
+      entry.known = true;
+      entry.expires = clockMillis() + ttl * 1000;
+      return index;
+    }
+    pos += length;
+  }
+  dPrintf(F("DNS %s: no address in the reply\n"),entry.host);
+  return -1;
+}
+
+bool dnsLookup(const char* host, IPAddress& ip) {
+  dnsCounters.lookups++;
+  if (ip.fromString(host)) {
+    return true;
+  }
+
+  DnsEntry& entry = dnsEntry(host);
+  uint64_t now = clockMillis();
+  entry.lastUsed = now;
+  if (entry.known && (now < entry.expires)) {
+    dnsCounters.hits++;
+    ip = entry.ip;
+    if (!taskScheduled(dnsTaskHandle)) {
+      taskWakeNow(dnsTaskHandle);     // refreshes stopped while light sleep was allowed
+    }
+    return true;
+  }
+
+  // wait for our own answer, others that come in meanwhile are kept too
+  bool answered = false;
+  uint64_t start = clockMicros();
+  if (dnsSend(entry)) {
+    while (!answered && (clockMillis() - entry.querySent < DNS_QUERY_TIMEOUT_MS)) {
+      if (dnsPending || (dnsUdp.parsePacket() > 0)) {
+        int8_t index = dnsReceive();
+        answered = (index == (&entry - dnsEntries));
+        dnsCounters.refreshes += (index >= 0) && !answered;
+      }
+      else {
+        delay(1);
+      }
+    }
+    entry.queryID = 0;
+  }
+  if (answered) {
+    dnsCounters.queries++;
+    dnsCounters.queryMs += (clockMicros() - start) / 1000;
+    ip = entry.ip;
+    taskWakeNow(dnsTaskHandle);     // plan its refresh
+    return true;
+  }
+
+  if (entry.known) {
+    dnsCounters.fallbacks++;
+    dPrintf(F("DNS %s: lookup failed, using the last known address\n"),host);
+    ip = entry.ip;
+    return true;
+  }
+  if (WiFi.hostByName(host,ip)) {
+    entry.ip = ip;
+    entry.known = true;
+    entry.expires = clockMillis() + DNS_MIN_TTL_S * 1000;
+    return true;
+  }
+  dnsCounters.failures++;
+  return false;
+}
+
+// DNS task. Takes replies to background refreshes and sends the ones due
+void dnsRun() {
+  if (dnsPending && (dnsReceive() >= 0)) {
+    dnsCounters.refreshes++;
+  }
+
+  // Between games the next lookup can be an hour away and light sleep needs
+  // WiFi off that long. Replies to refreshes in flight are dropped
+  if (powerLightSleepAllowed()) {
+    for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+      dnsEntries[i].queryID = 0;
+    }
+    return;
+  }
+
+  uint64_t now = clockMillis();
+  uint64_t wake = now + DNS_KEEP_WARM_MS;
+  for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+    DnsEntry& entry = dnsEntries[i];
+    if (!entry.known || (now - entry.lastUsed > DNS_KEEP_WARM_MS)) {
+      continue;
+    }
+    if ((entry.queryID != 0) && (now - entry.querySent >= DNS_QUERY_TIMEOUT_MS)) {
+      dPrintf(F("DNS %s: refresh timed out\n"),entry.host);
+      entry.queryID = 0;
+      entry.expires = now + DNS_MIN_TTL_S * 1000;     // keep the old address, try again later
+    }
+    uint64_t due = entry.expires - DNS_REFRESH_AHEAD_MS;
+    if (entry.queryID != 0) {
+      due = entry.querySent + DNS_QUERY_TIMEOUT_MS;
+    }
+    else if (now >= due) {
+      dnsSend(entry);
+      due = now + DNS_QUERY_TIMEOUT_MS;
+    }
+    wake = min(wake,due);
+  }
+  taskWakeIn(dnsTaskHandle,wake - now);
+}
+
+const DnsStats& dnsStats() {
+  return dnsCounters;
+}
+
+void dnsPrintStats() {
+  if (dnsCounters.lookups == 0) {
+    return;
+  }
+  uint32_t avgMs = dnsCounters.queries ? dnsCounters.queryMs / dnsCounters.queries : 0;
+  uint32_t savedMs = dnsCounters.hits * avgMs;
+  dPrintf(F("DNS: %d lookups, %d hits, %d queried (avg %d ms), %d refreshed in the background, %d fallbacks, %d failed\n"),
+          dnsCounters.lookups,dnsCounters.hits,dnsCounters.queries,avgMs,dnsCounters.refreshes,dnsCounters.fallbacks,
+          dnsCounters.failures);
+  dPrintf(F("DNS saved ~%d ms, %d ms per lookup\n"),savedMs,savedMs / dnsCounters.lookups);
+}
+
+int DnsCachedClient::connect(const char* host, uint16_t port) {
+  IPAddress ip;
+  if (!dnsLookup(host,ip)) {
+    return 0;
+  }
+  return WiFiClient::connect(ip,port);
+}
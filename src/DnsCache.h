@@ -0,0 +1,65 @@
+#ifndef DNS_CACHE
+#define DNS_CACHE
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include "TlsSessions.h"
+
+/*  Addresses of the score API hosts. Every query used to look its host up
+    again, because each one uses a new WiFiClient. DnsCachedClient is a
+    WiFiClient that connects through this cache instead.
+
+    The cache asks the DHCP-supplied DNS server directly over UDP, so it
+    knows each answer's TTL (lwIP doesn't pass that on). The TTL is clamped
+    to DNS_MIN_TTL_S..DNS_MAX_TTL_S. A host looked up within the last
+    DNS_KEEP_WARM_MS is refreshed by the dns task DNS_REFRESH_AHEAD_MS
+    before it expires, so polls don't wait for DNS. That's only worth it
+    while polls are frequent: while light sleep is allowed (no live game)
+    the task stops refreshing, so it doesn't keep waking WiFi. The next
+    lookup starts it again. If a lookup fails, the
+    last known address is used. With no address at all, it falls back to
+    WiFi.hostByName().
+
+    dnsCheck() is called from loop() and wakes the task when a reply is in.
+    Hits are credited with the average time of a real lookup, which gives
+    the DNS time saved.
+
+    TLS connections (firmware and file updates) still resolve through lwIP.
+    Connecting those by address would lose the SNI hostname.
+*/
+
+const uint8_t DNS_CACHE_SIZE = 6;
+const uint16_t DNS_PORT = 53;
+const uint16_t DNS_LOCAL_PORT = 4211;
+const uint16_t DNS_PACKET_SIZE = 512;
+const uint16_t DNS_QUERY_TIMEOUT_MS = 2000;
+const uint32_t DNS_MIN_TTL_S = 30;
+const uint32_t DNS_MAX_TTL_S = 60 * 60;
+const uint32_t DNS_REFRESH_AHEAD_MS = 10 * 1000;
+const uint32_t DNS_KEEP_WARM_MS = 15 * 60 * 1000;
+
+typedef struct {
+  uint32_t lookups;
+  uint32_t hits;
+  uint32_t queries;           // answered lookups while a caller waited
+  uint64_t queryMs;           // total time of those
+  uint32_t refreshes;         // answered in the background
+  uint32_t fallbacks;         // last known address used after a failure
+  uint32_t failures;          // nothing to use at all
+} DnsStats;
+
+class DnsCachedClient : public WiFiClient {
+  public:
+    using WiFiClient::connect;
+    int connect(const char* host, uint16_t port) override;
+};
+
+void dnsBegin(const uint8_t task);
+void dnsCheck();
+void dnsRun();
+
+bool dnsLookup(const char* host, IPAddress& ip);
+const DnsStats& dnsStats();
+void dnsPrintStats();
+
+#endif
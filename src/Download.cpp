@@ -0,0 +1,272 @@
+#include <ESP8266HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <LittleFS.h>
+#include <Updater.h>
+#include <flash_hal.h>
+#include "Download.h"
+#include "TlsSessions.h"
+#include "Clock.h"
+#include "Debug.h"
+
+const uint32_t DOWNLOAD_PROGRESS_MAGIC = 0x444C5032;    // "DLP2"
+
+typedef struct {
+  uint32_t magic = DOWNLOAD_PROGRESS_MAGIC;
+  uint32_t version = 0;
+  uint32_t size = 0;
+  uint8_t sha256[32];
+  uint32_t verified = 0;       // bytes, always a whole number of chunks
+  uint8_t header[4];           // first bytes of the image, see downloadStart()
+} DownloadRecord;
+
+uint8_t downloadHeader[4];
+BearSSL::HashSHA256 downloadHash;      // of everything handed to Update so far
+
+uint32_t roundToSector(const uint32_t size) {
+  return (size + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
+}
+
+// where Update puts the image, 0 if it doesn't fit. Worked out the same way
+// Update does it, so what it wrote in an earlier attempt can be read back
+uint32_t targetAddress(const DownloadTarget target, const uint32_t size) {
+  if (target == DOWNLOAD_FILESYSTEM) {
+    return (size <= FS_PHYS_SIZE) ? FS_PHYS_ADDR : 0;
+  }
+  uint32_t end = FS_PHYS_ADDR;
+  uint32_t start = (end > roundToSector(size)) ? end - roundToSector(size) : 0;
+  return (start >= roundToSector(ESP.getSketchSize())) ? start : 0;
+}
+
+uint32_t loadProgress(const ManifestEntry& entry) {
+  DownloadRecord record;
+  fs::File file = LittleFS.open(DOWNLOAD_PROGRESS_FILE,"r");
+  if (!file) {
+    return 0;
+  }
+  bool valid = (file.read((uint8_t*)&record,sizeof(record)) == sizeof(record)) && (record.magic == DOWNLOAD_PROGRESS_MAGIC)
+                && (record.version == entry.version) && (record.size == entry.size) && (memcmp(record.sha256,entry.sha256,sizeof(record.sha256)) == 0)
+                && (record.verified % entry.chunkSize == 0) && (record.verified < entry.size);
+  file.close();
+  if (!valid) {
+    return 0;
+  }
+  memcpy(downloadHeader,record.header,sizeof(downloadHeader));
+  return record.verified;
+}
+
+void saveProgress(const ManifestEntry& entry, const uint32_t verified) {
+  DownloadRecord record;
+  record.version = entry.version;
+  record.size = entry.size;
+  memcpy(record.sha256,entry.sha256,sizeof(record.sha256));
+  record.verified = verified;
+  memcpy(record.header,downloadHeader,sizeof(record.header));
+  fs::File file = LittleFS.open(DOWNLOAD_PROGRESS_FILE,"w");
+  if (file) {
+    file.write((const uint8_t*)&record,sizeof(record));
+    file.close();
+  }
+}
+
+// (Re)starts Update and hands it the first verified bytes again, read back
+// from where it wrote them before. Update may have set the flash mode byte in
+// its copy of the image header, so the header as downloaded goes back in
+bool downloadStart(const ManifestEntry& entry, const DownloadTarget target, const uint32_t address, const uint32_t verified, uint8_t* buffer) {
+
+  if (Update.isRunning()) {
+    Update.end();     // not finished, so this only resets it
+  }
+  if (!Update.begin(entry.size,(target == DOWNLOAD_FIRMWARE) ? U_FLASH : U_FS)) {
+    dPrintf(F("Update.begin failed: %d\n"),Update.getError());
+    return false;
+  }
+  Update.setMD5(entry.md5);
+  downloadHash.begin();
+
+  for (uint32_t done = 0; done < verified; done += FLASH_SECTOR_SIZE) {
+    if (!ESP.flashRead(address + done,(uint32_t*)buffer,FLASH_SECTOR_SIZE)) {
+      dPrintf(F("Flash read failed at 0x%06x\n"),address + done);
+      return false;
+    }
+    if (done == 0) {
+      memcpy(buffer,downloadHeader,sizeof(downloadHeader));
+    }
+    downloadHash.add(buffer,FLASH_SECTOR_SIZE);
+    if (Update.write(buffer,FLASH_SECTOR_SIZE) != FLASH_SECTOR_SIZE) {
+      dPrintf(F("Update write failed: %d\n"),Update.getError());
+      return false;
+    }
+  }
+  return true;
+}
+
+// one Range request for one chunk, handed to Update a sector at a time. The
+// last piece of the image is kept back in buffer, downloadImage() writes it
+// once the whole image has checked out
+bool fetchChunk(HTTPClient& httpClient, WiFiClientSecure& wificlient, const String& url, const ManifestEntry& entry,
+                const uint8_t chunk, uint8_t* buffer, UpdateStats& stats) {
+
+  uint32_t start = chunk * entry.chunkSize;
+  uint32_t length = min(entry.chunkSize,entry.size - start);
+
+  char range[32];
+  snprintf(range,sizeof(range),"bytes=%u-%u",start,start + length - 1);
+
+  TlsRequest tls = tlsBegin(wificlient,url);
+  httpClient.begin(wificlient,url);
+  httpClient.addHeader(F("Range"),range);
+  int httpCode = httpClient.GET();
+  tlsEnd(tls,wificlient);
+
+  bool wholeFile = (httpCode == 200) && (start == 0) && (length == entry.size);
+  if ((httpCode != 206) && !wholeFile) {
+    dPrintf(F("Chunk %d HTTP Error: %d\n"),chunk,httpCode);
+    httpClient.end();
+    return false;
+  }
+
+  Stream& stream = httpClient.getStream();
+  stream.setTimeout(DOWNLOAD_STREAM_TIMEOUT_MS);
+
+  BearSSL::HashSHA256 hash;
+  hash.begin();
+
+  uint32_t done = 0;
+  while (done < length) {
+    uint32_t piece = min(length - done,(uint32_t)FLASH_SECTOR_SIZE);
+    uint32_t got = stream.readBytes(buffer,piece);
+    stats.bytesDownloaded += got;
+    if (got != piece) {
+      dPrintf(F("Chunk %d dropped at %d of %d bytes\n"),chunk,done + got,length);
+      httpClient.end();
+      return false;
+    }
+    hash.add(buffer,piece);
+    downloadHash.add(buffer,piece);
+    if (start + done == 0) {
+      memcpy(downloadHeader,buffer,sizeof(downloadHeader));
+    }
+    done += piece;
+    if ((start + done < entry.size) && (Update.write(buffer,piece) != piece)) {
+      dPrintf(F("Update write failed: %d\n"),Update.getError());
+      httpClient.end();
+      return false;
+    }
+  }
+  httpClient.end();
+  hash.end();
+
+  if (memcmp(hash.hash(),entry.chunks[chunk],MANIFEST_CHUNK_HASH_SIZE) != 0) {
+    dPrintf(F("Chunk %d hash mismatch\n"),chunk);
+    return false;
+  }
+  return true;
+}
+
+bool downloadImage(const String& url, const ManifestEntry& entry, const DownloadTarget target, DownloadProgress onProgress, UpdateStats& stats) {
+
+  uint64_t startTime = clockMillis();
+  stats = UpdateStats();
+  stats.imageSize = entry.size;
+
+  uint32_t address = targetAddress(target,entry.size);
+  if (address == 0) {
+    dPrintf(F("No room for a %d byte image\n"),entry.size);
+    return false;
+  }
+
+  uint32_t verified = (target == DOWNLOAD_FIRMWARE) ? loadProgress(entry) : 0;
+  if (verified > 0) {
+    dPrintf(F("Resuming download at %d of %d bytes\n"),verified,entry.size);
+  }
+
+  uint8_t* buffer = (uint8_t*)malloc(FLASH_SECTOR_SIZE);
+  if (!buffer) {
+    dPrint(F("No memory for download buffer\n"));
+    return false;
+  }
+
+  // the image goes over the filesystem, nothing may use it meanwhile
+  if (target == DOWNLOAD_FILESYSTEM) {
+    LittleFS.end();
+  }
+
+  HTTPClient httpClient;
+  WiFiClientSecure wificlient;
+  wificlient.setInsecure();
+  httpClient.setReuse(true);     // keep-alive between chunks
+
+  dPrintf(F("Image to install: %s at 0x%06x\n"),url.c_str(),address);
+
+  bool ok = downloadStart(entry,target,address,verified,buffer);
+  for (uint8_t chunk = verified / entry.chunkSize; ok && (chunk < entry.numChunks); chunk++) {
+    uint8_t attempt = 0;
+    uint32_t retryDelay = DOWNLOAD_RETRY_DELAY_MS;
+    while (!fetchChunk(httpClient,wificlient,url,entry,chunk,buffer,stats)) {
+      if (++attempt > DOWNLOAD_RETRIES) {
+        ok = false;
+        break;
+      }
+      stats.retries++;
+      dPrintf(F("Retrying chunk %d in %d ms\n"),chunk,retryDelay);
+      delay(retryDelay);
+      retryDelay *= 2;
+      // Update already has part of the failed chunk, go back to its start
+      if (!downloadStart(entry,target,address,chunk * entry.chunkSize,buffer)) {
+        ok = false;
+        break;
+      }
+    }
+    if (ok) {
+      verified = min((chunk + 1) * entry.chunkSize,entry.size);
+      if ((target == DOWNLOAD_FIRMWARE) && (verified < entry.size)) {
+        saveProgress(entry,verified);
+      }
+      if (onProgress) {
+        onProgress(verified,entry.size);
+      }
+    }
+  }
+
+  if (ok) {
+    downloadHash.end();
+    if (memcmp(downloadHash.hash(),entry.sha256,sizeof(entry.sha256)) != 0) {
+      dPrint(F("Image SHA-256 mismatch\n"));
+      ok = false;
+    }
+  }
+
+  // Update only gets the last piece when the whole image matched. end() checks
+  // the MD5 and, in a signed build, the image signature and only then arms the
+  // image. Without the last piece it just resets Update
+  uint32_t lastPiece = entry.size - ((entry.size - 1) & ~(FLASH_SECTOR_SIZE - 1));
+  ok = ok && (Update.write(buffer,lastPiece) == lastPiece);
+  if (!Update.end() && ok) {
+    dPrintf(F("Update.end failed: %d\n"),Update.getError());
+    ok = false;
+  }
+  free(buffer);
+
+  stats.elapsedMs = clockMillis() - startTime;
+
+  if (!ok) {
+    dPrintf(F("Image download failed after %d retries, %d of %d bytes verified\n"),stats.retries,verified,entry.size);
+    if (target == DOWNLOAD_FILESYSTEM) {
+      // part of the old filesystem is already overwritten. An empty one has
+      // no fs_ver.txt, so the next boot downloads the data files again
+      if (stats.bytesDownloaded > 0) {
+        dPrint(F("Formatting the half written filesystem\n"));
+        LittleFS.format();
+      }
+      LittleFS.begin();
+    }
+    return false;
+  }
+
+  if (target == DOWNLOAD_FIRMWARE) {
+    LittleFS.remove(DOWNLOAD_PROGRESS_FILE);
+  }
+
+  dPrintf(F("Image verified and installed: %d bytes downloaded (%d retries) in %d ms\n"),stats.bytesDownloaded,stats.retries,stats.elapsedMs);
+  return true;
+}
@@ -0,0 +1,39 @@
+#ifndef DOWNLOAD
+#define DOWNLOAD
+
+#include <Arduino.h>
+#include "UpdateManifest.h"
+#include "DeltaUpdate.h"
+
+/*  Resumable image download. The image is fetched one manifest chunk at a time
+    with HTTP Range requests and streamed into Update: firmware to the free
+    space below the filesystem, data files over the filesystem. Each chunk is
+    checked against its manifest hash before moving on. A dropped connection
+    only repeats the current chunk: Update is started again and the chunks
+    before it are read back from flash, where Update wrote them.
+
+    For firmware the number of verified bytes is kept in DOWNLOAD_PROGRESS_FILE
+    so after a restart the same version carries on where it stopped, again by
+    reading the verified chunks back into Update. The filesystem can't hold
+    its own progress while being overwritten so a data file download only
+    resumes within one attempt. It is unmounted while the image is written,
+    and formatted if the download fails half way, so the next boot finds an
+    empty filesystem rather than a broken one and downloads it again.
+
+    Update gets the last piece of the image only when the whole image matches
+    the manifest SHA-256. Update.end() then checks the MD5 and, in a signed
+    build, the image signature before new firmware is armed for eboot to copy.
+*/
+
+const char* const DOWNLOAD_PROGRESS_FILE = "/download.dat";
+const uint8_t DOWNLOAD_RETRIES = 5;              // per chunk
+const uint16_t DOWNLOAD_RETRY_DELAY_MS = 1000;   // doubled on every retry
+const uint16_t DOWNLOAD_STREAM_TIMEOUT_MS = 10000;
+
+enum DownloadTarget {DOWNLOAD_FIRMWARE,DOWNLOAD_FILESYSTEM};
+
+typedef void (*DownloadProgress)(int cur, int total);
+
+bool downloadImage(const String& url, const ManifestEntry& entry, const DownloadTarget target, DownloadProgress onProgress, UpdateStats& stats);
+
+#endif
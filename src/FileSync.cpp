@@ -0,0 +1,242 @@
+#include <ESP8266HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <LittleFS.h>
+#include <coredecls.h>
+#include "FileSync.h"
+#include "TlsSessions.h"
+#include "Clock.h"
+#include "Debug.h"
+
+const uint16_t FILE_SYNC_BUFFER_SIZE = 512;
+const uint16_t FILE_SYNC_STREAM_TIMEOUT_MS = 10000;
+
+typedef struct {
+  uint8_t sha256[32];
+  uint32_t size;
+  char path[FILE_SYNC_PATH_SIZE];
+} FileSyncLine;
+
+// "<64 hex> <size> <path>", false for anything else
+bool parseLine(const String& line, FileSyncLine& result) {
+  char hex[65];
+  if ((sscanf(line.c_str(),"%64s %u %63s",hex,&result.size,result.path) != 3) || (result.path[0] != '/')) {
+    return false;
+  }
+  for (uint8_t i = 0; i < sizeof(result.sha256); i++) {
+    char byte[3] = {hex[i * 2],hex[i * 2 + 1],'\0'};
+    char* end;
+    result.sha256[i] = strtoul(byte,&end,16);
+    if (*end != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool hashFile(const char* path, const uint32_t size, const uint8_t* sha256, uint8_t* buffer) {
+  fs::File file = LittleFS.open(path,"r");
+  if (!file) {
+    return false;
+  }
+  if (file.size() != size) {
+    file.close();
+    return false;
+  }
+
+  BearSSL::HashSHA256 hash;
+  hash.begin();
+  size_t got;
+  while ((got = file.read(buffer,FILE_SYNC_BUFFER_SIZE)) > 0) {
+    hash.add(buffer,got);
+  }
+  file.close();
+  hash.end();
+  return memcmp(hash.hash(),sha256,32) == 0;
+}
+
+bool contains(const uint32_t* set, const uint16_t count, const uint32_t value) {
+  for (uint16_t i = 0; i < count; i++) {
+    if (set[i] == value) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// crc32 of every line of a list file, returns how many
+uint16_t loadLineSet(const char* listPath, uint32_t* set, const bool pathsOnly) {
+  uint16_t count = 0;
+  fs::File file = LittleFS.open(listPath,"r");
+  if (!file) {
+    return 0;
+  }
+  while (file.available() && (count < FILE_SYNC_MAX_FILES)) {
+    String line = file.readStringUntil('\n');
+    FileSyncLine entry;
+    if (parseLine(line,entry)) {
+      set[count++] = pathsOnly ? crc32(entry.path,strlen(entry.path)) : crc32(line.c_str(),line.length());
+    }
+  }
+  file.close();
+  return count;
+}
+
+// GET url into path, hashing on the way. The file is only kept when it matches
+bool fetchFile(HTTPClient& httpClient, WiFiClientSecure& wificlient, const String& url, const char* path,
+               const uint32_t size, const uint8_t* sha256, uint8_t* buffer, UpdateStats& stats) {
+
+  TlsRequest tls = tlsBegin(wificlient,url);
+  httpClient.begin(wificlient,url);
+  int httpCode = httpClient.GET();
+  tlsEnd(tls,wificlient);
+  if (httpCode != 200) {
+    dPrintf(F("File HTTP Error: %d\n"),httpCode);
+    httpClient.end();
+    return false;
+  }
+
+  fs::File file = LittleFS.open(path,"w");
+  if (!file) {
+    dPrintf(F("Can't create %s\n"),path);
+    httpClient.end();
+    return false;
+  }
+
+  Stream& stream = httpClient.getStream();
+  stream.setTimeout(FILE_SYNC_STREAM_TIMEOUT_MS);
+
+  BearSSL::HashSHA256 hash;
+  hash.begin();
+
+  uint32_t done = 0;
+  bool ok = true;
+  while (ok && (done < size)) {
+    uint32_t piece = min(size - done,(uint32_t)FILE_SYNC_BUFFER_SIZE);
+    uint32_t got = stream.readBytes(buffer,piece);
+    stats.bytesDownloaded += got;
+    hash.add(buffer,got);
+    ok = (got == piece) && (file.write(buffer,got) == got);
+    done += got;
+  }
+  httpClient.end();
+  file.close();
+  hash.end();
+
+  if (!ok || (memcmp(hash.hash(),sha256,32) != 0)) {
+    dPrintf(F("%s: bad download at %d of %d bytes\n"),path,done,size);
+    LittleFS.remove(path);
+    return false;
+  }
+  return true;
+}
+
+bool fetchWithRetries(HTTPClient& httpClient, WiFiClientSecure& wificlient, const String& url, const char* path,
+                      const uint32_t size, const uint8_t* sha256, uint8_t* buffer, UpdateStats& stats) {
+  uint32_t retryDelay = FILE_SYNC_RETRY_DELAY_MS;
+  for (uint8_t attempt = 0; attempt <= FILE_SYNC_RETRIES; attempt++) {
+    if (attempt > 0) {
+      stats.retries++;
+      dPrintf(F("Retrying %s in %d ms\n"),path,retryDelay);
+      delay(retryDelay);
+      retryDelay *= 2;
+    }
+    if (fetchFile(httpClient,wificlient,url,path,size,sha256,buffer,stats)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool fileSync(const String& baseURL, const ManifestFileList& list, FileSyncProgress onProgress, UpdateStats& stats) {
+
+  uint64_t startTime = clockMillis();
+  stats = UpdateStats();
+
+  uint8_t* buffer = (uint8_t*)malloc(FILE_SYNC_BUFFER_SIZE);
+  uint32_t* lineSet = (uint32_t*)malloc(FILE_SYNC_MAX_FILES * sizeof(uint32_t));
+  if (!buffer || !lineSet) {
+    dPrint(F("No memory for file sync\n"));
+    free(buffer);
+    free(lineSet);
+    return false;
+  }
+
+  HTTPClient httpClient;
+  WiFiClientSecure wificlient;
+  wificlient.setInsecure();
+  httpClient.setReuse(true);     // keep-alive between files
+
+  bool ok = fetchWithRetries(httpClient,wificlient,baseURL + (FILE_LIST + 1),FILE_LIST_NEW,list.size,list.sha256,buffer,stats);
+  uint16_t oldLines = ok ? loadLineSet(FILE_LIST,lineSet,false) : 0;
+
+  // first pass finds what has to change, second fetches it
+  uint16_t changed = 0;
+  uint16_t total = 0;
+  for (uint8_t pass = 0; ok && (pass < 2); pass++) {
+    fs::File listFile = LittleFS.open(FILE_LIST_NEW,"r");
+    uint32_t done = 0;
+    while (ok && listFile.available()) {
+      String line = listFile.readStringUntil('\n');
+      FileSyncLine entry;
+      if (!parseLine(line,entry)) {
+        continue;
+      }
+      total += (pass == 0);
+      if (contains(lineSet,oldLines,crc32(line.c_str(),line.length())) && LittleFS.exists(entry.path)) {
+        continue;
+      }
+      if (pass == 0) {
+        if (!hashFile(entry.path,entry.size,entry.sha256,buffer)) {
+          stats.imageSize += entry.size;
+          changed++;
+        }
+        continue;
+      }
+      if (hashFile(entry.path,entry.size,entry.sha256,buffer)) {
+        continue;
+      }
+
+      char tmpPath[FILE_SYNC_PATH_SIZE + 4];
+      snprintf(tmpPath,sizeof(tmpPath),"%s%s",entry.path,FILE_SYNC_TMP_EXT);
+      dPrintf(F("Updating %s (%d bytes)\n"),entry.path,entry.size);
+      ok = fetchWithRetries(httpClient,wificlient,baseURL + (entry.path + 1),tmpPath,entry.size,entry.sha256,buffer,stats)
+           && LittleFS.rename(tmpPath,entry.path);
+      done += entry.size;
+      if (onProgress && (stats.imageSize > 0)) {    // only empty files changed, nothing to show a share of
+        onProgress(done,stats.imageSize);
+      }
+    }
+    listFile.close();
+  }
+
+  // anything the old list had that the new one doesn't goes
+  uint16_t removed = 0;
+  if (ok) {
+    uint16_t newPaths = loadLineSet(FILE_LIST_NEW,lineSet,true);
+    fs::File listFile = LittleFS.open(FILE_LIST,"r");
+    while (listFile && listFile.available()) {
+      String line = listFile.readStringUntil('\n');
+      FileSyncLine entry;
+      if (parseLine(line,entry) && !contains(lineSet,newPaths,crc32(entry.path,strlen(entry.path)))) {
+        dPrintf(F("Removing %s\n"),entry.path);
+        LittleFS.remove(entry.path);
+        removed++;
+      }
+    }
+    listFile.close();
+    LittleFS.rename(FILE_LIST_NEW,FILE_LIST);
+  }
+
+  free(buffer);
+  free(lineSet);
+  stats.elapsedMs = clockMillis() - startTime;
+
+  if (!ok) {
+    dPrintf(F("File sync failed after %d retries, %d bytes downloaded\n"),stats.retries,stats.bytesDownloaded);
+    return false;
+  }
+
+  dPrintf(F("File sync: %d of %d files changed, %d removed, %d bytes downloaded (%d retries) in %d ms\n"),
+          changed,total,removed,stats.bytesDownloaded,stats.retries,stats.elapsedMs);
+  return true;
+}
@@ -0,0 +1,38 @@
+#ifndef FILE_SYNC
+#define FILE_SYNC
+
+#include <Arduino.h>
+#include "UpdateManifest.h"
+#include "DeltaUpdate.h"
+
+/*  Per file data updates. Rather than replacing the whole filesystem image the
+    server has a copy of the data directory next to a file list, one line per
+    file (tools/make_manifest.py writes it):
+
+      <sha256 64 hex> <size> <path>
+
+    The list itself is checked against the "files" entry of the manifest. Each
+    line is compared with the list from the last sync (FILE_LIST, kept on the
+    device) and, when that doesn't have it, with the file in flash. Only files
+    that differ are downloaded, to <path>.tmp, and renamed over the old one
+    once size and SHA-256 match. fs_ver.txt is always the last line so the new
+    version is only recorded when everything else is in, a sync that stops half
+    way is picked up again next boot.
+
+    Files that dropped out of the list are removed. Files that were never in it
+    (the team selection, snapshots, download progress) are left alone.
+*/
+
+const char* const FILE_LIST = "/files.txt";
+const char* const FILE_LIST_NEW = "/files.new";
+const char* const FILE_SYNC_TMP_EXT = ".tmp";
+const uint16_t FILE_SYNC_MAX_FILES = 256;
+const uint8_t FILE_SYNC_PATH_SIZE = 64;
+const uint8_t FILE_SYNC_RETRIES = 3;             // per file
+const uint16_t FILE_SYNC_RETRY_DELAY_MS = 1000;  // doubled on every retry
+
+typedef void (*FileSyncProgress)(int cur, int total);
+
+bool fileSync(const String& baseURL, const ManifestFileList& list, FileSyncProgress onProgress, UpdateStats& stats);
+
+#endif
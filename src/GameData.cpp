@@ -0,0 +1,106 @@
+#include <Time.h>
+#include "GameData.h"
+
+// String of the time expected in format YYYY-MM-DD HH-mm UTC
+time_t parseDateTime(const String& timeStr) {
+
+  tmElements_t tmSet;
+  tmSet.Year = timeStr.substring(0,4).toInt() - 1970;
+  tmSet.Month = timeStr.substring(5,7).toInt();
+  tmSet.Day = timeStr.substring(8,10).toInt();
+  tmSet.Hour = timeStr.substring(11,13).toInt();
+  tmSet.Minute = timeStr.substring(14,16).toInt();
+  tmSet.Second = 0;
+
+  return makeTime(tmSet);
+
+}
+
+// convert epoch time to string format
+String convertDate(const time_t epoch, const bool dashes) {
+  char dateChar[11] = {'\0'};
+
+  if (dashes) {
+    snprintf(dateChar,sizeof(dateChar),"%04d-%02d-%02d",year(epoch),month(epoch),day(epoch));
+  }
+  else {
+    snprintf(dateChar,sizeof(dateChar),"%04d%02d%02d",year(epoch),month(epoch),day(epoch));
+  }
+  String dateString = dateChar;
+  return dateString;
+}
+
+// epoch shifted so the calendar functions above give the local date. Schedules
+// are by local date, UTC is already tomorrow during evening games
+time_t localCalendarTime(const time_t epoch) {
+
+  struct tm* lt = localtime(&epoch);
+  tmElements_t tmSet;
+  tmSet.Year = lt->tm_year + 1900 - 1970;
+  tmSet.Month = lt->tm_mon + 1;
+  tmSet.Day = lt->tm_mday;
+  tmSet.Hour = lt->tm_hour;
+  tmSet.Minute = lt->tm_min;
+  tmSet.Second = lt->tm_sec;
+
+  return makeTime(tmSet);
+
+}
+
+bool addTickerGame(TickerBoard& board, const TickerGame& game) {
+  if (board.count >= TICKER_MAX_GAMES) {
+    return false;
+  }
+  board.games[board.count++] = game;
+  return true;
+}
+
+void setGDStrings(CurrentGameData& gd, const char* devision, const char* timeRemaining) {
+
+  snprintf(gd.devision,sizeof(gd.devision),"%s",devision);
+  snprintf(gd.timeRemaining,sizeof(gd.timeRemaining),"%s",timeRemaining);
+
+}
+
+// bases and outs stay false/0 outside MLB, so they're compared for every league
+bool gameStatsChanged(const CurrentGameData& prev, const CurrentGameData& curr) {
+
+  if (prev.gameID != curr.gameID) { return true; }
+  if (prev.awayID != curr.awayID) { return true; }
+  if (prev.homeID != curr.homeID) { return true; }
+  if (prev.awayScore != curr.awayScore) { return true; }
+  if (prev.homeScore != curr.homeScore) { return true; }
+  if (strcmp(prev.devision,curr.devision) != 0) { return true; }
+  if (strcmp(prev.timeRemaining,curr.timeRemaining) != 0) { return true; }
+  if (prev.outs != curr.outs) { return true; }
+  if (prev.bases[0] != curr.bases[0]) { return true; }
+  if (prev.bases[1] != curr.bases[1]) { return true; }
+  if (prev.bases[2] != curr.bases[2]) { return true; }
+  return false;
+}
+
+void copyGameData(CurrentGameData& dest, const CurrentGameData& source) {
+  dest.gameID = source.gameID;
+  dest.homeID = source.homeID;
+  dest.awayID = source.awayID;
+  dest.homeScore = source.homeScore;
+  dest.awayScore = source.awayScore;
+  dest.homeOther = source.homeOther;
+  dest.awayOther = source.awayOther;
+  strcpy(dest.devision,source.devision);
+  strcpy(dest.timeRemaining,source.timeRemaining);
+  dest.league = source.league;
+  dest.outs = source.outs;
+  dest.bases[0] = source.bases[0];
+  dest.bases[1] = source.bases[1];
+  dest.bases[2] = source.bases[2];
+}
+
+const char* findTeamName(const TeamInfo* teams, const uint8_t numTeams, const uint16_t teamID) {
+  for (uint8_t i = 0; i < numTeams; i++) {
+    if (teams[i].id == teamID) {
+      return teams[i].name;
+    }
+  }
+  return nullptr;
+}
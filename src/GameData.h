@@ -0,0 +1,80 @@
+#ifndef GAME_DATA
+#define GAME_DATA
+
+#include <Arduino.h>
+
+const uint32_t SECONDS_IN_A_DAY = 60 * 60 * 24;
+const uint32_t SECONDS_IN_A_WEEK = SECONDS_IN_A_DAY * 7;
+
+////////////////// Data Structs ///////////
+
+typedef struct  {
+  uint8_t id = 0;
+  char name[4] = "XXX";
+} TeamInfo;
+
+typedef struct {
+  uint8_t awayID = 0;
+  uint8_t homeID = 0;
+  uint32_t gameID = 0;
+  char homeRecord[9];   // xx-xx-xx
+  char awayRecord[9];
+  bool isPlayoffs = false;
+  time_t startTime = 0;
+  uint8_t league = 0;
+} NextGameData;
+
+typedef struct  {
+  uint32_t gameID = 0;
+  uint8_t awayID = 0;
+  uint8_t homeID = 0;
+  uint8_t awayScore = 0;
+  uint8_t homeScore = 0;
+  uint8_t homeOther = 0;   // only used for NHL powerplay right now
+  uint8_t awayOther = 0;   // only used for NHL powerplay right now
+  char devision[5];    // 1st, 2nd etc
+  char timeRemaining[6];  // 12:34
+  uint8_t league = 0;
+  bool bases[3] = {false,false,false};   // only set for MLB
+  uint8_t outs = 0;
+} CurrentGameData;
+
+enum GameStatus {NEW_TEAM,NO_GAMES,SCHEDULED,STARTED,FINISHED,AFTER_GAME};
+
+// League ticker: every game of the day from one scoreboard request. Records are
+// kept small and fixed size so a full slate is one flat array with no heap use
+const uint8_t TICKER_MAX_GAMES = 16;    // 32 team leagues
+
+enum TickerState {TICKER_SCHEDULED,TICKER_LIVE,TICKER_FINAL};
+
+typedef struct {
+  uint32_t gameID;
+  uint8_t awayID;
+  uint8_t homeID;
+  uint8_t awayScore;
+  uint8_t homeScore;
+  uint8_t state;            // TickerState
+  char devision[5];         // 1st, 2nd etc
+  char timeRemaining[6];    // 12:34, top, Final or the local start time
+} TickerGame;
+
+static_assert(sizeof(TickerGame) == 20,"TickerGame should pack into 20 bytes");
+
+typedef struct {
+  uint8_t league = 0;
+  uint8_t count = 0;
+  TickerGame games[TICKER_MAX_GAMES];
+} TickerBoard;
+
+////////////////// Shared helpers ///////////
+
+time_t parseDateTime(const String& timeStr);
+String convertDate(const time_t epoch, const bool dashes);
+time_t localCalendarTime(const time_t epoch);
+bool addTickerGame(TickerBoard& board, const TickerGame& game);
+void setGDStrings(CurrentGameData& gd, const char* devision, const char* timeRemaining);
+bool gameStatsChanged(const CurrentGameData& prev, const CurrentGameData& curr);
+void copyGameData(CurrentGameData& dest, const CurrentGameData& source);
+const char* findTeamName(const TeamInfo* teams, const uint8_t numTeams, const uint16_t teamID);   // nullptr if not found
+
+#endif
@@ -0,0 +1,91 @@
+#include "GameEvents.h"
+#include "Leagues.h"
+#include "Debug.h"
+
+// -1 away ahead, 0 tied, 1 home ahead
+int8_t leader(const CurrentGameData& game) {
+  if (game.homeScore == game.awayScore) {
+    return 0;
+  }
+  return (game.homeScore > game.awayScore) ? 1 : -1;
+}
+
+bool isFinal(const CurrentGameData& game) {
+  return strcasecmp(game.timeRemaining,"final") == 0;
+}
+
+// "pre" and "" are before the game or after it, not a period
+bool inPeriod(const CurrentGameData& game) {
+  return (game.devision[0] != '\0') && (strcmp(game.devision,"pre") != 0);
+}
+
+uint8_t detectGameEvents(const CurrentGameData& prev, const CurrentGameData& curr) {
+
+  uint8_t events = 0;
+
+  if ((prev.gameID == 0) || (prev.gameID != curr.gameID)) {
+    return 0;
+  }
+
+  if (curr.awayScore > prev.awayScore) {
+    events |= EVENT_AWAY_SCORED;
+  }
+  if (curr.homeScore > prev.homeScore) {
+    events |= EVENT_HOME_SCORED;
+  }
+  if ((leader(curr) != 0) && (leader(curr) != leader(prev))) {
+    events |= EVENT_LEAD_CHANGE;
+  }
+
+  if (curr.league == NHL) {
+    if (curr.awayOther && !prev.awayOther) {
+      events |= EVENT_AWAY_POWER_PLAY;
+    }
+    if (curr.homeOther && !prev.homeOther) {
+      events |= EVENT_HOME_POWER_PLAY;
+    }
+  }
+
+  if (isFinal(curr)) {
+    if (!isFinal(prev)) {
+      events |= EVENT_FINAL;
+    }
+  }
+  else if ((strcmp(curr.timeRemaining,"END") == 0) && (strcmp(prev.timeRemaining,"END") != 0)) {
+    events |= EVENT_PERIOD_END;
+  }
+  else if (inPeriod(prev) && (strcmp(prev.devision,curr.devision) != 0) && (strcmp(prev.timeRemaining,"END") != 0)) {
+    events |= EVENT_PERIOD_END;     // missed the intermission between polls
+  }
+
+  return events;
+}
+
+void printGameEvents(const uint8_t events, const CurrentGameData& prev, const CurrentGameData& game) {
+
+  const LeagueInfo* info = Leagues::info(game.league);
+  const char* score = info ? info->scoreLabel : "Score";
+
+  if (events & EVENT_AWAY_SCORED) {
+    dPrintf(F("Event: %s %d-%d away\n"),score,game.awayScore,game.homeScore);
+  }
+  if (events & EVENT_HOME_SCORED) {
+    dPrintf(F("Event: %s %d-%d home\n"),score,game.awayScore,game.homeScore);
+  }
+  if (events & EVENT_LEAD_CHANGE) {
+    dPrintf(F("Event: Lead change, %s ahead\n"),(leader(game) > 0) ? "home" : "away");
+  }
+  if (events & EVENT_AWAY_POWER_PLAY) {
+    dPrintln(F("Event: Power play away"));
+  }
+  if (events & EVENT_HOME_POWER_PLAY) {
+    dPrintln(F("Event: Power play home"));
+  }
+  if (events & EVENT_PERIOD_END) {
+    const char* ended = (strcmp(game.timeRemaining,"END") == 0) ? game.devision : prev.devision;
+    dPrintf(F("Event: End of %s %s\n"),info ? info->divisionLabel : "period",ended);
+  }
+  if (events & EVENT_FINAL) {
+    dPrintf(F("Event: Final %d-%d\n"),game.awayScore,game.homeScore);
+  }
+}
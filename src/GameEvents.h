@@ -0,0 +1,26 @@
+#ifndef GAME_EVENTS
+#define GAME_EVENTS
+
+#include <Arduino.h>
+#include "GameData.h"
+
+/*  Classifies what happened between two polls of the same game. The result is
+    a bit set so one poll can report a goal, the lead change it caused and the
+    end of the period together. The first poll of a game has nothing to compare
+    with and reports nothing.
+*/
+
+enum GameEvent : uint8_t {
+  EVENT_AWAY_SCORED     = 0x01,
+  EVENT_HOME_SCORED     = 0x02,
+  EVENT_LEAD_CHANGE     = 0x04,
+  EVENT_AWAY_POWER_PLAY = 0x08,     // NHL only, homeOther/awayOther
+  EVENT_HOME_POWER_PLAY = 0x10,
+  EVENT_PERIOD_END      = 0x20,     // period, inning or quater
+  EVENT_FINAL           = 0x40
+};
+
+uint8_t detectGameEvents(const CurrentGameData& prev, const CurrentGameData& curr);
+void printGameEvents(const uint8_t events, const CurrentGameData& prev, const CurrentGameData& game);
+
+#endif
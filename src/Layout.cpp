@@ -0,0 +1,54 @@
+#include "Layout.h"
+
+int16_t calculateScoreXPosition(const int16_t score, const bool bigFont) {
+
+  int16_t position = 0;
+
+  if (bigFont) {
+    if (score == 1) {
+      position = 8;
+    }
+    else if (score >= 100) {   // shouldn't happen
+      position = 12;
+    }
+    else if (score >= 20) {
+      position = 2;
+    }
+    else if (score >= 10) {
+      position = -8;
+    }
+    else {
+      position = 18;
+    }
+  }
+  else {
+    if (score == 1) {
+      position = 28;
+    }
+    else if (score >= 100) {
+      position = 13;
+    }
+    else if (score >= 20) {
+      position = 2;
+    }
+    else if (score >= 10) {
+      position = 20;
+    }
+    else {
+      position = 20;
+    }
+  }
+
+
+ 
+  return position;
+}
+
+void calculateScoreXPosition(const uint8_t awayScore, const uint8_t homeScore, int16_t& awayPosition, int16_t& homePosition, int16_t& fontNum) {
+
+  bool bigFont = ((awayScore < 100) && (homeScore < 100));
+  fontNum = bigFont ? 7 : 4;
+  awayPosition = calculateScoreXPosition(awayScore,bigFont);
+  homePosition = calculateScoreXPosition(homeScore,bigFont) + 90;
+  
+}
@@ -0,0 +1,14 @@
+#ifndef LAYOUT
+#define LAYOUT
+
+#include <Arduino.h>
+
+/*  Screen positions worked out from the game data, with no drawing, so the
+    display code and the native tests share them. The magic numbers assume
+    the 128x160 screen.
+*/
+
+int16_t calculateScoreXPosition(const int16_t score, const bool bigFont);
+void calculateScoreXPosition(const uint8_t awayScore, const uint8_t homeScore, int16_t& awayPosition, int16_t& homePosition, int16_t& fontNum);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef LEAGUE_PROVIDER
+#define LEAGUE_PROVIDER
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "GameData.h"
+#include "Upstream.h"
+
+/*  A league provider is a struct with only static members. Everything that is
+    different between leagues (endpoints, json filters, extractors, status codes,
+    team table, icon set) lives in the provider so the rest of the code can stay
+    league generic. Adding a league is one new League_XXX.h/.cpp pair plus adding
+    the provider to the list in Leagues.h.
+
+    struct XXXProvider {
+      static constexpr uint8_t ID;                      // index into selectedTeam[]
+      static constexpr size_t FILTER_DOC_SIZE;          // current game filter
+      static constexpr size_t CURRENT_GAME_DOC_SIZE;    // current game response
+      static constexpr uint8_t CURRENT_GAME_NESTING;
+      static constexpr const char* CURRENT_GAME_SEEK;   // skip to this before parsing, or nullptr
+      static const LeagueInfo INFO;
+
+      static void currentGameURL(const uint32_t gameID, String& queryString);
+      static void currentGameFilter(JsonDocument& filter);
+      static bool extractCurrentGame(CurrentGameData& gameData, const uint32_t gameID, JsonDocument& doc);  // true if game over
+      static UpstreamError getNextGame(const time_t today, const uint16_t teamID, NextGameData& nextGameData);  // OK with no game too
+      static bool getScoreboard(const time_t today, TickerBoard& board);   // all of today's games, one request
+      static void printCurrentGame(const CurrentGameData& gameData);   // league specific fields only
+    };
+*/
+
+typedef struct {
+  const char* name;            // also the file name of the league logo
+  const char* iconDir;         // sub directory of /icons/
+  const TeamInfo* teams;
+  uint8_t numTeams;
+  const char* divisionLabel;   // debug output labels
+  const char* clockLabel;
+  const char* scoreLabel;      // what one score is called, for event output
+} LeagueInfo;
+
+template <typename... Providers>
+struct LeagueList {
+
+  static constexpr uint8_t COUNT = sizeof...(Providers);
+
+  // Calls fn(Provider()) for the provider with the matching ID. This expands to
+  // an inlined compare chain so the poll path never pays for a virtual call.
+  // Returns false if there is no such league
+  template <typename Fn>
+  static bool dispatch(const uint8_t league, Fn&& fn) {
+    return ((league == Providers::ID ? (fn(Providers()), true) : false) || ...);
+  }
+
+  static const LeagueInfo* info(const uint8_t league) {
+    const LeagueInfo* result = nullptr;
+    dispatch(league,[&](auto provider) { result = &decltype(provider)::INFO; });
+    return result;
+  }
+
+  // provider IDs are used as array indexes so they have to be 0..COUNT-1 in list order
+  static constexpr bool idsAreIndexes() {
+    uint8_t i = 0;
+    bool result = true;
+    ((result = result && (Providers::ID == i++)), ...);
+    return result;
+  }
+
+};
+
+#endif
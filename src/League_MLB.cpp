@@ -0,0 +1,107 @@
+#include "League_MLB.h"
+#include "StatsApi.h"
+#include "Debug.h"
+
+const char* MLB_HOST = "statsapi.mlb.com";
+
+const TeamInfo MLB_TEAMS[] = {
+  {109,"ARI"}, {144,"ATL"}, {110,"BAL"}, {111,"BOS"}, {112,"CHC"}, {145,"CWS"},
+  {113,"CIN"}, {114,"CLE"}, {115,"COL"}, {116,"DET"}, {117,"HOU"}, {118,"KCR"},
+  {108,"LAA"}, {119,"LAD"}, {146,"MIA"}, {158,"MIL"}, {142,"MIN"}, {121,"NYM"},
+  {147,"NYY"}, {133,"OAK"}, {143,"PHI"}, {134,"PIT"}, {135,"SDP"}, {137,"SFG"},
+  {136,"SEA"}, {138,"STL"}, {139,"TBR"}, {140,"TEX"}, {141,"TOR"}, {120,"WSH"}
+};
+
+const LeagueInfo MLBProvider::INFO = {
+  "MLB", "MLB/", MLB_TEAMS, sizeof(MLB_TEAMS) / sizeof(MLB_TEAMS[0]), "Inning", "Inning", "Run"
+};
+
+const StatsApiConfig MLB_STATSAPI = {MLB, MLB_HOST, "\"dates\":[", false,
+                                     "hydrate=linescore", "currentInningOrdinal", "inningHalf", true};
+
+void MLBProvider::currentGameURL(const uint32_t gameID, String& queryString) {
+  queryString = "http://";
+  queryString += MLB_HOST;
+  queryString += "/api/v1.1/game/";
+  queryString += gameID;
+  queryString += "/feed/live";
+}
+
+void MLBProvider::currentGameFilter(JsonDocument& filter) {
+  filter["gamePk"] = true;
+  filter["gameData"]["status"]["abstractGameState"] = true;
+  filter["liveData"]["linescore"]["currentInning"] = true;
+  filter["liveData"]["linescore"]["currentInningOrdinal"] = true;
+  filter["liveData"]["linescore"]["isTopInning"] = true;
+  filter["liveData"]["linescore"]["teams"]["home"]["runs"] = true;
+  filter["liveData"]["linescore"]["teams"]["away"]["runs"] = true;
+  filter["liveData"]["linescore"]["offense"] = true;
+  filter["liveData"]["linescore"]["outs"] = true;
+  filter["liveData"]["boxscore"]["teams"]["home"]["team"]["id"] = true;
+  filter["liveData"]["boxscore"]["teams"]["away"]["team"]["id"] = true;
+}
+
+bool MLBProvider::extractCurrentGame(CurrentGameData& gameData, const uint32_t gameID, JsonDocument& doc) {
+
+   // the MLB linescore doesn't include the teamIDs or game status so we have to be hackey
+  // using the schedule data
+
+  bool isGameOver = false;
+
+  gameData.gameID = doc["gamePk"];
+  gameData.league = MLB;
+  gameData.homeID = doc["liveData"]["boxscore"]["teams"]["home"]["team"]["id"];
+  gameData.awayID = doc["liveData"]["boxscore"]["teams"]["away"]["team"]["id"];
+  JsonObject linescore = doc["liveData"]["linescore"];
+  uint8_t inning = linescore["currentInning"];
+  const char* gameState = doc["gameData"]["status"]["abstractGameState"];
+
+  if (strcmp(gameState,"preview") == 0) {
+    setGDStrings(gameData,"pre","");
+  }
+  else {
+    gameData.homeScore = linescore["teams"]["home"]["runs"];
+    gameData.awayScore = linescore["teams"]["away"]["runs"];
+    gameData.outs = linescore["outs"];
+    if (strcmp(gameState,STATUSCODE_FINAL) == 0) {
+      setGDStrings(gameData,"","FINAL");
+      isGameOver = true;
+    }
+    else {
+      const char* inningStr = linescore["currentInningOrdinal"];
+      bool isTopInning = linescore["isTopInning"];
+      if (isTopInning) {
+        setGDStrings(gameData,inningStr,"top");
+      }
+      else {
+        setGDStrings(gameData,inningStr,"bot");
+      }
+
+    }
+
+  }
+
+  JsonObject offense = linescore["offense"];
+  gameData.bases[0] = offense.containsKey("first");
+  gameData.bases[1] = offense.containsKey("second");
+  gameData.bases[2] = offense.containsKey("third");
+
+  return isGameOver;
+
+}
+
+UpstreamError MLBProvider::getNextGame(const time_t today, const uint16_t teamID, NextGameData& nextGameData) {
+  return getNextGame_StatsApi(MLB_STATSAPI,today,teamID,nextGameData);
+}
+
+bool MLBProvider::getScoreboard(const time_t today, TickerBoard& board) {
+  return getScoreboard_StatsApi(MLB_STATSAPI,today,board);
+}
+
+void MLBProvider::printCurrentGame(const CurrentGameData& gameData) {
+  dPrintf(F("Outs: %d\n"),gameData.outs);
+  dPrintf(F("Bases:\n"));
+  dPrintf(F(" Running on 1st: %s\n"),(gameData.bases[0]) ? "yes" : "no");
+  dPrintf(F(" Running on 2nd: %s\n"),(gameData.bases[1]) ? "yes" : "no");
+  dPrintf(F(" Running on 3rd: %s\n"),(gameData.bases[2]) ? "yes" : "no");
+}
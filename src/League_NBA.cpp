@@ -0,0 +1,381 @@
+#include <ESP8266HTTPClient.h>
+#include "League_NBA.h"
+#include "Deadlines.h"
+#include "DnsCache.h"
+#include "Debug.h"
+
+// ESPN api status codes
+const char* STATUSCODE_NBA_FINAL = "STATUS_FINAL";
+const char* STATUSCODE_NBA_HALFTIME = "STATUS_HALFTIME";
+const char* STATUSCODE_NBA_ENDOFQUATER = "STATUS_END_PERIOD";
+const char* STATUSCODE_NBA_SCHEDULED = "STATUS_SCHEDULED";
+
+const char* NBA_URL = "http://site.api.espn.com/apis/site/v2/sports/basketball/nba/";
+
+const TeamInfo NBA_TEAMS[] = {
+  {1,"ATL"},  {2,"BOS"},  {17,"BKN"}, {30,"CHA"}, {4,"CHI"},  {5,"CLE"},
+  {6,"DAL"},  {7,"DEN"},  {8,"DET"},  {9,"GSW"},  {10,"HOU"}, {11,"IND"},
+  {12,"LAC"}, {13,"LAL"}, {29,"MEM"}, {14,"MIA"}, {15,"MIL"}, {16,"MIN"},
+  {3,"NOP"},  {18,"NYK"}, {25,"OKC"}, {19,"ORL"}, {20,"PHI"}, {21,"PHX"},
+  {22,"POR"}, {23,"SAC"}, {24,"SAS"}, {28,"TOR"}, {26,"UTA"}, {27,"WAS"}
+};
+
+const LeagueInfo NBAProvider::INFO = {
+  "NBA", "NBA/", NBA_TEAMS, sizeof(NBA_TEAMS) / sizeof(NBA_TEAMS[0]), "Quater", "Time", "Basket"
+};
+
+void NBAProvider::currentGameURL(const uint32_t gameID, String& queryString) {
+  queryString = NBA_URL;
+  queryString += "summary?event=";
+  queryString += gameID;
+}
+
+void NBAProvider::currentGameFilter(JsonDocument& filter) {
+  filter["id"] = true;
+  filter["competitors"][0]["id"] = true;
+  filter["competitors"][0]["homeAway"] = true;
+  filter["competitors"][0]["score"] = true;
+
+  filter["competitors"][1]["id"] = true;
+  filter["competitors"][1]["homeAway"] = true;
+  filter["competitors"][0]["score"] = true;
+
+  filter["status"]["displayClock"] = true;
+  filter["status"]["period"] = true;
+  filter["status"]["type"]["name"] = true;
+}
+
+bool NBAProvider::extractCurrentGame(CurrentGameData& currentGameData, const uint32_t gameID, JsonDocument& doc) {
+
+  const char* id = doc["id"];
+  currentGameData.gameID = atoi(id);
+  currentGameData.league = NBA;
+
+  const char* status = doc["status"]["type"]["name"];
+  bool isFinal = (strcmp(status,STATUSCODE_NBA_FINAL) == 0);
+  bool isStillScheduled = (strcmp(status,STATUSCODE_NBA_SCHEDULED) == 0);  // API doesn't show required field until game actually starts
+
+  JsonArray competitors = doc["competitors"];
+  for (JsonObject competitor: competitors) {   // there is aways 2
+    const char* homeAway = competitor["homeAway"];
+    if (strcmp(homeAway,"home") == 0) {
+      currentGameData.homeID = competitor["id"];
+      if (!isStillScheduled) {
+        currentGameData.homeScore = competitor["score"];
+      }
+    }
+    else {
+      currentGameData.awayID = competitor["id"];
+      if (!isStillScheduled) {
+        currentGameData.awayScore = competitor["score"];
+      }
+    }
+  }
+
+  if (isFinal) {
+    setGDStrings(currentGameData,"","FINAL");
+  }
+  else if (strcmp(status,STATUSCODE_NBA_HALFTIME) == 0) {
+    setGDStrings(currentGameData,"","HALF");
+  }
+  else {
+
+    if (!isStillScheduled) {
+    const int quater = doc["status"]["period"];
+
+    char ordinalBuffer[4];
+      switch (quater){
+        case 1:
+          snprintf(ordinalBuffer,sizeof(ordinalBuffer),"1st");
+          break;
+        case 2:
+          snprintf(ordinalBuffer,sizeof(ordinalBuffer),"2nd");
+          break;
+        case 3:
+          snprintf(ordinalBuffer,sizeof(ordinalBuffer),"3rd");
+          break;
+        case 4:
+          snprintf(ordinalBuffer,sizeof(ordinalBuffer),"4th");
+          break;
+        default:
+          snprintf(ordinalBuffer,sizeof(ordinalBuffer),"?");
+      }
+
+      snprintf(currentGameData.devision,sizeof(currentGameData.devision),"%s",ordinalBuffer);
+      if (strcmp(status,STATUSCODE_NBA_ENDOFQUATER) == 0) {
+        snprintf(currentGameData.timeRemaining,sizeof(currentGameData.timeRemaining),"END");
+      }
+      else {
+
+        const char* tr = doc["status"]["displayClock"];
+        snprintf(currentGameData.timeRemaining,sizeof(currentGameData.timeRemaining),"%s",tr);
+      }
+    }
+    else {
+      memset(currentGameData.timeRemaining,'\0',sizeof(currentGameData.timeRemaining));
+      snprintf(currentGameData.devision,sizeof(currentGameData.devision),"pre");
+    }
+  }
+
+  return isFinal;
+
+}
+
+void extractNextGame_NBA(NextGameData& nextGameData, JsonDocument& doc) {
+
+  nextGameData.gameID = doc["id"];
+  JsonArray competitors = doc["competitions"][0]["competitors"];
+  for (JsonObject competitor: competitors) {   // there is aways 2
+    const char* homeAway = competitor["homeAway"];
+    if (strcmp(homeAway,"home") == 0) {
+      nextGameData.homeID = competitor["id"];
+      JsonArray records = competitor["records"];
+      for (JsonObject record : records) {
+        const char* type = record["type"];
+        if (strcmp(type,"total") == 0) {
+          const char* r = record["summary"];
+          snprintf(nextGameData.homeRecord,sizeof(nextGameData.homeRecord),"%s",r);
+          break;
+        }
+      }
+    }
+    else {
+      nextGameData.awayID = competitor["id"];
+      JsonArray records = competitor["records"];
+      for (JsonObject record : records) {
+        const char* type = record["type"];
+        if (strcmp(type,"total") == 0) {
+          const char* r = record["summary"];
+          snprintf(nextGameData.awayRecord,sizeof(nextGameData.homeRecord),"%s",r);
+          break;
+        }
+      }
+    }
+
+    String nextGameTS_str = doc["date"];
+    nextGameData.startTime = parseDateTime(nextGameTS_str);
+    nextGameData.league = NBA;
+   // int seasonType = doc["season"]["type"];
+    //nextGameData.isPlayoffs = (seasonType == 3);
+    nextGameData.isPlayoffs = false;
+
+  }
+
+}
+
+UpstreamError NBAProvider::getNextGame(const time_t today, const uint16_t teamID, NextGameData& nextGameData) {
+
+  HTTPClient httpClient;
+  DnsCachedClient wifiClient;
+  DeadlineStream stream(wifiClient,ENDPOINT_NEXT_GAME);
+  StaticJsonDocument<368> filter;
+  DynamicJsonDocument doc(2048);
+
+  String queryString = NBA_URL;
+  queryString += "scoreboard?limit=100&dates=";
+  queryString += convertDate(today - SECONDS_IN_A_DAY,false);
+  queryString += "-";
+  queryString += convertDate(today + (SECONDS_IN_A_DAY * 3),false);
+
+  dPrintln(F("Query - Type: Next NBA Game"));
+
+  filter["id"] = true;
+  filter["date"] = true;
+  filter["competitions"][0]["competitors"][0]["id"] = true;
+  filter["competitions"][0]["competitors"][0]["homeAway"] = true;
+  filter["competitions"][0]["competitors"][0]["score"] = true;
+  filter["competitions"][0]["competitors"][0]["records"][0]["type"] = true;
+  filter["competitions"][0]["competitors"][0]["records"][0]["summary"] = true;
+  filter["competitions"][0]["competitors"][1]["id"] = true;
+  filter["competitions"][0]["competitors"][1]["homeAway"] = true;
+  filter["competitions"][0]["competitors"][0]["score"] = true;
+  filter["competitions"][0]["competitors"][1]["records"][0]["type"] = true;
+  filter["competitions"][0]["competitors"][1]["records"][0]["summary"] = true;
+  filter["status"]["type"]["name"] = true;
+
+  dVerboseJson(filter);
+
+
+  dPrintf(F("\nQuery URL: %s\n"),queryString.c_str());
+
+  if (!upstreamAllowed(queryString)) {
+    return UPSTREAM_CIRCUIT_OPEN;
+  }
+
+  httpClient.useHTTP10(true);   // Very Important for NBA api to parse correctly
+  stream.prepare(httpClient);
+  httpClient.begin(wifiClient,queryString);
+
+  int httpResult = httpClient.GET();
+  stream.responded(httpResult);
+  if (httpResult != 200) {
+    dPrintf(F("HTTP error: %d\n"),httpResult);
+    httpClient.end();
+    UpstreamError result = upstreamClassify(httpResult);
+    result = (result == UPSTREAM_OK) ? UPSTREAM_HTTP_5XX : result;
+    upstreamResult(queryString,result);
+    return result;
+  }
+
+  bool found = false;
+
+  stream.find("\"events\":[");
+  uint16_t event = 0;
+  do {
+    dPrintf(F("checking: %d\n"),event);
+    DeserializationError err = deserializeJson(doc,stream,DeserializationOption::Filter(filter),DeserializationOption::NestingLimit(15));
+
+    if (err) {
+      dPrintf(F("Parse error: %s"),err.c_str());
+    }
+    else {
+
+      const char* status = doc["status"]["type"]["name"];
+
+      if (strcmp(status,STATUSCODE_NBA_FINAL) != 0) {
+        const int team1 = doc["competitions"][0]["competitors"][0]["id"];
+        const int team2 = doc["competitions"][0]["competitors"][1]["id"];
+        if ((team1 == teamID) || (team2 == teamID)) {
+          const uint32_t id = doc["id"];
+          if (id != nextGameData.gameID) {
+            found = true;
+            break;
+          }
+        }
+      }
+    }
+    event++;
+  } while (stream.findUntil(",","]"));
+
+  httpClient.end();
+
+  // a cut off scoreboard isn't "no game", unless our game was already in it
+  UpstreamError result = (!found && stream.expired()) ? UPSTREAM_TIMEOUT : UPSTREAM_OK;
+  if (found) {
+    dVerboseJson(doc);
+    extractNextGame_NBA(nextGameData,doc);
+  }
+  else if (result == UPSTREAM_OK) {
+    dPrintln(F("No next game found"));
+  }
+  upstreamResult(queryString,result);
+  return result;
+
+}
+
+bool NBAProvider::getScoreboard(const time_t today, TickerBoard& board) {
+
+  HTTPClient httpClient;
+  DnsCachedClient wifiClient;
+  DeadlineStream stream(wifiClient,ENDPOINT_SCOREBOARD);
+  StaticJsonDocument<384> filter;
+  DynamicJsonDocument doc(1024);    // one event at a time
+
+  board.league = NBA;
+  board.count = 0;
+
+  String queryString = NBA_URL;
+  queryString += "scoreboard?dates=";
+  queryString += convertDate(localCalendarTime(today),false);
+
+  dPrintln(F("Query - Type: NBA Scoreboard"));
+  dPrintf(F("Query URL: %s\n"),queryString.c_str());
+
+  filter["id"] = true;
+  filter["date"] = true;
+  filter["competitions"][0]["competitors"][0]["id"] = true;
+  filter["competitions"][0]["competitors"][0]["homeAway"] = true;
+  filter["competitions"][0]["competitors"][0]["score"] = true;
+  filter["status"]["displayClock"] = true;
+  filter["status"]["period"] = true;
+  filter["status"]["type"]["name"] = true;
+
+  httpClient.useHTTP10(true);
+  stream.prepare(httpClient);
+  httpClient.begin(wifiClient,queryString);
+
+  int httpResult = httpClient.GET();
+  stream.responded(httpResult);
+  if (httpResult != 200) {
+    dPrintf(F("HTTP error: %d\n"),httpResult);
+    httpClient.end();
+    return false;
+  }
+
+  if (!stream.find("\"events\":[")) {
+    httpClient.end();
+    return true;
+  }
+
+  bool ok = true;
+  do {
+    DeserializationError err = deserializeJson(doc,stream,DeserializationOption::Filter(filter),DeserializationOption::NestingLimit(15));
+    if (err) {
+      dPrintf(F("Parse error: %s\n"),err.c_str());
+      ok = false;
+      break;
+    }
+
+    TickerGame game;
+    memset(&game,0,sizeof(game));
+    game.gameID = doc["id"];
+
+    const char* status = doc["status"]["type"]["name"];
+    if (!status || (strcmp(status,STATUSCODE_NBA_SCHEDULED) == 0)) {
+      game.state = TICKER_SCHEDULED;
+      time_t startTime = parseDateTime(doc["date"].as<String>());
+      strftime(game.timeRemaining,sizeof(game.timeRemaining),"%H:%M",localtime(&startTime));
+    }
+    else if (strcmp(status,STATUSCODE_NBA_FINAL) == 0) {
+      game.state = TICKER_FINAL;
+      snprintf(game.timeRemaining,sizeof(game.timeRemaining),"Final");
+    }
+    else {
+      game.state = TICKER_LIVE;
+      const int quater = doc["status"]["period"];
+      if (quater > 4) {
+        snprintf(game.devision,sizeof(game.devision),"OT");
+      }
+      else {
+        snprintf(game.devision,sizeof(game.devision),"Q%d",quater);
+      }
+      if (strcmp(status,STATUSCODE_NBA_HALFTIME) == 0) {
+        snprintf(game.timeRemaining,sizeof(game.timeRemaining),"HALF");
+      }
+      else if (strcmp(status,STATUSCODE_NBA_ENDOFQUATER) == 0) {
+        snprintf(game.timeRemaining,sizeof(game.timeRemaining),"END");
+      }
+      else {
+        const char* tr = doc["status"]["displayClock"];
+        snprintf(game.timeRemaining,sizeof(game.timeRemaining),"%s",tr ? tr : "");
+      }
+    }
+
+    JsonArray competitors = doc["competitions"][0]["competitors"];
+    for (JsonObject competitor: competitors) {
+      const char* homeAway = competitor["homeAway"];
+      bool isHome = homeAway && (strcmp(homeAway,"home") == 0);
+      uint8_t score = (game.state == TICKER_SCHEDULED) ? 0 : competitor["score"].as<uint8_t>();
+      if (isHome) {
+        game.homeID = competitor["id"];
+        game.homeScore = score;
+      }
+      else {
+        game.awayID = competitor["id"];
+        game.awayScore = score;
+      }
+    }
+
+    if (!addTickerGame(board,game)) {
+      dPrintf(F("Scoreboard full, skipping game %d\n"),game.gameID);
+    }
+  } while (stream.findUntil(",","]"));
+
+  httpClient.end();
+
+  dPrintf(F("Scoreboard: %d games\n"),board.count);
+  return ok;
+
+}
+
+void NBAProvider::printCurrentGame(const CurrentGameData& gameData) {}
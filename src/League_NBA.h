@@ -0,0 +1,28 @@
+#ifndef LEAGUE_NBA
+#define LEAGUE_NBA
+
+#include "LeagueProvider.h"
+
+const uint8_t NBA = 2;
+
+struct NBAProvider {
+
+  static constexpr uint8_t ID = NBA;
+  static constexpr size_t FILTER_DOC_SIZE = 224;
+  static constexpr size_t CURRENT_GAME_DOC_SIZE = 512;
+  static constexpr uint8_t CURRENT_GAME_NESTING = 11;
+  static constexpr const char* CURRENT_GAME_SEEK = "\"competitions\":[";
+  static const LeagueInfo INFO;
+
+  static void currentGameURL(const uint32_t gameID, String& queryString);
+  static void currentGameFilter(JsonDocument& filter);
+  static bool extractCurrentGame(CurrentGameData& gameData, const uint32_t gameID, JsonDocument& doc);
+  static UpstreamError getNextGame(const time_t today, const uint16_t teamID, NextGameData& nextGameData);
+  static bool getScoreboard(const time_t today, TickerBoard& board);
+  static void printCurrentGame(const CurrentGameData& gameData);
+
+};
+
+void extractNextGame_NBA(NextGameData& nextGameData, JsonDocument& doc);   // one scoreboard event
+
+#endif
@@ -0,0 +1,92 @@
+#include "League_NHL.h"
+#include "StatsApi.h"
+#include "Debug.h"
+
+const char* NHL_HOST = "statsapi.web.nhl.com";
+
+const TeamInfo NHL_TEAMS[] = {
+  {24,"ANA"}, {53,"ARI"}, {6,"BOS"},  {7,"BUF"},  {12,"CAR"}, {29,"CBJ"},
+  {20,"CGY"}, {16,"CHI"}, {21,"COL"}, {25,"DAL"}, {17,"DET"}, {22,"EDM"},
+  {13,"FLA"}, {26,"LAK"}, {30,"MIN"}, {8,"MTL"},  {1,"NJD"},  {18,"NSH"},
+  {2,"NYI"},  {3,"NYR"},  {9,"OTT"},  {4,"PHI"},  {5,"PIT"},  {28,"SJS"},
+  {19,"STL"}, {14,"TBL"}, {10,"TOR"}, {23,"VAN"}, {54,"VGK"}, {52,"WPG"},
+  {15,"WSH"}
+};
+
+const LeagueInfo NHLProvider::INFO = {
+  "NHL", "NHL/", NHL_TEAMS, sizeof(NHL_TEAMS) / sizeof(NHL_TEAMS[0]), "Period", "Time", "Goal"
+};
+
+// bug in NHL API that has spaces in the tag. If they use the same schema why are there spaces?
+const StatsApiConfig NHL_STATSAPI = {NHL, NHL_HOST, "\"dates\" : [ ", true,
+                                     "expand=schedule.linescore", "currentPeriodOrdinal", "currentPeriodTimeRemaining", false};
+
+void NHLProvider::currentGameURL(const uint32_t gameID, String& queryString) {
+  queryString = "http://";
+  queryString += NHL_HOST;
+  queryString += "/api/v1/game/";
+  queryString += gameID;
+  queryString += "/linescore";
+}
+
+void NHLProvider::currentGameFilter(JsonDocument& filter) {
+  filter["currentPeriod"] = true;
+  filter["currentPeriodOrdinal"] = true;
+  filter["currentPeriodTimeRemaining"] = true;
+  filter["teams"]["home"]["team"]["id"] = true;
+  filter["teams"]["home"]["goals"] = true;
+  filter["teams"]["home"]["powerPlay"] = true;
+  filter["teams"]["away"]["team"]["id"] = true;
+  filter["teams"]["away"]["goals"] = true;
+  filter["teams"]["away"]["powerPlay"] = true;
+}
+
+bool NHLProvider::extractCurrentGame(CurrentGameData& gameData, const uint32_t gameID, JsonDocument& doc) {
+
+  bool isGameOver = false;
+
+  gameData.gameID = gameID;
+  gameData.league = NHL;
+  gameData.homeID = doc["teams"]["home"]["team"]["id"];
+  gameData.homeScore = doc["teams"]["home"]["goals"];
+  gameData.homeOther = doc["teams"]["home"]["powerPlay"];
+  gameData.awayID = doc["teams"]["away"]["team"]["id"];
+  gameData.awayScore = doc["teams"]["away"]["goals"];
+  gameData.awayOther = doc["teams"]["away"]["powerPlay"];
+
+  dPrintf(F("gameData.awayOther: %d\n"),gameData.awayOther);
+
+  uint8_t period = doc["currentPeriod"];
+
+  if (period == 0) {
+        setGDStrings(gameData,"pre","");
+  }
+  else {
+    const char* p = doc["currentPeriodOrdinal"];   // Json template issues if declartion isn't on same line
+    const char* tr = doc["currentPeriodTimeRemaining"];
+
+    if (strcmp(tr,STATUSCODE_FINAL) == 0) {
+      setGDStrings(gameData,"","Final");
+      isGameOver = true;
+    }
+    else {
+      setGDStrings(gameData,p,tr);
+    }
+  }
+
+  return isGameOver;
+
+}
+
+UpstreamError NHLProvider::getNextGame(const time_t today, const uint16_t teamID, NextGameData& nextGameData) {
+  return getNextGame_StatsApi(NHL_STATSAPI,today,teamID,nextGameData);
+}
+
+bool NHLProvider::getScoreboard(const time_t today, TickerBoard& board) {
+  return getScoreboard_StatsApi(NHL_STATSAPI,today,board);
+}
+
+void NHLProvider::printCurrentGame(const CurrentGameData& gameData) {
+  dPrintf(F("Home PP: %s\n"), gameData.homeOther ? "Yes" : "No");
+  dPrintf(F("Away PP: %s\n"), gameData.awayOther ? "Yes" : "No");
+}
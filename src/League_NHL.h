@@ -0,0 +1,26 @@
+#ifndef LEAGUE_NHL
+#define LEAGUE_NHL
+
+#include "LeagueProvider.h"
+
+const uint8_t NHL = 0;
+
+struct NHLProvider {
+
+  static constexpr uint8_t ID = NHL;
+  static constexpr size_t FILTER_DOC_SIZE = 256;
+  static constexpr size_t CURRENT_GAME_DOC_SIZE = 512;
+  static constexpr uint8_t CURRENT_GAME_NESTING = 10;
+  static constexpr const char* CURRENT_GAME_SEEK = nullptr;
+  static const LeagueInfo INFO;
+
+  static void currentGameURL(const uint32_t gameID, String& queryString);
+  static void currentGameFilter(JsonDocument& filter);
+  static bool extractCurrentGame(CurrentGameData& gameData, const uint32_t gameID, JsonDocument& doc);
+  static UpstreamError getNextGame(const time_t today, const uint16_t teamID, NextGameData& nextGameData);
+  static bool getScoreboard(const time_t today, TickerBoard& board);
+  static void printCurrentGame(const CurrentGameData& gameData);
+
+};
+
+#endif
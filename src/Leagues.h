@@ -0,0 +1,15 @@
+#ifndef LEAGUES
+#define LEAGUES
+
+#include "League_NHL.h"
+#include "League_MLB.h"
+#include "League_NBA.h"
+
+// Registry of supported leagues. Order has to match the provider IDs
+typedef LeagueList<NHLProvider,MLBProvider,NBAProvider> Leagues;
+
+static_assert(Leagues::idsAreIndexes(),"League provider IDs must match their position in Leagues");
+
+const uint8_t NUM_LEAGUES = Leagues::COUNT;
+
+#endif
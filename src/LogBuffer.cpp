@@ -0,0 +1,304 @@
+#include "LogBuffer.h"
+#include "Scheduler.h"
+#include "Debug.h"
+
+const uint16_t LOG_BUFFER_MASK = LOG_BUFFER_SIZE - 1;     // the size is a power of two
+
+uint8_t logRing[LOG_BUFFER_SIZE];
+volatile uint16_t logHead = 0;        // next byte written
+volatile uint16_t logTail = 0;        // next byte sent, only the log task moves it
+uint8_t logTaskHandle = NO_TASK;
+bool logMuted = false;
+bool logBinaryMode = false;
+char logLine[LOG_LINE_SIZE];          // the record being sent, as text or binary
+uint16_t logLineLength = 0;
+uint16_t logLineSent = 0;
+LogStats logCounters;
+
+void logBegin(const uint8_t task) {
+  logTaskHandle = task;
+}
+
+// called every pass of loop(), has to stay cheap
+void logCheck() {
+  if ((logHead != logTail) && !taskScheduled(logTaskHandle)) {
+    taskWakeNow(logTaskHandle);
+  }
+}
+
+// Copies a record in, with interrupts off. False if it doesn't fit
+bool IRAM_ATTR logPut(const uint8_t* data, const uint8_t size, bool& inIsr) {
+  uint32_t savedPS = xt_rsil(15);
+  inIsr = (savedPS & 0x0F) != 0;      // interrupt level was already up
+  uint16_t used = (logHead - logTail) & LOG_BUFFER_MASK;
+  bool fits = (used + size < LOG_BUFFER_SIZE);
+  if (fits) {
+    for (uint8_t i = 0; i < size; i++) {
+      logRing[(logHead + i) & LOG_BUFFER_MASK] = data[i];
+    }
+    logHead = (logHead + size) & LOG_BUFFER_MASK;
+    if (used + size > logCounters.maxUsed) {
+      logCounters.maxUsed = used + size;
+    }
+    logCounters.records++;
+    logCounters.bytes += size;
+  }
+  xt_wsr_ps(savedPS);
+  return fits;
+}
+
+void IRAM_ATTR LogRecord::commit() {
+  if (logMuted) {
+    logCounters.dropped++;
+    return;
+  }
+  _data[1] = _size - 2;
+  bool inIsr = false;
+  while (!logPut(_data,_size,inIsr)) {
+    if (inIsr) {
+      logCounters.dropped++;
+      break;
+    }
+    logCounters.flushes++;
+    logFlush();
+  }
+#if LOG_SYNC
+  if (!inIsr) {
+    logFlush();
+  }
+#endif
+  uint32_t us = micros() - _start;
+  logCounters.callerUs += us;
+  if (us > logCounters.maxCallerUs) {
+    logCounters.maxCallerUs = us;
+  }
+}
+
+void IRAM_ATTR logWrite(const uint8_t flags, PGM_P format) {
+  LogRecord record(flags,format);
+  record.commit();
+}
+
+// The oldest record, out of the ring. Returns its size, 0 for none
+uint8_t logTake(uint8_t* record) {
+  if (logHead == logTail) {
+    return 0;
+  }
+  uint8_t size = logRing[(logTail + 1) & LOG_BUFFER_MASK] + 2;
+  for (uint8_t i = 0; i < size; i++) {
+    record[i] = logRing[(logTail + i) & LOG_BUFFER_MASK];
+  }
+  logTail = (logTail + size) & LOG_BUFFER_MASK;
+  return size;
+}
+
+void logAppend(const char* text) {
+  while (*text && (logLineLength < LOG_LINE_SIZE)) {
+    logLine[logLineLength++] = *text++;
+  }
+}
+
+// One argument as text. spec is the printf conversion without its length
+// modifier, the stored type decides that. An argument that doesn't suit the
+// conversion is printed plainly
+void logFormatArg(const uint8_t*& pos, const uint8_t* end, const char* spec) {
+  char piece[LOG_MAX_STRING + 16];
+  char format[16];
+  uint8_t specLength = strlen(spec);
+  char conversion = spec[specLength - 1];
+  if (pos >= end) {
+    logAppend("?");         // cut off, the record was full
+    return;
+  }
+
+  switch (*pos++) {
+    case LOG_ARG_INT: {
+      int32_t value;
+      memcpy(&value,pos,4);
+      pos += 4;
+      snprintf(piece,sizeof(piece),strchr("diouxXc",conversion) ? spec : "%d",value);
+      break;
+    }
+    case LOG_ARG_LONG: {
+      int64_t value;
+      memcpy(&value,pos,8);
+      pos += 8;
+      if (strchr("diouxX",conversion)) {
+        snprintf(format,sizeof(format),"%.*sll%c",specLength - 1,spec,conversion);
+      }
+      snprintf(piece,sizeof(piece),strchr("diouxX",conversion) ? format : "%lld",value);
+      break;
+    }
+    case LOG_ARG_DOUBLE: {
+      double value;
+      memcpy(&value,pos,8);
+      pos += 8;
+      snprintf(piece,sizeof(piece),strchr("fFeEgG",conversion) ? spec : "%f",value);
+      break;
+    }
+    case LOG_ARG_STRING: {
+      char text[LOG_MAX_STRING + 1];
+      uint8_t length = *pos++;
+      length = min(length,LOG_MAX_STRING);
+      memcpy(text,pos,length);
+      text[length] = '\0';
+      pos += length;
+      snprintf(piece,sizeof(piece),(conversion == 's') ? spec : "%s",text);
+      break;
+    }
+    default:
+      pos = end;
+      piece[0] = '\0';
+  }
+  logAppend(piece);
+}
+
+// A record as the text dPrintf would have printed
+void logFormat(const uint8_t* record, const uint8_t size) {
+  uint32_t address;
+  memcpy(&address,record + 6,4);
+  PGM_P format = (PGM_P)(uintptr_t)address;
+  uint8_t flags = record[10];
+  const uint8_t* pos = record + LOG_HEADER_SIZE;
+  const uint8_t* end = record + size;
+
+  if (!format) {
+    while (pos < end) {
+      logFormatArg(pos,end,"%s");
+    }
+  }
+  else if (flags & LOG_LITERAL) {
+    char c;
+    while ((c = pgm_read_byte(format++)) && (logLineLength < LOG_LINE_SIZE)) {
+      logLine[logLineLength++] = c;
+    }
+  }
+  else {
+    char c;
+    char spec[16];
+    while ((c = pgm_read_byte(format++)) && (logLineLength < LOG_LINE_SIZE)) {
+      if (c != '%') {
+        logLine[logLineLength++] = c;
+        continue;
+      }
+      uint8_t specLength = 0;
+      spec[specLength++] = '%';
+      while ((c = pgm_read_byte(format)) && strchr("-+ #0123456789.",c) && (specLength < sizeof(spec) - 2)) {
+        spec[specLength++] = c;
+        format++;
+      }
+      while ((c = pgm_read_byte(format)) && strchr("hlLqjzt",c)) {
+        format++;
+      }
+      if (!c) {
+        break;
+      }
+      format++;
+      if (c == '%') {
+        logAppend("%");
+        continue;
+      }
+      spec[specLength++] = c;
+      spec[specLength] = '\0';
+      logFormatArg(pos,end,spec);
+    }
+  }
+  if (flags & LOG_NEWLINE) {
+    logAppend("\n");
+  }
+}
+
+void logPrepare(const uint8_t* record, const uint8_t size) {
+  logLineLength = 0;
+  logLineSent = 0;
+  if (logBinaryMode) {
+    memcpy(logLine,record,size);
+    logLineLength = size;
+  }
+  else {
+    logFormat(record,size);
+  }
+}
+
+// Log task. Sends what fits in the UART FIFO, comes back while there is more
+void logRun() {
+  uint8_t record[LOG_MAX_RECORD];
+  while (true) {
+    if (logLineSent == logLineLength) {
+      uint8_t size = logTake(record);
+      if (size == 0) {
+        return;     // logCheck() wakes us for the next one
+      }
+      logPrepare(record,size);
+    }
+    int room = Serial.availableForWrite();
+    uint16_t sending = min(room,(int)(logLineLength - logLineSent));
+    if (sending > 0) {
+      Serial.write((const uint8_t*)logLine + logLineSent,sending);
+      logLineSent += sending;
+    }
+    if (logLineSent < logLineLength) {
+      taskWakeIn(logTaskHandle,LOG_DRAIN_MS);
+      return;
+    }
+  }
+}
+
+void logFlush() {
+  uint8_t record[LOG_MAX_RECORD];
+  uint8_t size;
+  do {
+    if (logLineSent < logLineLength) {
+      Serial.write((const uint8_t*)logLine + logLineSent,logLineLength - logLineSent);
+    }
+    logLineSent = logLineLength = 0;
+    size = logTake(record);
+    if (size > 0) {
+      logPrepare(record,size);
+    }
+  } while (size > 0);
+}
+
+void logMute(const bool mute) {
+  logMuted = mute;
+}
+
+void logBinary(const bool binary) {
+  logFlush();       // what is queued goes out in the old form
+  logBinaryMode = binary;
+}
+
+bool logIsBinary() {
+  return logBinaryMode;
+}
+
+const LogStats& logStats() {
+  return logCounters;
+}
+
+void logPrintStats() {
+  if (logCounters.records == 0) {
+    return;
+  }
+  dPrintf(F("Log: %d records, %d bytes, buffer high water %d of %d, %d dropped, %d waited for the UART\n"),
+          logCounters.records,logCounters.bytes,logCounters.maxUsed,LOG_BUFFER_SIZE,logCounters.dropped,
+          logCounters.flushes);
+  dPrintf(F("Log time in callers: %llu us, avg %d us, max %d us%s\n"),logCounters.callerUs,
+          (uint32_t)(logCounters.callerUs / logCounters.records),logCounters.maxCallerUs,LOG_SYNC ? " (sync build)" : "");
+}
+
+size_t LogPrint::write(uint8_t c) {
+  _text[_length++] = c;
+  if (_length == LOG_MAX_STRING) {
+    flush();
+  }
+  return 1;
+}
+
+void LogPrint::flush() {
+  if (_length > 0) {
+    _text[_length] = '\0';
+    logWrite(0,nullptr,(const char*)_text);
+    _length = 0;
+  }
+}
@@ -0,0 +1,180 @@
+#ifndef LOG_BUFFER
+#define LOG_BUFFER
+
+#include <Arduino.h>
+
+/*  Log records in a RAM ring buffer, written to the serial port by the log
+    task. dPrintf() used to format and send on the spot. At 115200 baud that
+    held up the caller for about 87 us per character once the UART FIFO was
+    full, in ISRs and in the middle of polls.
+
+    A call now stores a binary record and returns. The record holds the
+    address of the format string in flash, the time and the arguments.
+    Numbers are stored as they are. Strings are copied, up to
+    LOG_MAX_STRING characters. Only the caller's work is done here:
+    formatting and the UART happen in the log task, which sends only what
+    fits in the UART FIFO and never waits. logCheck() is called from loop()
+    and wakes the task when there is something to send.
+
+    The task sends either:
+      text    formatted as before, for the serial monitor (default)
+      binary  the records as they are, LOG_FRAME_START then the length.
+              Console text in between passes through.
+              tools/log_decode.py turns a capture back into text, with
+              the format strings taken from the firmware ELF.
+
+    If the buffer is full, a task waits for it to drain (counted as a
+    flush). In an ISR the record is dropped and counted.
+
+    The time callers spend logging is summed, so it can be compared with a
+    -DLOG_SYNC=1 build, which sends every record straight away like the old
+    dPrintf. Both print it in the prof table (logPrintStats). test/test_log
+    does the same on the host against a model of the UART. A live game poll
+    (34 records, 1356 characters with the verbose JSON) held its caller for
+    about 107 ms in the sync build, 4.2 ms at most for one record. Buffered
+    it was 8 us of host time and no waits. Board numbers still have to come
+    from the prof table.
+
+    Record layout, little endian:
+      start (LOG_FRAME_START), size of the rest, millis() (4),
+      format address (4, 0 for none), flags, arguments
+    An argument is a LogArg type byte then 4 (int), 8 (long long, double),
+    or a length byte and the characters (string).
+*/
+
+#ifndef LOG_SYNC
+#define LOG_SYNC 0      // 1: send every record straight away, to compare
+#endif
+
+const uint16_t LOG_BUFFER_SIZE = 2048;  // a power of two
+const uint8_t LOG_MAX_RECORD = 128;
+const uint8_t LOG_MAX_STRING = 48;
+const uint8_t LOG_HEADER_SIZE = 11;
+const uint8_t LOG_FRAME_START = 0x1E;     // ASCII record separator, never in log text
+const uint16_t LOG_LINE_SIZE = 192;       // a record formatted as text, longer is cut
+const uint8_t LOG_DRAIN_MS = 5;           // the UART FIFO empties in about 11 ms
+
+// record flags
+const uint8_t LOG_NEWLINE = 0x01;         // dPrintln
+const uint8_t LOG_LITERAL = 0x02;         // the format is plain text (dPrint)
+const uint8_t LOG_TRUNCATED = 0x04;       // arguments didn't fit
+
+enum LogArg : uint8_t {LOG_ARG_INT,LOG_ARG_LONG,LOG_ARG_DOUBLE,LOG_ARG_STRING};
+
+typedef struct {
+  uint32_t records;
+  uint32_t bytes;
+  uint32_t dropped;               // buffer full in an ISR, or muted
+  uint32_t flushes;               // callers that had to wait for the UART
+  uint64_t callerUs;              // time spent in the logging calls
+  uint32_t maxCallerUs;
+  uint16_t maxUsed;               // high water mark of the buffer
+} LogStats;
+
+// One record, built on the caller's stack and copied into the buffer by commit()
+class LogRecord {
+  public:
+    LogRecord(const uint8_t flags, PGM_P format) : _start(micros()) {
+      uint32_t now = millis();
+      uint32_t address = (uint32_t)(uintptr_t)format;
+      _data[0] = LOG_FRAME_START;
+      put(&now,4,2);
+      put(&address,4,6);
+      _data[10] = flags;
+    }
+
+    void add(int value) { addInteger(value); }
+    void add(unsigned int value) { addInteger(value); }
+    void add(long value) { addInteger(value); }
+    void add(unsigned long value) { addInteger(value); }
+    void add(long long value) { addInteger(value); }
+    void add(unsigned long long value) { addInteger(value); }
+    void add(double value) { addNumber(LOG_ARG_DOUBLE,&value,8); }
+    void add(const String& value) { add(value.c_str()); }
+    void add(const char* value) {
+      uint8_t length = 0;
+      while (value && value[length] && (length < LOG_MAX_STRING)) {
+        length++;
+      }
+      if (!room(length + 2)) {
+        return;
+      }
+      _data[_size++] = LOG_ARG_STRING;
+      _data[_size++] = length;
+      put(value,length,_size);
+      _size += length;
+    }
+
+    void commit();
+
+  private:
+    bool room(const uint8_t size) {
+      if (_size + size > LOG_MAX_RECORD) {
+        _data[10] |= LOG_TRUNCATED;
+        return false;
+      }
+      return true;
+    }
+    void put(const void* value, const uint8_t size, const uint8_t pos) {
+      for (uint8_t i = 0; i < size; i++) {
+        _data[pos + i] = ((const uint8_t*)value)[i];
+      }
+    }
+    template <typename T>
+    void addInteger(const T value) {
+      addNumber((sizeof(value) > 4) ? LOG_ARG_LONG : LOG_ARG_INT,&value,(sizeof(value) > 4) ? 8 : 4);
+    }
+    void addNumber(const LogArg type, const void* value, const uint8_t size) {
+      if (room(size + 1)) {
+        _data[_size++] = type;
+        put(value,size,_size);
+        _size += size;
+      }
+    }
+
+    uint32_t _start;
+    uint8_t _size = LOG_HEADER_SIZE;
+    uint8_t _data[LOG_MAX_RECORD];
+};
+
+inline void logArgs(LogRecord& record) {}
+
+template <typename T, typename... Rest>
+inline void logArgs(LogRecord& record, const T& value, const Rest&... rest) {
+  record.add(value);
+  logArgs(record,rest...);
+}
+
+void logWrite(const uint8_t flags, PGM_P format);     // no arguments, in IRAM for ISRs
+
+template <typename T, typename... Rest>
+inline void logWrite(const uint8_t flags, PGM_P format, const T& first, const Rest&... rest) {
+  LogRecord record(flags,format);
+  logArgs(record,first,rest...);
+  record.commit();
+}
+
+// Text in pieces, one string record per LOG_MAX_STRING characters.
+// For output that comes as a stream, like serializeJson()
+class LogPrint : public Print {
+  public:
+    ~LogPrint() { flush(); }
+    size_t write(uint8_t c) override;
+    void flush() override;
+  private:
+    char _text[LOG_MAX_STRING + 1];
+    uint8_t _length = 0;
+};
+
+void logBegin(const uint8_t task);
+void logCheck();
+void logRun();
+void logFlush();                        // everything buffered, waits for the UART
+void logMute(const bool mute);          // records are dropped while muted
+void logBinary(const bool binary);
+bool logIsBinary();
+
+const LogStats& logStats();
+void logPrintStats();
+
+#endif
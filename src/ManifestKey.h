@@ -0,0 +1,14 @@
+#ifndef MANIFEST_KEY
+#define MANIFEST_KEY
+
+#include <Arduino.h>
+
+/*  Public half of the key manifest.json is signed with (UpdateManifest.h).
+    Written by tools/make_manifest.py --key-header public.key. Until then it
+    is empty and the device takes no updates, unless built with
+    -DMANIFEST_UNSIGNED=1.
+*/
+
+const char MANIFEST_PUBLIC_KEY[] PROGMEM = "";
+
+#endif
@@ -0,0 +1,305 @@
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include "Peers.h"
+#include "Scheduler.h"
+#include "Clock.h"
+#include "Debug.h"
+
+WiFiUDP peerUdp;
+uint8_t peerTaskHandle = NO_TASK;
+PeerReceiver peerOnGame = nullptr;
+bool peerOn = true;
+bool peerStarted = false;
+int peerPending = 0;            // size of a packet parsePacket already took
+uint32_t peerID = 0;
+PeerStats peerCounters;
+
+// the game we are interested in and who leads it
+uint8_t followLeague = 0xFF;
+uint32_t followGameID = 0;
+uint32_t leaderID = 0;
+uint64_t leaderHeard = 0;
+uint16_t leaderIntervalS = 0;
+
+// last state from the leader
+CurrentGameData rxGame;
+uint32_t rxSender = 0;
+uint16_t rxSeq = 0;
+bool rxValid = false;
+
+// what we sent last while leading
+CurrentGameData txGame;
+uint16_t txSeq = 0;
+uint8_t txSinceKeyframe = 0;
+bool txGameOver = false;
+uint16_t txIntervalS = 0;
+uint64_t lastPublish = 0;
+
+void peerBegin(const uint8_t task, PeerReceiver onGame) {
+  peerTaskHandle = task;
+  peerOnGame = onGame;
+  peerID = ESP.getChipId();
+}
+
+void peerEnable(const bool enable) {
+  peerOn = enable;
+  leaderID = 0;
+  rxValid = false;
+}
+
+bool peerEnabled() {
+  return peerOn;
+}
+
+bool peerAlive(const uint64_t heard, const uint16_t intervalS) {
+  return (heard != 0) && ((clockMillis() - heard) < (uint64_t)PEER_LEADER_TIMEOUTS * intervalS * 1000);
+}
+
+bool peerLeading() {
+  return peerAlive(lastPublish,txIntervalS) && (txGame.league == followLeague) && (txGame.gameID == followGameID);
+}
+
+// called every pass of loop(), has to stay cheap
+void peerCheck() {
+  if (!peerOn) {
+    return;
+  }
+  if (!peerStarted) {
+    if (WiFi.status() != WL_CONNECTED) {
+      return;
+    }
+    peerUdp.beginMulticast(WiFi.localIP(),IPAddress(PEER_GROUP[0],PEER_GROUP[1],PEER_GROUP[2],PEER_GROUP[3]),PEER_PORT);
+    peerStarted = true;
+  }
+  if ((peerPending == 0) && ((peerPending = peerUdp.parsePacket()) > 0)) {
+    taskWakeNow(peerTaskHandle);
+  }
+}
+
+uint16_t changedFields(const CurrentGameData& prev, const CurrentGameData& curr) {
+  uint16_t fields = 0;
+  if (prev.awayID != curr.awayID) { fields |= PEER_AWAY_ID; }
+  if (prev.homeID != curr.homeID) { fields |= PEER_HOME_ID; }
+  if (prev.awayScore != curr.awayScore) { fields |= PEER_AWAY_SCORE; }
+  if (prev.homeScore != curr.homeScore) { fields |= PEER_HOME_SCORE; }
+  if (prev.awayOther != curr.awayOther) { fields |= PEER_AWAY_OTHER; }
+  if (prev.homeOther != curr.homeOther) { fields |= PEER_HOME_OTHER; }
+  if (strncmp(prev.devision,curr.devision,sizeof(curr.devision)) != 0) { fields |= PEER_DIVISION; }
+  if (strncmp(prev.timeRemaining,curr.timeRemaining,sizeof(curr.timeRemaining)) != 0) { fields |= PEER_CLOCK; }
+  if (prev.outs != curr.outs) { fields |= PEER_OUTS; }
+  if (memcmp(prev.bases,curr.bases,sizeof(curr.bases)) != 0) { fields |= PEER_BASES; }
+  return fields;
+}
+
+uint8_t encodeFields(uint8_t* out, const CurrentGameData& game, const uint16_t fields) {
+  uint8_t* p = out;
+  if (fields & PEER_AWAY_ID) { *p++ = game.awayID; }
+  if (fields & PEER_HOME_ID) { *p++ = game.homeID; }
+  if (fields & PEER_AWAY_SCORE) { *p++ = game.awayScore; }
+  if (fields & PEER_HOME_SCORE) { *p++ = game.homeScore; }
+  if (fields & PEER_AWAY_OTHER) { *p++ = game.awayOther; }
+  if (fields & PEER_HOME_OTHER) { *p++ = game.homeOther; }
+  if (fields & PEER_DIVISION) { memcpy(p,game.devision,sizeof(game.devision)); p += sizeof(game.devision); }
+  if (fields & PEER_CLOCK) { memcpy(p,game.timeRemaining,sizeof(game.timeRemaining)); p += sizeof(game.timeRemaining); }
+  if (fields & PEER_OUTS) { *p++ = game.outs; }
+  if (fields & PEER_BASES) { *p++ = game.bases[0] | (game.bases[1] << 1) | (game.bases[2] << 2); }
+  return p - out;
+}
+
+// false if the packet is shorter than its fields say
+bool decodeFields(const uint8_t* in, const uint8_t size, CurrentGameData& game, const uint16_t fields) {
+  const uint8_t* p = in;
+  const uint8_t* end = in + size;
+  auto take = [&](void* dest, const uint8_t count) {
+    if (p + count > end) {
+      return false;
+    }
+    memcpy(dest,p,count);
+    p += count;
+    return true;
+  };
+  uint8_t bases = 0;
+  bool ok = true;
+  if (fields & PEER_AWAY_ID) { ok = ok && take(&game.awayID,1); }
+  if (fields & PEER_HOME_ID) { ok = ok && take(&game.homeID,1); }
+  if (fields & PEER_AWAY_SCORE) { ok = ok && take(&game.awayScore,1); }
+  if (fields & PEER_HOME_SCORE) { ok = ok && take(&game.homeScore,1); }
+  if (fields & PEER_AWAY_OTHER) { ok = ok && take(&game.awayOther,1); }
+  if (fields & PEER_HOME_OTHER) { ok = ok && take(&game.homeOther,1); }
+  if (fields & PEER_DIVISION) { ok = ok && take(game.devision,sizeof(game.devision)); }
+  if (fields & PEER_CLOCK) { ok = ok && take(game.timeRemaining,sizeof(game.timeRemaining)); }
+  if (fields & PEER_OUTS) { ok = ok && take(&game.outs,1); }
+  if ((fields & PEER_BASES) && (ok = ok && take(&bases,1))) {
+    game.bases[0] = bases & 0x01;
+    game.bases[1] = bases & 0x02;
+    game.bases[2] = bases & 0x04;
+  }
+  game.devision[sizeof(game.devision) - 1] = '\0';
+  game.timeRemaining[sizeof(game.timeRemaining) - 1] = '\0';
+  return ok;
+}
+
+void sendPacket(const uint8_t* packet, const uint8_t size) {
+  peerUdp.beginPacketMulticast(IPAddress(PEER_GROUP[0],PEER_GROUP[1],PEER_GROUP[2],PEER_GROUP[3]),PEER_PORT,WiFi.localIP());
+  peerUdp.write(packet,size);
+  peerUdp.endPacket();
+  peerCounters.sent++;
+}
+
+// the latest txGame, only the given fields
+void sendGame(const uint16_t fields, const bool keyframe) {
+  uint8_t packet[PEER_PACKET_SIZE];
+  PeerHeader header = {PEER_MAGIC,PEER_VERSION,PEER_GAME,peerID,txGame.league,
+                       (uint8_t)((keyframe ? PEER_KEYFRAME : 0) | (txGameOver ? PEER_GAME_OVER : 0)),txIntervalS,
+                       txGame.gameID,(uint16_t)(txSeq + 1),txSeq,fields};
+  txSeq++;
+  memcpy(packet,&header,sizeof(header));
+  sendPacket(packet,sizeof(header) + encodeFields(packet + sizeof(header),txGame,fields));
+}
+
+void sendSync(const uint8_t league, const uint32_t gameID) {
+  PeerHeader header = {PEER_MAGIC,PEER_VERSION,PEER_SYNC,peerID,league,0,0,gameID,0,0,0};
+  sendPacket((const uint8_t*)&header,sizeof(header));
+}
+
+void peerPublish(const CurrentGameData& game, const bool isGameOver, const uint16_t intervalS) {
+
+  if (!peerOn || !peerStarted) {
+    return;
+  }
+
+  bool newGame = (game.league != txGame.league) || (game.gameID != txGame.gameID) || !peerLeading();
+  bool keyframe = newGame || (txSinceKeyframe >= PEER_KEYFRAME_EVERY);
+  uint16_t fields = keyframe ? PEER_ALL_FIELDS : changedFields(txGame,game);
+
+  txGame = game;
+  txGameOver = isGameOver;
+  txIntervalS = intervalS;
+  lastPublish = clockMillis();
+  followLeague = game.league;
+  followGameID = game.gameID;
+  txSinceKeyframe = keyframe ? 1 : txSinceKeyframe + 1;
+
+  sendGame(fields,keyframe);
+
+}
+
+bool peerFollowing(const uint8_t league, const uint32_t gameID) {
+
+  if (!peerOn) {
+    return false;
+  }
+  if ((league != followLeague) || (gameID != followGameID)) {
+    followLeague = league;
+    followGameID = gameID;
+    leaderID = 0;
+    rxValid = false;
+    return false;
+  }
+  if ((leaderID == 0) || !peerAlive(leaderHeard,leaderIntervalS)) {
+    return false;
+  }
+  peerCounters.upstreamSaved++;
+  return true;
+
+}
+
+void handleGame(const PeerHeader& header, const uint8_t* body, const uint8_t bodySize) {
+
+  if ((header.league != followLeague) || (header.gameID != followGameID)) {
+    return;
+  }
+
+  // lowest chip ID leads, anyone else steps aside for it
+  if (peerLeading()) {
+    if (header.sender > peerID) {
+      return;
+    }
+    dPrintf(F("Peer %08x leads %d, stepping down\n"),header.sender,header.gameID);
+    lastPublish = 0;
+    peerCounters.stepDowns++;
+  }
+  if ((leaderID != 0) && (header.sender != leaderID) && peerAlive(leaderHeard,leaderIntervalS) && (header.sender > leaderID)) {
+    return;
+  }
+  if (header.sender != leaderID) {
+    dPrintf(F("Following peer %08x for game %d\n"),header.sender,header.gameID);
+  }
+  leaderID = header.sender;
+  leaderHeard = clockMillis();
+  leaderIntervalS = header.intervalS;
+
+  bool keyframe = header.flags & PEER_KEYFRAME;
+  if (!keyframe && (!rxValid || (rxSender != header.sender) || (rxSeq != header.baseSeq))) {
+    peerCounters.syncs++;
+    rxValid = false;
+    sendSync(header.league,header.gameID);
+    return;
+  }
+
+  CurrentGameData game = keyframe ? CurrentGameData() : rxGame;
+  if (!decodeFields(body,bodySize,game,header.fields)) {
+    return;
+  }
+  game.league = header.league;
+  game.gameID = header.gameID;
+  rxGame = game;
+  rxSender = header.sender;
+  rxSeq = header.seq;
+  rxValid = true;
+  peerCounters.applied++;
+
+  if (peerOnGame) {
+    peerOnGame(rxGame,header.flags & PEER_GAME_OVER);
+  }
+
+}
+
+// Peer task. Works through every packet that has arrived
+void peerRun() {
+
+  uint8_t packet[PEER_PACKET_SIZE];
+
+  while (peerPending > 0) {
+    int size = peerUdp.read(packet,sizeof(packet));
+    peerPending = peerUdp.parsePacket();
+
+    if (size < (int)sizeof(PeerHeader)) {
+      continue;
+    }
+    PeerHeader header;
+    memcpy(&header,packet,sizeof(header));
+    if ((header.magic != PEER_MAGIC) || (header.version != PEER_VERSION) || (header.sender == peerID)) {
+      continue;
+    }
+    peerCounters.received++;
+
+    if (header.type == PEER_GAME) {
+      handleGame(header,packet + sizeof(PeerHeader),size - sizeof(PeerHeader));
+    }
+    else if ((header.type == PEER_SYNC) && peerLeading() && (header.league == txGame.league) && (header.gameID == txGame.gameID)) {
+      sendGame(PEER_ALL_FIELDS,true);
+    }
+  }
+
+}
+
+const PeerStats& peerStats() {
+  return peerCounters;
+}
+
+void peerPrintStatus() {
+  dPrintf(F("Peers %s, we are %08x, game %d: "),peerOn ? "on" : "off",peerID,followGameID);
+  if (peerLeading()) {
+    dPrintf(F("leading\n"));
+  }
+  else if ((leaderID != 0) && peerAlive(leaderHeard,leaderIntervalS)) {
+    dPrintf(F("following %08x\n"),leaderID);
+  }
+  else {
+    dPrintf(F("polling ourselves\n"));
+  }
+  dPrintf(F("Peer packets: %d sent, %d received, %d applied, %d syncs, %d step downs, %d polls saved\n"),
+          peerCounters.sent,peerCounters.received,peerCounters.applied,peerCounters.syncs,peerCounters.stepDowns,
+          peerCounters.upstreamSaved);
+}
@@ -0,0 +1,93 @@
+#ifndef PEERS
+#define PEERS
+
+#include <Arduino.h>
+#include "GameData.h"
+
+/*  Sharing live scores with other scoreboards on the LAN. For each game, one
+    device is the leader. It polls upstream as usual and multicasts the result
+    after every poll. The others follow and take the score from those packets
+    instead of querying upstream themselves.
+
+    Leadership is implicit. A device follows while it has heard another
+    device's packets for its game within PEER_LEADER_TIMEOUTS of that leader's
+    poll interval. Otherwise it polls itself, which makes it a leader. If two
+    leaders hear each other, the one with the higher chip ID steps down. So a
+    leader that goes quiet is replaced within a few poll intervals by whoever
+    notices first.
+
+    Packets are PeerHeader, then the CurrentGameData fields whose bit is set
+    in "fields", in bit order. Every PEER_KEYFRAME_EVERY packets, or when the
+    game changes, all fields are sent. In between, only the fields that
+    changed since the previous packet (baseSeq) are sent. A follower that
+    missed a packet multicasts a PEER_SYNC. The leader answers with a
+    keyframe straight away. tools/peer_sim.py speaks the same format.
+*/
+
+const uint16_t PEER_PORT = 4210;
+const uint8_t PEER_GROUP[4] = {239,77,12,3};
+const uint16_t PEER_MAGIC = 0x5353;     // "SS"
+const uint8_t PEER_VERSION = 1;
+const uint8_t PEER_KEYFRAME_EVERY = 8;
+const uint8_t PEER_LEADER_TIMEOUTS = 3;
+const uint8_t PEER_PACKET_SIZE = 64;
+
+enum PeerType : uint8_t {PEER_GAME = 1,PEER_SYNC = 2};
+
+// flags
+const uint8_t PEER_KEYFRAME = 0x01;
+const uint8_t PEER_GAME_OVER = 0x02;
+
+// fields, in the order they follow the header
+const uint16_t PEER_AWAY_ID = 0x0001;       // u8
+const uint16_t PEER_HOME_ID = 0x0002;       // u8
+const uint16_t PEER_AWAY_SCORE = 0x0004;    // u8
+const uint16_t PEER_HOME_SCORE = 0x0008;    // u8
+const uint16_t PEER_AWAY_OTHER = 0x0010;    // u8
+const uint16_t PEER_HOME_OTHER = 0x0020;    // u8
+const uint16_t PEER_DIVISION = 0x0040;      // char[5]
+const uint16_t PEER_CLOCK = 0x0080;         // char[6]
+const uint16_t PEER_OUTS = 0x0100;          // u8
+const uint16_t PEER_BASES = 0x0200;         // u8, bit 0 is first base
+const uint16_t PEER_ALL_FIELDS = 0x03FF;
+
+typedef struct __attribute__((packed)) {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t type;            // PeerType
+  uint32_t sender;         // chip ID
+  uint8_t league;
+  uint8_t flags;
+  uint16_t intervalS;      // the sender's poll interval
+  uint32_t gameID;
+  uint16_t seq;
+  uint16_t baseSeq;        // the packet this one is a delta on
+  uint16_t fields;
+} PeerHeader;
+
+static_assert(sizeof(PeerHeader) == 22,"PeerHeader is part of the wire format");
+
+// a follower got a new state for the game it follows
+typedef void (*PeerReceiver)(const CurrentGameData& game, const bool isGameOver);
+
+typedef struct {
+  uint32_t sent = 0;
+  uint32_t received = 0;
+  uint32_t applied = 0;
+  uint32_t syncs = 0;          // deltas we couldn't apply
+  uint32_t stepDowns = 0;
+  uint32_t upstreamSaved = 0;  // polls skipped while following
+} PeerStats;
+
+void peerBegin(const uint8_t task, PeerReceiver onGame);
+void peerEnable(const bool enable);
+bool peerEnabled();
+void peerCheck();
+void peerRun();
+
+bool peerFollowing(const uint8_t league, const uint32_t gameID);
+void peerPublish(const CurrentGameData& game, const bool isGameOver, const uint16_t intervalS);
+const PeerStats& peerStats();
+void peerPrintStatus();
+
+#endif
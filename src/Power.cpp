@@ -0,0 +1,191 @@
+#include <ESP8266WiFi.h>
+#include <coredecls.h>
+#include <sys/time.h>
+extern "C" {
+  #include <user_interface.h>
+  #include <gpio.h>
+}
+#include "Power.h"
+#include "Clock.h"
+#include "Debug.h"
+
+uint8_t powerSelectPin = 0;
+uint8_t powerSwitchPin = 0;
+uint8_t powerBacklightPin = 0;
+void (*powerOnWake)() = nullptr;
+
+bool lightSleepAllowed = false;
+bool wifiSuspended = false;
+bool wifiRestoring = false;
+
+// state timeline totals for the energy model
+uint64_t awakeIdleMs = 0;
+uint64_t lightSleepMs = 0;
+uint64_t wifiRestoreMs = 0;
+uint64_t backlightOnMs = 0;
+uint32_t wakeups = 0;
+uint64_t wifiRestoreStart = 0;
+uint64_t lastBacklightSample = 0;
+uint64_t lastReport = 0;
+
+// station config saved before the radio goes off so reconnecting skips the scan
+char savedSSID[33];
+char savedPSK[65];
+uint8_t savedBSSID[6];
+int32_t savedChannel = 0;
+
+void powerBegin(const uint8_t selectPin, const uint8_t switchPin, const uint8_t backlightPin, void (*onWake)()) {
+  powerSelectPin = selectPin;
+  powerSwitchPin = switchPin;
+  powerBacklightPin = backlightPin;
+  powerOnWake = onWake;
+  WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+  lastBacklightSample = clockMillis();
+  lastReport = clockMillis();
+}
+
+void powerAllowLightSleep(const bool allow) {
+  lightSleepAllowed = allow;
+}
+
+bool powerLightSleepAllowed() {
+  return lightSleepAllowed;
+}
+
+void suspendWiFi() {
+  snprintf(savedSSID,sizeof(savedSSID),"%s",WiFi.SSID().c_str());
+  snprintf(savedPSK,sizeof(savedPSK),"%s",WiFi.psk().c_str());
+  memcpy(savedBSSID,WiFi.BSSID(),sizeof(savedBSSID));
+  savedChannel = WiFi.channel();
+
+  WiFi.persistent(false);      // don't wear the flash every time the radio goes off
+  WiFi.mode(WIFI_OFF);
+  wifiSuspended = true;
+}
+
+void restoreWiFi() {
+  dPrintf(F("Restoring WiFi: %s ch %d\n"),savedSSID,savedChannel);
+  wifiRestoreStart = clockMillis();
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(savedSSID,savedPSK,savedChannel,savedBSSID);
+  WiFi.persistent(true);
+  wifiSuspended = false;
+  wifiRestoring = true;
+}
+
+// true once the network can be used. Starts bringing WiFi back if it is off
+bool powerWiFiReady() {
+
+  if (wifiSuspended) {
+    restoreWiFi();
+  }
+
+  bool ready = (WiFi.status() == WL_CONNECTED);
+  if (ready && wifiRestoring) {
+    uint32_t took = clockMillis() - wifiRestoreStart;
+    wifiRestoring = false;
+    wifiRestoreMs += took;
+    dPrintf(F("WiFi restored in %d ms\n"),took);
+  }
+  return ready;
+}
+
+void lightSleepWakeup() {
+  esp_schedule();     // end the delay() we are sleeping in
+}
+
+void lightSleep(const uint32_t ms) {
+
+  uint8_t switchLevel = digitalRead(powerSwitchPin);
+
+  if (!wifiSuspended) {
+    suspendWiFi();
+  }
+
+  uint64_t startUs = micros64();
+  uint32_t rtcStart = system_get_rtc_time();
+  uint32_t rtcCal = system_rtc_clock_cali_proc();    // us per rtc tick, Q12
+
+  wifi_fpm_set_sleep_type(LIGHT_SLEEP_T);
+  wifi_fpm_open();
+  gpio_pin_wakeup_enable(GPIO_ID_PIN(powerSelectPin),GPIO_PIN_INTR_LOLEVEL);
+  gpio_pin_wakeup_enable(GPIO_ID_PIN(powerSwitchPin),switchLevel ? GPIO_PIN_INTR_LOLEVEL : GPIO_PIN_INTR_HILEVEL);
+  wifi_fpm_set_wakeup_cb(lightSleepWakeup);
+  wifi_fpm_do_sleep(ms * 1000);
+  delay(ms + 1);      // the chip sleeps in here
+
+  gpio_pin_wakeup_disable();
+  wifi_fpm_close();
+
+  uint64_t sleptUs = ((uint64_t)(system_get_rtc_time() - rtcStart) * rtcCal) >> 12;
+  uint64_t countedUs = micros64() - startUs;
+  uint32_t sleptMs = sleptUs / 1000;
+  if (sleptUs > countedUs) {
+    uint32_t missingUs = sleptUs - countedUs;
+    clockAdvanceUs(missingUs);
+
+    struct timeval tv;
+    gettimeofday(&tv,nullptr);
+    tv.tv_sec += missingUs / 1000000;
+    tv.tv_usec += missingUs % 1000000;
+    if (tv.tv_usec >= 1000000) {
+      tv.tv_sec++;
+      tv.tv_usec -= 1000000;
+    }
+    settimeofday(&tv,nullptr);
+  }
+  lightSleepMs += sleptMs;
+  wakeups++;
+
+  // the wakeup source left the pins in level interrupt mode
+  if (powerOnWake) {
+    powerOnWake();
+  }
+
+  bool byGPIO = (digitalRead(powerSelectPin) == LOW) || (digitalRead(powerSwitchPin) != switchLevel);
+  if (byGPIO) {
+    dPrintf(F("Woken by button after %d ms\n"),sleptMs);
+    restoreWiFi();
+  }
+
+}
+
+void powerIdle(const uint32_t untilNextMs) {
+
+  uint64_t now = clockMillis();
+  if (digitalRead(powerBacklightPin)) {
+    backlightOnMs += now - lastBacklightSample;
+  }
+  lastBacklightSample = now;
+
+  bool longWait = (untilNextMs >= POWER_LIGHT_SLEEP_MIN_MS) || (wifiSuspended && (untilNextMs > POWER_WIFI_RESTORE_MS * 2));
+
+  if (lightSleepAllowed && longWait && (wifiSuspended || (WiFi.status() == WL_CONNECTED))) {
+    uint32_t sleepMs = (untilNextMs == POWER_FOREVER) ? POWER_MAX_LIGHT_SLEEP_MS : untilNextMs - POWER_WIFI_RESTORE_MS;
+    lightSleep(min(sleepMs,POWER_MAX_LIGHT_SLEEP_MS));
+  }
+  else {
+    if (wifiSuspended && (untilNextMs <= POWER_WIFI_RESTORE_MS * 2)) {
+      restoreWiFi();
+    }
+    uint32_t idle = min(untilNextMs,(uint32_t)POWER_IDLE_SLICE_MS);
+    delay(idle);
+    if (!wifiRestoring) {
+      awakeIdleMs += idle;      // waiting for the reconnect counts as wifi restore
+    }
+  }
+
+  if (wifiRestoring) {
+    powerWiFiReady();
+  }
+
+  if ((clockMillis() - lastReport) >= POWER_REPORT_INTERVAL_MS) {
+    powerReport();
+  }
+
+}
+
+void powerReport() {
+  lastReport = clockMillis();
+  dPrintf(F("PWR,%llu,%llu,%llu,%llu,%llu,%u\n"),lastReport,awakeIdleMs,lightSleepMs,wifiRestoreMs,backlightOnMs,wakeups);
+}
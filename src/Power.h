@@ -0,0 +1,35 @@
+#ifndef POWER
+#define POWER
+
+#include <Arduino.h>
+
+/*  Power manager. The scheduler hands every idle period to powerIdle().
+    Short waits are spent in delay() with the radio in modem sleep. Waits of at
+    least POWER_LIGHT_SLEEP_MIN_MS put the chip into forced light sleep with WiFi
+    off; the select button and the display switch wake it early. WiFi is brought
+    back with the cached BSSID/channel ahead of the next deadline.
+
+    Forced light sleep stops the system timer so millis() and time() fall behind.
+    The sleep is measured with the RTC clock and the monotonic clock (Clock.h) and
+    the wall clock are advanced by the missing time.
+
+    Every POWER_REPORT_INTERVAL_MS a summary line is printed for the host side
+    energy model (tools/energy_model.py):
+      PWR,<uptime ms>,<idle ms>,<light sleep ms>,<wifi restore ms>,<backlight on ms>,<wakeups>
+*/
+
+const uint32_t POWER_FOREVER = 0xFFFFFFFF;
+const uint32_t POWER_LIGHT_SLEEP_MIN_MS = 5 * 60 * 1000;       // not worth dropping WiFi for less
+const uint32_t POWER_MAX_LIGHT_SLEEP_MS = 268 * 1000;          // SDK limit for a timed sleep
+const uint32_t POWER_WIFI_RESTORE_MS = 5 * 1000;               // wake this much before a deadline
+const uint32_t POWER_REPORT_INTERVAL_MS = 10 * 60 * 1000;
+const uint16_t POWER_IDLE_SLICE_MS = 25;                       // ISR latency bound when not light sleeping
+
+void powerBegin(const uint8_t selectPin, const uint8_t switchPin, const uint8_t backlightPin, void (*onWake)());
+void powerIdle(const uint32_t untilNextMs);
+void powerAllowLightSleep(const bool allow);
+bool powerLightSleepAllowed();
+bool powerWiFiReady();
+void powerReport();
+
+#endif
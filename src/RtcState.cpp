@@ -0,0 +1,47 @@
+#include <coredecls.h>
+extern "C" {
+  #include <user_interface.h>
+}
+#include "RtcState.h"
+#include "Debug.h"
+
+uint32_t rtcStateCRC(const RtcState& state) {
+  const uint8_t* data = (const uint8_t*)&state + sizeof(state.crc);
+  return crc32(data,sizeof(state) - sizeof(state.crc));
+}
+
+bool rtcStateLoad(RtcState& state) {
+
+  RtcState stored;
+  if (!ESP.rtcUserMemoryRead(0,(uint32_t*)&stored,sizeof(stored))) {
+    return false;
+  }
+
+  if ((stored.magic != RTC_STATE_MAGIC) || (stored.crc != rtcStateCRC(stored))) {
+    dPrintf(F("No valid game state in RTC memory\n"));
+    return false;
+  }
+
+  state = stored;
+  return true;
+}
+
+void rtcStateSave(RtcState& state) {
+  state.magic = RTC_STATE_MAGIC;
+  state.crc = rtcStateCRC(state);
+  ESP.rtcUserMemoryWrite(0,(uint32_t*)&state,sizeof(state));
+}
+
+// RTC memory only holds anything worth reading after one of these
+bool rtcStateWarmReset() {
+  switch (ESP.getResetInfoPtr()->reason) {
+    case REASON_SOFT_RESTART:
+    case REASON_EXCEPTION_RST:
+    case REASON_SOFT_WDT_RST:
+    case REASON_WDT_RST:
+    case REASON_EXT_SYS_RST:
+      return true;
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef RTC_STATE
+#define RTC_STATE
+
+#include <Arduino.h>
+#include "GameData.h"
+
+/*  Game state kept in RTC user memory. It survives ESP.restart(), watchdog
+    and exception resets (not power loss), so a crash during a live game can
+    go straight back to polling it instead of the full boot path.
+
+    Lives at the start of user memory. eboot keeps its OTA command 256 bytes in
+    so this has to stay below that.
+*/
+
+const uint32_t RTC_STATE_MAGIC = 0x54465431;     // "TFT1", bump when the layout changes
+
+typedef struct {
+  uint32_t crc = 0;            // crc32 of everything after this field
+  uint32_t magic = RTC_STATE_MAGIC;
+  uint8_t gameStatus = 0;
+  uint8_t league = 0;
+  uint16_t teamID = 0;
+  NextGameData nextGame;
+  CurrentGameData currentGame;
+} RtcState;
+
+static_assert(sizeof(RtcState) <= 256,"RtcState would overwrite the eboot command");
+
+bool rtcStateLoad(RtcState& state);
+void rtcStateSave(RtcState& state);
+bool rtcStateWarmReset();
+
+#endif
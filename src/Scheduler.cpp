@@ -0,0 +1,153 @@
+#include "Scheduler.h"
+#include "Power.h"
+#include "Clock.h"
+#include "Debug.h"
+
+Task tasks[MAX_TASKS];
+uint8_t numTasks = 0;
+uint64_t idleMs = 0;
+bool virtualTime = false;
+uint64_t virtualMs = 0;       // time skipped on virtual time, on top of clockMillis
+
+uint8_t taskAdd(const char* name, TaskCallback callback) {
+
+  if (numTasks >= MAX_TASKS) {
+    dPrintf(F("Too many tasks: %s\n"),name);
+    return NO_TASK;
+  }
+
+  Task& task = tasks[numTasks];
+  task.name = name;
+  task.callback = callback;
+  task.wakeTime = 0;
+  task.scheduled = false;
+  task.wakeRequested = false;
+  task.runCount = 0;
+  task.totalRunUs = 0;
+  task.maxRunUs = 0;
+  task.totalLateMs = 0;
+  task.maxLateMs = 0;
+
+  return numTasks++;
+}
+
+void taskWakeIn(const uint8_t task, const uint32_t delayMs) {
+  if (task < numTasks) {
+    tasks[task].wakeTime = schedulerMillis() + delayMs;
+    tasks[task].scheduled = true;
+  }
+}
+
+void taskWakeNow(const uint8_t task) {
+  taskWakeIn(task,0);
+}
+
+// only sets a flag, the scheduler moves the task to "now" on its next pass
+void ICACHE_RAM_ATTR taskWakeFromISR(const uint8_t task) {
+  if (task < numTasks) {
+    tasks[task].wakeRequested = true;
+  }
+}
+
+void taskStop(const uint8_t task) {
+  if (task < numTasks) {
+    tasks[task].scheduled = false;
+  }
+}
+
+bool taskScheduled(const uint8_t task) {
+  return (task < numTasks) && tasks[task].scheduled;
+}
+
+const Task* taskInfo(const uint8_t task) {
+  return (task < numTasks) ? &tasks[task] : nullptr;
+}
+
+// run the next due task or idle until one is due
+void schedulerRun() {
+
+  uint64_t now = schedulerMillis();
+  uint8_t next = NO_TASK;
+  int64_t nextDelta = 0;
+
+  for (uint8_t i = 0; i < numTasks; i++) {
+    if (tasks[i].wakeRequested) {
+      tasks[i].wakeRequested = false;
+      tasks[i].wakeTime = now;
+      tasks[i].scheduled = true;
+    }
+    if (tasks[i].scheduled) {
+      int64_t delta = (int64_t)(tasks[i].wakeTime - now);
+      if ((next == NO_TASK) || (delta < nextDelta)) {
+        next = i;
+        nextDelta = delta;
+      }
+    }
+  }
+
+  if ((next != NO_TASK) && (nextDelta <= 0)) {
+    Task& task = tasks[next];
+    uint32_t late = (uint32_t)(-nextDelta);
+    task.scheduled = false;
+
+    uint64_t startTime = clockMicros();
+    task.callback();
+    uint32_t runTime = clockMicros() - startTime;
+
+    task.runCount++;
+    task.totalRunUs += runTime;
+    task.totalLateMs += late;
+    if (runTime > task.maxRunUs) {
+      task.maxRunUs = runTime;
+    }
+    if (late > task.maxLateMs) {
+      task.maxLateMs = late;
+    }
+    return;
+  }
+
+  uint32_t untilNext = POWER_FOREVER;
+  if ((next != NO_TASK) && (nextDelta < POWER_FOREVER)) {
+    untilNext = nextDelta;
+  }
+  if (virtualTime) {
+    // nothing to wait for, jump to the next deadline
+    virtualMs += min(untilNext,SCHEDULER_MAX_SKIP_MS);
+  }
+  else {
+    uint64_t idleStart = clockMillis();
+    powerIdle(untilNext);
+    idleMs += clockMillis() - idleStart;
+  }
+
+}
+
+// back on real time the pending deadlines keep their distance from now
+void schedulerVirtualTime(const bool enable) {
+  if (!enable) {
+    for (uint8_t i = 0; i < numTasks; i++) {
+      tasks[i].wakeTime -= min(tasks[i].wakeTime,virtualMs);
+    }
+    virtualMs = 0;
+  }
+  virtualTime = enable;
+}
+
+uint64_t schedulerMillis() {
+  return clockMillis() + virtualMs;
+}
+
+uint64_t schedulerIdleMs() {
+  return idleMs;
+}
+
+void schedulerPrintStats() {
+  dPrintf(F("\n%-8s %8s %10s %10s %10s %10s\n"),"task","runs","avg us","max us","avg late","max late");
+  for (uint8_t i = 0; i < numTasks; i++) {
+    const Task& task = tasks[i];
+    uint32_t avgRun = task.runCount ? (uint32_t)(task.totalRunUs / task.runCount) : 0;
+    uint32_t avgLate = task.runCount ? (task.totalLateMs / task.runCount) : 0;
+    dPrintf(F("%-8s %8u %10u %10u %10u %10u\n"),task.name,task.runCount,avgRun,task.maxRunUs,avgLate,task.maxLateMs);
+  }
+  dPrintf(F("idle: %llu ms of %llu ms\n"),idleMs,clockMillis());
+}
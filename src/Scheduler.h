@@ -0,0 +1,54 @@
+#ifndef SCHEDULER
+#define SCHEDULER
+
+#include <Arduino.h>
+
+/*  Small cooperative scheduler. Tasks are plain functions that run to completion
+    and decide themselves when they want to run again (taskWakeIn). The task with
+    the earliest deadline runs first, ties go to the task added first. Between
+    deadlines the idle time is handed to the power manager (powerIdle) which
+    returns within POWER_IDLE_SLICE_MS, or after a light sleep, so a wakeup
+    requested from an ISR is picked up on the next pass. Deadlines are on the
+    64 bit monotonic clock (Clock.h) so they survive light sleep and never wrap.
+
+    With virtual time on (simulations), idle time isn't waited out. Scheduler
+    time (schedulerMillis) is moved straight to the next deadline, at most
+    SCHEDULER_MAX_SKIP_MS at a time, so hours of schedule run in seconds. The
+    skipped time is kept apart from the monotonic clock, which stays true, and
+    is taken back out of the pending deadlines when virtual time ends.
+*/
+
+const uint8_t MAX_TASKS = 16;
+const uint8_t NO_TASK = 0xFF;
+const uint32_t SCHEDULER_MAX_SKIP_MS = 60 * 60 * 1000;
+
+typedef void (*TaskCallback)();
+
+typedef struct {
+  const char* name;
+  TaskCallback callback;
+  uint64_t wakeTime;              // schedulerMillis
+  bool scheduled;
+  volatile bool wakeRequested;    // set by ISRs
+  uint32_t runCount;
+  uint64_t totalRunUs;
+  uint32_t maxRunUs;
+  uint32_t totalLateMs;
+  uint32_t maxLateMs;
+} Task;
+
+uint8_t taskAdd(const char* name, TaskCallback callback);
+void taskWakeIn(const uint8_t task, const uint32_t delayMs);
+void taskWakeNow(const uint8_t task);
+void taskWakeFromISR(const uint8_t task);
+void taskStop(const uint8_t task);
+bool taskScheduled(const uint8_t task);
+const Task* taskInfo(const uint8_t task);
+
+void schedulerRun();
+void schedulerVirtualTime(const bool enable);
+uint64_t schedulerMillis();
+uint64_t schedulerIdleMs();
+void schedulerPrintStats();
+
+#endif
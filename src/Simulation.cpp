@@ -0,0 +1,336 @@
+#include <LittleFS.h>
+#include "Simulation.h"
+#include "Scheduler.h"
+#include "Debug.h"
+
+typedef struct {
+  uint32_t id;
+  uint32_t at;
+  uint8_t awayID;
+  uint8_t homeID;
+} SimGame;
+
+typedef struct {
+  uint32_t id;
+  uint32_t at;
+  uint8_t awayScore;
+  uint8_t homeScore;
+  char devision[5];
+  char timeRemaining[6];
+  bool final;
+} SimLine;
+
+typedef struct {
+  uint32_t at;
+  uint8_t from;
+  uint8_t to;
+  int32_t lagS;         // -1 when nothing in the script marks the moment
+} SimTransition;
+
+SimGame simGames[SIM_MAX_GAMES];
+SimLine* simLines = nullptr;
+uint8_t numSimGames = 0;
+uint8_t numSimLines = 0;
+time_t simStartEpoch = 0;
+uint32_t simLength = 0;
+uint8_t simLeague = 0;
+bool simOn = false;
+uint64_t simStartMs = 0;
+uint32_t simStartRealMs = 0;
+
+// report
+uint16_t simNextQueries = 0;
+uint16_t simCurrentQueries = 0;
+uint16_t simRepaints = 0;
+uint32_t simStatusS[AFTER_GAME + 1];
+uint8_t simLastStatus = NEW_TEAM;
+uint32_t simLastStatusAt = 0;
+SimTransition simTransitions[SIM_MAX_TRANSITIONS];
+uint8_t numSimTransitions = 0;
+uint8_t simSeenAway[SIM_MAX_GAMES];
+uint8_t simSeenHome[SIM_MAX_GAMES];
+uint16_t simScoreChanges = 0;
+uint32_t simScoreLagTotalS = 0;
+uint32_t simScoreLagMaxS = 0;
+
+uint32_t simElapsed() {
+  return (schedulerMillis() - simStartMs) / 1000;
+}
+
+int8_t simGameIndex(const uint32_t id) {
+  for (uint8_t i = 0; i < numSimGames; i++) {
+    if (simGames[i].id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// when the script says the game ended, 0xFFFFFFFF if never
+uint32_t simFinalAt(const uint32_t id) {
+  for (uint8_t i = 0; i < numSimLines; i++) {
+    if ((simLines[i].id == id) && simLines[i].final) {
+      return simLines[i].at;
+    }
+  }
+  return 0xFFFFFFFF;
+}
+
+bool simLoad(const char* path) {
+
+  fs::File file = LittleFS.open(path,"r");
+  if (!file) {
+    dPrintf(F("No simulation script: %s\n"),path);
+    return false;
+  }
+
+  free(simLines);
+  simLines = (SimLine*)malloc(SIM_MAX_LINES * sizeof(SimLine));
+  numSimGames = 0;
+  numSimLines = 0;
+  simStartEpoch = 0;
+  simLength = 0;
+
+  bool ok = (simLines != nullptr);
+  uint16_t lineNumber = 0;
+  while (ok && file.available()) {
+    String line = file.readStringUntil('\n');
+    lineNumber++;
+    char kind[8];
+    if ((line.length() == 0) || (line[0] == '#') || (sscanf(line.c_str(),"%7s",kind) != 1)) {
+      continue;
+    }
+
+    uint32_t value = 0;
+    if (strcmp(kind,"start") == 0) {
+      ok = (sscanf(line.c_str(),"%*s %u",&value) == 1);
+      simStartEpoch = value;
+    }
+    else if (strcmp(kind,"end") == 0) {
+      ok = (sscanf(line.c_str(),"%*s %u",&simLength) == 1);
+    }
+    else if (strcmp(kind,"game") == 0) {
+      SimGame& game = simGames[numSimGames];
+      ok = (numSimGames < SIM_MAX_GAMES)
+           && (sscanf(line.c_str(),"%*s %u %u %hhu %hhu",&game.id,&game.at,&game.awayID,&game.homeID) == 4);
+      numSimGames += ok;
+    }
+    else if ((strcmp(kind,"score") == 0) || (strcmp(kind,"final") == 0)) {
+      SimLine& entry = simLines[numSimLines];
+      ok = (numSimLines < SIM_MAX_LINES)
+           && (sscanf(line.c_str(),"%*s %u %u %hhu %hhu %4s %5s",&entry.id,&entry.at,&entry.awayScore,&entry.homeScore,
+                      entry.devision,entry.timeRemaining) == 6)
+           && (simGameIndex(entry.id) >= 0);
+      entry.final = (kind[0] == 'f');
+      numSimLines += ok;
+    }
+    else {
+      ok = false;
+    }
+    if (!ok) {
+      dPrintf(F("%s line %d: can't use \"%s\"\n"),path,lineNumber,line.c_str());
+    }
+  }
+  file.close();
+
+  if (ok && ((simStartEpoch == 0) || (simLength == 0))) {
+    dPrintf(F("%s needs a start and an end\n"),path);
+    ok = false;
+  }
+  if (!ok) {
+    free(simLines);
+    simLines = nullptr;
+    return false;
+  }
+
+  dPrintf(F("Simulation %s: %d games, %d score lines, %d s\n"),path,numSimGames,numSimLines,simLength);
+  return true;
+
+}
+
+void simStart(const uint8_t league) {
+
+  simLeague = league;
+  simStartMs = schedulerMillis();
+  simStartRealMs = millis();
+  simNextQueries = 0;
+  simCurrentQueries = 0;
+  simRepaints = 0;
+  memset(simStatusS,0,sizeof(simStatusS));
+  simLastStatus = NEW_TEAM;
+  simLastStatusAt = 0;
+  numSimTransitions = 0;
+  memset(simSeenAway,0,sizeof(simSeenAway));
+  memset(simSeenHome,0,sizeof(simSeenHome));
+  simScoreChanges = 0;
+  simScoreLagTotalS = 0;
+  simScoreLagMaxS = 0;
+
+  simOn = true;
+  schedulerVirtualTime(true);
+
+}
+
+void simStop() {
+  simOn = false;
+  schedulerVirtualTime(false);
+  free(simLines);
+  simLines = nullptr;
+}
+
+bool simActive() {
+  return simOn;
+}
+
+time_t simTime() {
+  return simStartEpoch + simElapsed();
+}
+
+uint32_t simRemainingMs() {
+  uint32_t elapsed = simElapsed();
+  return (elapsed < simLength) ? (simLength - elapsed) * 1000 : 0;
+}
+
+// the first game that hasn't ended yet
+void simNextGame(NextGameData& nextGame) {
+
+  simNextQueries++;
+  nextGame = NextGameData();
+  uint32_t now = simElapsed();
+
+  for (uint8_t i = 0; i < numSimGames; i++) {
+    if (simFinalAt(simGames[i].id) > now) {
+      nextGame.gameID = simGames[i].id;
+      nextGame.awayID = simGames[i].awayID;
+      nextGame.homeID = simGames[i].homeID;
+      nextGame.startTime = simStartEpoch + simGames[i].at;
+      nextGame.league = simLeague;
+      strcpy(nextGame.awayRecord,"0-0");
+      strcpy(nextGame.homeRecord,"0-0");
+      return;
+    }
+  }
+
+}
+
+bool simCurrentGame(const uint32_t gameID, CurrentGameData& game, bool& isGameOver) {
+
+  simCurrentQueries++;
+  int8_t index = simGameIndex(gameID);
+  if (index < 0) {
+    return false;
+  }
+
+  game = CurrentGameData();
+  game.gameID = gameID;
+  game.league = simLeague;
+  game.awayID = simGames[index].awayID;
+  game.homeID = simGames[index].homeID;
+  strcpy(game.devision,"1st");
+  strcpy(game.timeRemaining,"");
+  game.bases[0] = game.bases[1] = game.bases[2] = false;
+  isGameOver = false;
+
+  uint32_t now = simElapsed();
+  for (uint8_t i = 0; (i < numSimLines) && (simLines[i].at <= now); i++) {
+    if (simLines[i].id == gameID) {
+      game.awayScore = simLines[i].awayScore;
+      game.homeScore = simLines[i].homeScore;
+      strcpy(game.devision,simLines[i].devision);
+      strcpy(game.timeRemaining,simLines[i].timeRemaining);
+      isGameOver = simLines[i].final;
+    }
+  }
+  return true;
+
+}
+
+void simRepaint() {
+  if (simOn) {
+    simRepaints++;
+  }
+}
+
+void simStatus(const GameStatus status, const NextGameData& nextGame) {
+
+  if (!simOn || (status == simLastStatus)) {
+    return;
+  }
+
+  uint32_t now = simElapsed();
+  simStatusS[simLastStatus] += now - simLastStatusAt;
+
+  // the scripted moment this transition reacts to
+  uint32_t scripted = 0xFFFFFFFF;
+  if ((status == STARTED) && (nextGame.startTime != 0)) {
+    scripted = nextGame.startTime - simStartEpoch;
+  }
+  else if (status == FINISHED) {
+    scripted = simFinalAt(nextGame.gameID);
+  }
+
+  if (numSimTransitions < SIM_MAX_TRANSITIONS) {
+    SimTransition& transition = simTransitions[numSimTransitions++];
+    transition.at = now;
+    transition.from = simLastStatus;
+    transition.to = status;
+    transition.lagS = (scripted <= now) ? (int32_t)(now - scripted) : -1;
+  }
+
+  simLastStatus = status;
+  simLastStatusAt = now;
+
+}
+
+void simScoreSeen(const CurrentGameData& game) {
+
+  int8_t index = simGameIndex(game.gameID);
+  if (!simOn || (index < 0) || ((simSeenAway[index] == game.awayScore) && (simSeenHome[index] == game.homeScore))) {
+    return;
+  }
+  simSeenAway[index] = game.awayScore;
+  simSeenHome[index] = game.homeScore;
+
+  uint32_t now = simElapsed();
+  for (uint8_t i = 0; (i < numSimLines) && (simLines[i].at <= now); i++) {
+    if ((simLines[i].id == game.gameID) && (simLines[i].awayScore == game.awayScore) && (simLines[i].homeScore == game.homeScore)) {
+      uint32_t lag = now - simLines[i].at;
+      simScoreChanges++;
+      simScoreLagTotalS += lag;
+      simScoreLagMaxS = max(simScoreLagMaxS,lag);
+      return;
+    }
+  }
+
+}
+
+void simReport() {
+
+  static const char* names[] = {"NEW_TEAM","NO_GAMES","SCHEDULED","STARTED","FINISHED","AFTER_GAME"};
+
+  uint32_t now = simElapsed();
+  simStatusS[simLastStatus] += now - simLastStatusAt;
+  simLastStatusAt = now;
+
+  dPrintf(F("\nSimulation: %d s of virtual time in %d ms\n"),now,millis() - simStartRealMs);
+  dPrintf(F("Queries: %d next game, %d current game. Repaints: %d\n"),simNextQueries,simCurrentQueries,simRepaints);
+  dPrintf(F("%-12s %8s\n"),"state","seconds");
+  for (uint8_t i = 0; i <= AFTER_GAME; i++) {
+    dPrintf(F("%-12s %8d\n"),names[i],simStatusS[i]);
+  }
+  dPrintf(F("%8s  %-12s %-12s %6s\n"),"at s","from","to","lag s");
+  for (uint8_t i = 0; i < numSimTransitions; i++) {
+    const SimTransition& transition = simTransitions[i];
+    if (transition.lagS >= 0) {
+      dPrintf(F("%8d  %-12s %-12s %6d\n"),transition.at,names[transition.from],names[transition.to],transition.lagS);
+    }
+    else {
+      dPrintf(F("%8d  %-12s %-12s %6s\n"),transition.at,names[transition.from],names[transition.to],"-");
+    }
+  }
+  if (simScoreChanges > 0) {
+    dPrintf(F("Score changes: %d seen, lag avg %d s max %d s\n"),simScoreChanges,simScoreLagTotalS / simScoreChanges,
+            simScoreLagMaxS);
+  }
+
+}
@@ -0,0 +1,55 @@
+#ifndef SIMULATION
+#define SIMULATION
+
+#include <Arduino.h>
+#include "GameData.h"
+
+/*  Runs the real poll state machine through a scripted game day in seconds.
+    While a simulation is active:
+    - the scheduler runs on virtual time (schedulerVirtualTime), so every
+      wait is skipped. The script and the state machine's own timers read
+      schedulerMillis(), clockMillis() keeps real time;
+    - currentTime() comes from simTime();
+    - the next game and current game queries are answered from the script,
+      not the network.
+    When the script's end is reached, a report is printed. It covers the
+    queries made, the repaints, the time spent in each GameStatus, and how
+    long after the scripted moment each game start, score change and final
+    was noticed.
+
+    Scripts are text files on LittleFS (data/sim). All times are seconds
+    after the start:
+      start <epoch>                       wall clock at the start of the day
+      end <seconds>                       length of the run
+      game <id> <at> <awayID> <homeID>    a game of the selected team starting at <at>
+      score <id> <at> <away> <home> <division> <clock>
+      final <id> <at> <away> <home> <division> <clock>
+    A game shows 0-0 until its first score line. The latest line at or
+    before the current time is what a query returns. Games and lines have to
+    be in time order. Team IDs are those of the league selected on the
+    device. Start one from the serial console with "sim /sim/overtime.txt".
+
+    The parser and the report also build natively: test/test_sim runs
+    doubleheader.txt through them (pio test -e native_sim).
+*/
+
+const uint8_t SIM_MAX_GAMES = 4;
+const uint8_t SIM_MAX_LINES = 96;
+const uint8_t SIM_MAX_TRANSITIONS = 16;
+
+bool simLoad(const char* path);
+void simStart(const uint8_t league);
+void simStop();
+bool simActive();
+time_t simTime();
+uint32_t simRemainingMs();
+
+void simNextGame(NextGameData& nextGame);
+bool simCurrentGame(const uint32_t gameID, CurrentGameData& game, bool& isGameOver);
+
+void simRepaint();
+void simStatus(const GameStatus status, const NextGameData& nextGame);
+void simScoreSeen(const CurrentGameData& game);
+void simReport();
+
+#endif
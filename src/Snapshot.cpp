@@ -0,0 +1,38 @@
+#include <LittleFS.h>
+#include "Snapshot.h"
+#include "Debug.h"
+
+bool snapshotLoad(BootSnapshot& snapshot) {
+
+  bool success = false;
+
+  fs::File file = LittleFS.open(SNAPSHOT_FILE,"r");
+  if (file) {
+    BootSnapshot loaded;
+    if ((file.read((uint8_t*)&loaded,sizeof(loaded)) == sizeof(loaded)) && (loaded.version == SNAPSHOT_VERSION) && (loaded.size == sizeof(loaded))) {
+      snapshot = loaded;
+      success = true;
+    }
+    else {
+      dPrintf(F("Ignoring stale boot snapshot\n"));
+    }
+    file.close();
+  }
+
+  return success;
+}
+
+void snapshotSave(BootSnapshot& snapshot) {
+
+  snapshot.version = SNAPSHOT_VERSION;
+  snapshot.size = sizeof(snapshot);
+
+  fs::File file = LittleFS.open(SNAPSHOT_FILE,"w");
+  if (file) {
+    file.write((const uint8_t*)&snapshot,sizeof(snapshot));
+    file.close();
+  }
+  else {
+    dPrintf(F("Error opening snapshot file for writing\n"));
+  }
+}
@@ -0,0 +1,29 @@
+#ifndef BOOT_SNAPSHOT
+#define BOOT_SNAPSHOT
+
+#include <Arduino.h>
+#include "GameData.h"
+
+/*  Last known state of the scoreboard. Written to LittleFS whenever a game
+    screen is drawn and painted straight after tft.init on the next boot so the
+    display shows something useful while WiFi, NTP and the update checks run.
+    A snapshot from another firmware layout (version or size differs) is ignored.
+*/
+
+const char* const SNAPSHOT_FILE = "/snapshot.dat";
+const uint16_t SNAPSHOT_VERSION = 1;
+
+typedef struct {
+  uint16_t version = SNAPSHOT_VERSION;
+  uint16_t size = 0;
+  uint8_t screen = 0;         // Screen enum in main.cpp
+  uint8_t league = 0;
+  uint16_t teamID = 0;
+  NextGameData nextGame;
+  CurrentGameData currentGame;
+} BootSnapshot;
+
+bool snapshotLoad(BootSnapshot& snapshot);
+void snapshotSave(BootSnapshot& snapshot);
+
+#endif
@@ -0,0 +1,278 @@
+#include <ESP8266HTTPClient.h>
+#include "StatsApi.h"
+#include "Leagues.h"
+#include "Deadlines.h"
+#include "DnsCache.h"
+#include "Debug.h"
+
+void extractNextGame_StatsApi(const StatsApiConfig& api, NextGameData& nextGameData, JsonObject& game) {
+
+  nextGameData.gameID = game["gamePk"];
+  nextGameData.awayID = game["teams"]["away"]["team"]["id"];
+  nextGameData.homeID = game["teams"]["home"]["team"]["id"];
+  nextGameData.league = api.league;
+  const char* gameType = game["gameType"];
+  nextGameData.isPlayoffs = (strcmp(gameType,"P") == 0);
+  String nextGameTS_str = game["gameDate"];
+  nextGameData.startTime = parseDateTime(nextGameTS_str);
+  JsonObject homeRecord = game["teams"]["home"]["leagueRecord"];
+  JsonObject awayRecord = game["teams"]["away"]["leagueRecord"];
+  uint8_t homeWins = homeRecord["wins"];
+  uint8_t awayWins = awayRecord["wins"];
+  uint8_t homeLosses = homeRecord["losses"];
+  uint8_t awayLosses = awayRecord["losses"];
+
+  if (api.recordHasOT) {
+    uint8_t homeOT = homeRecord["ot"];
+    uint8_t awayOT = awayRecord["ot"];
+    sprintf(nextGameData.homeRecord,"%d-%d-%d",homeWins,homeLosses,homeOT);
+    sprintf(nextGameData.awayRecord,"%d-%d-%d",awayWins,awayLosses,awayOT);
+  }
+  else {
+      sprintf(nextGameData.homeRecord,"%d-%d",homeWins,homeLosses);
+      sprintf(nextGameData.awayRecord,"%d-%d",awayWins,awayLosses);
+  }
+}
+
+// A query that fails or runs out of time is an error, not "no next game". The
+// host's backoff says when to try again (upstreamLastRetryMs)
+UpstreamError getNextGame_StatsApi(const StatsApiConfig& api, const time_t today, const uint16_t teamID, NextGameData& nextGameData) {
+
+  StaticJsonDocument<320> filter;
+  DynamicJsonDocument doc(2048);
+  JsonObject resultGame;
+
+  String queryString;
+  HTTPClient httpClient;
+  DnsCachedClient wifiClient;
+  DeadlineStream stream(wifiClient,ENDPOINT_NEXT_GAME);
+  int8_t gameCount = 0;
+  uint32_t excludeGameID = nextGameData.gameID;
+
+  nextGameData.gameID = 0;
+
+  queryString = "http://";
+  queryString += api.host;
+  queryString += "/api/v1/schedule?";
+  queryString += "sportId=1";
+  queryString += "&teamId=";
+  queryString += teamID;
+  queryString += "&startDate=";
+  queryString += convertDate(today - SECONDS_IN_A_DAY,true); // need to grab from yesterday
+  queryString += "&endDate=";
+  // get 7 days worth of data to in order to cover the all star break and playoff gaps4
+  queryString += convertDate(today + (SECONDS_IN_A_DAY * 7),true);
+
+  dPrintf(F("Query - Type: Next %s Game\n"), Leagues::info(api.league)->name);
+
+  filter["games"][0]["gamePk"] = true;
+  filter["games"][0]["gameType"] = true;
+  filter["games"][0]["gameDate"] = true;
+  filter["games"][0]["status"]["abstractGameState"] = true;
+  filter["games"][0]["status"]["detailedState"] = true;
+
+  filter["games"][0]["teams"]["home"]["team"]["id"] = true;
+  filter["games"][0]["teams"]["home"]["leagueRecord"]["wins"] = true;
+  filter["games"][0]["teams"]["home"]["leagueRecord"]["losses"] = true;
+  filter["games"][0]["teams"]["away"]["team"]["id"] = true;
+  filter["games"][0]["teams"]["away"]["leagueRecord"]["wins"] = true;
+  filter["games"][0]["teams"]["away"]["leagueRecord"]["losses"] = true;
+  if (api.recordHasOT) {
+    filter["games"][0]["teams"]["home"]["leagueRecord"]["ot"] = true;
+    filter["games"][0]["teams"]["away"]["leagueRecord"]["ot"] = true;
+  }
+
+  dVerboseJson(filter);
+
+  dPrintf(F("\nQuery URL: %s\n"),queryString.c_str());
+
+  if (!upstreamAllowed(queryString)) {
+    return UPSTREAM_CIRCUIT_OPEN;
+  }
+
+  httpClient.useHTTP10(true);
+  stream.prepare(httpClient);
+  httpClient.begin(wifiClient,queryString);
+
+  int httpResult = httpClient.GET();
+  stream.responded(httpResult);
+  if (httpResult != 200) {
+    dPrintf(F("HTTP error: %d\n"),httpResult);
+    httpClient.end();
+    UpstreamError result = upstreamClassify(httpResult);
+    result = (result == UPSTREAM_OK) ? UPSTREAM_HTTP_5XX : result;
+    upstreamResult(queryString,result);
+    return result;
+  }
+
+  bool found = false;
+  UpstreamError result = UPSTREAM_OK;
+
+  stream.find(api.datesTag);
+  do {
+    DeserializationError err = deserializeJson(doc,stream,DeserializationOption::Filter(filter));
+
+    if (err) {
+      dPrintf(F("Parse error: %s\n"),err.c_str());
+      if (err == DeserializationError::IncompleteInput) {
+        result = UPSTREAM_PARSE;      // cut off. An empty dates list fails too, but is no games
+      }
+      break;
+    }
+
+    JsonArray games = doc["games"];
+    for (JsonObject game : games) {   // in case of doubleheaders
+      uint32_t gameID = game["gamePk"];
+      const char* ags = game["status"]["abstractGameState"];
+      const char* ds = game["status"]["detailedState"];
+      dPrintf(F("GameID: %d Abstract: %s Detailed: %s"),gameID,ags,ds);
+      gameCount++;
+      if ((strcmp(ags,STATUSCODE_FINAL) != 0) && (gameID != excludeGameID)) {
+        if ((strcmp(ds,STATUSCODE_INPROGRESS) == 0) || (strcmp(ds,STATUSCODE_SCHEDULED) == 0)) {
+          dPrintln(F(" match"));
+          found = true;
+          resultGame = game;
+          break;
+        }
+      }
+      else {
+        dPrintln(F(" no match"));
+      }
+    }
+    if (found) {
+      break;
+    }
+  } while (stream.findUntil(",","]"));
+
+  httpClient.end();
+
+  // a cut off schedule isn't "no game", unless our game was already in it
+  if (found) {
+    result = UPSTREAM_OK;
+  }
+  else if (stream.expired()) {
+    result = UPSTREAM_TIMEOUT;
+  }
+
+  if (found) {
+    dVerboseJson(resultGame);
+
+    extractNextGame_StatsApi(api,nextGameData,resultGame);
+  }
+  else if (result == UPSTREAM_OK) {
+    dPrintln(F("No next game found"));
+  }
+  upstreamResult(queryString,result);
+  return result;
+
+}
+
+// start time in local HH:MM for games that haven't started
+void setTickerStartTime(TickerGame& game, const char* gameDate) {
+  time_t startTime = parseDateTime(String(gameDate ? gameDate : ""));
+  strftime(game.timeRemaining,sizeof(game.timeRemaining),"%H:%M",localtime(&startTime));
+}
+
+bool getScoreboard_StatsApi(const StatsApiConfig& api, const time_t today, TickerBoard& board) {
+
+  StaticJsonDocument<384> filter;
+  DynamicJsonDocument doc(768);    // one game at a time, a full slate costs the same as one game
+
+  HTTPClient httpClient;
+  DnsCachedClient wifiClient;
+  DeadlineStream stream(wifiClient,ENDPOINT_SCOREBOARD);
+
+  board.league = api.league;
+  board.count = 0;
+
+  String queryString = "http://";
+  queryString += api.host;
+  queryString += "/api/v1/schedule?sportId=1&date=";
+  queryString += convertDate(localCalendarTime(today),true);
+  queryString += "&";
+  queryString += api.linescoreParam;
+
+  dPrintf(F("Query - Type: %s Scoreboard\n"), Leagues::info(api.league)->name);
+  dPrintf(F("Query URL: %s\n"),queryString.c_str());
+
+  filter["gamePk"] = true;
+  filter["gameDate"] = true;
+  filter["status"]["abstractGameState"] = true;
+  filter["teams"]["home"]["team"]["id"] = true;
+  filter["teams"]["home"]["score"] = true;
+  filter["teams"]["away"]["team"]["id"] = true;
+  filter["teams"]["away"]["score"] = true;
+  filter["linescore"][api.divisionField] = true;
+  filter["linescore"][api.clockField] = true;
+
+  httpClient.useHTTP10(true);
+  stream.prepare(httpClient);
+  httpClient.begin(wifiClient,queryString);
+
+  int httpResult = httpClient.GET();
+  stream.responded(httpResult);
+  if (httpResult != 200) {
+    dPrintf(F("HTTP error: %d\n"),httpResult);
+    httpClient.end();
+    return false;
+  }
+
+  // no games today means no "games" array at all
+  if (!stream.find("\"games\"") || !stream.find("[")) {
+    httpClient.end();
+    return true;
+  }
+
+  bool ok = true;
+  do {
+    DeserializationError err = deserializeJson(doc,stream,DeserializationOption::Filter(filter));
+    if (err) {
+      dPrintf(F("Parse error: %s\n"),err.c_str());
+      ok = false;
+      break;
+    }
+
+    TickerGame game;
+    memset(&game,0,sizeof(game));
+    game.gameID = doc["gamePk"];
+    game.awayID = doc["teams"]["away"]["team"]["id"];
+    game.homeID = doc["teams"]["home"]["team"]["id"];
+
+    const char* ags = doc["status"]["abstractGameState"];
+    if (ags && (strcmp(ags,STATUSCODE_FINAL) == 0)) {
+      game.state = TICKER_FINAL;
+      snprintf(game.timeRemaining,sizeof(game.timeRemaining),"Final");
+    }
+    else if (ags && (strcmp(ags,STATUSCODE_LIVE) == 0)) {
+      game.state = TICKER_LIVE;
+      const char* division = doc["linescore"][api.divisionField];
+      const char* clock = doc["linescore"][api.clockField];
+      snprintf(game.devision,sizeof(game.devision),"%s",division ? division : "");
+      if (api.clockIsInningHalf) {
+        snprintf(game.timeRemaining,sizeof(game.timeRemaining),"%s",(clock && (clock[0] == 'T')) ? "top" : "bot");
+      }
+      else {
+        snprintf(game.timeRemaining,sizeof(game.timeRemaining),"%s",clock ? clock : "");
+      }
+    }
+    else {
+      game.state = TICKER_SCHEDULED;
+      setTickerStartTime(game,doc["gameDate"]);
+    }
+
+    if (game.state != TICKER_SCHEDULED) {
+      game.awayScore = doc["teams"]["away"]["score"];
+      game.homeScore = doc["teams"]["home"]["score"];
+    }
+
+    if (!addTickerGame(board,game)) {
+      dPrintf(F("Scoreboard full, skipping game %d\n"),game.gameID);
+    }
+  } while (stream.findUntil(",","]"));
+
+  httpClient.end();
+
+  dPrintf(F("Scoreboard: %d games\n"),board.count);
+  return ok;
+
+}
@@ -0,0 +1,33 @@
+#ifndef STATS_API
+#define STATS_API
+
+#include "LeagueProvider.h"
+
+// Game status codes. These are dependant on the statsapi
+const char* const STATUSCODE_PREGAME = "Preview";
+const char* const STATUSCODE_LIVE = "Live";
+const char* const STATUSCODE_FINAL = "Final";
+const char* const STATUSCODE_SCHEDULED = "Scheduled";
+const char* const STATUSCODE_INPROGRESS = "In Progress";
+
+// Awesomely the NHL & MLB use the same api schema. We just have to change the
+// host and the few places where the NHL deviates
+typedef struct {
+  uint8_t league;
+  const char* host;
+  const char* datesTag;       // NHL api has spaces in the tag
+  bool recordHasOT;
+  const char* linescoreParam;   // schedule query option that adds the linescore
+  const char* divisionField;    // linescore fields for the ticker
+  const char* clockField;
+  bool clockIsInningHalf;       // "Top"/"Bottom" rather than a game clock
+} StatsApiConfig;
+
+extern const StatsApiConfig NHL_STATSAPI;
+extern const StatsApiConfig MLB_STATSAPI;
+
+void extractNextGame_StatsApi(const StatsApiConfig& api, NextGameData& nextGameData, JsonObject& game);
+UpstreamError getNextGame_StatsApi(const StatsApiConfig& api, const time_t today, const uint16_t teamID, NextGameData& nextGameData);
+bool getScoreboard_StatsApi(const StatsApiConfig& api, const time_t today, TickerBoard& board);
+
+#endif
@@ -0,0 +1,187 @@
+#include <ESP8266WiFi.h>
+#include <coredecls.h>
+#include "StatusServer.h"
+#include "Scheduler.h"
+#include "Clock.h"
+#include "Debug.h"
+
+typedef struct {
+  const char* path;
+  StatusWriter writer;
+  bool cacheable;
+} StatusPath;
+
+// first pass of a response, nothing is sent
+class CountingPrint : public Print {
+  public:
+    uint32_t length = 0;
+    uint32_t crc = 0xFFFFFFFF;
+    size_t write(uint8_t c) override {
+      return write(&c,1);
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+      crc = crc32(buffer,size,crc);
+      length += size;
+      return size;
+    }
+};
+
+WiFiServer statusServer(STATUS_PORT);
+StatusPath statusPaths[STATUS_MAX_PATHS];
+uint8_t numStatusPaths = 0;
+uint8_t statusTaskHandle = NO_TASK;
+bool statusStarted = false;
+StatusStats statusCounters;
+
+void statusBegin(const uint8_t task) {
+  statusTaskHandle = task;
+}
+
+bool statusAdd(const char* path, StatusWriter writer, const bool cacheable) {
+  if (numStatusPaths >= STATUS_MAX_PATHS) {
+    dPrintf(F("No room for status path: %s\n"),path);
+    return false;
+  }
+  statusPaths[numStatusPaths++] = {path,writer,cacheable};
+  return true;
+}
+
+// called every pass of loop(), has to stay cheap
+void statusCheck() {
+  if (!statusStarted) {
+    if (WiFi.status() != WL_CONNECTED) {
+      return;
+    }
+    statusServer.begin();
+    statusServer.setNoDelay(true);
+    statusStarted = true;
+    dPrintf(F("Status server on http://%s:%d/\n"),WiFi.localIP().toString().c_str(),STATUS_PORT);
+  }
+  if (statusServer.hasClient() && !taskScheduled(statusTaskHandle)) {
+    taskWakeNow(statusTaskHandle);
+  }
+}
+
+void sendStatus(WiFiClient& client, const uint16_t code, const char* reason) {
+  client.printf_P(PSTR("HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"),code,reason);
+}
+
+// One line of the request. Stream's own timeout restarts with every byte, so
+// a client trickling bytes could keep it going; this one stops at the deadline
+bool readLine(WiFiClient& client, String& line, const uint64_t deadline) {
+  line = "";
+  while (clockMillis() < deadline) {
+    int c = client.read();
+    if (c < 0) {
+      if (!client.connected()) {
+        return false;
+      }
+      delay(1);
+    }
+    else if (c == '\n') {
+      return true;
+    }
+    else if (line.length() < STATUS_MAX_LINE) {
+      line += (char)c;
+    }
+  }
+  statusCounters.timeouts++;
+  return false;
+}
+
+void serveClient(WiFiClient& client) {
+
+  uint64_t deadline = clockMillis() + STATUS_READ_TIMEOUT_MS;
+
+  // "GET /path HTTP/1.1"
+  char method[8];
+  char path[32];
+  String line;
+  if (!readLine(client,line,deadline) || (sscanf(line.c_str(),"%7s %31s",method,path) != 2)) {
+    return;
+  }
+
+  // only If-None-Match matters, the rest is skipped up to the blank line
+  uint32_t etag = 0;
+  bool hasEtag = false;
+  for (uint8_t i = 0; i < STATUS_MAX_HEADERS; i++) {
+    if (!readLine(client,line,deadline)) {
+      return;
+    }
+    if (line.length() <= 1) {
+      break;
+    }
+    if (strncasecmp(line.c_str(),"If-None-Match:",14) == 0) {
+      hasEtag = (sscanf(line.c_str() + 14," \"%x\"",&etag) == 1);
+    }
+  }
+
+  if (strcmp(method,"GET") != 0) {
+    sendStatus(client,405,"Method Not Allowed");
+    return;
+  }
+
+  const StatusPath* entry = nullptr;
+  for (uint8_t i = 0; i < numStatusPaths; i++) {
+    if (strcmp(path,statusPaths[i].path) == 0) {
+      entry = &statusPaths[i];
+    }
+  }
+  if (entry == nullptr) {
+    statusCounters.notFound++;
+    sendStatus(client,404,"Not Found");
+    return;
+  }
+
+  CountingPrint counter;
+  entry->writer(counter);
+
+  if (entry->cacheable && hasEtag && (etag == counter.crc)) {
+    statusCounters.notModified++;
+    client.printf_P(PSTR("HTTP/1.1 304 Not Modified\r\nETag: \"%08x\"\r\nConnection: close\r\n\r\n"),counter.crc);
+    return;
+  }
+
+  client.printf_P(PSTR("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"),counter.length);
+  if (entry->cacheable) {
+    client.printf_P(PSTR("ETag: \"%08x\"\r\n"),counter.crc);
+  }
+  else {
+    client.print(F("Cache-Control: no-store\r\n"));
+  }
+  client.print(F("Access-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n"));
+  entry->writer(client);
+  statusCounters.bytes += counter.length;
+
+}
+
+// Status task. Answers up to STATUS_MAX_CLIENTS_PER_RUN waiting clients, one
+// request each. statusCheck wakes it again for any still waiting
+void statusRun() {
+
+  for (uint8_t served = 0; (served < STATUS_MAX_CLIENTS_PER_RUN) && statusServer.hasClient(); served++) {
+    uint64_t start = clockMicros();
+    WiFiClient client = statusServer.available();
+    serveClient(client);
+    client.stop();
+
+    uint32_t took = clockMicros() - start;
+    statusCounters.requests++;
+    statusCounters.totalUs += took;
+    statusCounters.maxUs = max(statusCounters.maxUs,took);
+  }
+
+}
+
+const StatusStats& statusStats() {
+  return statusCounters;
+}
+
+void statusPrintStats() {
+  if (statusCounters.requests == 0) {
+    return;
+  }
+  dPrintf(F("Status server: %d requests, %d not modified, %d not found, %d timed out, %d bytes, avg %d us max %d us\n"),
+          statusCounters.requests,statusCounters.notModified,statusCounters.notFound,statusCounters.timeouts,statusCounters.bytes,
+          (uint32_t)(statusCounters.totalUs / statusCounters.requests),statusCounters.maxUs);
+}
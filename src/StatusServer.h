@@ -0,0 +1,50 @@
+#ifndef STATUS_SERVER
+#define STATUS_SERVER
+
+#include <Arduino.h>
+
+/*  Small HTTP server for the LAN. Paths are added with statusAdd() and each
+    one has a writer that prints its JSON straight from the data that is
+    already in memory. Nothing is buffered and nothing upstream is queried,
+    however many clients ask.
+
+    Every response is written twice. The first pass goes to a counter that
+    works out the length and a crc32 of the body. That crc is the ETag, so a
+    request with a matching If-None-Match gets a 304 with no body. Paths
+    added as not cacheable, like the counters, skip the ETag.
+
+    loop() calls statusCheck(). It only wakes the status task when a client
+    is waiting. One request is served per connection, then the connection
+    is closed. The request has STATUS_READ_TIMEOUT_MS in all to arrive, so a
+    slow client can't hold the scheduler, and one run serves at most
+    STATUS_MAX_CLIENTS_PER_RUN clients. The rest wait for the next run. While the device is in forced light sleep, WiFi is off and
+    nothing answers.
+*/
+
+const uint16_t STATUS_PORT = 80;
+const uint8_t STATUS_MAX_PATHS = 6;
+const uint16_t STATUS_READ_TIMEOUT_MS = 500;    // for the whole request, not per line
+const uint8_t STATUS_MAX_HEADERS = 24;      // give up on requests with more
+const uint8_t STATUS_MAX_LINE = 128;        // longer lines are cut, only their start is looked at
+const uint8_t STATUS_MAX_CLIENTS_PER_RUN = 2;
+
+typedef void (*StatusWriter)(Print& out);
+
+typedef struct {
+  uint32_t requests = 0;
+  uint32_t notModified = 0;
+  uint32_t notFound = 0;
+  uint32_t timeouts = 0;          // requests that didn't arrive in time
+  uint32_t bytes = 0;
+  uint64_t totalUs = 0;
+  uint32_t maxUs = 0;
+} StatusStats;
+
+void statusBegin(const uint8_t task);
+bool statusAdd(const char* path, StatusWriter writer, const bool cacheable);
+void statusCheck();
+void statusRun();
+const StatusStats& statusStats();
+void statusPrintStats();
+
+#endif
@@ -0,0 +1,141 @@
+#include <coredecls.h>
+#include "TlsSessions.h"
+#include "Clock.h"
+#include "Debug.h"
+
+typedef struct {
+  char host[TLS_HOST_LENGTH];
+  BearSSL::Session session;
+  uint64_t lastUsed;
+} TlsCacheEntry;
+
+typedef struct {
+  uint32_t crc;
+  uint32_t hostHash;
+  br_ssl_session_parameters params;
+} RtcTlsSession;
+
+static_assert(sizeof(RtcTlsSession) <= 512 - (RTC_TLS_OFFSET * 4),"RtcTlsSession doesn't fit in RTC user memory");
+
+// handshake cost, [0] full [1] resumed
+typedef struct {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint32_t maxHeap;
+} TlsStats;
+
+TlsCacheEntry tlsCache[TLS_CACHE_SIZE];
+TlsStats tlsStats[2];
+
+uint32_t hostHash(const char* host) {
+  return crc32(host,strlen(host));
+}
+
+void urlHost(const String& url, char* host) {
+  int start = url.indexOf("://");
+  start = (start < 0) ? 0 : start + 3;
+  int end = start;
+  while ((end < (int)url.length()) && (url[end] != '/') && (url[end] != ':')) {
+    end++;
+  }
+  snprintf(host,TLS_HOST_LENGTH,"%s",url.substring(start,end).c_str());
+}
+
+bool rtcSessionLoad(const char* host, BearSSL::Session& session) {
+  RtcTlsSession stored;
+  if (!ESP.rtcUserMemoryRead(RTC_TLS_OFFSET,(uint32_t*)&stored,sizeof(stored))) {
+    return false;
+  }
+  if ((stored.hostHash != hostHash(host)) || (stored.crc != crc32(&stored.hostHash,sizeof(stored) - sizeof(stored.crc)))) {
+    return false;
+  }
+  memcpy(session.getSession(),&stored.params,sizeof(stored.params));
+  return true;
+}
+
+void rtcSessionSave(const char* host, BearSSL::Session& session) {
+  RtcTlsSession stored;
+  stored.hostHash = hostHash(host);
+  memcpy(&stored.params,session.getSession(),sizeof(stored.params));
+  stored.crc = crc32(&stored.hostHash,sizeof(stored) - sizeof(stored.crc));
+  ESP.rtcUserMemoryWrite(RTC_TLS_OFFSET,(uint32_t*)&stored,sizeof(stored));
+}
+
+// slot for host, reusing the least recently used one if it isn't cached
+uint8_t tlsSlot(const char* host) {
+  uint8_t slot = 0;
+  for (uint8_t i = 0; i < TLS_CACHE_SIZE; i++) {
+    if (strcmp(tlsCache[i].host,host) == 0) {
+      return i;
+    }
+    if (tlsCache[i].lastUsed < tlsCache[slot].lastUsed) {
+      slot = i;
+    }
+  }
+
+  snprintf(tlsCache[slot].host,TLS_HOST_LENGTH,"%s",host);
+  tlsCache[slot].session = BearSSL::Session();
+  if (rtcSessionLoad(host,tlsCache[slot].session)) {
+    dPrintf(F("TLS session for %s restored from RTC memory\n"),host);
+  }
+  return slot;
+}
+
+TlsRequest tlsBegin(WiFiClientSecure& client, const String& url) {
+
+  char host[TLS_HOST_LENGTH];
+  urlHost(url,host);
+
+  TlsRequest request;
+  request.slot = tlsSlot(host);
+  TlsCacheEntry& entry = tlsCache[request.slot];
+  entry.lastUsed = clockMillis();
+
+  br_ssl_session_parameters* params = entry.session.getSession();
+  request.hadSession = (params->session_id_len > 0);
+  memcpy(request.sessionID,params->session_id,sizeof(request.sessionID));
+
+  client.setSession(&entry.session);
+  request.freeHeap = ESP.getFreeHeap();
+  request.startTime = clockMicros();
+  return request;
+}
+
+// call while the connection is still open so the TLS buffers count
+void tlsEnd(const TlsRequest& request, WiFiClientSecure& client) {
+
+  uint32_t took = clockMicros() - request.startTime;
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t heapUsed = (request.freeHeap > freeHeap) ? request.freeHeap - freeHeap : 0;
+
+  TlsCacheEntry& entry = tlsCache[request.slot];
+  br_ssl_session_parameters* params = entry.session.getSession();
+
+  // the server accepted the session if it kept the same ID
+  bool resumed = request.hadSession && (memcmp(request.sessionID,params->session_id,sizeof(request.sessionID)) == 0);
+
+  TlsStats& stats = tlsStats[resumed ? 1 : 0];
+  stats.count++;
+  stats.totalUs += took;
+  if (took > stats.maxUs) {
+    stats.maxUs = took;
+  }
+  if (heapUsed > stats.maxHeap) {
+    stats.maxHeap = heapUsed;
+  }
+
+  dPrintf(F("TLS %s: %s handshake, request %d ms, heap %d bytes\n"),entry.host,resumed ? "resumed" : "full",took / 1000,heapUsed);
+
+  if (!resumed && (params->session_id_len > 0)) {
+    rtcSessionSave(entry.host,entry.session);
+  }
+}
+
+void tlsPrintStats() {
+  const char* labels[2] = {"full","resumed"};
+  for (uint8_t i = 0; i < 2; i++) {
+    uint32_t avg = tlsStats[i].count ? (uint32_t)(tlsStats[i].totalUs / tlsStats[i].count / 1000) : 0;
+    dPrintf(F("TLS %-8s %4d requests, avg %5d ms, max %5d ms, peak heap %6d\n"),labels[i],tlsStats[i].count,avg,tlsStats[i].maxUs / 1000,tlsStats[i].maxHeap);
+  }
+}
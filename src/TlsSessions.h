@@ -0,0 +1,37 @@
+#ifndef TLS_SESSIONS
+#define TLS_SESSIONS
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+/*  BearSSL session cache. A resumed handshake skips the public key work, which
+    on the ESP8266 is seconds of CPU. Sessions are kept per host in RAM and the
+    most recent one also in RTC user memory so it survives a restart (the
+    update check after an OTA or crash is usually to the same host).
+
+    Usage around any HTTPS request:
+      TlsRequest tls = tlsBegin(client,url);   // attaches the cached session
+      ... httpClient.begin(client,url); httpClient.GET(); ...
+      tlsEnd(tls,client);                       // logs full vs resumed cost
+
+    The RTC copy sits after the eboot command (RTC_TLS_OFFSET blocks in).
+*/
+
+const uint8_t TLS_CACHE_SIZE = 4;
+const uint8_t TLS_HOST_LENGTH = 40;
+const uint8_t RTC_TLS_OFFSET = 96;      // 4 byte blocks, eboot uses 64-95
+
+typedef struct {
+  uint8_t slot;
+  bool hadSession;
+  uint8_t sessionID[32];
+  uint64_t startTime;       // us
+  uint32_t freeHeap;
+} TlsRequest;
+
+TlsRequest tlsBegin(WiFiClientSecure& client, const String& url);
+void tlsEnd(const TlsRequest& request, WiFiClientSecure& client);
+void tlsPrintStats();
+void urlHost(const String& url, char* host);   // TLS_HOST_LENGTH bytes
+
+#endif
@@ -0,0 +1,158 @@
+#include <ESP8266HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <ArduinoJson.h>
+#include <flash_hal.h>
+#include "UpdateManifest.h"
+#include "ManifestKey.h"
+#include "TlsSessions.h"
+#include "Clock.h"
+#include "Debug.h"
+
+bool hexToBytes(const char* hex, uint8_t* bytes, const uint8_t length) {
+  if (!hex || (strlen(hex) != length * 2)) {
+    return false;
+  }
+  for (uint8_t i = 0; i < length; i++) {
+    char byte[3] = {hex[i * 2],hex[i * 2 + 1],'\0'};
+    char* end;
+    bytes[i] = strtoul(byte,&end,16);
+    if (*end != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool parseEntry(JsonObject entry, ManifestEntry& result) {
+  result.version = entry["version"].as<uint32_t>();
+  result.size = entry["size"].as<uint32_t>();
+  result.chunkSize = entry["chunk"].as<uint32_t>();
+  if ((result.version == 0) || (result.size == 0) || (result.chunkSize == 0) || !hexToBytes(entry["sha256"].as<const char*>(),result.sha256,sizeof(result.sha256))) {
+    return false;
+  }
+  // chunks are written in whole flash sectors
+  if (result.chunkSize % FLASH_SECTOR_SIZE != 0) {
+    dPrintf(F("Manifest chunk size %d is not a multiple of %d\n"),result.chunkSize,FLASH_SECTOR_SIZE);
+    return false;
+  }
+  uint8_t md5[16];
+  if (!hexToBytes(entry["md5"].as<const char*>(),md5,sizeof(md5))) {
+    return false;
+  }
+  snprintf(result.md5,sizeof(result.md5),"%s",entry["md5"].as<const char*>());
+
+  JsonArray chunks = entry["chunks"];
+  result.numChunks = 0;
+  for (JsonVariant chunk : chunks) {
+    if ((result.numChunks >= MANIFEST_MAX_CHUNKS) || !hexToBytes(chunk.as<const char*>(),result.chunks[result.numChunks],MANIFEST_CHUNK_HASH_SIZE)) {
+      return false;
+    }
+    result.numChunks++;
+  }
+  return result.numChunks == (result.size + result.chunkSize - 1) / result.chunkSize;
+}
+
+// Checks the signature after the JSON. Returns the length of the JSON, 0 if
+// the signature is missing or doesn't match
+uint32_t manifestVerify(const uint8_t* body, const uint32_t size) {
+
+  if (pgm_read_byte(MANIFEST_PUBLIC_KEY) == '\0') {
+#if MANIFEST_UNSIGNED
+    dPrint(F("Manifest signature not checked (unsigned build)\n"));
+    return size;
+#else
+    dPrint(F("No manifest key in this build, updates are off\n"));
+    return 0;
+#endif
+  }
+
+  uint32_t sigLength = 0;
+  if (size > 4) {
+    memcpy(&sigLength,body + size - 4,4);
+  }
+  if ((sigLength == 0) || (sigLength + 4 >= size)) {
+    dPrint(F("Manifest is not signed\n"));
+    return 0;
+  }
+  uint32_t jsonLength = size - 4 - sigLength;
+
+  BearSSL::PublicKey key(MANIFEST_PUBLIC_KEY);
+  BearSSL::SigningVerifier verifier(&key);
+  BearSSL::HashSHA256 hash;
+  hash.begin();
+  hash.add(body,jsonLength);
+  hash.end();
+  if (!verifier.verify(&hash,body + jsonLength,sigLength)) {
+    dPrint(F("Manifest signature check failed\n"));
+    return 0;
+  }
+  return jsonLength;
+}
+
+bool manifestFetch(const String& url, UpdateManifest& manifest) {
+
+  uint64_t startTime = clockMillis();
+  manifest.valid = false;
+
+  HTTPClient httpClient;
+  WiFiClientSecure wificlient;
+  wificlient.setInsecure();
+
+  dPrint(F("Query Type: Update manifest\n"));
+  dPrintf(F("Query URL: %s\n"),url.c_str());
+
+  TlsRequest tls = tlsBegin(wificlient,url);
+  httpClient.begin(wificlient,url);
+  int httpCode = httpClient.GET();
+  tlsEnd(tls,wificlient);
+  if (httpCode != 200) {
+    dPrintf(F("Manifest HTTP Error: %d\n"),httpCode);
+    httpClient.end();
+    return false;
+  }
+
+  // the whole file, the signature covers it byte for byte
+  int size = httpClient.getSize();
+  if ((size <= 0) || (size > MANIFEST_MAX_SIZE)) {
+    dPrintf(F("Manifest size %d not accepted\n"),size);
+    httpClient.end();
+    return false;
+  }
+  uint8_t* body = (uint8_t*)malloc(size);
+  if (!body) {
+    dPrint(F("No memory for the manifest\n"));
+    httpClient.end();
+    return false;
+  }
+  int got = httpClient.getStream().readBytes(body,size);
+  httpClient.end();
+
+  uint32_t jsonLength = (got == size) ? manifestVerify(body,size) : 0;
+  if (jsonLength == 0) {
+    free(body);
+    return false;
+  }
+
+  DynamicJsonDocument doc(MANIFEST_DOC_SIZE);
+  DeserializationError err = deserializeJson(doc,(const char*)body,jsonLength);
+  free(body);
+
+  if (err) {
+    dPrintf(F("Manifest parse error: %s\n"),err.c_str());
+    return false;
+  }
+
+  if (!parseEntry(doc["fw"],manifest.fw) || !parseEntry(doc["fs"],manifest.fs)) {
+    dPrint(F("Manifest incomplete\n"));
+    return false;
+  }
+
+  manifest.files.size = doc["files"]["size"].as<uint32_t>();
+  if ((manifest.files.size > 0) && !hexToBytes(doc["files"]["sha256"].as<const char*>(),manifest.files.sha256,sizeof(manifest.files.sha256))) {
+    manifest.files.size = 0;
+  }
+
+  manifest.valid = true;
+  dPrintf(F("Manifest: FW %d (%d bytes) FS %d (%d bytes), fetched in %d ms\n"),manifest.fw.version,manifest.fw.size,manifest.fs.version,manifest.fs.size,(uint32_t)(clockMillis() - startTime));
+  return true;
+}
@@ -0,0 +1,63 @@
+#ifndef UPDATE_MANIFEST
+#define UPDATE_MANIFEST
+
+#include <Arduino.h>
+
+/*  One file on the update server describes everything that can be installed,
+    so the boot check is a single request (tools/make_manifest.py writes it):
+
+      {"fw":{"version":2023,"size":456789,"sha256":"<64 hex>","md5":"<32 hex>",
+             "chunk":65536,"chunks":["<16 hex>",...]},
+       "fs":{...},
+       "files":{"size":4321,"sha256":"<64 hex>"}}
+
+    "chunks" has the first 8 bytes of the SHA-256 of each chunk of the image so
+    the download engine (Download.h) can check every Range request on its own.
+    The image is only installed when the whole of it matches "sha256". "md5"
+    is handed to Update, which checks it before arming an image, delta or not.
+
+    "files" is optional and describes the file list for per file data updates
+    (FileSync.h) of version fs.version.
+
+    Every hash the updates are checked with comes from here, so the manifest is
+    signed. The JSON is followed by its RSA signature (SHA-256) and the length
+    of the signature as a u32, the same layout the core's signing.py gives
+    signed images. It is checked with MANIFEST_PUBLIC_KEY (ManifestKey.h), a
+    manifest that doesn't match is ignored.
+*/
+
+#ifndef MANIFEST_UNSIGNED
+#define MANIFEST_UNSIGNED 0     // 1: take manifests without a signature, for a test server
+#endif
+
+const char* const MANIFEST_FILENAME = "manifest.json";
+const uint16_t MANIFEST_DOC_SIZE = 3584;
+const uint16_t MANIFEST_MAX_SIZE = 4096;      // JSON and signature
+const uint8_t MANIFEST_MAX_CHUNKS = 32;       // 2MB filesystem in 64KB chunks
+const uint8_t MANIFEST_CHUNK_HASH_SIZE = 8;
+
+typedef struct {
+  uint32_t version = 0;
+  uint32_t size = 0;
+  uint8_t sha256[32];
+  char md5[33];
+  uint32_t chunkSize = 0;
+  uint8_t numChunks = 0;
+  uint8_t chunks[MANIFEST_MAX_CHUNKS][MANIFEST_CHUNK_HASH_SIZE];
+} ManifestEntry;
+
+typedef struct {
+  uint32_t size = 0;          // 0 when the server has no file list
+  uint8_t sha256[32];
+} ManifestFileList;
+
+typedef struct {
+  bool valid = false;
+  ManifestEntry fw;
+  ManifestEntry fs;
+  ManifestFileList files;
+} UpdateManifest;
+
+bool manifestFetch(const String& url, UpdateManifest& manifest);
+
+#endif
@@ -0,0 +1,150 @@
+#include <ESP8266HTTPClient.h>
+#include "Upstream.h"
+#include "Clock.h"
+#include "Debug.h"
+
+UpstreamHost upstreamHosts[UPSTREAM_MAX_HOSTS];
+UpstreamHost* upstreamLast = nullptr;     // for callers that don't have the url
+
+const char* const UPSTREAM_ERROR_NAMES[UPSTREAM_ERROR_COUNT] = {
+  "ok","connect","timeout","http 4xx","http 5xx","rate limited","parse","circuit open"
+};
+
+const char* const BREAKER_STATE_NAMES[] = {"closed","open","half open"};
+
+UpstreamError upstreamClassify(const int httpCode) {
+  if ((httpCode >= 200) && (httpCode < 300)) {
+    return UPSTREAM_OK;
+  }
+  if (httpCode == 429) {
+    return UPSTREAM_RATE_LIMITED;
+  }
+  if ((httpCode >= 400) && (httpCode < 500)) {
+    return UPSTREAM_HTTP_4XX;
+  }
+  if (httpCode == HTTPC_ERROR_READ_TIMEOUT) {
+    return UPSTREAM_TIMEOUT;
+  }
+  if (httpCode < 0) {
+    return UPSTREAM_CONNECT;
+  }
+  return UPSTREAM_HTTP_5XX;     // and anything else unexpected
+}
+
+const char* upstreamErrorName(const UpstreamError err) {
+  return (err < UPSTREAM_ERROR_COUNT) ? UPSTREAM_ERROR_NAMES[err] : "?";
+}
+
+// the slot for url's host. A new host takes a free or healthy slot first
+UpstreamHost& upstreamHost(const String& url) {
+  char host[TLS_HOST_LENGTH];
+  urlHost(url,host);
+
+  uint8_t free = 0;
+  for (uint8_t i = 0; i < UPSTREAM_MAX_HOSTS; i++) {
+    if (strcmp(upstreamHosts[i].host,host) == 0) {
+      return upstreamHosts[i];
+    }
+    if ((upstreamHosts[i].host[0] == '\0') || (upstreamHosts[i].failingSince < upstreamHosts[free].failingSince)) {
+      free = i;
+    }
+  }
+  upstreamHosts[free] = UpstreamHost();
+  strlcpy(upstreamHosts[free].host,host,sizeof(upstreamHosts[free].host));
+  return upstreamHosts[free];
+}
+
+// doubling per failure, capped, +-UPSTREAM_JITTER_PERCENT
+uint32_t backoffMs(const uint8_t failures) {
+  uint32_t delayMs = UPSTREAM_RETRY_BASE_MS;
+  for (uint8_t i = 1; (i < failures) && (delayMs < UPSTREAM_RETRY_MAX_MS); i++) {
+    delayMs *= 2;
+  }
+  delayMs = min(delayMs,UPSTREAM_RETRY_MAX_MS);
+  int32_t jitter = delayMs * UPSTREAM_JITTER_PERCENT / 100;
+  return delayMs + random(-jitter,jitter + 1);
+}
+
+bool upstreamAllowed(const String& url) {
+  UpstreamHost& host = upstreamHost(url);
+  if (host.state != BREAKER_OPEN) {
+    return true;
+  }
+  if (clockMillis() >= host.retryAt) {
+    host.state = BREAKER_HALF_OPEN;
+    dPrintf(F("Upstream %s: half open, trying one request\n"),host.host);
+    return true;
+  }
+  host.errors[UPSTREAM_CIRCUIT_OPEN]++;
+  upstreamLast = &host;
+  return false;
+}
+
+void upstreamResult(const String& url, const UpstreamError err) {
+  UpstreamHost& host = upstreamHost(url);
+  uint64_t now = clockMillis();
+  host.errors[err]++;
+  upstreamLast = &host;
+
+  if (err == UPSTREAM_OK) {
+    if (host.failingSince != 0) {
+      host.lastRecoveryMs = now - host.failingSince;
+      host.recoveries++;
+      dPrintf(F("Upstream %s: recovered after %d failures in %d ms\n"),host.host,host.failures,host.lastRecoveryMs);
+    }
+    host.state = BREAKER_CLOSED;
+    host.failures = 0;
+    host.retryMs = 0;
+    host.retryAt = 0;
+    host.failingSince = 0;
+    return;
+  }
+
+  if (host.failingSince == 0) {
+    host.failingSince = now;
+  }
+  if (host.failures < 0xFF) {
+    host.failures++;
+  }
+  host.retryMs = backoffMs(host.failures);
+  if (err == UPSTREAM_RATE_LIMITED) {
+    host.retryMs = max(host.retryMs,UPSTREAM_RATE_LIMIT_MS);
+  }
+  host.retryAt = now + host.retryMs;
+
+  if ((host.state == BREAKER_HALF_OPEN) || (host.failures >= UPSTREAM_BREAKER_FAILURES)) {
+    if (host.state != BREAKER_OPEN) {
+      host.opened++;
+    }
+    host.state = BREAKER_OPEN;
+  }
+  dPrintf(F("Upstream %s: %s, failure %d, breaker %s, retry in %d ms\n"),host.host,upstreamErrorName(err),
+          host.failures,BREAKER_STATE_NAMES[host.state],host.retryMs);
+}
+
+uint32_t upstreamRetryMs(const String& url) {
+  UpstreamHost& host = upstreamHost(url);
+  uint64_t now = clockMillis();
+  return (host.retryAt > now) ? host.retryAt - now : 0;
+}
+
+uint32_t upstreamLastRetryMs() {
+  uint64_t now = clockMillis();
+  return (upstreamLast && (upstreamLast->retryAt > now)) ? upstreamLast->retryAt - now : 0;
+}
+
+void upstreamPrintStats() {
+  for (uint8_t i = 0; i < UPSTREAM_MAX_HOSTS; i++) {
+    UpstreamHost& host = upstreamHosts[i];
+    if (host.host[0] == '\0') {
+      continue;
+    }
+    dPrintf(F("Upstream %s: breaker %s (opened %d), %d recoveries, last took %d ms\n"),host.host,
+            BREAKER_STATE_NAMES[host.state],host.opened,host.recoveries,host.lastRecoveryMs);
+    for (uint8_t e = 0; e < UPSTREAM_ERROR_COUNT; e++) {
+      if (host.errors[e]) {
+        dPrintf(F("  %-13s %d\n"),upstreamErrorName((UpstreamError)e),host.errors[e]);
+      }
+    }
+  }
+}
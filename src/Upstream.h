@@ -0,0 +1,68 @@
+#ifndef UPSTREAM
+#define UPSTREAM
+
+#include <Arduino.h>
+#include "TlsSessions.h"
+
+/*  Error handling for the score APIs. A failed query used to reboot the
+    board. Now each result is classified, and each upstream host gets a
+    circuit breaker so a dead API isn't hammered.
+
+    Every failure in a row doubles the host's retry delay, from
+    UPSTREAM_RETRY_BASE_MS up to UPSTREAM_RETRY_MAX_MS, give or take
+    UPSTREAM_JITTER_PERCENT so boards that failed together don't retry
+    together. A 429 waits at least UPSTREAM_RATE_LIMIT_MS. After
+    UPSTREAM_BREAKER_FAILURES in a row the breaker opens and
+    upstreamAllowed() refuses requests to the host until the retry delay is
+    up. Then one request is let through (half open). Success closes the
+    breaker and resets the delay, failure opens it again for longer.
+
+    Callers keep showing their last good data meanwhile. tools/fault_server.py
+    serves injected faults to test this against, and models the same policy.
+*/
+
+const uint32_t UPSTREAM_RETRY_BASE_MS = 5000;
+const uint32_t UPSTREAM_RETRY_MAX_MS = 2 * 60 * 1000;
+const uint32_t UPSTREAM_RATE_LIMIT_MS = 60 * 1000;
+const uint8_t UPSTREAM_JITTER_PERCENT = 25;
+const uint8_t UPSTREAM_BREAKER_FAILURES = 3;
+const uint8_t UPSTREAM_MAX_HOSTS = 4;
+
+enum UpstreamError : uint8_t {
+  UPSTREAM_OK,
+  UPSTREAM_CONNECT,       // no connection, or it dropped before the headers
+  UPSTREAM_TIMEOUT,
+  UPSTREAM_HTTP_4XX,
+  UPSTREAM_HTTP_5XX,
+  UPSTREAM_RATE_LIMITED,
+  UPSTREAM_PARSE,         // bad or truncated body
+  UPSTREAM_CIRCUIT_OPEN,  // not sent, the breaker is open
+  UPSTREAM_ERROR_COUNT
+};
+
+enum BreakerState : uint8_t {BREAKER_CLOSED,BREAKER_OPEN,BREAKER_HALF_OPEN};
+
+typedef struct {
+  char host[TLS_HOST_LENGTH] = "";
+  BreakerState state = BREAKER_CLOSED;
+  uint8_t failures = 0;           // in a row
+  uint32_t retryMs = 0;           // current delay, 0 after a success
+  uint64_t retryAt = 0;           // clockMillis the next attempt is due
+  uint64_t failingSince = 0;      // clockMillis of the first failure in a row, 0 when healthy
+  uint32_t opened = 0;
+  uint32_t recoveries = 0;
+  uint32_t lastRecoveryMs = 0;    // from the first failure to the next success
+  uint32_t errors[UPSTREAM_ERROR_COUNT] = {};
+} UpstreamHost;
+
+UpstreamError upstreamClassify(const int httpCode);
+const char* upstreamErrorName(const UpstreamError err);
+
+bool upstreamAllowed(const String& url);    // counts an UPSTREAM_CIRCUIT_OPEN when not
+void upstreamResult(const String& url, const UpstreamError err);
+uint32_t upstreamRetryMs(const String& url);  // until the next attempt is due, 0 when healthy
+uint32_t upstreamLastRetryMs();               // the same, for the host of the last result or refusal
+
+void upstreamPrintStats();
+
+#endif
@@ -0,0 +1,88 @@
+#include "Watchlist.h"
+#include "Clock.h"
+#include "Debug.h"
+
+WatchEntry watchlist[WATCHLIST_SIZE];
+uint8_t watchCount = 0;
+
+// requests per minute over the last hour, bucketMinute is the newest
+uint8_t requestBuckets[60];
+uint32_t bucketMinute = 0;
+uint32_t requestTotals[3] = {0,0,0};
+uint32_t requestsDeferred = 0;
+
+int8_t watchFind(const uint8_t league, const uint16_t teamID) {
+  for (uint8_t i = 0; i < watchCount; i++) {
+    if ((watchlist[i].league == league) && (watchlist[i].teamID == teamID)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool watchAdd(const uint8_t league, const uint16_t teamID) {
+  if ((watchCount >= WATCHLIST_SIZE) || (watchFind(league,teamID) >= 0)) {
+    return false;
+  }
+  watchlist[watchCount] = WatchEntry();
+  watchlist[watchCount].league = league;
+  watchlist[watchCount].teamID = teamID;
+  watchCount++;
+  return true;
+}
+
+bool watchRemove(const uint8_t league, const uint16_t teamID) {
+  int8_t index = watchFind(league,teamID);
+  if (index < 0) {
+    return false;
+  }
+  for (uint8_t i = index; i + 1 < watchCount; i++) {
+    watchlist[i] = watchlist[i + 1];
+  }
+  watchCount--;
+  return true;
+}
+
+// drop the buckets that fell out of the hour
+void advanceBuckets() {
+  uint32_t minute = clockMillis() / 60000;
+  if (minute - bucketMinute >= 60) {
+    memset(requestBuckets,0,sizeof(requestBuckets));
+  }
+  else {
+    for (uint32_t m = bucketMinute + 1; m <= minute; m++) {
+      requestBuckets[m % 60] = 0;
+    }
+  }
+  bucketMinute = minute;
+}
+
+uint16_t requestsLastHour() {
+  advanceBuckets();
+  uint16_t total = 0;
+  for (uint8_t i = 0; i < 60; i++) {
+    total += requestBuckets[i];
+  }
+  return total;
+}
+
+void requestCount(const RequestSource source) {
+  advanceBuckets();
+  if (requestBuckets[bucketMinute % 60] < 0xFF) {
+    requestBuckets[bucketMinute % 60]++;
+  }
+  requestTotals[source]++;
+}
+
+bool requestAllowed() {
+  if (requestsLastHour() < REQUEST_BUDGET_PER_HOUR) {
+    return true;
+  }
+  requestsDeferred++;
+  return false;
+}
+
+void requestReport() {
+  dPrintf(F("REQ,%d,%d,%d,%d,%d,%d\n"),requestsLastHour(),REQUEST_BUDGET_PER_HOUR,
+          requestTotals[REQUEST_SELECTED],requestTotals[REQUEST_WATCHED],requestTotals[REQUEST_TICKER],requestsDeferred);
+}
@@ -0,0 +1,52 @@
+#ifndef WATCHLIST
+#define WATCHLIST
+
+#include <Arduino.h>
+#include "GameData.h"
+
+/*  Teams followed besides the selected one, across any league. The selected
+    team keeps its own poll task; watched teams are checked by the watch task
+    in main from a cached schedule, refreshed every WATCH_SCHEDULE_REFRESH_MS
+    or right after their game ends. A watched game is only polled while it is
+    live. The first live one in list order gets the normal game interval when
+    the selected team isn't playing, the rest are polled every
+    WATCH_SLOW_POLL_MS.
+
+    Every upstream request is counted here in one minute buckets. Watched teams
+    only get a request while the total over the last hour is below
+    REQUEST_BUDGET_PER_HOUR, the selected team is never held back. Once an hour
+    a summary line is printed, all fields after the budget are running totals:
+      REQ,<last hour>,<budget>,<selected>,<watched>,<ticker>,<deferred>
+*/
+
+const uint8_t WATCHLIST_SIZE = 6;
+const uint32_t WATCH_SCHEDULE_REFRESH_MS = 12 * 60 * 60 * 1000;
+const uint32_t WATCH_SLOW_POLL_MS = 5 * 60 * 1000;
+const uint16_t REQUEST_BUDGET_PER_HOUR = 120;
+const uint32_t REQUEST_REPORT_INTERVAL_MS = 60 * 60 * 1000;
+
+typedef struct {
+  uint8_t league = 0;
+  uint16_t teamID = 0;
+  NextGameData nextGame;
+  CurrentGameData currentGame;
+  uint64_t scheduleChecked = 0;   // clockMillis of the last schedule query, 0 for never
+  uint64_t nextPoll = 0;
+  bool live = false;
+} WatchEntry;
+
+enum RequestSource {REQUEST_SELECTED,REQUEST_WATCHED,REQUEST_TICKER};
+
+extern WatchEntry watchlist[WATCHLIST_SIZE];
+extern uint8_t watchCount;
+
+int8_t watchFind(const uint8_t league, const uint16_t teamID);
+bool watchAdd(const uint8_t league, const uint16_t teamID);
+bool watchRemove(const uint8_t league, const uint16_t teamID);
+
+void requestCount(const RequestSource source);
+bool requestAllowed();      // for watched teams, counts a deferral when not
+uint16_t requestsLastHour();
+void requestReport();
+
+#endif
@@ -74,9 +74,7 @@ ToDo:           - Testing
                 - update icons for NHL
                 - better documentation
 
-*   Maybe:     - change millis() code to be rollover safe
-               - change code to be league generic? so nhl, mlb, nba aren't listed in variable names
-               - dark mode
+*   Maybe:     - dark mode
                - secure and/or signed OTA updates
                - figure out series record for mlb games - no API options?
                - clean up use of global variables
@@ -91,17 +89,38 @@ ToDo:           - Testing
 #include <Timezone.h>
 #include <LittleFS.h>
 #include <WiFiManager.h>
-#define ARDUINOJSON_USE_LONG_LONG 1
-#define ARDUINOJSON_USE_DOUBLE 1
 #include <ArduinoJson.h>
 #include <ESP8266HTTPClient.h>
-#include <ESP8266httpUpdate.h>
 #include <TZ.h>
 
-#define SIMPLEDEBUG_SERIAL Serial
-#include "SimpleDebug.h"
+#include "Debug.h"
 
 #include "BMP_functions.h"
+#include "Layout.h"
+#include "Leagues.h"
+#include "Scheduler.h"
+#include "Power.h"
+#include "Clock.h"
+#include "Snapshot.h"
+#include "RtcState.h"
+#include "DeltaUpdate.h"
+#include "UpdateManifest.h"
+#include "TlsSessions.h"
+#include "Download.h"
+#include "FileSync.h"
+#include "Watchlist.h"
+#include "GameEvents.h"
+#include "Animation.h"
+#include "Console.h"
+#include "StatusServer.h"
+#include "Peers.h"
+#include "Simulation.h"
+#include "Upstream.h"
+#include "Deadlines.h"
+#include "DnsCache.h"
+#include "Bench.h"
+#include "StatsApi.h"
+#include "League_NBA.h"
 
 ////////////////// Global Constants //////////////////
 // !!!!! Change version for each build !!!!!
@@ -113,6 +132,7 @@ const uint8_t SELECT_BUTTON_PIN = D1;     // change with caution
 
 const uint8_t DEBOUNCE_INTERVAL = 25;
 const uint16_t LONG_PRESS_THRESHOLD = 1000;
+const uint16_t WATCH_PRESS_THRESHOLD = 3000;     // in the team menu: add to or drop from the watchlist
 const uint8_t TFT_ROTATION = 3;
 
 const char* TEAMS_DATAFILE = "/myteam.dat";
@@ -125,112 +145,43 @@ const uint16_t NTP_WAIT = 500;
 const uint16_t TFT_HALF_WIDTH = 80;
 const uint16_t TFT_HALF_HEIGHT = 64;
 
-const uint32_t SECONDS_IN_A_DAY = 60 * 60 * 24;
-const uint32_t SECONDS_IN_A_WEEK = SECONDS_IN_A_DAY * 7;
 const char* HTTP_END_OF_HEADER = "\r\n\r\n";
 
 const char* ORDINALS[4] = {"1st","2nd","3rd","4th"};
 
-
-// Game status codes. These are dependant on the statsapi
-// NHL uses numbers and MLB uses characters
-const char* STATUSCODE_PREGAME = "Preview";
-const char* STATUSCODE_LIVE = "Live";
-const char* STATUSCODE_FINAL = "Final";
-const char* STATUSCODE_SCHEDULED = "Scheduled";
-const char* STATUSCODE_INPROGRESS = "In Progress";
-
-//const char* STATUSCODE_NBA_SCHEDULED = "Scheduled";
-//const char* STATUSCODE_NBA_INPROGRESS = "In Progress";
-const char* STATUSCODE_NBA_FINAL = "STATUS_FINAL";
-const char* STATUSCODE_NBA_HALFTIME = "STATUS_HALFTIME";
-const char* STATUSCODE_NBA_ENDOFQUATER = "STATUS_END_PERIOD";
-const char* STATUSCODE_NBA_SCHEDULED = "STATUS_SCHEDULED";
-
 const uint32_t AFTER_GAME_RESULTS_DURATION_MS = 60 * 60 * 1 * 1000; // 1 hours
 const uint32_t GAME_UPDATE_INTERVAL = 65;  // 65 seconds
 const uint32_t MAX_SLEEP_INTERVAL_S = 60 * 60; // 1 hour
+const uint32_t WIFI_WAIT_MS = 250;   // poll retry while WiFi comes back from light sleep
+const uint32_t WIFI_CONNECT_TIMEOUT_MS = 15 * 1000;   // then fall back to the config portal
+const uint32_t SNAPSHOT_MIN_INTERVAL_MS = 5 * 60 * 1000;   // limit flash writes during live games
+const time_t VALID_TIME = 1500000000;        // anything before this means NTP hasn't answered yet
+const uint32_t TICKER_PAGE_MS = 5 * 1000;            // time each page of the ticker is shown
+const uint32_t TICKER_IDLE_POLL_MS = 5 * 60 * 1000;  // nothing live yet but games still to come
+const uint8_t TICKER_ROWS = 7;
+const uint8_t TICKER_ROW_HEIGHT = 16;
+const uint16_t SCORE_POP_MS = 1000;
+const uint16_t NEXT_GAME_SLIDE_MS = 400;
+const uint16_t NEXT_GAME_FADE_MS = 600;
+const uint8_t STALE_AFTER_POLLS = 3;                // missed game polls before the score is marked stale
 
 const char* FW_URL = "https://www.lipscomb.ca/IOT/firmware/";
-const char* FW_HOST = "lipscomb.ca";
 const char* PROJECT_NAME = "TFT_SportsScores/";
-const char* FW_VERSION_FILENAME = "firmware_ver.txt";
 const char* CFG_VERSION_FILENAME = "fs_ver.txt";
 const char* FW_PREFIX = "firmware_";
 const char* CFG_PREFIX = "littlefs_";
 const char* FW_EXT = ".bin";
+const char* DELTA_EXT = ".delta";      // firmware_<from>_<to>.delta
 const char* CFG_EXT = ".bin";
+const char* FILES_PREFIX = "files_";   // files_<version>/ has the data directory and its file list
 const char* NBA_FILTER_JSON = "nba_filter.json";
 
 const uint8_t TFT_BUFFER_SIZE = 80;
 
-const uint8_t NUM_LEAGUES = 3;
-
-const uint8_t NHL = 0;
-const uint8_t NHL_ICON_ID = 253; // can't match any other team ids   
-const char* NHL_HOST = "statsapi.web.nhl.com";
-const uint16_t NHL_PORT = 80;
-const uint8_t NHL_NUM_TEAMS = 31;
-const uint8_t NHL_NUM_MENU_ITEMS = NHL_NUM_TEAMS + NUM_LEAGUES - 1;
-
-const uint8_t MLB = 1; 
-const uint8_t MLB_ICON_ID = 254; // can't match any other team ids
-const char* MLB_HOST = "statsapi.mlb.com";
-const uint16_t MLB_PORT = 80;
-const uint8_t MLB_NUM_TEAMS = 30;
-const uint8_t MLB_NUM_MENU_ITEMS = MLB_NUM_TEAMS + NUM_LEAGUES - 1;
-
-
-const uint8_t NBA = 2;
-const uint8_t NBA_ICON_ID = 255;   // can't match any other team ids
-const char* NBA_HOST = "";
-const uint16_t NBA_PORT = 443;
-const uint8_t NBA_NUM_TEAMS = 30;
-const uint8_t NBA_NUM_MENU_ITEMS = NBA_NUM_TEAMS + NUM_LEAGUES - 1;
-
-
-const char* LEAGUE_NAMES[NUM_LEAGUES] = {"NHL","MLB","NBA"};
 
 // handy for testing
 #define ILOOP while(true){yield();}  
 
-
-////////////////// Data Structs ///////////
-
-
-typedef struct  {
-  uint8_t id = 0;
-  char name[4] = "XXX";
-} TeamInfo;
-
-typedef struct {
-  uint8_t awayID = 0;
-  uint8_t homeID = 0;
-  uint32_t gameID = 0;
-  char homeRecord[9];   // xx-xx-xx
-  char awayRecord[9];
-  bool isPlayoffs = false;
-  time_t startTime = 0;
-  uint8_t league = 0;
-} NextGameData;
-
-typedef struct  {
-  uint32_t gameID = 0;
-  uint8_t awayID = 0;
-  uint8_t homeID = 0;
-  uint8_t awayScore = 0;
-  uint8_t homeScore = 0;
-  uint8_t homeOther = 0;   // only used for NHL powerplay right now
-  uint8_t awayOther = 0;   // only used for NHL powerplay right now
-  char devision[5];    // 1st, 2nd etc
-  char timeRemaining[6];  // 12:34
-  uint8_t league = NHL;
-  bool bases[3];
-  uint8_t outs = 0;
-} CurrentGameData;
-
-enum GameStatus {NEW_TEAM,NO_GAMES,SCHEDULED,STARTED,FINISHED,AFTER_GAME};
-
 ///////////// Global Variables ////////////
 uint16_t selectedTeam[NUM_LEAGUES] = {24,109,37};  // Aniheim, Arizona,     alphabetical first
 
@@ -238,12 +189,79 @@ char timeString[16 + 1];    // date buffer format: YYYY/MM/DD HH:mm
 uint8_t currentLeague = NHL;
 bool otaSelected = false;
 volatile bool switchTeamsFlag = false;   // used by button interrupt to signal to switch the selected team
+volatile bool shortPressFlag = false;    // used by button interrupt to signal a short press
+bool afterGameDismissed = false;
+bool timeIsValid = false;
+bool showingSnapshot = false;    // last boot's screen is up, progress messages don't replace it
+bool liveFrameShown = false;
+bool resumedGame = false;        // warm reset straight back into a live game
+bool peerGameOver = false;       // the leader we follow said our game ended
+bool simPeersWere = true;        // peer sharing is off during a simulation
+
+// poll intervals, start at the defaults above and can be changed from the console
+uint32_t gameUpdateInterval = GAME_UPDATE_INTERVAL;   // seconds
+uint32_t tickerIdlePollMs = TICKER_IDLE_POLL_MS;
+uint32_t watchSlowPollMs = WATCH_SLOW_POLL_MS;
+
+// What the render task should draw next
+enum Screen {SCREEN_NONE,SCREEN_NEXT_GAME,SCREEN_CURRENT_GAME,SCREEN_TICKER,SCREEN_WATCHED_GAME};
+Screen pendingScreen = SCREEN_NONE;
+
+// League ticker. Each poll fills tickerFetch, it only replaces tickerBoard when
+// something changed. tickerShown is what each row has on screen right now
+bool tickerMode = false;
+TickerBoard tickerBoard;
+TickerBoard tickerFetch;
+TickerGame tickerShown[TICKER_ROWS];
+uint8_t tickerPage = 0;
+bool tickerRedraw = true;
+uint64_t tickerNextFetch = 0;
+
+int8_t watchShown = -1;     // watchlist entry whose live game is on screen
+bool watchLive = false;
+
+// score pop: the scoring side's score flashes in inverse over its own rectangle.
+// It starts once the render task has drawn the new score
+bool scorePopHome = false;
+bool scorePopPending = false;
+uint64_t scorePopResponseUs = 0;
+uint64_t lastResponseUs = 0;                 // when the last current game query answered
+uint64_t lastGoodGameMs = 0;                 // schedulerMillis of the last good score for our game or its start, 0 for not yet (never stale)
+uint32_t currentGameRetryMs = 0;             // after a failed current game query, from the upstream backoff
+uint32_t nextGameRetryMs = 0;                // the same for the next game query
+bool nextGameUnknown = false;                // the next game query after the last final failed
+uint32_t staleMinutes = 0;                   // age on the stale marker, 0 while the score is fresh
+uint32_t scoreLatencyCount = 0;
+uint32_t scoreLatencyMaxMs = 0;
+uint64_t scoreLatencyTotalMs = 0;
+
+// Boot time update checks. Waiting for a button press is a state rather than a busy wait
+enum UpdateStage {CHECK_FW,WAIT_FW,CHECK_CFG,WAIT_CFG,UPDATES_DONE};
+UpdateStage updateStage = CHECK_FW;
+uint32_t pendingUpdateVersion = 0;
+UpdateManifest updateManifest;
+uint64_t fwUpdateStart = 0;
+uint32_t fwUpdateBytes = 0;
+
+// scheduler task handles
+uint8_t inputTask = NO_TASK;
+uint8_t renderTask = NO_TASK;
+uint8_t pollTask = NO_TASK;
+uint8_t timeTask = NO_TASK;
+uint8_t updateTask = NO_TASK;
+uint8_t wifiTask = NO_TASK;
+uint8_t tickerTask = NO_TASK;
+uint8_t watchTask = NO_TASK;
+uint8_t animTask = NO_TASK;
+uint8_t consoleTask = NO_TASK;
+uint8_t statusTask = NO_TASK;
+uint8_t peerTask = NO_TASK;
+uint8_t simTask = NO_TASK;
+uint8_t dnsTask = NO_TASK;
+uint8_t logTask = NO_TASK;
 
 /////////// Global Object Variables //////////
 TFT_eSPI tft = TFT_eSPI();
-TeamInfo nhlTeams[NHL_NUM_MENU_ITEMS];
-TeamInfo mlbTeams[MLB_NUM_MENU_ITEMS];
-TeamInfo nbaTeams[NBA_NUM_MENU_ITEMS];
 Bounce debouncer = Bounce();
 WiFiManager wifiManager;
 NextGameData nextGameData;
@@ -258,6 +276,8 @@ void tftMessage(const __FlashStringHelper *format, ...) {
   va_list ap;
   va_start(ap,format);
   vsnprintf(buffer,sizeof(buffer), (const char*) format, ap);
+  showingSnapshot = false;
+  animStopAll();
   tft.fillScreen(TFT_BLACK);
   tft.setTextSize(1);
   tft.setTextColor(TFT_WHITE);
@@ -268,6 +288,7 @@ void tftMessage(const __FlashStringHelper *format, ...) {
 
 void iLoop() {
   dPrintf(F("infinite delay"));
+  logFlush();
   while (true) {
     delay(0xFFFFFFFF);
   }
@@ -282,6 +303,7 @@ void permanentError(const __FlashStringHelper *format, ...) {
   tftMessage(format,ap);
   dPrintf(F("Permanent Error!!!: %s\n"),buffer);
   va_end(ap);
+  logFlush();
   delay(5000);
   ESP.restart();
 
@@ -292,7 +314,8 @@ void tftSet(int8_t action);
 void ICACHE_RAM_ATTR buttonInterrupt() {
 
   dPrintln(F("select button pressed"));
-  static uint32_t pressedTime = 0;
+  static bool pressed = false;
+  static uint32_t pressedTime = 0;    // millis() differences are rollover safe, clockMillis() isn't ISR safe
 
   if (digitalRead(SWITCH_PIN_1) == LOW) {  // screen off
     if (gameStatus != STARTED) {
@@ -301,15 +324,21 @@ void ICACHE_RAM_ATTR buttonInterrupt() {
   }
   else {
     if (digitalRead(SELECT_BUTTON_PIN) == LOW) {
-      if (pressedTime == 0) {
+      if (!pressed) {
+        pressed = true;
         pressedTime = millis();
       }
     }
-    else {
-      if ((millis() - pressedTime) > LONG_PRESS_THRESHOLD) {
+    else if (pressed) {
+      uint32_t pressDuration = millis() - pressedTime;
+      if (pressDuration > LONG_PRESS_THRESHOLD) {
         switchTeamsFlag = true;    
       }
-      pressedTime = 0;
+      else if (pressDuration > DEBOUNCE_INTERVAL) {
+        shortPressFlag = true;
+      }
+      pressed = false;
+      taskWakeFromISR(inputTask);
     }
   }
  
@@ -327,219 +356,6 @@ void setInterrupt(const bool enable) {
 }
 
 
-
-
-// populate teams list
-void teamListInit_NHL() {
-  nhlTeams[0].id = 24;
-  snprintf(nhlTeams[0].name,sizeof(nhlTeams[0].name),"%s",F("ANA"));
-  nhlTeams[1].id = 53;
-  snprintf(nhlTeams[1].name,sizeof(nhlTeams[1].name),"%s",F("ARI"));
-  nhlTeams[2].id = 6;
-  snprintf(nhlTeams[2].name,sizeof(nhlTeams[2].name),"%s",F("BOS"));
-  nhlTeams[3].id = 7;
-  snprintf(nhlTeams[3].name,sizeof(nhlTeams[3].name),"%s",F("BUF"));
-  nhlTeams[4].id = 12;
-  snprintf(nhlTeams[4].name,sizeof(nhlTeams[4].name),"%s",F("CAR"));
-  nhlTeams[5].id = 29;
-  snprintf(nhlTeams[5].name,sizeof(nhlTeams[5].name),"%s",F("CBJ"));
-  nhlTeams[6].id = 20;
-  snprintf(nhlTeams[6].name,sizeof(nhlTeams[6].name),"%s",F("CGY"));
-  nhlTeams[7].id = 16;
-  snprintf(nhlTeams[7].name,sizeof(nhlTeams[7].name),"%s",F("CHI"));
-  nhlTeams[8].id = 21;
-  snprintf(nhlTeams[8].name,sizeof(nhlTeams[8].name),"%s",F("COL"));
-  nhlTeams[9].id = 25;
-  snprintf(nhlTeams[9].name,sizeof(nhlTeams[9].name),"%s",F("DAL"));
-  nhlTeams[10].id = 17;
-  snprintf(nhlTeams[10].name,sizeof(nhlTeams[10].name),"%s",F("DET"));
-  nhlTeams[11].id = 22;
-  snprintf(nhlTeams[11].name,sizeof(nhlTeams[11].name),"%s",F("EDM"));
-  nhlTeams[12].id = 13;
-  snprintf(nhlTeams[12].name,sizeof(nhlTeams[12].name),"%s",F("FLA"));
-  nhlTeams[13].id = 26;
-  snprintf(nhlTeams[13].name,sizeof(nhlTeams[13].name),"%s",F("LAK"));
-  nhlTeams[14].id = 30;
-  snprintf(nhlTeams[14].name,sizeof(nhlTeams[14].name),"%s",F("MIN"));
-  nhlTeams[15].id = 8;
-  snprintf(nhlTeams[15].name,sizeof(nhlTeams[15].name),"%s",F("MTL"));
-  nhlTeams[16].id = 1;
-  snprintf(nhlTeams[16].name,sizeof(nhlTeams[16].name),"%s",F("NJD"));
-  nhlTeams[17].id = 18;
-  snprintf(nhlTeams[17].name,sizeof(nhlTeams[17].name),"%s",F("NSH"));
-  nhlTeams[18].id = 2;
-  snprintf(nhlTeams[18].name,sizeof(nhlTeams[18].name),"%s",F("NYI"));
-  nhlTeams[19].id = 3;
-  snprintf(nhlTeams[19].name,sizeof(nhlTeams[19].name),"%s",F("NYR"));
-  nhlTeams[20].id = 9;
-  snprintf(nhlTeams[20].name,sizeof(nhlTeams[20].name),"%s",F("OTT"));
-  nhlTeams[21].id = 4;
-  snprintf(nhlTeams[21].name,sizeof(nhlTeams[21].name),"%s",F("PHI"));
-  nhlTeams[22].id = 5;
-  snprintf(nhlTeams[22].name,sizeof(nhlTeams[22].name),"%s",F("PIT"));
-  nhlTeams[23].id = 28;
-  snprintf(nhlTeams[23].name,sizeof(nhlTeams[23].name),"%s",F("SJS"));
-  nhlTeams[24].id = 19;
-  snprintf(nhlTeams[24].name,sizeof(nhlTeams[24].name),"%s",F("STL"));
-  nhlTeams[25].id = 14;
-  snprintf(nhlTeams[25].name,sizeof(nhlTeams[25].name),"%s",F("TBL"));
-  nhlTeams[26].id = 10;
-  snprintf(nhlTeams[26].name,sizeof(nhlTeams[26].name),"%s",F("TOR"));
-  nhlTeams[27].id = 23;
-  snprintf(nhlTeams[27].name,sizeof(nhlTeams[27].name),"%s",F("VAN"));
-  nhlTeams[28].id = 54;
-  snprintf(nhlTeams[28].name,sizeof(nhlTeams[28].name),"%s",F("VGK"));
-  nhlTeams[29].id = 52;
-  snprintf(nhlTeams[29].name,sizeof(nhlTeams[29].name),"%s",F("WPG"));
-  nhlTeams[30].id = 15;
-  snprintf(nhlTeams[30].name,sizeof(nhlTeams[30].name),"%s",F("WSH"));
-  nhlTeams[31].id = MLB_ICON_ID;
-  snprintf(nhlTeams[31].name,sizeof(nhlTeams[31].name),"%s",F("MLB"));
-  nhlTeams[32].id = NBA_ICON_ID;
-  snprintf(nhlTeams[32].name,sizeof(nhlTeams[32].name),"%s",F("NBA"));
-}
-
-// populate teams list
-void teamListInit_MLB() {
-  mlbTeams[0].id = 109;
-  snprintf(mlbTeams[0].name,sizeof(mlbTeams[0].name),"%s",F("ARI"));
-  mlbTeams[1].id = 144;
-  snprintf(mlbTeams[1].name,sizeof(mlbTeams[1].name),"%s",F("ATL"));
-  mlbTeams[2].id = 110;
-  snprintf(mlbTeams[2].name,sizeof(mlbTeams[2].name),"%s",F("BAL"));
-  mlbTeams[3].id = 111;
-  snprintf(mlbTeams[3].name,sizeof(mlbTeams[3].name),"%s",F("BOS"));
-  mlbTeams[4].id = 112;
-  snprintf(mlbTeams[4].name,sizeof(mlbTeams[4].name),"%s",F("CHC"));
-  mlbTeams[5].id = 145;
-  snprintf(mlbTeams[5].name,sizeof(mlbTeams[5].name),"%s",F("CWS"));
-  mlbTeams[6].id = 113;
-  snprintf(mlbTeams[6].name,sizeof(mlbTeams[6].name),"%s",F("CIN"));
-  mlbTeams[7].id = 114;
-  snprintf(mlbTeams[7].name,sizeof(mlbTeams[7].name),"%s",F("CLE"));
-  mlbTeams[8].id = 115;
-  snprintf(mlbTeams[8].name,sizeof(mlbTeams[8].name),"%s",F("COL"));
-  mlbTeams[9].id = 116;
-  snprintf(mlbTeams[9].name,sizeof(mlbTeams[9].name),"%s",F("DET"));
-  mlbTeams[10].id = 117;
-  snprintf(mlbTeams[10].name,sizeof(mlbTeams[10].name),"%s",F("HOU"));
-  mlbTeams[11].id = 118;
-  snprintf(mlbTeams[11].name,sizeof(mlbTeams[11].name),"%s",F("KCR"));
-  mlbTeams[12].id = 108;
-  snprintf(mlbTeams[12].name,sizeof(mlbTeams[12].name),"%s",F("LAA"));
-  mlbTeams[13].id = 119;
-  snprintf(mlbTeams[13].name,sizeof(mlbTeams[13].name),"%s",F("LAD"));
-  mlbTeams[14].id = 146;
-  snprintf(mlbTeams[14].name,sizeof(mlbTeams[14].name),"%s",F("MIA"));
-  mlbTeams[15].id = 158;
-  snprintf(mlbTeams[15].name,sizeof(mlbTeams[15].name),"%s",F("MIL"));
-  mlbTeams[16].id = 142;
-  snprintf(mlbTeams[16].name,sizeof(mlbTeams[16].name),"%s",F("MIN"));
-  mlbTeams[17].id = 121;
-  snprintf(mlbTeams[17].name,sizeof(mlbTeams[17].name),"%s",F("NYM"));
-  mlbTeams[18].id = 147;
-  snprintf(mlbTeams[18].name,sizeof(mlbTeams[18].name),"%s",F("NYY"));
-  mlbTeams[19].id = 133;
-  snprintf(mlbTeams[19].name,sizeof(mlbTeams[19].name),"%s",F("OAK"));
-  mlbTeams[20].id = 143;
-  snprintf(mlbTeams[20].name,sizeof(mlbTeams[20].name),"%s",F("PHI"));
-  mlbTeams[21].id = 134;
-  snprintf(mlbTeams[21].name,sizeof(mlbTeams[21].name),"%s",F("PIT"));
-  mlbTeams[22].id = 135;
-  snprintf(mlbTeams[22].name,sizeof(mlbTeams[22].name),"%s",F("SDP"));
-  mlbTeams[23].id = 137;
-  snprintf(mlbTeams[23].name,sizeof(mlbTeams[23].name),"%s",F("SFG"));
-  mlbTeams[24].id = 136;
-  snprintf(mlbTeams[24].name,sizeof(mlbTeams[24].name),"%s",F("SEA"));
-  mlbTeams[25].id = 138;
-  snprintf(mlbTeams[25].name,sizeof(mlbTeams[25].name),"%s",F("STL"));
-  mlbTeams[26].id = 139;
-  snprintf(mlbTeams[26].name,sizeof(mlbTeams[26].name),"%s",F("TBR"));
-  mlbTeams[27].id = 140;
-  snprintf(mlbTeams[27].name,sizeof(mlbTeams[27].name),"%s",F("TEX"));
-  mlbTeams[28].id = 141;
-  snprintf(mlbTeams[28].name,sizeof(mlbTeams[28].name),"%s",F("TOR"));
-  mlbTeams[29].id = 120;
-  snprintf(mlbTeams[29].name,sizeof(mlbTeams[29].name),"%s",F("WSH"));
-  mlbTeams[30].id = NHL_ICON_ID;
-  snprintf(mlbTeams[30].name,sizeof(mlbTeams[30].name),"%s",F("NHL"));
-  mlbTeams[31].id = NBA_ICON_ID;
-  snprintf(mlbTeams[31].name,sizeof(mlbTeams[31].name),"%s",F("NBA"));
-}
-
-void teamListInit_NBA() {
-  nbaTeams[0].id = 1;
-  snprintf(nbaTeams[0].name,sizeof(nbaTeams[0].name),"%s",F("ATL"));
-  nbaTeams[1].id = 2;
-  snprintf(nbaTeams[1].name,sizeof(nbaTeams[1].name),"%s",F("BOS"));
-  nbaTeams[2].id = 17;
-  snprintf(nbaTeams[2].name,sizeof(nbaTeams[2].name),"%s",F("BKN"));
-  nbaTeams[3].id = 30;
-  snprintf(nbaTeams[3].name,sizeof(nbaTeams[3].name),"%s",F("CHA"));
-  nbaTeams[4].id = 4;
-  snprintf(nbaTeams[4].name,sizeof(nbaTeams[4].name),"%s",F("CHI"));
-  nbaTeams[5].id = 5;
-  snprintf(nbaTeams[5].name,sizeof(nbaTeams[5].name),"%s",F("CLE"));
-  nbaTeams[6].id = 6;
-  snprintf(nbaTeams[6].name,sizeof(nbaTeams[6].name),"%s",F("DAL"));
-  nbaTeams[7].id = 7;
-  snprintf(nbaTeams[7].name,sizeof(nbaTeams[7].name),"%s",F("DEN"));
-  nbaTeams[8].id = 8;
-  snprintf(nbaTeams[8].name,sizeof(nbaTeams[8].name),"%s",F("DET"));
-  nbaTeams[9].id = 9;
-  snprintf(nbaTeams[9].name,sizeof(nbaTeams[9].name),"%s",F("GSW"));
-  nbaTeams[10].id = 10;
-  snprintf(nbaTeams[10].name,sizeof(nbaTeams[10].name),"%s",F("HOU"));
-  nbaTeams[11].id = 11;
-  snprintf(nbaTeams[11].name,sizeof(nbaTeams[11].name),"%s",F("IND"));
-  nbaTeams[12].id = 12;
-  snprintf(nbaTeams[12].name,sizeof(nbaTeams[12].name),"%s",F("LAC"));
-  nbaTeams[13].id = 13;
-  snprintf(nbaTeams[13].name,sizeof(nbaTeams[13].name),"%s",F("LAL"));
-  nbaTeams[14].id = 29;
-  snprintf(nbaTeams[14].name,sizeof(nbaTeams[14].name),"%s",F("MEM"));
-  nbaTeams[15].id = 14;
-  snprintf(nbaTeams[15].name,sizeof(nbaTeams[15].name),"%s",F("MIA"));
-  nbaTeams[16].id = 15;
-  snprintf(nbaTeams[16].name,sizeof(nbaTeams[16].name),"%s",F("MIL"));
-  nbaTeams[17].id = 16;
-  snprintf(nbaTeams[17].name,sizeof(nbaTeams[17].name),"%s",F("MIN"));
-  nbaTeams[18].id = 3;
-  snprintf(nbaTeams[18].name,sizeof(nbaTeams[18].name),"%s",F("NOP"));
-  nbaTeams[19].id = 18;
-  snprintf(nbaTeams[19].name,sizeof(nbaTeams[19].name),"%s",F("NYK"));
-  nbaTeams[20].id = 25;
-  snprintf(nbaTeams[20].name,sizeof(nbaTeams[20].name),"%s",F("OKC"));
-  nbaTeams[21].id = 19;
-  snprintf(nbaTeams[21].name,sizeof(nbaTeams[21].name),"%s",F("ORL"));
-  nbaTeams[22].id = 20;
-  snprintf(nbaTeams[22].name,sizeof(nbaTeams[22].name),"%s",F("PHI"));
-  nbaTeams[23].id = 21;
-  snprintf(nbaTeams[23].name,sizeof(nbaTeams[23].name),"%s",F("PHX"));
-  nbaTeams[24].id = 22;
-  snprintf(nbaTeams[24].name,sizeof(nbaTeams[24].name),"%s",F("POR"));
-  nbaTeams[25].id = 23;
-  snprintf(nbaTeams[25].name,sizeof(nbaTeams[25].name),"%s",F("SAC"));
-  nbaTeams[26].id = 24;
-  snprintf(nbaTeams[26].name,sizeof(nbaTeams[26].name),"%s",F("SAS"));
-  nbaTeams[27].id = 28;
-  snprintf(nbaTeams[27].name,sizeof(nbaTeams[27].name),"%s",F("TOR"));
-  nbaTeams[28].id = 26;
-  snprintf(nbaTeams[28].name,sizeof(nbaTeams[28].name),"%s",F("UTA"));
-  nbaTeams[29].id = 27;
-  snprintf(nbaTeams[29].name,sizeof(nbaTeams[29].name),"%s",F("WAS"));
-  nbaTeams[30].id = NHL_ICON_ID;
-  snprintf(nbaTeams[30].name,sizeof(nbaTeams[30].name),"%s",F("NHL"));
-  nbaTeams[31].id = MLB_ICON_ID;
-  snprintf(nbaTeams[31].name,sizeof(nbaTeams[31].name),"%s",F("MLB"));
-}
-
-void teamListInit() {
-  teamListInit_NHL();
-  teamListInit_MLB();
-  teamListInit_NBA();
-}
-
 void drawIcon(const char *filename, int16_t x, int16_t y) {
   if (!drawBmp(&tft,filename,x,y)) {
     tft.fillRect(x,y,x+50,y+50,TFT_WHITE);
@@ -548,208 +364,132 @@ void drawIcon(const char *filename, int16_t x, int16_t y) {
   }
 }
 
-char* getTeamAbbreviation(const uint16_t teamID, const uint8_t league) {
+const char* getTeamAbbreviation(const uint16_t teamID, const uint8_t league) {
 
-  if (league == NHL) {
-    for (uint8_t i = 0; i < NHL_NUM_MENU_ITEMS; i++) {
-      if (nhlTeams[i].id == teamID) {
-        return nhlTeams[i].name;
-      }
-    }
-  }
-  else if (league == MLB) {
-    for (uint8_t i = 0; i < MLB_NUM_MENU_ITEMS; i++) {
-      if (mlbTeams[i].id == teamID) {
-        return mlbTeams[i].name;
-      }
-    }
-  }
-  else if (league == NBA) {
-    for (uint8_t i = 0; i < NBA_NUM_MENU_ITEMS; i++) {
-      if (nbaTeams[i].id == teamID) {
-        return nbaTeams[i].name;
-      }
-    }
-  }
+  const LeagueInfo* info = Leagues::info(league);
+  const char* name = info ? findTeamName(info->teams,info->numTeams,teamID) : nullptr;
 
-  return "ERR";
+  return name ? name : "ERR";
 }
 
-void displaySingleLogo(const uint8_t teamID, const uint8_t league) {
+const char* getLeagueName(const uint8_t league) {
+  const LeagueInfo* info = Leagues::info(league);
+  return info ? info->name : "ERR";
+}
 
-  char filePath[19];
-  char* path;
+// icon files are /icons/<league>/<name>.bmp
+void drawLeagueIcon(const uint8_t league, const char* name, int16_t x, int16_t y) {
 
-  switch (teamID) {
-    case NHL_ICON_ID:
-      path = "NHL/";
-      break;
-    case MLB_ICON_ID:
-      path = "MLB/";
-      break;
-    case NBA_ICON_ID:
-      path = "NBA/";
-      break;
-    default: 
-    {
-      if (league == NHL) {
-        path = "NHL/";
-      }
-      else if (league == MLB) {
-        path = "MLB/";
-      }
-      else if (league == NBA) {
-        path = "NBA/";
-      }
-      else {
-        dPrintf(F("DisplaySingleLogo: Unrecognized logo: teamID %d  league: %d\n"),teamID,league);
-        path = "XXX/";
-      }
-    }
+  char filePath[19];
+  const LeagueInfo* info = Leagues::info(league);
 
+  if (!info) {
+    dPrintf(F("drawLeagueIcon: Unrecognized league: %d\n"),league);
   }
 
-  char* teamName = getTeamAbbreviation(teamID,league);
-  sprintf(filePath,"%s%s%s%s","/icons/",path,teamName,".bmp");
-
-  drawIcon(filePath,TFT_HALF_WIDTH-25,TFT_HALF_HEIGHT-25);
+  snprintf(filePath,sizeof(filePath),"%s%s%s%s","/icons/",info ? info->iconDir : "XXX/",name,".bmp");
+  drawIcon(filePath,x,y);
 
 }
 
-void displayTeamLogos(const uint8_t awayID, const uint8_t homeID, const uint8_t league) {
-
-  char filePath[19];
-  char* sportPath;
-
-  if (league == NHL) {
-    sportPath = "NHL/";
-  }
-  else if (league == MLB) {
-    sportPath = "MLB/";
-  }
-  else if (league == NBA) {
-    sportPath = "NBA/";  
-  }
-  else {
-    dPrintf(F("DisplayTeamLogos: Unrecognized league: %d\n"),league);
-  }
-
-  sprintf(filePath,"%s%s%s%s","/icons/",sportPath,getTeamAbbreviation(awayID,league),".bmp");
-  drawIcon(filePath,10,10);
+void displaySingleLogo(const uint8_t teamID, const uint8_t league) {
+  drawLeagueIcon(league,getTeamAbbreviation(teamID,league),TFT_HALF_WIDTH-25,TFT_HALF_HEIGHT-25);
+}
 
-  sprintf(filePath,"%s%s%s%s","/icons/",sportPath,getTeamAbbreviation(homeID,league),".bmp");
-  drawIcon(filePath,100,10);
+void displayLeagueLogo(const uint8_t league) {
+  drawLeagueIcon(league,getLeagueName(league),TFT_HALF_WIDTH-25,TFT_HALF_HEIGHT-25);
+}
 
+void displayTeamLogos(const uint8_t awayID, const uint8_t homeID, const uint8_t league) {
+  drawLeagueIcon(league,getTeamAbbreviation(awayID,league),10,10);
+  drawLeagueIcon(league,getTeamAbbreviation(homeID,league),100,10);
 }
 
-uint16_t selectTeam(TeamInfo* teamList, const uint8_t numIcons, const uint8_t league)  {
+// The menu for a league lists its teams followed by the logos of the other leagues
+// Returns true if a team was picked (saved in selectedTeam). Returns false if
+// another league was picked (currentLeague is switched to it)
+bool selectTeam(const uint8_t league)  {
 
-  uint8_t teamIndex = 0;
-  bool teamSelected = false;
+  const LeagueInfo* info = Leagues::info(league);
+  const uint8_t numItems = info->numTeams + NUM_LEAGUES - 1;
+  uint8_t itemIndex = 0;
   bool switchTeams = true;
-  uint32_t buttonTimer = 0;
+  uint64_t buttonTimer = 0;
   bool alreadyFell = false;
 
   // get our current team's index
-  for (uint8_t i = 0; i < numIcons; i++) {
-    if (teamList[i].id == selectedTeam[league]) {
-      teamIndex = i;
+  for (uint8_t i = 0; i < info->numTeams; i++) {
+    if (info->teams[i].id == selectedTeam[league]) {
+      itemIndex = i;
       break;
     }
   }
 
+  animStopAll();
   tft.fillScreen(TFT_WHITE);
-  while (!teamSelected) {
+  while (true) {
+    // menu items after the teams map to the other leagues in order, skipping ourselves
+    uint8_t otherLeague = itemIndex - info->numTeams;
+    if (otherLeague >= league) {
+      otherLeague++;
+    }
     if (switchTeams) {
-      displaySingleLogo(teamList[teamIndex].id,league);
+      if (itemIndex < info->numTeams) {
+        displaySingleLogo(info->teams[itemIndex].id,league);
+        tft.fillRect(0,100,tft.width(),20,TFT_WHITE);
+        if (watchFind(league,info->teams[itemIndex].id) >= 0) {
+          tft.setTextColor(TFT_BLACK);
+          tft.drawString("watching",TFT_HALF_WIDTH - (tft.textWidth("watching",2)/2),100,2);
+        }
+      }
+      else {
+        displayLeagueLogo(otherLeague);
+      }
       switchTeams = false;
     }
     debouncer.update();
     if (debouncer.fell()) {
-      buttonTimer = millis();
+      buttonTimer = clockMillis();
       alreadyFell = true;
     }
     if (debouncer.rose() && alreadyFell) {
-      if ((millis() - buttonTimer) > LONG_PRESS_THRESHOLD) {
-        return teamList[teamIndex].id;
+      if (((clockMillis() - buttonTimer) > WATCH_PRESS_THRESHOLD) && (itemIndex < info->numTeams)) {
+        uint16_t teamID = info->teams[itemIndex].id;
+        if (!watchRemove(league,teamID) && !watchAdd(league,teamID)) {
+          dPrintf(F("Watchlist full (%d teams)\n"),WATCHLIST_SIZE);
+        }
+        dPrintf(F("Watching %d teams\n"),watchCount);
+        switchTeams = true;     // redraw with the new state
+      }
+      else if ((clockMillis() - buttonTimer) > LONG_PRESS_THRESHOLD) {
+        if (itemIndex < info->numTeams) {
+          selectedTeam[league] = info->teams[itemIndex].id;
+          return true;
+        }
+        currentLeague = otherLeague;
+        dPrintf(F("changed league: %s\n"),getLeagueName(currentLeague));
+        return false;
       }
       else {
         switchTeams = true;
-        teamIndex = (teamIndex + 1) % numIcons;
+        itemIndex = (itemIndex + 1) % numItems;
       }
     }
     yield();
   }
 }
 
-
-uint16_t selectNHLTeam() {
-  return selectTeam(nhlTeams,NHL_NUM_MENU_ITEMS,NHL);
-}
-
-uint16_t selectMLBTeam() {
-  return selectTeam(mlbTeams,MLB_NUM_MENU_ITEMS,MLB);
-}
-
-uint16_t selectNBATeam() {
-  return selectTeam(nbaTeams,NBA_NUM_MENU_ITEMS,NBA);
-}
-
 void selectMenu() {
 
   setInterrupt(false);
 
-  uint16_t selectedTeamID = 0;
-
-  while (true) {
+  if (!Leagues::info(currentLeague)) {
+    permanentError(F("Unrecognized league: %d\n"),currentLeague);
+  }
 
-    if (currentLeague == NHL) {
-        selectedTeamID = selectNHLTeam();
-        if (selectedTeamID == MLB_ICON_ID) {
-          currentLeague = MLB;
-        }
-        else if (selectedTeamID == NBA_ICON_ID) {
-          currentLeague = NBA;
-        }
-        else {
-          selectedTeam[NHL] = selectedTeamID;
-          break;
-        }
-    }
-    else if (currentLeague == MLB) {
-        selectedTeamID = selectMLBTeam();
-        if (selectedTeamID == NHL_ICON_ID) {
-          currentLeague = NHL;
-        }
-        else if (selectedTeamID == NBA_ICON_ID) {
-          currentLeague = NBA;
-        }
-        else {
-          selectedTeam[MLB] = selectedTeamID;
-          break;
-        }
-    }
-    else if (currentLeague == NBA) {
-        selectedTeamID = selectNBATeam();
-        dPrintf(F("Selected NBA Team: %d\n"),selectedTeamID);
-        if (selectedTeamID == MLB_ICON_ID) {
-          currentLeague = MLB;
-          dPrintf(F("changed league: %d\n"),currentLeague);
-        }
-        else if (selectedTeamID == NHL_ICON_ID) {
-          currentLeague = NHL;
-          dPrintf(F("changed league: %d\n"),currentLeague);
-        }
-        else {
-          selectedTeam[NBA] = selectedTeamID;
-          break;
-        }
-    }
-    else {
-      permanentError(F("Unrecognized league: %d\n"),currentLeague);
-    }
+  while (!selectTeam(currentLeague)) {}
 
-  }
+  dPrintf(F("Selected %s Team: %d\n"),getLeagueName(currentLeague),selectedTeam[currentLeague]);
 
   setInterrupt(true);
 
@@ -759,6 +499,7 @@ void selectMenu() {
 
 
 
+
 // output out favourite team to config file
 void saveTeams() {
   fs::File file = LittleFS.open(TEAMS_DATAFILE,"w");
@@ -767,6 +508,10 @@ void saveTeams() {
       file.println(selectedTeam[i]);
     }
     file.println(currentLeague);
+    file.println(watchCount);
+    for (uint8_t i = 0; i < watchCount; i++) {
+      file.printf("%d %d\n",watchlist[i].league,watchlist[i].teamID);
+    }
   }
   else {
     dPrintf(F("Error opening myTeam file for writing\n"));
@@ -776,6 +521,7 @@ void saveTeams() {
 }
 
 void selectTeam() {
+  showingSnapshot = false;
   selectMenu();
   saveTeams();
 }
@@ -788,24 +534,40 @@ bool loadTeams() {
   fs::File file = LittleFS.open(TEAMS_DATAFILE,"r");
 
   if (file) {
-    tftMessage(F("Loading teams..."));
+    if (!showingSnapshot) {
+      tftMessage(F("Loading teams..."));
+    }
     uint8_t i = 0;
     for (i = 0; i < NUM_LEAGUES; i++) {
       selectedTeam[i] = file.parseInt();
-      char* teamName = getTeamAbbreviation(selectedTeam[i],i);
+      const char* teamName = getTeamAbbreviation(selectedTeam[i],i);
       if (strcmp(teamName,"ERR") != 0) {
-        dPrintf(F("%s Team: %s (%d)\n"), LEAGUE_NAMES[i], teamName, selectedTeam[i]);
+        dPrintf(F("%s Team: %s (%d)\n"), getLeagueName(i), teamName, selectedTeam[i]);
       }
       else {
-        dPrintf(F("%s Team not found: %d\n"),LEAGUE_NAMES[i],selectedTeam[i]);
+        dPrintf(F("%s Team not found: %d\n"),getLeagueName(i),selectedTeam[i]);
       }
     }
     if (i == NUM_LEAGUES) {
       currentLeague = file.parseInt();
       if (currentLeague < NUM_LEAGUES) {
-        dPrintf(F("League to display: %s (%d)\n"),LEAGUE_NAMES[currentLeague],currentLeague);
+        dPrintf(F("League to display: %s (%d)\n"),getLeagueName(currentLeague),currentLeague);
         success = true;
       }
+      // older files end here, no watchlist. At the end of the file parseInt()
+      // would wait out the whole stream timeout
+      while (file.available() && isspace(file.peek())) {
+        file.read();
+      }
+      uint8_t count = file.available() ? file.parseInt() : 0;
+      watchCount = 0;
+      for (i = 0; i < count; i++) {
+        uint8_t league = file.parseInt();
+        uint16_t teamID = file.parseInt();
+        if ((league < NUM_LEAGUES) && watchAdd(league,teamID)) {
+          dPrintf(F("Watching %s %s\n"),getLeagueName(league),getTeamAbbreviation(teamID,league));
+        }
+      }
     }
   }
    
@@ -816,34 +578,6 @@ bool loadTeams() {
 
 }
 
-// String of the time expected in format YYYY-MM-DD HH-mm UTC
-time_t parseDateTime(const String& timeStr) {
-
-  tmElements_t tmSet;
-  tmSet.Year = timeStr.substring(0,4).toInt() - 1970;
-  tmSet.Month = timeStr.substring(5,7).toInt();
-  tmSet.Day = timeStr.substring(8,10).toInt();
-  tmSet.Hour = timeStr.substring(11,13).toInt();
-  tmSet.Minute = timeStr.substring(14,16).toInt();
-  tmSet.Second = 0;
-  
-  return makeTime(tmSet);
-
-}
-
-// convert epoch time to string format
-String convertDate(const time_t epoch, const bool dashes) {
-  char dateChar[11] = {'\0'};
-
-  if (dashes) {
-    snprintf(dateChar,sizeof(dateChar),"%04d-%02d-%02d",year(epoch),month(epoch),day(epoch));
-  }
-  else {
-    snprintf(dateChar,sizeof(dateChar),"%04d%02d%02d",year(epoch),month(epoch),day(epoch));
-  }
-  String dateString = dateChar;
-  return dateString;
-}
 
 void printDate(const time_t theTime) {
   dPrintf(F("%s\n"),convertDate(theTime,true).c_str());
@@ -855,6 +589,9 @@ void printTime(const time_t theTime) {
 
 time_t currentTime() {
   static time_t theTime = 0;
+  if (simActive()) {
+    return simTime();
+  }
   time(&theTime);
   return theTime;
 }
@@ -867,31 +604,50 @@ void printTime() {
   printTime(currentTime());
 }
 
-void updateTime() {
-  static uint32_t lastTimeUpdate = 0;
-  static time_t theTime = 0;
-  if ((lastTimeUpdate == 0) || ((millis() - lastTimeUpdate) > TIME_UPDATE_INTERVAL_MS)) {
-   
+// NTP task. configTime() starts SNTP in the background so instead of blocking
+// until it answers just check back every NTP_WAIT ms
+void timeTaskRun() {
+  static uint64_t requestTime = 0;
+  static bool waiting = false;
+
+  if (!waiting) {
     dPrintf(F("Fetching time please wait\n"));
-    lastTimeUpdate = millis();
+    requestTime = clockMillis();
     configTime(MY_TZ,NTP_SERVER);
+    waiting = true;
+    taskWakeIn(timeTask,NTP_WAIT);
+    return;
+  }
 
-    while (theTime < 1500000000) {
-      delay(NTP_WAIT);
-      theTime = time(nullptr);
-      time(&theTime);
-    }
-    dPrintf(F("Time update took: %d\n"),millis()-lastTimeUpdate);
-    dPrintf(F("Epoch time: %d\n"),theTime);
+  time_t theTime = time(nullptr);
+  if (theTime < VALID_TIME) {
+    taskWakeIn(timeTask,NTP_WAIT);
+    return;
+  }
 
-    char buffer[20];
-    
-    strftime(buffer,sizeof(buffer),"%Y/%m/%d %H:%M:%S",gmtime(&theTime));
-    dPrintf(F("Epoch time: %s\n"),buffer);
-    strftime(buffer,sizeof(buffer),"%Y/%m/%d %H:%M:%S",localtime(&theTime));
-    dPrintf(F("Local time: %s\n"),buffer);
+  waiting = false;
+  dPrintf(F("Time update took: %d\n"),(uint32_t)(clockMillis() - requestTime));
+  dPrintf(F("Epoch time: %d\n"),theTime);
+
+  char buffer[20];
+
+  strftime(buffer,sizeof(buffer),"%Y/%m/%d %H:%M:%S",gmtime(&theTime));
+  dPrintf(F("Epoch time: %s\n"),buffer);
+  strftime(buffer,sizeof(buffer),"%Y/%m/%d %H:%M:%S",localtime(&theTime));
+  dPrintf(F("Local time: %s\n"),buffer);
+
+  schedulerPrintStats();
+  animPrintStats();
+  tlsPrintStats();
+  upstreamPrintStats();
 
+  if (!timeIsValid) {
+    timeIsValid = true;
+    if (updateStage != UPDATES_DONE) {
+      taskWakeNow(updateTask);
+    }
   }
+  taskWakeIn(timeTask,TIME_UPDATE_INTERVAL_MS);
 }
 
 
@@ -921,7 +677,7 @@ void wifiConnect() {
 void printNextGame(NextGameData& nextGame) {
   dPrintf(F("\n-----------------\n"));
   dPrintf(F("GameID: %d\n"),nextGame.gameID);
-  dPrintf(F("League: %d\n"),LEAGUE_NAMES[nextGame.league]);
+  dPrintf(F("League: %s\n"),getLeagueName(nextGame.league));
   dPrintf(F("awayID: %d (%s)\n"),nextGame.awayID,getTeamAbbreviation(nextGame.awayID,nextGame.league));
   dPrintf(F("homeID: %d (%s)\n"),nextGame.homeID,getTeamAbbreviation(nextGame.homeID,nextGame.league));
   dPrintf(F("StartTime: %d\n"),nextGame.startTime);
@@ -938,699 +694,152 @@ void printNextGame(NextGameData& nextGame) {
 void printCurrentGame (CurrentGameData& currentGame) {
   dPrintf(F("\n-----------------\n"));
   dPrintf(F("GameID: %d\n"),currentGame.gameID);
-  dPrintf(F("League: %s\n"),LEAGUE_NAMES[currentGame.league]);
+  dPrintf(F("League: %s\n"),getLeagueName(currentGame.league));
   dPrintf(F("awayID: %d (%s)\n"),currentGame.awayID,getTeamAbbreviation(currentGame.awayID,currentGame.league));
   dPrintf(F("homeID: %d (%s)\n"),currentGame.homeID,getTeamAbbreviation(currentGame.homeID,currentGame.league));
   dPrintf(F("Away score: %d\n"),currentGame.awayScore);
   dPrintf(F("Home score: %d\n"),currentGame.homeScore);
-  switch (currentGame.league) {
-    case NHL:
-      dPrintf(F("Period:  %s\n"),currentGame.devision);
-      dPrintf(F("Time: %s\n"),currentGame.timeRemaining);
-      break;
-    case MLB:
-      dPrintf(F("Inning: %s\n"),currentGame.devision);
-      dPrintf(F("Inning: %s\n"),currentGame.timeRemaining);
-      break;
-    case NBA:
-      dPrintf(F("Quater: %s\n"),currentGame.devision);
-      dPrintf(F("Time: %s\n"),currentGame.timeRemaining);
-      break;
-  }
-  if (currentGame.league == NHL) {
-    dPrintf(F("Home PP: %s\n"), currentGame.homeOther ? "Yes" : "No");
-    dPrintf(F("Away PP: %s\n"), currentGame.awayOther ? "Yes" : "No");
-  }
-  else if (currentGame.league == MLB) {
-    dPrintf(F("Outs: %d\n"),currentGame.outs);
-    dPrintf(F("Bases:\n"));
-    dPrintf(F(" Running on 1st: %s\n"),(currentGame.bases[0]) ? "yes" : "no");
-    dPrintf(F(" Running on 2nd: %s\n"),(currentGame.bases[1]) ? "yes" : "no");
-    dPrintf(F(" Running on 3rd: %s\n"),(currentGame.bases[2]) ? "yes" : "no");
-  }
+  Leagues::dispatch(currentGame.league,[&](auto provider) {
+    typedef decltype(provider) League;
+    dPrintf(F("%s: %s\n"),League::INFO.divisionLabel,currentGame.devision);
+    dPrintf(F("%s: %s\n"),League::INFO.clockLabel,currentGame.timeRemaining);
+    League::printCurrentGame(currentGame);
+  });
   dPrintf(F("-----------------\n"));
 }
 
-void setGDStrings(CurrentGameData& gd, const char* devision, const char* timeRemaining) {
-
-  snprintf(gd.devision,sizeof(gd.devision),"%s",devision);
-  snprintf(gd.timeRemaining,sizeof(gd.timeRemaining),"%s",timeRemaining);
+// UPSTREAM_OK when the schedule was read, whether or not it has a game for us
+UpstreamError getNextGame(const time_t today,const uint16_t teamID, const uint8_t league, NextGameData& nextGameData) {
 
+  UpstreamError err = UPSTREAM_OK;
+  if (!Leagues::dispatch(league,[&](auto provider) {
+        err = decltype(provider)::getNextGame(today,teamID,nextGameData);
+      })) {
+    dPrintf(F("Invalid league: %d\n"),league);
+  }
+  return err;
 }
 
-bool extractCurrentGame_MLB(CurrentGameData& gameData, JsonDocument& doc) {
 
-   // the MLB linescore doesn't include the teamIDs or game status so we have to be hackey
-  // using the schedule data
-
-  bool isGameOver = false;
+bool switchOneValue() {
+  return digitalRead(SWITCH_PIN_1);
+}
 
-  gameData.gameID = doc["gamePk"];
-  gameData.league = MLB;
-  gameData.homeID = doc["liveData"]["boxscore"]["teams"]["home"]["team"]["id"];
-  gameData.awayID = doc["liveData"]["boxscore"]["teams"]["away"]["team"]["id"];
-  JsonObject linescore = doc["liveData"]["linescore"];
-  uint8_t inning = linescore["currentInning"];
-  const char* gameState = doc["gameData"]["status"]["abstractGameState"];
+// On an error the host's backoff is left in nextGameRetryMs
+UpstreamError getNextGame() {
 
-  if (strcmp(gameState,"preview") == 0) {
-    setGDStrings(gameData,"pre","");
+  uint16_t tID = 0;
+  UpstreamError err = UPSTREAM_OK;
+  if (simActive()) {
+    simNextGame(nextGameData);
   }
   else {
-    gameData.homeScore = linescore["teams"]["home"]["runs"];
-    gameData.awayScore = linescore["teams"]["away"]["runs"];
-    gameData.outs = linescore["outs"];
-    if (strcmp(gameState,"Final") == 0) {
-      setGDStrings(gameData,"","FINAL");
-      isGameOver = true;
-    }
-    else {
-      const char* inningStr = linescore["currentInningOrdinal"];
-      bool isTopInning = linescore["isTopInning"];
-      if (isTopInning) {
-        setGDStrings(gameData,inningStr,"top");
-      }
-      else {
-        setGDStrings(gameData,inningStr,"bot");
-      }
-
-    }
-
+    requestCount(REQUEST_SELECTED);
+    err = getNextGame(currentTime(),selectedTeam[currentLeague],currentLeague,nextGameData);
   }
-
-  JsonObject offense = linescore["offense"];
-  gameData.bases[0] = offense.containsKey("first");
-  gameData.bases[1] = offense.containsKey("second");
-  gameData.bases[2] = offense.containsKey("third");
-
-  return isGameOver;
+  if (err != UPSTREAM_OK) {
+    nextGameRetryMs = upstreamLastRetryMs();
+    dPrintf(F("Next game query failed (%s), next try in %d ms\n"),upstreamErrorName(err),nextGameRetryMs);
+    return err;
+  }
+  printNextGame(nextGameData);
+  return err;
 
 }
 
-bool extractCurrentGame_NHL(CurrentGameData& gameData,uint32_t gameID, JsonDocument& doc) {
-
-  bool isGameOver = false;
-
-  gameData.gameID = gameID;
-  gameData.league = NHL;
-  gameData.homeID = doc["teams"]["home"]["team"]["id"];
-  gameData.homeScore = doc["teams"]["home"]["goals"];
-  gameData.homeOther = doc["teams"]["home"]["powerPlay"];
-  gameData.awayID = doc["teams"]["away"]["team"]["id"];
-  gameData.awayScore = doc["teams"]["away"]["goals"];
-  gameData.awayOther = doc["teams"]["away"]["powerPlay"];
-
-  dPrintf(F("gameData.awayOther: %d\n"),gameData.awayOther);
-
-  uint8_t period = doc["currentPeriod"];
+// action
+// 1 = turn on
+// 0 = turn off
+// -1 = toggle
+void tftSet(int8_t action) {
+  static bool ledState = false;
 
-  if (period == 0) {
-        setGDStrings(gameData,"pre","");
+  if (action == -1) {
+    ledState = !ledState;
   }
   else {
-    const char* p = doc["currentPeriodOrdinal"];   // Json template issues if declartion isn't on same line
-    const char* tr = doc["currentPeriodTimeRemaining"];
-
-    if (strcmp(tr,STATUSCODE_FINAL) == 0) {
-      setGDStrings(gameData,"","Final");
-      isGameOver = true;
-    }
-    else {
-      setGDStrings(gameData,p,tr);
-    }
+    ledState = action;
   }
+  digitalWrite(TFT_BACKLIGHT_PIN,ledState);
+  dPrintf(F("LED backlight: %s\n"),ledState ? "ON" : "OFF"); 
+}
 
-  return isGameOver;
+void displayNextGame(NextGameData& nextGameData) {
 
-}
+  tftSet(digitalRead(SWITCH_PIN_1));
 
-bool extractCurrentGame_NBA(CurrentGameData& currentGameData, JsonDocument& doc) {
-  
-  const char* id = doc["id"];
-  currentGameData.gameID = atoi(id);
-  currentGameData.league = NBA;
-
-  const char* status = doc["status"]["type"]["name"];
-  bool isFinal = (strcmp(status,STATUSCODE_NBA_FINAL) == 0);
-  bool isStillScheduled = (strcmp(status,STATUSCODE_NBA_SCHEDULED) == 0);  // API doesn't show required field until game actually starts
-
-  JsonArray competitors = doc["competitors"];
-  for (JsonObject competitor: competitors) {   // there is aways 2
-    const char* homeAway = competitor["homeAway"];
-    if (strcmp(homeAway,"home") == 0) {
-      currentGameData.homeID = competitor["id"];
-      if (!isStillScheduled) {
-        currentGameData.homeScore = competitor["score"];
-      }
-    }
-    else {
-      currentGameData.awayID = competitor["id"];
-      if (!isStillScheduled) {
-        currentGameData.awayScore = competitor["score"];
-      }
-    }
-  }
+  animStopAll();
+  tft.fillScreen(TFT_WHITE);
+  tft.setTextColor(TFT_BLACK);
 
-  if (isFinal) {
-    setGDStrings(currentGameData,"","FINAL");
-  }
-  else if (strcmp(status,STATUSCODE_NBA_HALFTIME) == 0) {
-    setGDStrings(currentGameData,"","HALF");
+  if (nextGameData.gameID == 0) {  
+    displaySingleLogo(selectedTeam[currentLeague],currentLeague);
+    animMarquee(0,95,tft.width(),16,"No games scheduled",2,TFT_BLACK,TFT_WHITE);
   }
   else {
-  
-    if (!isStillScheduled) { 
-    const int quater = doc["status"]["period"];
-    
-    char ordinalBuffer[4];
-      switch (quater){
-        case 1:
-          snprintf(ordinalBuffer,sizeof(ordinalBuffer),"1st");
-          break;
-        case 2:
-          snprintf(ordinalBuffer,sizeof(ordinalBuffer),"2nd");
-          break;
-        case 3:
-          snprintf(ordinalBuffer,sizeof(ordinalBuffer),"3rd");
-          break;
-        case 4:
-          snprintf(ordinalBuffer,sizeof(ordinalBuffer),"4th");
-          break;
-        default:
-          snprintf(ordinalBuffer,sizeof(ordinalBuffer),"?");
-      }
+    displayTeamLogos(nextGameData.awayID,nextGameData.homeID,nextGameData.league);
 
-      snprintf(currentGameData.devision,sizeof(currentGameData.devision),"%s",ordinalBuffer);
-      if (strcmp(status,STATUSCODE_NBA_ENDOFQUATER) == 0) {
-        snprintf(currentGameData.timeRemaining,sizeof(currentGameData.timeRemaining),"END");  
-      }
-      else {
-  
-        const char* tr = doc["status"]["displayClock"];
-        snprintf(currentGameData.timeRemaining,sizeof(currentGameData.timeRemaining),"%s",tr);  
-      }
-    }
-    else {
-      memset(currentGameData.timeRemaining,'\0',sizeof(currentGameData.timeRemaining));
-      snprintf(currentGameData.devision,sizeof(currentGameData.devision),"pre");
+    if (!(nextGameData.isPlayoffs)) {
+      tft.drawString(nextGameData.awayRecord,35 - (tft.textWidth(nextGameData.awayRecord)/2),65);
+      tft.drawString(nextGameData.homeRecord,125 - (tft.textWidth(nextGameData.homeRecord)/2),65);
     }
-  } 
 
-  return isFinal;
+    char buffer[12];       // fit: Mon, Jan 23
+    
+    strftime(buffer,sizeof(buffer),"%a, %b %e",localtime(&(nextGameData.startTime)));
+    animSlide(0,85,tft.width(),tft.fontHeight(4),buffer,4,TFT_BLACK,TFT_WHITE,NEXT_GAME_SLIDE_MS);
 
-}
+    strftime(buffer,sizeof(buffer),"%H:%M",localtime(&(nextGameData.startTime)));
+    animFade(0,110,tft.width(),tft.fontHeight(2),buffer,2,TFT_WHITE,TFT_BLACK,TFT_WHITE,NEXT_GAME_FADE_MS);
+    tft.drawString("VS",72,20,2);
+  }
 
-void extractNextGame_NBA(NextGameData& nextGameData, JsonDocument& doc) {
+}
 
-  nextGameData.gameID = doc["id"];
-  JsonArray competitors = doc["competitions"][0]["competitors"];
-  for (JsonObject competitor: competitors) {   // there is aways 2
-    const char* homeAway = competitor["homeAway"];
-    if (strcmp(homeAway,"home") == 0) {
-      nextGameData.homeID = competitor["id"];
-      JsonArray records = competitor["records"];
-      for (JsonObject record : records) {
-        const char* type = record["type"];
-        if (strcmp(type,"total") == 0) {
-          const char* r = record["summary"];
-          snprintf(nextGameData.homeRecord,sizeof(nextGameData.homeRecord),"%s",r);
-          break;
-        }
-      }
-    }
-    else {
-      nextGameData.awayID = competitor["id"];
-      JsonArray records = competitor["records"];
-      for (JsonObject record : records) {
-        const char* type = record["type"];
-        if (strcmp(type,"total") == 0) {
-          const char* r = record["summary"];
-          snprintf(nextGameData.awayRecord,sizeof(nextGameData.homeRecord),"%s",r);
-          break;
-        }
-      }
-    }
 
-    String nextGameTS_str = doc["date"];
-    nextGameData.startTime = parseDateTime(nextGameTS_str);
-    nextGameData.league = NBA;
-   // int seasonType = doc["season"]["type"];
-    //nextGameData.isPlayoffs = (seasonType == 3);
-    nextGameData.isPlayoffs = false;
 
-  }
-  
-}
+// i2s based sound code removed due to compile issues (on platformIO)
+// and pin availability and functionality issues
+// leaving the frame work for the sound code in place for the future.
+// The screen side is the score pop (startScorePop)
+void playHorn(const bool myTeamScored) {}
 
-void extractNextGame_NHLorMLB(NextGameData& nextGameData, JsonObject& game,const uint8_t league) {
-
-  nextGameData.gameID = game["gamePk"];
-  nextGameData.awayID = game["teams"]["away"]["team"]["id"];
-  nextGameData.homeID = game["teams"]["home"]["team"]["id"];
-  nextGameData.league = league;
-  const char* gameType = game["gameType"];
-  nextGameData.isPlayoffs = (strcmp(gameType,"P") == 0);
-  String nextGameTS_str = game["gameDate"];
-  nextGameData.startTime = parseDateTime(nextGameTS_str);
-  JsonObject homeRecord = game["teams"]["home"]["leagueRecord"];
-  JsonObject awayRecord = game["teams"]["away"]["leagueRecord"];
-  uint8_t homeWins = homeRecord["wins"];
-  uint8_t awayWins = awayRecord["wins"];
-  uint8_t homeLosses = homeRecord["losses"];
-  uint8_t awayLosses = awayRecord["losses"];
-
-  if (league == NHL) {
-    uint8_t homeOT = homeRecord["ot"];
-    uint8_t awayOT = awayRecord["ot"];
-    sprintf(nextGameData.homeRecord,"%d-%d-%d",homeWins,homeLosses,homeOT);
-    sprintf(nextGameData.awayRecord,"%d-%d-%d",awayWins,awayLosses,awayOT);
+// hackey hardcoded postion.up
+int16_t awayScorePosition(const uint8_t theScore) {
+  int16_t position = 20;
+  if (theScore == 1) {
+    position = 10;
   }
   else {
-      sprintf(nextGameData.homeRecord,"%d-%d",homeWins,homeLosses);
-      sprintf(nextGameData.awayRecord,"%d-%d",awayWins,awayLosses);
+    if (theScore >= 20) {
+      position = 2;
+    }
+    else if (theScore >= 10) {
+      position = -8;
+    }
   }
+  return position;
 }
 
-// Awesomely the NHL & MLB use the same api schema
-void getNextGame_NHLorMLB(const time_t today,const uint16_t teamID, const uint8_t league, NextGameData& nextGameData) {
+// hackey hardcoded position
+int16_t homeScorePosition(const uint8_t theScore) {
+  return awayScorePosition(theScore) + 90;
+}
 
-  StaticJsonDocument<320> filter;
-  DynamicJsonDocument doc(2048);
-  JsonObject resultGame;
+// hacky code that assumed TFT screen size and uses magic numbers
+// Won't look right on other size screens
+void displayCurrentGame(CurrentGameData& gameData) {
 
-  String queryString;
-  HTTPClient httpClient;
-  WiFiClient wifiClient;
-  int8_t gameCount = 0;
-  uint32_t excludeGameID = nextGameData.gameID;
+  char score[4];
+  int16_t awayPosX; int16_t homePosX; int16_t font;
 
-  nextGameData.gameID = 0;
+  tftSet(true);
+  animStopAll();
+  tft.fillScreen(TFT_WHITE);
+  tft.setTextColor(TFT_BLACK);
 
-  char* host;
-  uint16_t port;
-
-  // we just have to change the HOST everything else is the same between the two APIs
-  if (league == NHL) {
-    host = (char*)NHL_HOST;
-    port = NHL_PORT;
-  }
-  else if (league == MLB) {
-    host = (char*)MLB_HOST;
-    port = MLB_PORT;
-  }
-  else {
-    dPrintf(F("Invalid league: %d\n"),league);
-    return;
-  }
-
-  queryString = "http://";
-  queryString += host;
-  queryString += "/api/v1/schedule?";
-  queryString += "sportId=1";
-  queryString += "&teamId=";
-  queryString += teamID;
-  queryString += "&startDate=";
-  queryString += convertDate(today - SECONDS_IN_A_DAY,true); // need to grab from yesterday
-  queryString += "&endDate=";
-  // get 7 days worth of data to in order to cover the all star break and playoff gaps4
-  queryString += convertDate(today + (SECONDS_IN_A_DAY * 7),true);
-
-  dPrintf(F("Query - Type: Next %s Game\n"), LEAGUE_NAMES[league]);
-
-  filter["games"][0]["gamePk"] = true;
-  filter["games"][0]["gameType"] = true;
-  filter["games"][0]["gameDate"] = true;
-  filter["games"][0]["status"]["abstractGameState"] = true;
-  filter["games"][0]["status"]["detailedState"] = true;
-  
-  filter["games"][0]["teams"]["home"]["team"]["id"] = true;
-  filter["games"][0]["teams"]["home"]["leagueRecord"]["wins"] = true;
-  filter["games"][0]["teams"]["home"]["leagueRecord"]["losses"] = true;
-  filter["games"][0]["teams"]["away"]["team"]["id"] = true;
-  filter["games"][0]["teams"]["away"]["leagueRecord"]["wins"] = true;
-  filter["games"][0]["teams"]["away"]["leagueRecord"]["losses"] = true;
-  if (league == NHL) {
-    filter["games"][0]["teams"]["home"]["leagueRecord"]["ot"] = true;
-    filter["games"][0]["teams"]["away"]["leagueRecord"]["ot"] = true;
-  }
-
-  serializeJsonPretty(filter,Serial);
-
-  dPrintf(F("\nQuery URL: %s\n"),queryString.c_str());
-
-  httpClient.useHTTP10(true); 
-  httpClient.begin(wifiClient,queryString);
- 
-  int httpResult = httpClient.GET();
-  if (httpResult != 200) {
-    dPrintf(F("HTTP error: %d\n"),httpResult);
-    httpClient.end();
-    return;
-  }
-
-  bool found = false;
-
-  // bug in NHL API that has spaces in the tag. If they use the same schema why are there spaces?
-  if (league == NHL) {
-    wifiClient.find("\"dates\" : [ ");
-  }
-  else {
-    wifiClient.find("\"dates\":[");
-  }
-  do {
-    DeserializationError err = deserializeJson(doc,wifiClient,DeserializationOption::Filter(filter));
-    
-    if (err) {
-      dPrintf(F("Parse error: %s\n"),err.c_str());
-      break;
-    }
-    
-    JsonArray games = doc["games"];
-    for (JsonObject game : games) {   // in case of doubleheaders 
-      uint32_t gameID = game["gamePk"];
-      const char* ags = game["status"]["abstractGameState"];
-      const char* ds = game["status"]["detailedState"];
-      dPrintf(F("GameID: %d Abstract: %s Detailed: %s"),gameID,ags,ds);
-      gameCount++;
-      if ((strcmp(ags,STATUSCODE_FINAL) != 0) && (gameID != excludeGameID)) {
-        if ((strcmp(ds,STATUSCODE_INPROGRESS) == 0) || (strcmp(ds,STATUSCODE_SCHEDULED) == 0)) {
-          dPrintln(F(" match"));
-          found = true;
-          resultGame = game;
-          break;
-        }
-      }
-      else {
-        dPrintln(F(" no match"));
-      }
-    }
-    if (found) {
-      break;
-    }
-  } while (wifiClient.findUntil(",","]"));
-  
-  httpClient.end();
-
-  if (found) {
-    serializeJsonPretty(resultGame,Serial);
-    
-    extractNextGame_NHLorMLB(nextGameData,resultGame,league);
-  }
-  else {
-    dPrintln(F("No next game found"));
-  }
-
-}
-
-void getNextGame_NBA(const time_t today,const uint16_t teamID, NextGameData& nextGameData) {
-
-  HTTPClient httpClient;
-  WiFiClient wifiClient;
-  StaticJsonDocument<368> filter;
-  DynamicJsonDocument doc(2048);
- 
-  String queryString = "http://site.api.espn.com/apis/site/v2/sports/basketball/nba/scoreboard?limit=100&dates=";
-  queryString += convertDate(today - SECONDS_IN_A_DAY,false);
-  queryString += "-";
-  queryString += convertDate(today + (SECONDS_IN_A_DAY * 3),false);
-  
-  dPrintln(F("Query - Type: Next NBA Game"));
-  
-  filter["id"] = true;
-  filter["date"] = true;
-  filter["competitions"][0]["competitors"][0]["id"] = true;
-  filter["competitions"][0]["competitors"][0]["homeAway"] = true;
-  filter["competitions"][0]["competitors"][0]["score"] = true;
-  filter["competitions"][0]["competitors"][0]["records"][0]["type"] = true;
-  filter["competitions"][0]["competitors"][0]["records"][0]["summary"] = true;
-  filter["competitions"][0]["competitors"][1]["id"] = true;
-  filter["competitions"][0]["competitors"][1]["homeAway"] = true;
-  filter["competitions"][0]["competitors"][0]["score"] = true;
-  filter["competitions"][0]["competitors"][1]["records"][0]["type"] = true;
-  filter["competitions"][0]["competitors"][1]["records"][0]["summary"] = true;
-  filter["status"]["type"]["name"] = true;
-
-  serializeJsonPretty(filter,Serial);
-
-  
-  dPrintf(F("\nQuery URL: %s\n"),queryString.c_str());
-
-  httpClient.useHTTP10(true);   // Very Important for NBA api to parse correctly
-  httpClient.begin(wifiClient,queryString);
-
-  int httpResult = httpClient.GET();
-  if (httpResult != 200) {
-    dPrintf(F("HTTP error: %d\n"),httpResult);
-    httpClient.end();
-    return;
-  }
-    
-  bool found = false;
-
-  wifiClient.find("\"events\":[");
-  uint16_t event = 0;
-  do {
-    dPrintf(F("checking: %d\n"),event);
-    DeserializationError err = deserializeJson(doc,wifiClient,DeserializationOption::Filter(filter),DeserializationOption::NestingLimit(15));
-    
-    if (err) {
-      dPrintf(F("Parse error: %s"),err.c_str());
-    }
-    else {
-
-      const char* status = doc["status"]["type"]["name"];
-      
-      if (strcmp(status,STATUSCODE_NBA_FINAL) != 0) {
-        const int team1 = doc["competitions"][0]["competitors"][0]["id"];
-        const int team2 = doc["competitions"][0]["competitors"][1]["id"];
-        if ((team1 == teamID) || (team2 == teamID)) {
-          const uint32_t id = doc["id"];
-          if (id != nextGameData.gameID) {
-            found = true;
-            break;
-          }  
-        }
-      }
-    }
-    event++;
-  } while (wifiClient.findUntil(",","]"));
-
-  httpClient.end();
-  
-  if (found) {
-    serializeJsonPretty(doc,Serial);
-    extractNextGame_NBA(nextGameData,doc);
-  }
-  else {
-    Serial.println(F("No next game found"));
-  }
-
-}
-
-void getNextGame(const time_t today,const uint16_t teamID, const uint8_t league, NextGameData& nextGameData) {
-
-  if (league == NBA) {
-    getNextGame_NBA(today,teamID,nextGameData);
-  }
-  else {
-    getNextGame_NHLorMLB(today,teamID,league,nextGameData);   // NHL & MLB use the same api schema
-  }
-}
-
-bool switchOneValue() {
-  return digitalRead(SWITCH_PIN_1);
-}
-
-void getNextGame() {
-
-  uint16_t tID = 0;
-  getNextGame(currentTime(),selectedTeam[currentLeague],currentLeague,nextGameData);
-  printNextGame(nextGameData);
-
-}
-
-// action
-// 1 = turn on
-// 0 = turn off
-// -1 = toggle
-void tftSet(int8_t action) {
-  static bool ledState = false;
-
-  if (action == -1) {
-    ledState = !ledState;
-  }
-  else {
-    ledState = action;
-  }
-  digitalWrite(TFT_BACKLIGHT_PIN,ledState);
-  dPrintf(F("LED backlight: %s\n"),ledState ? "ON" : "OFF"); 
-}
-
-void displayNextGame(NextGameData& nextGameData) {
-
-  tftSet(digitalRead(SWITCH_PIN_1));
-
-  tft.fillScreen(TFT_WHITE);
-  tft.setTextColor(TFT_BLACK);
-
-  if (nextGameData.gameID == 0) {  
-    displaySingleLogo(selectedTeam[currentLeague],currentLeague);
-    tft.drawString("No games scheduled",(tft.width() - tft.textWidth("No games scheduled",2))/2,95,2);
-  }
-  else {
-    displayTeamLogos(nextGameData.awayID,nextGameData.homeID,nextGameData.league);
-
-    if (!(nextGameData.isPlayoffs)) {
-      tft.drawString(nextGameData.awayRecord,35 - (tft.textWidth(nextGameData.awayRecord)/2),65);
-      tft.drawString(nextGameData.homeRecord,125 - (tft.textWidth(nextGameData.homeRecord)/2),65);
-    }
-
-    char buffer[12];       // fit: Mon, Jan 23
-    
-    strftime(buffer,sizeof(buffer),"%a, %b %e",localtime(&(nextGameData.startTime)));
-    tft.drawString(buffer,TFT_HALF_WIDTH - (tft.textWidth(buffer,4)/2),85,4);
-
-    strftime(buffer,sizeof(buffer),"%H:%M",localtime(&(nextGameData.startTime)));
-    tft.drawString(buffer,TFT_HALF_WIDTH - (tft.textWidth(buffer,2)/2),110,2);
-    tft.drawString("VS",72,20,2);
-  }
-
-}
-
-
-
-bool gameStatsChanged(CurrentGameData& prev, CurrentGameData& curr) {
-
-  bool result = false;
-
-  if (prev.gameID != curr.gameID) { return true; }
-  if (prev.awayID != curr.awayID) { return true; }
-  if (prev.homeID != curr.homeID) { return true; }
-  if (prev.awayScore != curr.awayScore) { return true; }
-  if (prev.homeScore != curr.homeScore) { return true; }
-  if (strcmp(prev.devision,curr.devision) != 0) { return true; }
-  if (strcmp(prev.timeRemaining,curr.timeRemaining) != 0) { return true; }
-  if (curr.league == MLB) {
-      if (prev.outs != curr.outs) { return true; }
-      if (prev.bases[0] != curr.bases[0]) { return true; }
-      if (prev.bases[1] != curr.bases[1]) { return true; }
-      if (prev.bases[2] != curr.bases[2]) { return true; }
-  }
-  return false;
-}
-
-void copyGameData(CurrentGameData& dest, CurrentGameData& source) {
-  dest.gameID = source.gameID;
-  dest.homeID = source.homeID;
-  dest.awayID = source.awayID;
-  dest.homeScore = source.homeScore;
-  dest.awayScore = source.awayScore;
-  dest.homeOther = source.homeOther;
-  dest.awayOther = source.awayOther;
-  strcpy(dest.devision,source.devision);
-  strcpy(dest.timeRemaining,source.timeRemaining);
-  dest.league = source.league;
-  dest.outs = source.outs;
-  dest.bases[0] = source.bases[0];
-  dest.bases[1] = source.bases[1];
-  dest.bases[2] = source.bases[2];
-}
-
-
-// i2s based sound code removed due to compile issues (on platformIO)
-// and pin availability and functionality issues
-// leaving the frame work for the sound code in place for the future
-// perhaps add flashing screen functionality instead
-void playHorn(const bool myTeamScored) {}
-
-// hackey hardcoded postion.up
-int16_t awayScorePosition(const uint8_t theScore) {
-  int16_t position = 20;
-  if (theScore == 1) {
-    position = 10;
-  }
-  else {
-    if (theScore >= 20) {
-      position = 2;
-    }
-    else if (theScore >= 10) {
-      position = -8;
-    }
-  }
-  return position;
-}
-
-// hackey hardcoded position
-int16_t homeScorePosition(const uint8_t theScore) {
-  return awayScorePosition(theScore) + 90;
-}
-
-int16_t calculateScoreXPosition(const int16_t score, const bool bigFont) {
-
-  int16_t position = 0;
-
-  if (bigFont) {
-    if (score == 1) {
-      position = 8;
-    }
-    else if (score >= 100) {   // shouldn't happen
-      position = 12;
-    }
-    else if (score >= 20) {
-      position = 2;
-    }
-    else if (score >= 10) {
-      position = -8;
-    }
-    else {
-      position = 18;
-    }
-  }
-  else {
-    if (score == 1) {
-      position = 28;
-    }
-    else if (score >= 100) {
-      position = 13;
-    }
-    else if (score >= 20) {
-      position = 2;
-    }
-    else if (score >= 10) {
-      position = 20;
-    }
-    else {
-      position = 20;
-    }
-  }
-
-
- 
-  return position;
-}
-
-void calculateScoreXPosition(const uint8_t awayScore, const uint8_t homeScore, int16_t& awayPosition, int16_t& homePosition, int16_t& fontNum) {
-
-  bool bigFont = ((awayScore < 100) && (homeScore < 100));
-  fontNum = bigFont ? 7 : 4;
-  awayPosition = calculateScoreXPosition(awayScore,bigFont);
-  homePosition = calculateScoreXPosition(homeScore,bigFont) + 90;
-  
-}
-
-// hacky code that assumed TFT screen size and uses magic numbers
-// Won't look right on other size screens
-void displayCurrentGame(CurrentGameData& gameData) {
-
-  char score[4];
-  int16_t awayPosX; int16_t homePosX; int16_t font;
-
-  tftSet(true);
-  tft.fillScreen(TFT_WHITE);
-  tft.setTextColor(TFT_BLACK);
-
-  printCurrentGame(gameData);
-  displayTeamLogos(gameData.awayID,gameData.homeID,gameData.league);
+  printCurrentGame(gameData);
+  displayTeamLogos(gameData.awayID,gameData.homeID,gameData.league);
 
   calculateScoreXPosition(gameData.awayScore,gameData.homeScore,awayPosX,homePosX,font);
 
@@ -1714,482 +923,1633 @@ void displayCurrentGame(CurrentGameData& gameData) {
 
 }
 
+// the score pop's first frame is on screen
+void scorePopShown() {
+  uint32_t latencyMs = (clockMicros() - scorePopResponseUs) / 1000;
+  scoreLatencyCount++;
+  scoreLatencyTotalMs += latencyMs;
+  scoreLatencyMaxMs = max(scoreLatencyMaxMs,latencyMs);
+  dPrintf(F("Score event: HTTP response to first frame %d ms (avg %d max %d over %d)\n"),latencyMs,
+          (uint32_t)(scoreLatencyTotalMs / scoreLatencyCount),scoreLatencyMaxMs,scoreLatencyCount);
+}
 
-bool getAndDisplayCurrentMLBGame(const uint32_t gameID, CurrentGameData& prevUpdate) {
-
-  StaticJsonDocument<512> filter;
-  DynamicJsonDocument doc(2048);
+// called by displayCurrentGame after it drew the new score
+void showScorePop() {
 
-  HTTPClient httpClient;
-  WiFiClient wifiClient;
-  String queryString;
+  char score[4];
+  int16_t awayPosX; int16_t homePosX; int16_t font;
 
-  CurrentGameData gameData;
-  bool isGameOver = false;
+  scorePopPending = false;
+  calculateScoreXPosition(currentGameData.awayScore,currentGameData.homeScore,awayPosX,homePosX,font);
+  snprintf(score,sizeof(score),"%d",scorePopHome ? currentGameData.homeScore : currentGameData.awayScore);
+  int16_t x = scorePopHome ? homePosX : awayPosX;
 
-  dPrintln(F("Query - Type: Current Game"));
-
-  queryString = "http://";
-  queryString += MLB_HOST;
-  queryString += "/api/v1.1/game/";
-  queryString += gameID;
-  queryString += "/feed/live";
-
-  filter["gamePk"] = true;
-  filter["gameData"]["status"]["abstractGameState"] = true;
-  filter["liveData"]["linescore"]["currentInning"] = true;
-  filter["liveData"]["linescore"]["currentInningOrdinal"] = true;
-  filter["liveData"]["linescore"]["isTopInning"] = true;
-  filter["liveData"]["linescore"]["teams"]["home"]["runs"] = true;
-  filter["liveData"]["linescore"]["teams"]["away"]["runs"] = true;
-  filter["liveData"]["linescore"]["offense"] = true;
-  filter["liveData"]["linescore"]["outs"] = true;
-  filter["liveData"]["boxscore"]["teams"]["home"]["team"]["id"] = true;
-  filter["liveData"]["boxscore"]["teams"]["away"]["team"]["id"] = true;
-
-  serializeJsonPretty(filter,Serial);
-  
-  dPrintf(F("\nQuery URL: %s\n"),queryString.c_str());
+  animFlash(x - 2,68,tft.textWidth(score,font) + 4,tft.fontHeight(font) + 4,score,font,TFT_BLACK,TFT_WHITE,
+            SCORE_POP_MS,scorePopShown);
 
-  httpClient.useHTTP10(true);
-  httpClient.begin(wifiClient,queryString);
+}
 
-  int httpResult = httpClient.GET();
-  if (httpResult != 200) {
-    dPrintf(F("HTTP error: %d\n"),httpResult);
-    httpClient.end();
-    permanentError(F("HTTP error: %s\n"),httpResult);
+void startScorePop(const bool home) {
+  if (tickerMode || (watchShown >= 0)) {
+    return;     // the selected game isn't on screen
   }
-  
-  DeserializationError err = deserializeJson(doc,wifiClient,DeserializationOption::Filter(filter),DeserializationOption::NestingLimit(14));
- 
-  httpClient.end();
-  
-  if (err) {
-    permanentError(F("%s"),err.c_str());
+  scorePopHome = home;
+  scorePopPending = true;
+  scorePopResponseUs = lastResponseUs;
+}
+
+void drawTickerHeader(const uint8_t page, const uint8_t pages) {
+
+  char buffer[12];
+
+  tft.fillRect(0,0,tft.width(),TICKER_ROW_HEIGHT,TFT_BLACK);
+  tft.setTextColor(TFT_WHITE);
+  tft.drawString(getLeagueName(tickerBoard.league),2,0,2);
+  time_t now = currentTime();
+  strftime(buffer,sizeof(buffer),"%a, %b %e",localtime(&now));
+  tft.drawString(buffer,TFT_HALF_WIDTH - (tft.textWidth(buffer,2)/2),0,2);
+  if (pages > 1) {
+    snprintf(buffer,sizeof(buffer),"%d/%d",page + 1,pages);
+    tft.drawRightString(buffer,tft.width() - 2,0,2);
   }
 
-  serializeJsonPretty(doc,Serial);
+}
 
-  isGameOver = extractCurrentGame_MLB(gameData,doc);
+// hacky hardcoded columns for 160 pixels: away, score, home, score, status
+void drawTickerRow(const uint8_t row, const TickerGame& game) {
 
-  printCurrentGame(gameData);
+  char buffer[12];
+  int16_t y = TICKER_ROW_HEIGHT * (row + 1);
 
-  if (gameStatsChanged(prevUpdate,gameData)) {
-    copyGameData(prevUpdate,gameData);
-    displayCurrentGame(prevUpdate);
+  tft.fillRect(0,y,tft.width(),TICKER_ROW_HEIGHT,TFT_WHITE);
+  if (game.gameID == 0) {
+    return;
   }
 
-  return isGameOver;
+  tft.setTextColor(TFT_BLACK);
+  tft.drawString(getTeamAbbreviation(game.awayID,tickerBoard.league),2,y,2);
+  tft.drawString(getTeamAbbreviation(game.homeID,tickerBoard.league),54,y,2);
+  if (game.state != TICKER_SCHEDULED) {
+    snprintf(buffer,sizeof(buffer),"%d",game.awayScore);
+    tft.drawRightString(buffer,48,y,2);
+    snprintf(buffer,sizeof(buffer),"%d",game.homeScore);
+    tft.drawRightString(buffer,100,y,2);
+  }
+
+  if (game.state == TICKER_LIVE) {
+    tft.setTextColor(TFT_RED);
+  }
+  snprintf(buffer,sizeof(buffer),"%s %s",game.devision,game.timeRemaining);
+  tft.drawString(game.devision[0] ? buffer : game.timeRemaining,106,y + 4,1);
 
 }
 
-bool getAndDisplayCurrentNHLGame(const uint32_t gameID, CurrentGameData& prevUpdate) {
+// Only rows whose game record differs from what is on screen are drawn again
+void displayTicker() {
 
-  StaticJsonDocument<256> filter;
-  StaticJsonDocument<512> doc;
+  static uint8_t headerPage = 0xFF;
+  static uint8_t headerPages = 0xFF;
+
+  uint8_t pages = max(1,(tickerBoard.count + TICKER_ROWS - 1) / TICKER_ROWS);
+  if (tickerPage >= pages) {
+    tickerPage = 0;
+  }
+
+  if (tickerRedraw) {
+    tickerRedraw = false;
+    tftSet(digitalRead(SWITCH_PIN_1));
+    animStopAll();
+    tft.fillScreen(TFT_WHITE);
+    memset(tickerShown,0xFF,sizeof(tickerShown));    // matches no game
+    headerPage = 0xFF;
+  }
+
+  if ((headerPage != tickerPage) || (headerPages != pages)) {
+    drawTickerHeader(tickerPage,pages);
+    headerPage = tickerPage;
+    headerPages = pages;
+  }
+
+  uint8_t redrawn = 0;
+  for (uint8_t row = 0; row < TICKER_ROWS; row++) {
+    uint8_t index = tickerPage * TICKER_ROWS + row;
+    TickerGame game;
+    if (index < tickerBoard.count) {
+      game = tickerBoard.games[index];
+    }
+    else {
+      memset(&game,0,sizeof(game));
+    }
+    if (memcmp(&game,&tickerShown[row],sizeof(game)) != 0) {
+      drawTickerRow(row,game);
+      tickerShown[row] = game;
+      redrawn++;
+    }
+  }
+
+  dPrintf(F("Ticker page %d of %d, %d rows redrawn\n"),tickerPage + 1,pages,redrawn);
+
+}
+
+void requestRender(const Screen screen) {
+  if (tickerMode && (screen != SCREEN_TICKER)) {
+    return;     // the team screens are drawn again when the ticker is closed
+  }
+  if (screen == SCREEN_CURRENT_GAME) {
+    watchShown = -1;     // our own team's game always wins
+  }
+  else if ((watchShown >= 0) && (screen == SCREEN_NEXT_GAME)) {
+    return;     // a watched team's live game beats our next game
+  }
+  pendingScreen = screen;
+  taskWakeNow(renderTask);
+}
+
+// top centre, above the logos: how long since the score last updated
+void drawStaleMarker() {
+  char text[12];
+  snprintf(text,sizeof(text),"%dm old",staleMinutes);
+  int16_t width = tft.textWidth(text,1) + 4;
+  tft.fillRect(TFT_HALF_WIDTH - width / 2,0,width,10,TFT_RED);
+  tft.setTextColor(TFT_WHITE);
+  tft.drawString(text,TFT_HALF_WIDTH - width / 2 + 2,1,1);
+  tft.setTextColor(TFT_BLACK);
+}
+
+// After every poll of our game. Redraws when the marker appears, its minutes
+// change or it goes away
+void checkStale() {
+  uint32_t minutes = 0;
+  uint64_t age = schedulerMillis() - lastGoodGameMs;
+  if ((gameStatus == STARTED) && (lastGoodGameMs != 0) && (age > (uint64_t)STALE_AFTER_POLLS * gameUpdateInterval * 1000)) {
+    minutes = age / 60000;
+  }
+  if (minutes != staleMinutes) {
+    if ((minutes > 0) && (staleMinutes == 0)) {
+      dPrintf(F("Score is stale, last good one %d minutes ago\n"),minutes);
+    }
+    staleMinutes = minutes;
+    requestRender(SCREEN_CURRENT_GAME);
+  }
+}
+
+void saveSnapshot(const Screen screen) {
+  BootSnapshot snapshot;
+  snapshot.screen = screen;
+  snapshot.league = currentLeague;
+  snapshot.teamID = selectedTeam[currentLeague];
+  snapshot.nextGame = nextGameData;
+  snapshot.currentGame = currentGameData;
+  snapshotSave(snapshot);
+}
+
+// paint the last known screen before anything else is up. Time isn't known
+// yet so this needs the time zone to show the start time right
+bool showSnapshot() {
+
+  BootSnapshot snapshot;
+  if (!snapshotLoad(snapshot) || (snapshot.league >= NUM_LEAGUES)) {
+    return false;
+  }
+
+  char tz[48];
+  strncpy_P(tz,MY_TZ,sizeof(tz) - 1);
+  tz[sizeof(tz) - 1] = '\0';
+  setenv("TZ",tz,1);
+  tzset();
+
+  currentLeague = snapshot.league;
+  selectedTeam[currentLeague] = snapshot.teamID;
+  if (snapshot.screen == SCREEN_CURRENT_GAME) {
+    displayCurrentGame(snapshot.currentGame);
+  }
+  else {
+    displayNextGame(snapshot.nextGame);
+  }
+
+  return true;
+}
+
+void saveRtcState() {
+  RtcState state;
+  state.gameStatus = gameStatus;
+  state.league = currentLeague;
+  state.teamID = selectedTeam[currentLeague];
+  state.nextGame = nextGameData;
+  state.currentGame = currentGameData;
+  rtcStateSave(state);
+}
+
+// after a crash or restart during a live game go straight back to polling it.
+// The update checks wait for the next cold boot
+bool resumeGame() {
+
+  RtcState state;
+  if (!rtcStateWarmReset() || !rtcStateLoad(state) || (state.gameStatus != STARTED) || (state.league >= NUM_LEAGUES)) {
+    return false;
+  }
+
+  dPrintf(F("Resuming live game %d after %s\n"),state.nextGame.gameID,ESP.getResetReason().c_str());
+  gameStatus = STARTED;
+  lastGoodGameMs = schedulerMillis();    // the stale marker counts from the resume, not from boot
+  currentLeague = state.league;
+  selectedTeam[currentLeague] = state.teamID;
+  nextGameData = state.nextGame;
+  currentGameData = state.currentGame;
+  updateStage = UPDATES_DONE;
+
+  displayCurrentGame(currentGameData);
+
+  return true;
+}
+
+void renderTaskRun() {
+
+  static uint64_t lastSnapshot = 0;
+
+  if (pendingScreen == SCREEN_NONE) {
+    return;
+  }
+  simRepaint();
+
+  if (pendingScreen == SCREEN_TICKER) {
+    displayTicker();
+    showingSnapshot = false;
+    pendingScreen = SCREEN_NONE;
+    return;
+  }
+
+  if (pendingScreen == SCREEN_WATCHED_GAME) {
+    if (watchShown >= 0) {
+      displayCurrentGame(watchlist[watchShown].currentGame);
+    }
+    showingSnapshot = false;
+    pendingScreen = SCREEN_NONE;
+    return;
+  }
+
+  if (pendingScreen == SCREEN_NEXT_GAME) {
+    scorePopPending = false;
+    displayNextGame(nextGameData);
+  }
+  else if (pendingScreen == SCREEN_CURRENT_GAME) {
+    displayCurrentGame(currentGameData);
+    if (staleMinutes > 0) {
+      drawStaleMarker();
+    }
+    if (scorePopPending) {
+      showScorePop();
+    }
+  }
+  showingSnapshot = false;
+
+  if (!liveFrameShown) {
+    liveFrameShown = true;
+    dPrintf(F("Boot to first live frame: %llu ms\n"),clockMillis());
+  }
+
+  // simulated screens aren't worth restoring at boot
+  bool snapshotDue = (pendingScreen == SCREEN_NEXT_GAME) || (lastSnapshot == 0) || ((clockMillis() - lastSnapshot) >= SNAPSHOT_MIN_INTERVAL_MS);
+  if (snapshotDue && !simActive()) {
+    saveSnapshot(pendingScreen);
+    lastSnapshot = clockMillis();
+  }
+
+  pendingScreen = SCREEN_NONE;
+}
+
+// Current game response to gameData, from the network or a replayed fixture
+template <typename League>
+bool parseCurrentGame(Stream& stream, JsonDocument& filter, const uint32_t gameID, CurrentGameData& gameData, bool& isGameOver) {
+
+  DynamicJsonDocument doc(League::CURRENT_GAME_DOC_SIZE);
+
+  if (League::CURRENT_GAME_SEEK) {
+    stream.find(League::CURRENT_GAME_SEEK);
+  }
+
+  DeserializationError err = deserializeJson(doc,stream,DeserializationOption::Filter(filter),DeserializationOption::NestingLimit(League::CURRENT_GAME_NESTING));
+
+  if (err) {
+    dPrintf(F("Parse error: %s\n"),err.c_str());
+    return false;
+  }
+
+  dVerboseJson(doc);
+
+  isGameOver = League::extractCurrentGame(gameData,gameID,doc);
+
+  printCurrentGame(gameData);
+
+  return true;
+
+}
+
+// Generic current game query. Instantiated once per league provider so the
+// league specific calls are resolved at compile time. On an error the host's
+// backoff is left in currentGameRetryMs
+template <typename League>
+UpstreamError fetchCurrentGame(const uint32_t gameID, CurrentGameData& gameData, bool& isGameOver) {
+
+  StaticJsonDocument<League::FILTER_DOC_SIZE> filter;
 
   HTTPClient httpClient;
-  WiFiClient wifiClient;
+  DnsCachedClient wifiClient;
+  DeadlineStream stream(wifiClient,ENDPOINT_CURRENT_GAME);
   String queryString;
 
-  CurrentGameData gameData;
-  bool isGameOver = false;
+  dPrintf(F("Query - Type: Current Game %s\n"),League::INFO.name);
 
-  dPrint(F("Query - Type: Current Game NHL\n"));
-
-  queryString = "http://";
-  queryString += NHL_HOST;
-  queryString += "/api/v1/game/";
-  queryString += gameID;
-  queryString += "/linescore";
-
-  filter["currentPeriod"] = true;
-  filter["currentPeriodOrdinal"] = true;
-  filter["currentPeriodTimeRemaining"] = true;
-  filter["teams"]["home"]["team"]["id"] = true;
-  filter["teams"]["home"]["goals"] = true;
-  filter["teams"]["home"]["powerPlay"] = true;
-  filter["teams"]["away"]["team"]["id"] = true;
-  filter["teams"]["away"]["goals"] = true;
-  filter["teams"]["away"]["powerPlay"] = true;
-  
-  serializeJsonPretty(filter,Serial);
+  League::currentGameURL(gameID,queryString);
+  League::currentGameFilter(filter);
+
+  dVerboseJson(filter);
 
   dPrintf(F("\nQuery URL: %s\n"),queryString.c_str());
 
-  httpClient.useHTTP10(true);
+  if (!upstreamAllowed(queryString)) {
+    currentGameRetryMs = upstreamRetryMs(queryString);
+    dPrintf(F("Upstream breaker open, next try in %d ms\n"),currentGameRetryMs);
+    return UPSTREAM_CIRCUIT_OPEN;
+  }
+
+  httpClient.useHTTP10(true);   // Very Important for NBA api to parse correctly
+  stream.prepare(httpClient);
   httpClient.begin(wifiClient,queryString);
 
   int httpResult = httpClient.GET();
+  stream.responded(httpResult);
+  UpstreamError err = upstreamClassify(httpResult);
   if (httpResult != 200) {
     dPrintf(F("HTTP error: %d\n"),httpResult);
-    httpClient.end();
-    permanentError(F("HTTP error: %d\n"),httpResult);
+    err = (err == UPSTREAM_OK) ? UPSTREAM_HTTP_5XX : err;   // 2xx without a body we can use
+  }
+  else {
+    lastResponseUs = clockMicros();
+    if (!parseCurrentGame<League>(stream,filter,gameID,gameData,isGameOver)) {
+      err = stream.expired() ? UPSTREAM_TIMEOUT : UPSTREAM_PARSE;
+    }
   }
-
-  DeserializationError err = deserializeJson(doc,wifiClient,DeserializationOption::Filter(filter));
   httpClient.end();
 
-  serializeJsonPretty(doc,Serial);
+  upstreamResult(queryString,err);
+  currentGameRetryMs = upstreamRetryMs(queryString);
+  return err;
 
-  if (err) {
-    permanentError(F("%s"),err.c_str());
+}
+
+UpstreamError fetchCurrentGame(const uint8_t league, const uint32_t gameID, CurrentGameData& gameData, bool& isGameOver) {
+
+  UpstreamError err = UPSTREAM_HTTP_4XX;
+
+  if (simActive()) {
+    currentGameRetryMs = gameUpdateInterval * 1000;
+    return simCurrentGame(gameID,gameData,isGameOver) ? UPSTREAM_OK : UPSTREAM_PARSE;
   }
 
-  isGameOver = extractCurrentGame_NHL(gameData,gameID,doc);
+  if (!Leagues::dispatch(league,[&](auto provider) {
+        err = fetchCurrentGame<decltype(provider)>(gameID,gameData,isGameOver);
+      })) {
+    dPrintf(F("Unrecognized league: %d\n"),league);
+  }
 
-  printCurrentGame(gameData);
+  return err;
+
+}
+
+// a new state of the selected game, from our own query or a peer
+void showCurrentGame(CurrentGameData& gameData, CurrentGameData& prevUpdate) {
+
+  simScoreSeen(gameData);
+
+  uint8_t events = detectGameEvents(prevUpdate,gameData);
+  if (events) {
+    printGameEvents(events,prevUpdate,gameData);
+  }
 
   if (gameStatsChanged(prevUpdate,gameData)) {
     copyGameData(prevUpdate,gameData);
-    displayCurrentGame(prevUpdate);
+    requestRender(SCREEN_CURRENT_GAME);
   }
 
-  return isGameOver;
-}
+  uint16_t myTeam = selectedTeam[currentLeague];
+  bool homeScored = (events & EVENT_HOME_SCORED) && (gameData.homeID == myTeam);
+  bool awayScored = (events & EVENT_AWAY_SCORED) && (gameData.awayID == myTeam);
+  if (homeScored || awayScored) {
+    playHorn(true);
+    startScorePop(homeScored);
+  }
 
-bool getAndDisplayCurrentNBAGame(const uint32_t gameID, CurrentGameData& prevUpdate) {
+}
 
-  HTTPClient httpClient;
-  WiFiClient wifiClient;
+// Poll our game. On an error the last good score stays up, marked stale once
+// it's old enough, and err says why
+bool getAndDisplayCurrentGame(const uint8_t league, const uint32_t gameID, CurrentGameData& prevUpdate, UpstreamError& err) {
 
-  String queryString;
-  StaticJsonDocument<224> filter;
-  StaticJsonDocument<512> doc;
-  
   CurrentGameData gameData;
   bool isGameOver = false;
 
-  
-  dPrint(F("Query - Type: Current Game NBA\n"));
+  requestCount(REQUEST_SELECTED);
+  err = fetchCurrentGame(league,gameID,gameData,isGameOver);
+  if (err != UPSTREAM_OK) {
+    dPrintf(F("Current game query failed (%s), keeping the last score\n"),upstreamErrorName(err));
+    checkStale();
+    return false;
+  }
 
-  filter["id"] = true;
-  filter["competitors"][0]["id"] = true;
-  filter["competitors"][0]["homeAway"] = true;
-  filter["competitors"][0]["score"] = true;
-  
-  filter["competitors"][1]["id"] = true;
-  filter["competitors"][1]["homeAway"] = true;
-  filter["competitors"][0]["score"] = true;
+  lastGoodGameMs = schedulerMillis();
+  peerPublish(gameData,isGameOver,gameUpdateInterval);
+  showCurrentGame(gameData,prevUpdate);
+  checkStale();
+
+  return isGameOver;
+
+}
+
+// Sim task. Wakes at the end of the scripted day, reports and goes back to live data
+void simTaskRun() {
+
+  if (!simActive()) {
+    return;
+  }
+  if (simRemainingMs() > 0) {
+    taskWakeIn(simTask,simRemainingMs());
+    return;
+  }
+
+  simReport();
+  simStop();
+  peerEnable(simPeersWere);
+  dPrintf(F("Simulation over, back to live data\n"));
+
+  gameStatus = NEW_TEAM;
+  taskWakeNow(pollTask);
+  taskWakeNow(watchTask);
+
+}
+
+// Peer callback. The leader for our game multicast its latest poll
+void peerGameReceived(const CurrentGameData& game, const bool isGameOver) {
+
+  if ((gameStatus != STARTED) || (game.league != currentLeague) || (game.gameID != nextGameData.gameID)) {
+    return;
+  }
+  CurrentGameData gameData = game;
+  lastResponseUs = clockMicros();
+  lastGoodGameMs = schedulerMillis();
+  showCurrentGame(gameData,currentGameData);
+  checkStale();
+  if (isGameOver) {
+    peerGameOver = true;
+    taskWakeNow(pollTask);
+  }
+
+}
+
+
+void ICACHE_RAM_ATTR ledSwitchInterrupt() {
+
+    if (digitalRead(SWITCH_PIN_1)) {
+      tftSet(HIGH);
+    }
+    else {
+      if (gameStatus != STARTED) {
+        tftSet(LOW);
+      }
+    }
+}
+
+// light sleep leaves the wakeup pins in level interrupt mode
+void powerWake() {
+  attachInterrupt(digitalPinToInterrupt(SWITCH_PIN_1),ledSwitchInterrupt,CHANGE);
+  setInterrupt(true);
+  ledSwitchInterrupt();
+  buttonInterrupt();    // record the press that woke us
+}
+
+void cfgUpdate_onStart() {
+  dPrintln(F("CFG update started"));
+  tftMessage(F("CFG update started"));
+}
+
+void cfgUpdate_onEnd(const UpdateStats& stats) {
+  dPrintf(F("Data files download complete: %d bytes in %d ms\n"),stats.bytesDownloaded,stats.elapsedMs);
+  tftMessage(F("Downloading data\n\nprogress: complete\n%d KB in %d s\n\nrestarting..."),stats.bytesDownloaded / 1024,stats.elapsedMs / 1000);
+  logFlush();
+  delay(1000);
+  ESP.restart();
+}
+
+void cfgUpdate_onProgress(int cur, int total) {
+  static uint8_t lastPercent = 0xFF;
+  uint8_t percent = ((uint64_t)cur * 100) / total;
+  if (percent != lastPercent) {
+    lastPercent = percent;
+    dPrintf(F("Data update progress %d of %d bytes\n"),cur,total);
+    tftMessage(F("Downloading data\n\nprogress: %d%%"),percent);
+  }
+}
+
+void cfgUpdate_onError(const UpdateStats& stats) {
+  dPrintf(F("Data update failed: %d bytes downloaded, %d retries\n"),stats.bytesDownloaded,stats.retries);
+  tftMessage(F("Data update failed\n\nWill try again on\nnext restart"));
+}
+
+void performCFGUpdate(const uint32_t version) {
+
+  String queryString = FW_URL;
+  queryString += PROJECT_NAME;
+
+  dPrint(F("\nDownloading... DON'T TURN OFF!\n"));
+  tftMessage(F("Downloading...\nDON'T TURN OFF!"));
+
+  UpdateStats stats;
+  cfgUpdate_onStart();
+
+  // only what changed when the server has a file list, the whole image otherwise
+  if (updateManifest.files.size > 0) {
+    queryString += FILES_PREFIX;
+    queryString += version;
+    queryString += "/";
+    if (fileSync(queryString,updateManifest.files,cfgUpdate_onProgress,stats)) {
+      cfgUpdate_onEnd(stats);
+    }
+  }
+  else {
+    queryString += CFG_PREFIX;
+    queryString += version;
+    queryString += CFG_EXT;
+    if (downloadImage(queryString,updateManifest.fs,DOWNLOAD_FILESYSTEM,cfgUpdate_onProgress,stats)) {
+      cfgUpdate_onEnd(stats);
+    }
+  }
+  cfgUpdate_onError(stats);
+
+}
+
+uint32_t getFSVer() {
+  File file = LittleFS.open(CFG_VERSION_FILENAME,"r");
+  uint32_t result = 0;
+
+  if (!file) {
+    dPrint(F("CFG Version read error\n"));
+  }
+  else {
+    result = file.parseInt();
+  }
+
+  file.close();
+  return result;
+
+}
+
+uint32_t checkForCFGUpdate() {
+
+  uint32_t currentVersion = getFSVer();
+  uint32_t availableVersion = updateManifest.valid ? updateManifest.fs.version : 0;
+
+  dPrintf(F("Data files Version Current:  %d\n"),currentVersion);
+  dPrintf(F("Data files Version Available: %d\n"),availableVersion);
+  dPrintf(F("New data files available?:  %s\n"), (availableVersion > currentVersion) ? "Yes" : "No");
+
+  return (availableVersion > currentVersion) ? availableVersion : 0;
   
-  filter["status"]["displayClock"] = true;
-  filter["status"]["period"] = true;
-  filter["status"]["type"]["name"] = true;
+}
 
-  serializeJsonPretty(filter,Serial);
+void fwUpdate_onStart() {
+  dPrintln(F("FW update started"));
+  tftMessage(F("FW update started"));
+}
 
-  queryString = "http://site.api.espn.com/apis/site/v2/sports/basketball/nba/summary?event=";
-  queryString += gameID;
+void fwUpdate_onEnd() {
+  uint32_t took = clockMillis() - fwUpdateStart;
+  dPrintf(F("FW download complete: %d bytes in %d ms\n"),fwUpdateBytes,took);
+  tftMessage(F("Downloading firmware\n\nprogress: complete\n%d KB in %d s\n\nrestarting..."),fwUpdateBytes / 1024,took / 1000);
+  logFlush();
+  delay(1000);
+  ESP.restart();
+}
 
-  dPrintf(F("\nQuery URL: %s\n"),queryString.c_str());
+void fwUpdate_onProgress(int cur, int total) {
+  static uint8_t lastPercent = 0xFF;
+  uint8_t percent = ((uint64_t)cur * 100) / total;
+  fwUpdateBytes = cur;
+  if (percent != lastPercent) {
+    lastPercent = percent;
+    dPrintf(F("FW update progress %d of %d bytes\n"),cur,total);
+    tftMessage(F("Downloading firmware\n\nprogress: %d%%"),percent);
+  }
+}
 
-  httpClient.useHTTP10(true);   // Very Important for NBA api to parse correctly
-  httpClient.begin(wifiClient,queryString);
+void fwUpdate_onError(const UpdateStats& stats) {
+  dPrintf(F("FW update failed: %d bytes downloaded, %d retries\n"),stats.bytesDownloaded,stats.retries);
+  tftMessage(F("FW update failed\n\nDownload resumes on\nnext restart"));
+}
 
-  int httpResult = httpClient.GET();
-  if (httpResult != 200) {
-    httpClient.end();
-    permanentError(F("HTTP error: %d\n"),httpResult);
+// called per patch op so only redraw when the percentage moves
+void fwUpdate_onDeltaProgress(uint32_t done, uint32_t total) {
+  static uint8_t lastPercent = 0xFF;
+  uint8_t percent = ((uint64_t)done * 100) / total;
+  if (percent != lastPercent) {
+    lastPercent = percent;
+    tftMessage(F("Patching firmware\n\nprogress: %d%%"),percent);
+  }
+}
+
+void performFWUpdate(const uint32_t version) {
+
+    fwUpdateStart = clockMillis();
+    fwUpdateBytes = 0;
+
+    // a patch from this build is a fraction of the size. Anything wrong with
+    // it and the full image below is used instead
+    String deltaString = FW_URL;
+    deltaString += PROJECT_NAME;
+    deltaString += FW_PREFIX;
+    deltaString += CURRENT_FW_VERSION;
+    deltaString += "_";
+    deltaString += version;
+    deltaString += DELTA_EXT;
+
+    UpdateStats stats;
+    if (deltaUpdate(deltaString,updateManifest.fw.md5,stats,fwUpdate_onDeltaProgress) == DELTA_OK) {
+      fwUpdateBytes = stats.bytesDownloaded;
+      fwUpdate_onEnd();
+    }
+    dPrint(F("Using full FW image\n"));
+
+    String queryString = FW_URL;
+    queryString += PROJECT_NAME;
+    queryString += FW_PREFIX;
+    queryString += version;
+    queryString += FW_EXT;
+
+    dPrint(F("\nDownloading... DON'T TURN OFF!\n"));
+    tftMessage(F("Downloading...\nDON'T TURN OFF!"));
+
+    fwUpdate_onStart();
+    if (downloadImage(queryString,updateManifest.fw,DOWNLOAD_FIRMWARE,fwUpdate_onProgress,stats)) {
+      fwUpdateBytes = stats.bytesDownloaded;
+      fwUpdate_onEnd();
+    }
+    fwUpdate_onError(stats);
+    
+}
+
+// one request for both firmware and data file versions
+void fetchUpdateManifest() {
+
+  String queryString = FW_URL;
+  queryString += PROJECT_NAME;
+  queryString += MANIFEST_FILENAME;
+
+  uint64_t startTime = clockMillis();
+  manifestFetch(queryString,updateManifest);
+  dPrintf(F("Update check took: %d ms\n"),(uint32_t)(clockMillis() - startTime));
+}
+
+uint32_t checkForFWUpdate() {
+
+  uint32_t availableVersion = updateManifest.valid ? updateManifest.fw.version : 0;
+
+  dPrintf(F("FW Version Current:   %d\n"),CURRENT_FW_VERSION);
+  dPrintf(F("FW Version Available: %d\n"),availableVersion);
+  dPrintf(F("FW Update Available:  %s\n"), (availableVersion > CURRENT_FW_VERSION) ? "Yes" : "No");
+
+  return (availableVersion > CURRENT_FW_VERSION) ? availableVersion : 0;
+
+}
+
+// load the teams and start polling once the update checks are out of the way
+void startScoreboard() {
+
+  // GUI selection of favourite team if button is being pressed
+  debouncer.update();
+
+  if (!loadTeams() || (debouncer.read() == LOW)) {
+      selectTeam();
+  }
+
+  taskWakeNow(pollTask);
+  taskWakeNow(watchTask);
+}
+
+void updateTaskRun() {
+
+  if (updateStage == CHECK_FW) {
+    if (!showingSnapshot) {
+      tftMessage(F("Checking for updates..."));
+    }
+    fetchUpdateManifest();
+    pendingUpdateVersion = checkForFWUpdate();
+    if (pendingUpdateVersion) {
+      tftMessage(F("FW update available\n\n\nPress button to continue"));
+      updateStage = WAIT_FW;
+      return;
+    }
+    updateStage = CHECK_CFG;
+  }
+
+  if (updateStage == CHECK_CFG) {
+    pendingUpdateVersion = checkForCFGUpdate();
+    if (pendingUpdateVersion) {
+      tftMessage(F("New data files available\n\n\nPress buttton to continue"));
+      updateStage = WAIT_CFG;
+      return;
+    }
+    updateStage = UPDATES_DONE;
+    startScoreboard();
+  }
+
+}
+
+// Ticker task. Fetches the league scoreboard, live games at the normal game
+// interval, and flips pages in between when there are more games than rows
+void tickerTaskRun() {
+
+  if (!tickerMode) {
+    return;
+  }
+
+  uint64_t now = clockMillis();
+  bool changed = false;
+
+  if (now >= tickerNextFetch) {
+    if (!powerWiFiReady()) {
+      taskWakeIn(tickerTask,WIFI_WAIT_MS);
+      return;
+    }
+
+    bool fetched = false;
+    requestCount(REQUEST_TICKER);
+    Leagues::dispatch(currentLeague,[&](auto provider) {
+      fetched = decltype(provider)::getScoreboard(currentTime(),tickerFetch);
+    });
+
+    uint32_t interval = gameUpdateInterval * 1000;    // also the retry after an error
+    if (fetched) {
+      changed = tickerRedraw || (tickerFetch.league != tickerBoard.league) || (tickerFetch.count != tickerBoard.count)
+                || (memcmp(tickerFetch.games,tickerBoard.games,tickerFetch.count * sizeof(TickerGame)) != 0);
+      if (changed) {
+        tickerBoard = tickerFetch;
+      }
+
+      bool anyLive = false;
+      bool anyScheduled = false;
+      for (uint8_t i = 0; i < tickerBoard.count; i++) {
+        anyLive = anyLive || (tickerBoard.games[i].state == TICKER_LIVE);
+        anyScheduled = anyScheduled || (tickerBoard.games[i].state == TICKER_SCHEDULED);
+      }
+      if (!anyLive) {
+        interval = anyScheduled ? tickerIdlePollMs : MAX_SLEEP_INTERVAL_S * 1000;
+      }
+    }
+    tickerNextFetch = now + interval;
+  }
+  else {
+    tickerPage++;
+    changed = true;
+  }
+
+  if (changed) {
+    requestRender(SCREEN_TICKER);
+  }
+
+  uint64_t wake = tickerNextFetch;
+  if ((tickerBoard.count > TICKER_ROWS) && (now + TICKER_PAGE_MS < wake)) {
+    wake = now + TICKER_PAGE_MS;
+  }
+  taskWakeIn(tickerTask,wake - now);
+
+}
+
+void setTickerMode(const bool enable) {
+
+  tickerMode = enable;
+  dPrintf(F("Ticker mode: %s\n"),enable ? "on" : "off");
+
+  if (enable) {
+    tftMessage(F("Fetching %s scoreboard..."),getLeagueName(currentLeague));
+    tickerBoard.count = 0;
+    tickerPage = 0;
+    tickerRedraw = true;
+    tickerNextFetch = 0;
+    taskWakeNow(tickerTask);
+  }
+  else {
+    taskStop(tickerTask);
+    if (watchShown >= 0) {
+      pendingScreen = SCREEN_WATCHED_GAME;
+      taskWakeNow(renderTask);
+    }
+    else {
+      requestRender(((gameStatus == STARTED) || (gameStatus == AFTER_GAME)) ? SCREEN_CURRENT_GAME : SCREEN_NEXT_GAME);
+    }
+  }
+
+}
+
+// One watched team: refresh its cached schedule when due, poll its game while
+// live. Returns when the entry next needs attention
+uint64_t watchEntryRun(WatchEntry& entry, const bool fast) {
+
+  uint64_t now = clockMillis();
+  time_t today = currentTime();
+
+  if ((entry.scheduleChecked == 0) || (now - entry.scheduleChecked >= WATCH_SCHEDULE_REFRESH_MS)) {
+    if (!requestAllowed()) {
+      return now + watchSlowPollMs;
+    }
+    requestCount(REQUEST_WATCHED);
+    if (getNextGame(today,entry.teamID,entry.league,entry.nextGame) != UPSTREAM_OK) {    // skips the game that just ended
+      return now + max(upstreamLastRetryMs(),watchSlowPollMs);
+    }
+    entry.scheduleChecked = now;
+    entry.nextPoll = 0;
+  }
+
+  if ((entry.nextGame.gameID == 0) || (today < entry.nextGame.startTime)) {
+    entry.live = false;
+    uint64_t refresh = entry.scheduleChecked + WATCH_SCHEDULE_REFRESH_MS;
+    if (entry.nextGame.gameID == 0) {
+      return refresh;
+    }
+    return min(refresh,now + (uint64_t)(entry.nextGame.startTime - today) * 1000);
+  }
+
+  if (now >= entry.nextPoll) {
+    if (!requestAllowed()) {
+      return now + watchSlowPollMs;
+    }
+    bool isGameOver = false;
+    requestCount(REQUEST_WATCHED);
+    UpstreamError err = fetchCurrentGame(entry.league,entry.nextGame.gameID,entry.currentGame,isGameOver);
+    if ((err == UPSTREAM_OK) && isGameOver) {
+      dPrintf(F("Watched game over: %s %s\n"),getLeagueName(entry.league),getTeamAbbreviation(entry.teamID,entry.league));
+      entry.live = false;
+      entry.scheduleChecked = 0;    // look for the next game on the next pass
+      return now;
+    }
+    entry.live = true;
+    entry.nextPoll = now + (fast ? gameUpdateInterval * 1000 : watchSlowPollMs);
+    if (err != UPSTREAM_OK) {
+      entry.nextPoll = now + max(currentGameRetryMs,fast ? gameUpdateInterval * 1000 : watchSlowPollMs);
+    }
+  }
+
+  return entry.nextPoll;
+}
+
+// Watch task. Works out the next event across the watchlist and sleeps until
+// then. The first watched team playing gets the screen when ours isn't
+void watchTaskRun() {
+
+  static uint64_t lastReport = 0;
+
+  if (simActive()) {
+    return;     // woken again when the simulation ends
+  }
+
+  uint64_t now = clockMillis();
+  uint64_t wake = now + MAX_SLEEP_INTERVAL_S * 1000;
+
+  if ((now - lastReport) >= REQUEST_REPORT_INTERVAL_MS) {
+    lastReport = now;
+    requestReport();
+  }
+
+  if (watchCount > 0) {
+    if (!powerWiFiReady()) {
+      taskWakeIn(watchTask,WIFI_WAIT_MS);
+      return;
+    }
+  }
+
+  bool ourGameLive = (gameStatus == STARTED);
+  int8_t featured = -1;
+  bool featuredChanged = false;
+  time_t today = currentTime();
+
+  for (uint8_t i = 0; i < watchCount; i++) {
+    WatchEntry& entry = watchlist[i];
+    if ((entry.league == currentLeague) && (entry.teamID == selectedTeam[currentLeague])) {
+      entry.live = false;
+      continue;     // the poll task has this one
+    }
+    bool startedByNow = (entry.nextGame.gameID != 0) && (today >= entry.nextGame.startTime);
+    bool fast = !ourGameLive && (featured < 0) && startedByNow;
+    CurrentGameData before = entry.currentGame;
+    wake = min(wake,watchEntryRun(entry,fast));
+    if (fast && entry.live) {
+      featured = i;
+      featuredChanged = gameStatsChanged(before,entry.currentGame);
+    }
+  }
+
+  watchLive = false;
+  for (uint8_t i = 0; i < watchCount; i++) {
+    watchLive = watchLive || watchlist[i].live;
+  }
+
+  if (featured >= 0) {
+    bool changed = featuredChanged || (watchShown != featured);
+    watchShown = featured;
+    if (!tickerMode && changed) {
+      pendingScreen = SCREEN_WATCHED_GAME;
+      taskWakeNow(renderTask);
+    }
+  }
+  else if (watchShown >= 0) {
+    watchShown = -1;
+    requestRender(((gameStatus == STARTED) || (gameStatus == AFTER_GAME)) ? SCREEN_CURRENT_GAME : SCREEN_NEXT_GAME);
+  }
+
+  powerAllowLightSleep((updateStage == UPDATES_DONE) && (gameStatus != STARTED) && !watchLive);
+
+  taskWakeIn(watchTask,(wake > now) ? wake - now : 0);
+
+}
+
+void inputTaskRun() {
+
+  if (switchTeamsFlag) {
+    switchTeamsFlag = false;
+    if (updateStage == UPDATES_DONE) {
+      dPrintln(F("Select button interrupt\n"));
+      if (tickerMode) {
+        setTickerMode(false);
+      }
+      nextGameData.gameID = 0;
+      selectTeam();
+      gameStatus = NEW_TEAM;
+      watchShown = -1;      // the menu may have changed the watchlist
+      taskWakeNow(pollTask);
+      taskWakeNow(watchTask);
+    }
+  }
+
+  if (shortPressFlag) {
+    shortPressFlag = false;
+    if (updateStage == WAIT_FW) {
+      performFWUpdate(pendingUpdateVersion);   // only returns if the update failed
+      updateStage = CHECK_CFG;
+      taskWakeNow(updateTask);
+    }
+    else if (updateStage == WAIT_CFG) {
+      performCFGUpdate(pendingUpdateVersion);   // only returns if the update failed
+      updateStage = UPDATES_DONE;
+      startScoreboard();
+    }
+    else if ((gameStatus == AFTER_GAME) && !tickerMode) {
+      afterGameDismissed = true;
+      taskWakeNow(pollTask);
+    }
+    else if (updateStage == UPDATES_DONE) {
+      setTickerMode(!tickerMode);     // short press flips between our team and the whole league
+    }
+  }
+
+}
+
+// One step of the game state machine. Every branch schedules the next step
+void pollTaskRun() {
+
+  static uint64_t gameFinishedTime = 0;
+
+  //dPrintf(F("ESP Free Heap: %d Frag: %d%% Max Block: %d\n"),ESP.getFreeHeap(),ESP.getHeapFragmentation(),ESP.getMaxFreeBlockSize());
+
+  bool needsNetwork = (gameStatus == NEW_TEAM) || (gameStatus == STARTED) || ((gameStatus == FINISHED) && (currentTime() > nextGameData.startTime));
+  if (needsNetwork && !simActive() && !powerWiFiReady()) {
+    taskWakeIn(pollTask,WIFI_WAIT_MS);
+    return;
+  }
+
+  if (gameStatus == NEW_TEAM) {
+    if (!showingSnapshot) {
+      tftMessage(F("Fetching next game..."));
+    }
+    if (getNextGame() != UPSTREAM_OK) {
+      taskWakeIn(pollTask,max(nextGameRetryMs,WIFI_WAIT_MS));     // not "no games", ask again
+      return;
+    }
+      if (nextGameData.gameID == 0) {
+        gameStatus = NO_GAMES;
+      }
+      else {
+        gameStatus = SCHEDULED;
+      }
+    requestRender(SCREEN_NEXT_GAME);
+    taskWakeNow(pollTask);
+  }
+  else if (gameStatus == NO_GAMES) {
+    dPrintln(F("No games. Waiting for a new team"));    // input task wakes us
+  }
+  else if (gameStatus == STARTED) {
+    // following a peer the scores come in through peerGameReceived, we only check it's still there
+    bool isGameOver;
+    UpstreamError err = UPSTREAM_OK;
+    if (peerFollowing(currentLeague,nextGameData.gameID)) {
+      isGameOver = peerGameOver;
+      checkStale();
+    }
+    else {
+      isGameOver = getAndDisplayCurrentGame(currentLeague,nextGameData.gameID,currentGameData,err);
+    }
+    peerGameOver = false;
+    if (resumedGame) {
+      resumedGame = false;
+      dPrintf(F("Reset to first live score refresh: %llu ms\n"),clockMillis());
+    }
+    if (isGameOver) {
+      gameStatus = FINISHED;
+      gameFinishedTime = schedulerMillis();
+      taskWakeNow(pollTask);
+    }
+    else if (err != UPSTREAM_OK) {
+      taskWakeIn(pollTask,max(currentGameRetryMs,WIFI_WAIT_MS));
+    }
+    else {
+      taskWakeIn(pollTask,gameUpdateInterval * 1000);
+    }
+  }
+  else if (gameStatus == AFTER_GAME) {
+    uint64_t shownFor = schedulerMillis() - gameFinishedTime;
+    if (afterGameDismissed || (currentTime() > nextGameData.startTime) || (shownFor > AFTER_GAME_RESULTS_DURATION_MS))   {
+      afterGameDismissed = false;
+      if (nextGameUnknown) {
+        gameStatus = NEW_TEAM;      // the query after the final failed, run it again
+      }
+      else if (nextGameData.gameID == 0) {
+        gameStatus = NO_GAMES;
+        requestRender(SCREEN_NEXT_GAME);
+      }
+      else {
+        gameStatus = SCHEDULED;
+        requestRender(SCREEN_NEXT_GAME);
+      }
+      taskWakeNow(pollTask);
+    }
+    else {
+      uint32_t wait = AFTER_GAME_RESULTS_DURATION_MS - shownFor;
+      uint64_t untilStartMs = (uint64_t)(nextGameData.startTime - currentTime()) * 1000;   // days away don't fit 32 bits
+      if ((nextGameData.gameID != 0) && (untilStartMs < wait)) {
+        wait = untilStartMs;
+      }
+      taskWakeIn(pollTask,wait + 1000);
+    }
   }
-
-  
-  wifiClient.find("\"competitions\":[");
-
-  DeserializationError err = deserializeJson(doc,wifiClient,DeserializationOption::Filter(filter),DeserializationOption::NestingLimit(11));
-
-  if (err) {
-    dPrintf(F("Parse Error: %s\n"),err.c_str());
+  else if (currentTime() > nextGameData.startTime) {
+    if (gameStatus == FINISHED) {
+      nextGameUnknown = (getNextGame() != UPSTREAM_OK);
+      gameStatus = AFTER_GAME;
+    }
+    else {
+      gameStatus = STARTED;
+      lastGoodGameMs = schedulerMillis();    // a new game, the last one's score doesn't age this one
+    }
+    taskWakeNow(pollTask);
   }
   else {
-    serializeJsonPretty(doc,Serial);
+    uint32_t wait = min((uint32_t)(nextGameData.startTime - currentTime()),MAX_SLEEP_INTERVAL_S);
+    dPrintf(F("Sleeping for %d seconds @ millis: %llu\n"),wait,clockMillis());
+    taskWakeIn(pollTask,(wait + 1) * 1000);
   }
 
-  isGameOver = extractCurrentGame_NBA(gameData,doc);
-  printCurrentGame(gameData);
+  // live games poll too often for light sleep to pay off
+  powerAllowLightSleep((updateStage == UPDATES_DONE) && (gameStatus != STARTED) && !watchLive);
 
-  if (gameStatsChanged(prevUpdate,gameData)) {
-    copyGameData(prevUpdate,gameData);
-    displayCurrentGame(prevUpdate);
+  if (simActive()) {
+    simStatus(gameStatus,nextGameData);
+  }
+  else {
+    saveRtcState();
   }
 
-  return isGameOver;
-  
 }
 
+// WiFi task. Joins the saved network in the background and only falls back to
+// the blocking WiFiManager portal if that doesn't work out
+void wifiTaskRun() {
+  static uint64_t startTime = 0;
 
-// "sleep" function. We need to fake sleep to monitor for button interrupts
-// this makes power consumption bad, but whatever
-
-// return true iff time expired. Otherwise (button pressed) return false
-bool sleep(uint32_t timeInSeconds) {
-
-  uint32_t wakupTime = millis() + (timeInSeconds * 1000);
-  dPrintf(F("Sleeping for %d seconds @ millis: %d\n"),timeInSeconds,millis());
-
-  while (millis() < wakupTime) {
-    if (switchTeamsFlag) {
-      switchTeamsFlag = false;
-      dPrintln(F("Select button interrupt\n"));
-      nextGameData.gameID = 0;
-      selectTeam();
-      gameStatus = NEW_TEAM;
-      return false;
+  if (startTime == 0) {
+    startTime = clockMillis();
+    if (WiFi.SSID().length() > 0) {
+      dPrintf(F("Connecting to WiFi: %s\n"),WiFi.SSID().c_str());
+      WiFi.mode(WIFI_STA);
+      WiFi.begin();
     }
-    delay(50);
   }
 
-  char buffer[20];
-  dPrintln(F("Woke up"));
-  time_t t = currentTime();
-  strftime(buffer,sizeof(buffer),"%Y/%m/%d %H:%M:%S",localtime(&t));
-  dPrintf(F("Local time: %s\n"),buffer);
-
-  return true;
+  if (WiFi.status() != WL_CONNECTED) {
+    if ((WiFi.SSID().length() > 0) && ((clockMillis() - startTime) < WIFI_CONNECT_TIMEOUT_MS)) {
+      taskWakeIn(wifiTask,WIFI_WAIT_MS);
+      return;
+    }
+    wifiConnect();
+  }
 
+  dPrintf(F("WiFi connected after %llu ms\n"),clockMillis());
+  if (!showingSnapshot) {
+    tftMessage(F("Fetching time..."));
+  }
+  taskWakeNow(timeTask);
 }
 
-void sleepForever() {
-  
-  while (sleep(60 * 60 * 24)) {}
-   
+const char* gameStatusName(const GameStatus status) {
+  static const char* names[] = {"new team","no games","scheduled","started","finished","after game"};
+  return names[status];
 }
 
-void ICACHE_RAM_ATTR ledSwitchInterrupt() {
+////////// Serial console commands //////////
 
-    if (digitalRead(SWITCH_PIN_1)) {
-      tftSet(HIGH);
-    }
-    else {
-      if (gameStatus != STARTED) {
-        tftSet(LOW);
-      }
-    }
+void consoleState(const char* args) {
+  static const char* stageNames[] = {"check fw","wait fw","check cfg","wait cfg","done"};
+  dPrintf(F("League: %s, team: %s (%d)\n"),getLeagueName(currentLeague),
+          getTeamAbbreviation(selectedTeam[currentLeague],currentLeague),selectedTeam[currentLeague]);
+  dPrintf(F("Game status: %s, updates: %s, time valid: %s\n"),gameStatusName(gameStatus),stageNames[updateStage],
+          timeIsValid ? "yes" : "no");
+  dPrintf(F("Ticker: %s, watched on screen: %d, watched live: %s, watching %d\n"),tickerMode ? "on" : "off",
+          watchShown,watchLive ? "yes" : "no",watchCount);
+  dPrintf(F("Pending screen: %d, snapshot shown: %s, animating: %s\n"),pendingScreen,showingSnapshot ? "yes" : "no",
+          animActive() ? "yes" : "no");
+  dPrintf(F("Uptime: %llu ms, idle: %llu ms\n"),clockMillis(),schedulerIdleMs());
 }
 
-void cfgUpdate_onStart() {
-  dPrintln(F("CFG update started"));
-  tftMessage(F("CFG update started"));
+void consoleGames(const char* args) {
+  dPrintf(F("Next game:"));
+  printNextGame(nextGameData);
+  dPrintf(F("Current game:"));
+  printCurrentGame(currentGameData);
+  for (uint8_t i = 0; i < watchCount; i++) {
+    WatchEntry& entry = watchlist[i];
+    dPrintf(F("Watched %s %s: game %d, %s\n"),getLeagueName(entry.league),getTeamAbbreviation(entry.teamID,entry.league),
+            entry.nextGame.gameID,entry.live ? "live" : "not live");
+  }
 }
 
-void cfgUpdate_onEnd() {
-  dPrintln(F("Data files download complete"));
-  tftMessage(F("Downloading data\n\nprogress: complete\n\nrestarting..."));
-  delay(1000);
-  ESP.restart();
+void consolePoll(const char* args) {
+  if (!timeIsValid || (updateStage != UPDATES_DONE)) {
+    dPrintf(F("Still starting up, not polling\n"));
+    return;
+  }
+  dPrintf(F("Polling now\n"));
+  taskWakeNow(pollTask);
+  if (tickerMode) {
+    tickerNextFetch = 0;
+    taskWakeNow(tickerTask);
+  }
+  for (uint8_t i = 0; i < watchCount; i++) {
+    watchlist[i].nextPoll = 0;
+  }
+  taskWakeNow(watchTask);
 }
 
-void cfgUpdate_onProgress(int cur, int total) {
-  dPrintf(F("Data update progress %d of %d bytes\n"),cur,total);
-  tftMessage(F("Downloading data\n\nprogress: %d%%"),(cur*100)/total);
+void consoleProfile(const char* args) {
+  schedulerPrintStats();
+  animPrintStats();
+  tlsPrintStats();
+  upstreamPrintStats();
+  deadlinePrintStats();
+  dnsPrintStats();
+  logPrintStats();
+  statusPrintStats();
+  peerPrintStatus();
+  requestReport();
+  powerReport();
+  if (scoreLatencyCount > 0) {
+    dPrintf(F("Score events: %d, response to first frame avg %d ms max %d ms\n"),scoreLatencyCount,
+            (uint32_t)(scoreLatencyTotalMs / scoreLatencyCount),scoreLatencyMaxMs);
+  }
 }
 
-void cfgUpdate_onError(int err) {
-  dPrintf(F("Data update fatal error code: %d\n"),err);
+void consolePeers(const char* args) {
+  if (strcmp(args,"on") == 0) {
+    peerEnable(true);
+  }
+  else if (strcmp(args,"off") == 0) {
+    peerEnable(false);
+  }
+  peerPrintStatus();
 }
 
-void performCFGUpdate(const uint32_t version) {
-
-  WiFiClientSecure wificlient;
-  wificlient.setInsecure();
-
-  String queryString = FW_URL;
-  queryString += PROJECT_NAME;
-  queryString += CFG_PREFIX;
-  queryString += version;
-  queryString += CFG_EXT;
+// sim <path>: the poll state machine through a scripted day on virtual time (Simulation.h)
+void consoleSimulate(const char* args) {
+  if (!timeIsValid || (updateStage != UPDATES_DONE) || simActive()) {
+    dPrintf(F("Can't start a simulation now\n"));
+    return;
+  }
+  if (!simLoad(args)) {
+    return;
+  }
+  if (tickerMode) {
+    setTickerMode(false);
+  }
+  simPeersWere = peerEnabled();
+  peerEnable(false);
+  simStart(currentLeague);
 
-  dPrintf(F("Data Image to install: %s\n"),queryString.c_str());
-  dPrint(F("\nDownloading... DON'T TURN OFF!\n"));
-  tftMessage(F("Downloading...\nDON'T TURN OFF!"));
+  gameStatus = NEW_TEAM;
+  nextGameData = NextGameData();
+  currentGameData = CurrentGameData();
+  afterGameDismissed = false;
+  taskWakeNow(pollTask);
+  taskWakeIn(simTask,simRemainingMs());
+}
 
-  ESPhttpUpdate.onStart(cfgUpdate_onStart);
-  ESPhttpUpdate.onEnd(cfgUpdate_onEnd);
-  ESPhttpUpdate.onProgress(cfgUpdate_onProgress);
-  ESPhttpUpdate.onError(cfgUpdate_onError);
+// interval [game|ticker|watch <seconds>]
+void consoleInterval(const char* args) {
+  char name[8];
+  uint32_t seconds = 0;
+  if (sscanf(args,"%7s %u",name,&seconds) == 2) {
+    if (seconds == 0) {
+      dPrintf(F("Interval has to be at least 1 second\n"));
+    }
+    else if (strcmp(name,"game") == 0) {
+      gameUpdateInterval = seconds;
+    }
+    else if (strcmp(name,"ticker") == 0) {
+      tickerIdlePollMs = seconds * 1000;
+    }
+    else if (strcmp(name,"watch") == 0) {
+      watchSlowPollMs = seconds * 1000;
+    }
+    else {
+      dPrintf(F("Unknown interval: %s\n"),name);
+    }
+  }
+  dPrintf(F("Intervals (s): game %d, ticker idle %d, watch slow %d. Used from the next poll\n"),gameUpdateInterval,
+          tickerIdlePollMs / 1000,watchSlowPollMs / 1000);
+}
 
-  t_httpUpdate_return ret = ESPhttpUpdate.updateFS(wificlient,queryString);
-  switch(ret) {
-    case HTTP_UPDATE_FAILED:
-      dPrintf(F("HTTP_UPDATE_FAILED Error (%d): %s\n"), ESPhttpUpdate.getLastError(), ESPhttpUpdate.getLastErrorString().c_str());
-      break;
-    case HTTP_UPDATE_NO_UPDATES:
-      dPrint(F("HTTP_UPDATE_NO_UPDATES\n"));
-      break;
-    case HTTP_UPDATE_OK:
-      dPrintf(F("HTTP Update OK"));
+void consoleDeadline(const char* args) {
+  char name[8];
+  uint32_t connectMs, firstByteMs, totalMs;
+  if (sscanf(args,"%7s %u %u %u",name,&connectMs,&firstByteMs,&totalMs) == 4) {
+    int8_t endpoint = endpointFind(name);
+    if (endpoint < 0) {
+      dPrintf(F("Unknown endpoint: %s\n"),name);
+    }
+    else if ((connectMs == 0) || (firstByteMs == 0) || (totalMs < firstByteMs)
+             || (max(connectMs,totalMs) > ((endpoint == ENDPOINT_NEXT_GAME) ? 0xFFFF : DEADLINE_MAX_MS))) {
+      dPrintf(F("Deadlines have to be 1 to %d ms (next: 65535), total at least first byte\n"),DEADLINE_MAX_MS);
+    }
+    else {
+      endpointDeadlines[endpoint] = {(uint16_t)connectMs,(uint16_t)firstByteMs,(uint16_t)totalMs};
+    }
+  }
+  for (uint8_t i = 0; i < ENDPOINT_COUNT; i++) {
+    dPrintf(F("Deadlines (ms) %s: connect %d, first byte %d, total %d\n"),endpointName((Endpoint)i),
+            endpointDeadlines[i].connectMs,endpointDeadlines[i].firstByteMs,endpointDeadlines[i].totalMs);
   }
-  
 }
 
-uint32_t getFSVer() {
-  File file = LittleFS.open(CFG_VERSION_FILENAME,"r");
-  uint32_t result = 0;
+// replay <league> <gameID> <path>: a saved current game response through the
+// parser, compared with the live game. Nothing on screen or in the game state changes
+void consoleReplay(const char* args) {
+  char leagueName[8];
+  char path[48];
+  uint32_t gameID = 0;
+  if (sscanf(args,"%7s %u %47s",leagueName,&gameID,path) != 3) {
+    dPrintf(F("Usage: replay <league> <gameID> <path>\n"));
+    return;
+  }
 
-  if (!file) {
-    dPrint(F("CFG Version read error\n"));
+  uint8_t league = NUM_LEAGUES;
+  for (uint8_t i = 0; i < NUM_LEAGUES; i++) {
+    if (strcasecmp(leagueName,getLeagueName(i)) == 0) {
+      league = i;
+    }
   }
-  else {
-    result = file.parseInt();
+  fs::File file = LittleFS.open(path,"r");
+  if ((league == NUM_LEAGUES) || !file) {
+    dPrintf(F("Can't replay %s %s\n"),leagueName,path);
+    return;
   }
 
+  Leagues::dispatch(league,[&](auto provider) {
+    typedef decltype(provider) League;
+    StaticJsonDocument<League::FILTER_DOC_SIZE> filter;
+    CurrentGameData gameData;
+    bool isGameOver = false;
+    League::currentGameFilter(filter);
+    uint64_t start = clockMicros();
+    if (parseCurrentGame<League>(file,filter,gameID,gameData,isGameOver)) {
+      dPrintf(F("Replay parsed in %d us, game over: %s\n"),(uint32_t)(clockMicros() - start),isGameOver ? "yes" : "no");
+      uint8_t events = detectGameEvents(currentGameData,gameData);
+      if (events) {
+        printGameEvents(events,currentGameData,gameData);
+      }
+    }
+  });
   file.close();
-  return result;
-
 }
 
-uint32_t checkForCFGUpdate() {
+// bench [name prefix]: the microbenchmarks, one BENCH line per case (Bench.h)
+void consoleBench(const char* args) {
+  if (simActive()) {
+    dPrintf(F("Not while a simulation runs\n"));
+    return;
+  }
+  benchRun(args);
+  if (tickerMode) {
+    tickerRedraw = true;
+    requestRender(SCREEN_TICKER);
+  }
+  else if (watchShown >= 0) {
+    pendingScreen = SCREEN_WATCHED_GAME;
+    taskWakeNow(renderTask);
+  }
+  else {
+    requestRender(((gameStatus == STARTED) || (gameStatus == AFTER_GAME)) ? SCREEN_CURRENT_GAME : SCREEN_NEXT_GAME);
+  }
+}
 
-  String queryString;
-  WiFiClientSecure wificlient;
-  wificlient.setInsecure();
-  HTTPClient httpClient;
-  uint32_t currentVersion = 0;
-  
-  currentVersion = getFSVer();
+void addConsoleCommands() {
+  consoleAdd("state","league, team, game status and what is on screen",consoleState);
+  consoleAdd("games","next, current and watched games",consoleGames);
+  consoleAdd("poll","query everything now",consolePoll);
+  consoleAdd("prof","task, animation, TLS, upstream, deadline, DNS, log, request and power tables",consoleProfile);
+  consoleAdd("interval","[game|ticker|watch <s>] show or set poll intervals",consoleInterval);
+  consoleAdd("deadline","[next|game|board <connect> <first byte> <total>] show or set request deadlines in ms",consoleDeadline);
+  consoleAdd("peers","[on|off] LAN score sharing",consolePeers);
+  consoleAdd("sim","<path> run a scripted game day on virtual time",consoleSimulate);
+  consoleAdd("replay","<league> <gameID> <path> parse a saved response",consoleReplay);
+  consoleAdd("bench","[name prefix] run the microbenchmarks",consoleBench);
+}
 
-  queryString = FW_URL;
-  queryString += PROJECT_NAME;
-  queryString += CFG_VERSION_FILENAME;
+////////// Benchmarks (Bench.h) //////////
 
-  dPrint(F("Query Type: CFG files Check\n"));
-  dPrintf(F("Query URL: %s\n"),queryString.c_str());
+// fixtures are /bench/<league>_game.json, a current game response with some noise
+template <typename League>
+bool benchLoadGame(String& text, const char*& json) {
+  char path[24];
+  snprintf(path,sizeof(path),"/bench/%s_game.json",League::INFO.name);
+  if (!benchLoad(path,text)) {
+    return false;
+  }
+  json = text.c_str();
+  if (League::CURRENT_GAME_SEEK) {
+    json = strstr(json,League::CURRENT_GAME_SEEK);
+    json = json ? json + strlen(League::CURRENT_GAME_SEEK) : nullptr;
+  }
+  return json != nullptr;
+}
 
-  httpClient.begin(wificlient, queryString);
+template <typename League>
+bool benchParse(const uint16_t iterations) {
+  String text;
+  const char* json;
+  StaticJsonDocument<League::FILTER_DOC_SIZE> filter;
+  DynamicJsonDocument doc(League::CURRENT_GAME_DOC_SIZE);
+  if (!benchLoadGame<League>(text,json) || (doc.capacity() == 0)) {
+    return false;
+  }
+  League::currentGameFilter(filter);
+  bool ok = true;
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    ok &= !deserializeJson(doc,json,DeserializationOption::Filter(filter),DeserializationOption::NestingLimit(League::CURRENT_GAME_NESTING));
+  }
+  benchStop();
+  return ok;
+}
 
-  int httpCode = httpClient.GET();
-  uint32_t availableVersion = 0;
-  if (httpCode == 200) {
-    availableVersion = httpClient.getString().toInt();
-    dPrintf(F("Data files Version Current:  %d\n"),currentVersion);
-    dPrintf(F("Data files Version Available: %d\n"),availableVersion);
-    dPrintf(F("New data files available?:  %s\n"), (availableVersion > currentVersion) ? "Yes" : "No");
+template <typename League>
+bool benchExtract(const uint16_t iterations) {
+  String text;
+  const char* json;
+  StaticJsonDocument<League::FILTER_DOC_SIZE> filter;
+  DynamicJsonDocument doc(League::CURRENT_GAME_DOC_SIZE);
+  if (!benchLoadGame<League>(text,json) || (doc.capacity() == 0)) {
+    return false;
   }
-   else {
-    dPrintf(F("CFG HTTP Error: %d\n"),httpCode);
+  League::currentGameFilter(filter);
+  if (deserializeJson(doc,json,DeserializationOption::Filter(filter),DeserializationOption::NestingLimit(League::CURRENT_GAME_NESTING))) {
+    return false;
   }
-  httpClient.end();
+  CurrentGameData gameData;
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    League::extractCurrentGame(gameData,1,doc);
+  }
+  benchStop();
+  return true;
+}
 
-  return (availableVersion > currentVersion) ? availableVersion : 0;
-  
+bool benchNextGameNBA(const uint16_t iterations) {
+  String text;
+  DynamicJsonDocument doc(2048);
+  if (!benchLoad("/bench/NBA_next.json",text) || deserializeJson(doc,text)) {
+    return false;
+  }
+  NextGameData nextGame;
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    extractNextGame_NBA(nextGame,doc);
+  }
+  benchStop();
+  return true;
 }
 
-void fwUpdate_onStart() {
-  dPrintln(F("FW update started"));
-  tftMessage(F("FW update started"));
+// the first game of the saved MLB schedule
+bool benchNextGameStatsApi(const uint16_t iterations) {
+  String text;
+  DynamicJsonDocument doc(4096);
+  if (!benchLoad("/dh.json",text)) {
+    return false;
+  }
+  const char* json = strstr(text.c_str(),"\"games\":[");
+  if (!json || deserializeJson(doc,json + 9)) {
+    return false;
+  }
+  JsonObject game = doc.as<JsonObject>();
+  NextGameData nextGame;
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    extractNextGame_StatsApi(MLB_STATSAPI,nextGame,game);
+  }
+  benchStop();
+  return true;
 }
 
-void fwUpdate_onEnd() {
-  dPrintln(F("FW download complete"));
-  tftMessage(F("Downloading firmware\n\nprogress: complete\n\nrestarting..."));
-  delay(1000);
-  ESP.restart();
+bool benchParseDateTime(const uint16_t iterations) {
+  String timeStr("2021-04-17T00:10:00Z");
+  time_t total = 0;
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    total += parseDateTime(timeStr);
+  }
+  benchStop();
+  return total != 0;
 }
 
-void fwUpdate_onProgress(int cur, int total) {
-  dPrintf(F("FW update progress %d of %d bytes\n"),cur,total);
-  tftMessage(F("Downloading firmware\n\nprogress: %d%%"),(cur*100)/total);
+bool benchGameChanged(const uint16_t iterations) {
+  CurrentGameData prev;
+  CurrentGameData curr;
+  prev.league = curr.league = MLB;
+  memset(prev.bases,0,sizeof(prev.bases));
+  memset(curr.bases,0,sizeof(curr.bases));
+  setGDStrings(prev,"6th","Top");
+  setGDStrings(curr,"6th","Top");
+  uint16_t changed = 0;
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    curr.bases[2] = i & 1;    // the last field compared
+    changed += gameStatsChanged(prev,curr);
+  }
+  benchStop();
+  return changed > 0;
 }
 
-void fwUpdate_onError(int err) {
-  dPrintf(F("FW update fatal error code: %d\n"),err);
+bool benchCopyGame(const uint16_t iterations) {
+  CurrentGameData source;
+  CurrentGameData dest;
+  setGDStrings(source,"2nd","08:41");
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    source.homeScore = i;
+    copyGameData(dest,source);
+  }
+  benchStop();
+  return dest.homeScore == source.homeScore;
 }
 
-void performFWUpdate(const uint32_t version) {
+bool benchScoreLayout(const uint16_t iterations) {
+  int16_t awayPosition, homePosition, fontNum;
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    calculateScoreXPosition(i % 25,(i / 25) % 25,awayPosition,homePosition,fontNum);
+  }
+  benchStop();
+  return true;
+}
 
-    WiFiClientSecure wificlient;
-    wificlient.setInsecure();
+bool benchTeamName(const uint16_t iterations) {
+  const LeagueInfo* info = Leagues::info(MLB);
+  if (!info) {
+    return false;
+  }
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    getTeamAbbreviation(info->teams[i % info->numTeams].id,MLB);
+  }
+  benchStop();
+  return true;
+}
 
-    String queryString = FW_URL;
-    queryString += PROJECT_NAME;
-    queryString += FW_PREFIX;
-    queryString += version;
-    queryString += FW_EXT;
+// a team logo straight to the screen, which is drawn again after the run
+bool benchDrawIcon(const uint16_t iterations) {
+  bool ok = true;
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    ok &= drawBmp(&tft,"/icons/NHL/TOR.bmp",TFT_HALF_WIDTH-25,TFT_HALF_HEIGHT-25);
+  }
+  benchStop();
+  return ok;
+}
 
-    dPrintf(F("FW Image to install: %s\n"),queryString.c_str());
-    dPrint(F("\nDownloading... DON'T TURN OFF!\n"));
-    tftMessage(F("Downloading...\nDON'T TURN OFF!"));
+// the same logo decoded into a sprite: file reads and colour conversion, no SPI
+bool benchDrawIconSprite(const uint16_t iterations) {
+  TFT_eSprite sprite(&tft);
+  if (sprite.createSprite(50,50) == nullptr) {
+    return false;
+  }
+  bool ok = true;
+  benchStart();
+  for (uint16_t i = 0; i < iterations; i++) {
+    ok &= drawBmp(&sprite,"/icons/NHL/TOR.bmp",0,0);
+  }
+  benchStop();
+  sprite.deleteSprite();
+  return ok;
+}
 
-    ESPhttpUpdate.onStart(fwUpdate_onStart);
-    ESPhttpUpdate.onEnd(fwUpdate_onEnd);
-    ESPhttpUpdate.onProgress(fwUpdate_onProgress);
-    ESPhttpUpdate.onError(fwUpdate_onError);
- 
-    t_httpUpdate_return ret = ESPhttpUpdate.update(wificlient,queryString);
-    switch(ret) {
-      case HTTP_UPDATE_FAILED:
-        dPrintf(F("HTTP_UPDATE_FAILED Error (%d): %s\n"), ESPhttpUpdate.getLastError(), ESPhttpUpdate.getLastErrorString().c_str());
-        break;
-      case HTTP_UPDATE_NO_UPDATES:
-        dPrint(F("HTTP_UPDATE_NO_UPDATES\n"));
-        break;
-      case HTTP_UPDATE_OK:
-        dPrintf(F("HTTP Update OK"));
-    }
-    
+void addBenchCases() {
+  benchAdd("nhl.parse",benchParse<NHLProvider>,100);
+  benchAdd("nhl.extract",benchExtract<NHLProvider>,500);
+  benchAdd("mlb.parse",benchParse<MLBProvider>,100);
+  benchAdd("mlb.extract",benchExtract<MLBProvider>,500);
+  benchAdd("nba.parse",benchParse<NBAProvider>,100);
+  benchAdd("nba.extract",benchExtract<NBAProvider>,500);
+  benchAdd("nba.next",benchNextGameNBA,500);
+  benchAdd("statsapi.next",benchNextGameStatsApi,500);
+  benchAdd("parseDateTime",benchParseDateTime,1000);
+  benchAdd("gameStatsChanged",benchGameChanged,5000);
+  benchAdd("copyGameData",benchCopyGame,5000);
+  benchAdd("scoreLayout",benchScoreLayout,2000);
+  benchAdd("teamName",benchTeamName,2000);
+  benchAdd("bmp.draw",benchDrawIcon,10);
+  benchAdd("bmp.sprite",benchDrawIconSprite,10);
 }
 
-uint32_t checkForFWUpdate() {
+////////// LAN status pages //////////
 
-  // Github forces https which causes issue with redirect for httpClient
-  // easiest way around is to just use setInsecure
-  // 
+void writeTeam(Print& out, const char* name, const uint16_t teamID, const uint8_t league) {
+  out.printf_P(PSTR("\"%s\":{\"id\":%d,\"abbr\":\"%s\""),name,teamID,getTeamAbbreviation(teamID,league));
+}
 
-  HTTPClient httpClient;
-  WiFiClientSecure wificlient;
-  wificlient.setInsecure();
-  if (!wificlient.connect(FW_HOST,443)) {
-    dPrint(F("FW check failed!"));
-    wificlient.stop();
-    return 0;
-  }
-  
-  String queryString = FW_URL;
-  queryString += PROJECT_NAME;
-  queryString += FW_VERSION_FILENAME;
-  dPrint(F("Query Type: Fireware Check\n"));
-  dPrintf(F("Query URL: %s\n"),queryString.c_str());
+// /game: selection, next and current game, watchlist
+void writeGameStatus(Print& out) {
 
-  httpClient.begin(wificlient, queryString);
+  out.printf_P(PSTR("{\"league\":\"%s\","),getLeagueName(currentLeague));
+  writeTeam(out,"team",selectedTeam[currentLeague],currentLeague);
+  out.printf_P(PSTR("},\"status\":\"%s\",\"ticker\":%s,"),gameStatusName(gameStatus),tickerMode ? "true" : "false");
 
-  int httpCode = httpClient.GET();
-  uint32_t availableVersion = 0;
-  if (httpCode == 200) {
-    availableVersion = httpClient.getString().toInt();
-    dPrintf(F("FW Version Current:   %d\n"),CURRENT_FW_VERSION);
-    dPrintf(F("FW Version Available: %d\n"),availableVersion);
-    dPrintf(F("FW Update Available:  %s\n"), (availableVersion > CURRENT_FW_VERSION) ? "Yes" : "No");
-  }
-  else {
-    dPrintf(F("FW HTTP Error: %d\n"),httpCode);
+  out.printf_P(PSTR("\"next\":{\"gameID\":%u,\"league\":\"%s\",\"start\":%ld,\"playoffs\":%s,"),nextGameData.gameID,
+               getLeagueName(nextGameData.league),(long)nextGameData.startTime,nextGameData.isPlayoffs ? "true" : "false");
+  writeTeam(out,"away",nextGameData.awayID,nextGameData.league);
+  out.printf_P(PSTR(",\"record\":\"%s\"},"),nextGameData.awayRecord);
+  writeTeam(out,"home",nextGameData.homeID,nextGameData.league);
+  out.printf_P(PSTR(",\"record\":\"%s\"}},"),nextGameData.homeRecord);
+
+  const CurrentGameData& game = currentGameData;
+  out.printf_P(PSTR("\"current\":{\"gameID\":%u,\"league\":\"%s\",\"division\":\"%s\",\"clock\":\"%s\","),game.gameID,
+               getLeagueName(game.league),game.devision,game.timeRemaining);
+  if (game.league == MLB) {
+    out.printf_P(PSTR("\"outs\":%d,\"bases\":[%d,%d,%d],"),game.outs,game.bases[0],game.bases[1],game.bases[2]);
   }
-  httpClient.end();
+  writeTeam(out,"away",game.awayID,game.league);
+  out.printf_P(PSTR(",\"score\":%d},"),game.awayScore);
+  writeTeam(out,"home",game.homeID,game.league);
+  out.printf_P(PSTR(",\"score\":%d}},\"watch\":["),game.homeScore);
 
-  return (availableVersion > CURRENT_FW_VERSION) ? availableVersion : 0;
+  for (uint8_t i = 0; i < watchCount; i++) {
+    const WatchEntry& entry = watchlist[i];
+    out.printf_P(PSTR("%s{\"league\":\"%s\","),(i > 0) ? "," : "",getLeagueName(entry.league));
+    writeTeam(out,"team",entry.teamID,entry.league);
+    out.printf_P(PSTR("},\"live\":%s"),entry.live ? "true" : "false");
+    if (entry.live) {
+      out.printf_P(PSTR(",\"awayScore\":%d,\"homeScore\":%d"),entry.currentGame.awayScore,entry.currentGame.homeScore);
+    }
+    out.print('}');
+  }
+  out.print(F("]}"));
 
 }
 
-void checkForUpdates() {
-  
-  tftMessage(F("Checking for updates..."));
-  uint32_t ver = checkForFWUpdate();
-  if (ver) {
-    tftMessage(F("FW update available\n\n\nPress button to continue"));
-    while (!debouncer.rose()) {
-      debouncer.update();
-      yield();
-    }
-    performFWUpdate(ver);
-  }
-  ver = checkForCFGUpdate();
-  if (ver) {
-    tftMessage(F("New data files available\n\n\nPress buttton to continue"));
-    while (!debouncer.rose()) {
-      debouncer.update();
-      yield();
-    }
-    performCFGUpdate(ver);
+// /perf: counters, always fresh
+void writePerfStatus(Print& out) {
+
+  const AnimStats& anim = animStats();
+  const StatusStats& status = statusStats();
+
+  out.printf_P(PSTR("{\"uptimeMs\":%llu,\"idleMs\":%llu,\"heap\":{\"free\":%u,\"frag\":%u,\"maxBlock\":%u},"),
+               clockMillis(),schedulerIdleMs(),ESP.getFreeHeap(),ESP.getHeapFragmentation(),ESP.getMaxFreeBlockSize());
+  out.printf_P(PSTR("\"requests\":{\"lastHour\":%u,\"budget\":%u},"),requestsLastHour(),REQUEST_BUDGET_PER_HOUR);
+  out.printf_P(PSTR("\"anim\":{\"frames\":%u,\"skipped\":%u,\"maxRenderUs\":%u},"),anim.frames,anim.skipped,anim.maxRenderUs);
+  out.printf_P(PSTR("\"status\":{\"requests\":%u,\"notModified\":%u,\"maxUs\":%u},"),status.requests,status.notModified,
+               status.maxUs);
+  out.printf_P(PSTR("\"scoreLatency\":{\"count\":%u,\"maxMs\":%u},\"tasks\":["),scoreLatencyCount,scoreLatencyMaxMs);
+
+  const Task* task;
+  for (uint8_t i = 0; (task = taskInfo(i)) != nullptr; i++) {
+    out.printf_P(PSTR("%s{\"name\":\"%s\",\"runs\":%u,\"avgUs\":%u,\"maxUs\":%u,\"maxLateMs\":%u}"),(i > 0) ? "," : "",
+                 task->name,task->runCount,task->runCount ? (uint32_t)(task->totalRunUs / task->runCount) : 0,task->maxRunUs,
+                 task->maxLateMs);
   }
+  out.print(F("]}"));
+
 }
 
 void setup() {
@@ -2210,106 +2570,78 @@ void setup() {
   dPrintf(F("Firmware Version: %d\n"),CURRENT_FW_VERSION);
   uint32_t fsVer = getFSVer();
   dPrintf(F("Filesystem Version: %d\n"),fsVer);
-  tftMessage(F("TFT Sports Scoreboard\n\nFW Ver: %d\nFS Ver: %d\n\nConnecting to WiFi..."),CURRENT_FW_VERSION,fsVer);
 
   pinMode(SWITCH_PIN_1,INPUT_PULLUP);
   attachInterrupt(digitalPinToInterrupt(SWITCH_PIN_1),ledSwitchInterrupt,CHANGE);
   
   pinMode(TFT_BACKLIGHT_PIN,OUTPUT);
-  tftSet(1);
+
+  // tasks added first win deadline ties. Before the first frame, the
+  // animated fields of a resumed game or snapshot need the anim task
+  inputTask = taskAdd("input",inputTaskRun);
+  renderTask = taskAdd("render",renderTaskRun);
+  pollTask = taskAdd("poll",pollTaskRun);
+  timeTask = taskAdd("ntp",timeTaskRun);
+  updateTask = taskAdd("update",updateTaskRun);
+  wifiTask = taskAdd("wifi",wifiTaskRun);
+  tickerTask = taskAdd("ticker",tickerTaskRun);
+  watchTask = taskAdd("watch",watchTaskRun);
+  animTask = taskAdd("anim",animRun);
+  animBegin(&tft,animTask);
+  consoleTask = taskAdd("console",consoleRun);
+  consoleBegin(consoleTask);
+  addConsoleCommands();
+  addBenchCases();
+  statusTask = taskAdd("status",statusRun);
+  statusBegin(statusTask);
+  statusAdd("/game",writeGameStatus,true);
+  statusAdd("/perf",writePerfStatus,false);
+  peerTask = taskAdd("peer",peerRun);
+  peerBegin(peerTask,peerGameReceived);
+  simTask = taskAdd("sim",simTaskRun);
+  dnsTask = taskAdd("dns",dnsRun);
+  dnsBegin(dnsTask);
+  logTask = taskAdd("log",logRun);
+  logBegin(logTask);
+
+  if (resumeGame()) {
+    resumedGame = true;
+    showingSnapshot = true;
+    loadTeams();
+    dPrintf(F("Boot to first frame (resumed game): %llu ms\n"),clockMillis());
+  }
+  else if (showSnapshot()) {
+    showingSnapshot = true;
+    dPrintf(F("Boot to first frame (snapshot): %llu ms\n"),clockMillis());
+  }
+  else {
+    tftMessage(F("TFT Sports Scoreboard\n\nFW Ver: %d\nFS Ver: %d\n\nConnecting to WiFi..."),CURRENT_FW_VERSION,fsVer);
+    tftSet(1);
+    dPrintf(F("Boot to first frame: %llu ms\n"),clockMillis());
+  }
 
   debouncer.attach(SELECT_BUTTON_PIN,INPUT_PULLUP);
   debouncer.interval(DEBOUNCE_INTERVAL);
 
  // wifiManager.resetSettings();
   wifiManager.setAPCallback(wifiConfigCallback);
-  wifiConnect();
-
-  tftMessage(F("Fetching time..."));
-  updateTime();
-
-  checkForUpdates();
-
-  // load the list of NHL teams
-  teamListInit();
+  powerBegin(SELECT_BUTTON_PIN,SWITCH_PIN_1,TFT_BACKLIGHT_PIN,powerWake);
 
-  // GUI selection of favourite team if button is being pressed
-  debouncer.update();
+  setInterrupt(true);
 
-  if (!loadTeams() || (debouncer.read() == LOW)) {
-      selectTeam();
-  }
-  else {
-    setInterrupt(true);
+  // network, time and update checks all happen in the background from here
+  taskWakeNow(wifiTask);
+  if (resumedGame) {
+    taskWakeNow(pollTask);    // waits for WiFi on its own
   }
 
 }
 
 void loop() {
-
-  static time_t waitUntil = 0;
-  static uint32_t gameFinishedTime = 0;
-
-  //dPrintf(F("ESP Free Heap: %d Frag: %d%% Max Block: %d\n"),ESP.getFreeHeap(),ESP.getHeapFragmentation(),ESP.getMaxFreeBlockSize());
-
-  if (gameStatus == NEW_TEAM) {
-    tftMessage(F("Fetching next game..."));
-    getNextGame();
-      if (nextGameData.gameID == 0) {
-        gameStatus = NO_GAMES;
-      }
-      else {
-        gameStatus = SCHEDULED;
-      }
-    displayNextGame(nextGameData);
-  }
-  else if (gameStatus == NO_GAMES) {
-    sleepForever();
-  }
-  else if (gameStatus == STARTED) {
-    if ((currentLeague == NHL) && (getAndDisplayCurrentNHLGame(nextGameData.gameID,currentGameData))) {
-      gameStatus = FINISHED;
-      gameFinishedTime = millis();
-    }
-    else if ((currentLeague == MLB) && (getAndDisplayCurrentMLBGame(nextGameData.gameID,currentGameData))) {
-       gameStatus = FINISHED;
-       gameFinishedTime = millis();
-    }
-    else if ((currentLeague == NBA) && (getAndDisplayCurrentNBAGame(nextGameData.gameID,currentGameData))) {
-      gameStatus = FINISHED;
-      gameFinishedTime = millis();
-    }
-    else {
-        sleep(GAME_UPDATE_INTERVAL);
-    }
-  }
-  else if (gameStatus == AFTER_GAME) {
-    debouncer.update();
-    if (debouncer.rose() || (currentTime() > nextGameData.startTime) || ((millis() - gameFinishedTime) > AFTER_GAME_RESULTS_DURATION_MS))   {
-      displayNextGame(nextGameData);
-      if (nextGameData.gameID == 0) {
-        gameStatus = NO_GAMES;
-      }
-      else {
-        gameStatus = SCHEDULED;
-      }
-      //ledSwitchInterrupt();
-    }
-  }
-  else if (currentTime() > nextGameData.startTime) {
-    if (gameStatus == FINISHED) {
-      getNextGame();
-      gameStatus = AFTER_GAME;
-    }
-    else {
-      gameStatus = STARTED;
-    }
-  }
-  else if (nextGameData.startTime > currentTime()) {
-    sleep((uint32_t)(nextGameData.startTime - currentTime()));
-  }
-
-  updateTime();
-  yield();
-
+  consoleCheck();
+  statusCheck();
+  peerCheck();
+  dnsCheck();
+  logCheck();
+  schedulerRun();
 }
@@ -0,0 +1,75 @@
+#ifndef NATIVE_ARDUINO_STUB
+#define NATIVE_ARDUINO_STUB
+
+// Just enough of Arduino.h for the modules the [env:native] tests build.
+// The tests define the core functions themselves, to control the time
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+#define IRAM_ATTR
+#define PROGMEM
+#define PSTR(s) (s)
+typedef const char* PGM_P;
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper*)(s))
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+
+template <typename A, typename B>
+inline auto min(const A& a, const B& b) -> decltype(a < b ? a : b) { return (a < b) ? a : b; }
+
+template <typename A, typename B>
+inline auto max(const A& a, const B& b) -> decltype(a > b ? a : b) { return (a > b) ? a : b; }
+
+uint64_t micros64();
+uint32_t millis();
+uint32_t micros();
+
+// interrupt level, the tests run at 0 (no ISR)
+inline uint32_t xt_rsil(const int level) { return 0; }
+inline void xt_wsr_ps(const uint32_t state) {}
+
+// the parts of the core's String the shared code uses
+class String {
+  public:
+    String(const char* text = "") : s(text) {}
+    String(const std::string& text) : s(text) {}
+    unsigned int length() const { return s.length(); }
+    const char* c_str() const { return s.c_str(); }
+    bool reserve(const unsigned int size) { s.reserve(size); return true; }
+    long toInt() const { return atol(s.c_str()); }
+    char operator[](const unsigned int i) const { return (i < s.length()) ? s[i] : '\0'; }
+    String substring(const unsigned int from, const unsigned int to) const {
+      return (from < s.length()) ? String(s.substr(from,to - from)) : String();
+    }
+  private:
+    std::string s;
+};
+
+class Print {
+  public:
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+      size_t n = 0;
+      while (size--) { n += write(*buffer++); }
+      return n;
+    }
+    virtual void flush() {}
+};
+
+// the UART. Tests that log define it, with their own timing
+class HardwareSerial : public Print {
+  public:
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int availableForWrite();
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef NATIVE_LITTLEFS_STUB
+#define NATIVE_LITTLEFS_STUB
+
+// LittleFS read from the data directory, which is what the file system
+// image is built from. pio test runs from the project directory
+
+#include "Arduino.h"
+
+#ifndef NATIVE_FS_ROOT
+#define NATIVE_FS_ROOT "data"
+#endif
+
+namespace fs {
+
+class File {
+  public:
+    File(FILE* file = nullptr) : _file(file) {}
+    explicit operator bool() const { return _file != nullptr; }
+    int available() {
+      int c = fgetc(_file);
+      if (c == EOF) {
+        return 0;
+      }
+      ungetc(c,_file);
+      return 1;
+    }
+    String readStringUntil(const char terminator) {
+      std::string text;
+      int c;
+      while (((c = fgetc(_file)) != EOF) && (c != terminator)) {
+        text += (char)c;
+      }
+      return String(text);
+    }
+    void close() {
+      if (_file) {
+        fclose(_file);
+        _file = nullptr;
+      }
+    }
+  private:
+    FILE* _file;
+};
+
+class FS {
+  public:
+    File open(const char* path, const char* mode) {
+      std::string full = std::string(NATIVE_FS_ROOT) + path;
+      return File(fopen(full.c_str(),mode));
+    }
+};
+
+}
+
+static fs::FS LittleFS;
+
+#endif
@@ -0,0 +1 @@
+#include "Arduino.h"    // pre 1.0 name, still included by the Time library
@@ -0,0 +1,132 @@
+#include <unity.h>
+#include <chrono>
+#include "GameData.h"
+#include "Layout.h"
+
+/*  Host side microbenchmarks of the pure hot paths, the ones that don't need
+    the board: parseDateTime, gameStatsChanged, copyGameData, the score layout
+    and the team name lookup. Each test checks the result first, then times the
+    step the way the "bench" console command does (src/Bench.h): BENCH_RUNS
+    runs of "iterations" steps, one line with the best and mean time per step
+      BENCH,<name>,<iterations>,<best ns per step>,<mean ns per step>
+    Compare a run with tools/bench_baseline_native.csv:
+      pio test -e native -f test_bench -v | tools/bench_compare.py --baseline tools/bench_baseline_native.csv
+    The parse/extract cases and the logo draws need the board and its files,
+    they stay in the console command.
+*/
+
+const uint8_t BENCH_RUNS = 5;
+
+uint64_t micros64() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t millis() {
+  return (uint32_t)(micros64() / 1000);
+}
+
+uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+volatile uint32_t benchSink = 0;     // results the compiler has to keep
+
+template <typename Step>
+void bench(const char* name, const uint32_t iterations, Step step) {
+  uint64_t bestNs = UINT64_MAX;
+  uint64_t totalNs = 0;
+  for (uint8_t run = 0; run < BENCH_RUNS; run++) {
+    uint64_t start = nowNs();
+    for (uint32_t i = 0; i < iterations; i++) {
+      step(i);
+    }
+    uint64_t elapsed = nowNs() - start;
+    bestNs = (elapsed < bestNs) ? elapsed : bestNs;
+    totalNs += elapsed;
+  }
+  printf("BENCH,%s,%u,%u,%u\n",name,iterations,(uint32_t)(bestNs / iterations),
+         (uint32_t)(totalNs / ((uint64_t)iterations * BENCH_RUNS)));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_parse_date_time() {
+  TEST_ASSERT_EQUAL_UINT32(1617476700,parseDateTime("2021-04-03T19:05:00Z"));
+
+  const String times[] = {"2021-04-03T19:05:00Z","2021-10-31T23:30:00Z","2022-01-01T00:00:00Z"};
+  bench("parseDateTime",10000,[&](const uint32_t i) {
+    benchSink += parseDateTime(times[i % 3]);
+  });
+}
+
+void test_game_stats_changed() {
+  CurrentGameData prev;
+  CurrentGameData curr;
+  setGDStrings(prev,"6th","Top");
+  setGDStrings(curr,"6th","Top");
+  TEST_ASSERT_FALSE(gameStatsChanged(prev,curr));
+  curr.bases[2] = true;
+  TEST_ASSERT_TRUE(gameStatsChanged(prev,curr));
+
+  bench("gameStatsChanged",100000,[&](const uint32_t i) {
+    curr.bases[2] = i & 1;    // the last field compared
+    benchSink += gameStatsChanged(prev,curr);
+  });
+}
+
+void test_copy_game_data() {
+  CurrentGameData source;
+  CurrentGameData dest;
+  setGDStrings(source,"2nd","08:41");
+  source.homeScore = 3;
+  copyGameData(dest,source);
+  TEST_ASSERT_FALSE(gameStatsChanged(dest,source));
+
+  bench("copyGameData",100000,[&](const uint32_t i) {
+    source.homeScore = i;
+    copyGameData(dest,source);
+    benchSink += dest.homeScore;
+  });
+}
+
+void test_score_layout() {
+  int16_t awayPosition, homePosition, fontNum;
+  calculateScoreXPosition(1,12,awayPosition,homePosition,fontNum);
+  TEST_ASSERT_EQUAL_INT16(8,awayPosition);
+  TEST_ASSERT_EQUAL_INT16(82,homePosition);
+  TEST_ASSERT_EQUAL_INT16(7,fontNum);
+  calculateScoreXPosition(100,99,awayPosition,homePosition,fontNum);
+  TEST_ASSERT_EQUAL_INT16(4,fontNum);
+
+  bench("scoreLayout",100000,[&](const uint32_t i) {
+    calculateScoreXPosition(i % 25,(i / 25) % 25,awayPosition,homePosition,fontNum);
+    benchSink += awayPosition + homePosition;
+  });
+}
+
+void test_team_name() {
+  // the size of a 30 team league, ids as sparse as the real ones
+  TeamInfo teams[30];
+  for (uint8_t i = 0; i < 30; i++) {
+    teams[i].id = 100 + i * 3;
+    snprintf(teams[i].name,sizeof(teams[i].name),"T%02d",i);
+  }
+  TEST_ASSERT_EQUAL_STRING("T29",findTeamName(teams,30,187));
+  TEST_ASSERT_NULL(findTeamName(teams,30,101));
+
+  bench("teamName",100000,[&](const uint32_t i) {
+    benchSink += findTeamName(teams,30,teams[i % 30].id)[0];
+  });
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_date_time);
+  RUN_TEST(test_game_stats_changed);
+  RUN_TEST(test_copy_game_data);
+  RUN_TEST(test_score_layout);
+  RUN_TEST(test_team_name);
+  return UNITY_END();
+}
@@ -0,0 +1,93 @@
+#include <unity.h>
+#include "Clock.h"
+
+/*  clockMillis() across the point where the core's 32 bit millis() wraps,
+    after 2^32 ms (49.7 days). micros64() is replaced by a counter the tests
+    set, the way the core extends the 32 bit system timer.
+*/
+
+const uint64_t MILLIS_WRAP_MS = 0x100000000ULL;
+
+extern uint64_t clockOffsetUs;
+uint64_t fakeMicros = 0;
+
+uint64_t micros64() {
+  return fakeMicros;
+}
+
+void setTimeMs(const uint64_t ms) {
+  fakeMicros = ms * 1000;
+}
+
+// the core's 32 bit millis(), from the same counter
+uint32_t millis() {
+  return (uint32_t)(fakeMicros / 1000);
+}
+
+void setUp() {
+  fakeMicros = 0;
+  clockOffsetUs = 0;
+}
+
+void tearDown() {}
+
+void test_counts_past_the_wrap() {
+  setTimeMs(MILLIS_WRAP_MS - 10);
+  uint64_t before = clockMillis();
+  setTimeMs(MILLIS_WRAP_MS + 10);
+  uint64_t after = clockMillis();
+
+  TEST_ASSERT_TRUE(millis() < 20);     // millis() has wrapped
+  TEST_ASSERT_TRUE(after > before);
+  TEST_ASSERT_EQUAL_UINT64(20,after - before);
+  TEST_ASSERT_EQUAL_UINT64(MILLIS_WRAP_MS + 10,after);
+}
+
+void test_deadline_across_the_wrap() {
+  setTimeMs(MILLIS_WRAP_MS - 1000);
+  uint64_t deadline = clockMillis() + 5000;     // as taskWakeIn() sets it
+
+  setTimeMs(MILLIS_WRAP_MS + 10);
+  TEST_ASSERT_FALSE(clockMillis() >= deadline);
+  setTimeMs(MILLIS_WRAP_MS + 3999);
+  TEST_ASSERT_FALSE(clockMillis() >= deadline);
+  setTimeMs(MILLIS_WRAP_MS + 4000);
+  TEST_ASSERT_TRUE(clockMillis() >= deadline);
+}
+
+void test_light_sleep_offset_across_the_wrap() {
+  setTimeMs(MILLIS_WRAP_MS - 100000);
+  uint64_t before = clockMillis();
+  clockAdvanceUs(268000000ULL);          // a full light sleep the timer missed
+  setTimeMs(MILLIS_WRAP_MS - 99990);
+
+  TEST_ASSERT_EQUAL_UINT64(before + 268010,clockMillis());
+  TEST_ASSERT_TRUE(clockMillis() > MILLIS_WRAP_MS);
+}
+
+void test_isr_differences_stay_right() {
+  setTimeMs(MILLIS_WRAP_MS - 30);
+  uint32_t pressed = millis();
+  setTimeMs(MILLIS_WRAP_MS + 1470);
+
+  TEST_ASSERT_TRUE(millis() < pressed);
+  TEST_ASSERT_EQUAL_UINT32(1500,millis() - pressed);
+}
+
+void test_second_wrap() {
+  setTimeMs(2 * MILLIS_WRAP_MS - 1);
+  uint64_t before = clockMillis();
+  setTimeMs(2 * MILLIS_WRAP_MS + 1);
+
+  TEST_ASSERT_EQUAL_UINT64(2,clockMillis() - before);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_counts_past_the_wrap);
+  RUN_TEST(test_deadline_across_the_wrap);
+  RUN_TEST(test_light_sleep_offset_across_the_wrap);
+  RUN_TEST(test_isr_differences_stay_right);
+  RUN_TEST(test_second_wrap);
+  return UNITY_END();
+}
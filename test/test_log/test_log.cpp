@@ -0,0 +1,163 @@
+#include <unity.h>
+#include <chrono>
+#include <sys/mman.h>
+#include "LogBuffer.h"
+#include "Debug.h"
+
+/*  Time a poll's worth of logging costs its caller, buffered against a
+    -DLOG_SYNC=1 build:
+      pio test -e native_log
+      pio test -e native_log_sync
+    The UART is modelled: a 128 byte FIFO that sends a character every
+    86.8 us (115200 baud, 10 bits). A write to a full FIFO waits, and the
+    wait is added to micros(), which is otherwise the host clock. So the
+    waits are the board's, the record building is the host's. Each build
+    prints one line
+      LOGTIME,<build>,<records>,<characters>,<caller us>,<max caller us>,<waits>
+    and checks the result that build promises.
+*/
+
+const uint8_t UART_FIFO_SIZE = 128;
+const double UART_US_PER_CHAR = 1e6 * 10 / 115200;
+
+uint8_t logLevel = LOG_VERBOSE;
+uint64_t uartWaitUs = 0;        // time writes spent waiting, added to micros()
+double uartFifoUsed = 0;
+uint64_t uartLastUs = 0;
+std::string uartSent;
+HardwareSerial Serial;
+
+uint64_t hostMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t micros64() {
+  return hostMicros() + uartWaitUs;
+}
+
+uint32_t micros() {
+  return (uint32_t)micros64();
+}
+
+uint32_t millis() {
+  return (uint32_t)(micros64() / 1000);
+}
+
+// the FIFO empties at the baud rate
+void uartDrain() {
+  uint64_t now = micros64();
+  uartFifoUsed -= (now - uartLastUs) / UART_US_PER_CHAR;
+  uartFifoUsed = (uartFifoUsed < 0) ? 0 : uartFifoUsed;
+  uartLastUs = now;
+}
+
+int HardwareSerial::availableForWrite() {
+  uartDrain();
+  return UART_FIFO_SIZE - (int)(uartFifoUsed + 0.999);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  uartDrain();
+  if (uartFifoUsed + 1 > UART_FIFO_SIZE) {
+    double waitUs = (uartFifoUsed + 1 - UART_FIFO_SIZE) * UART_US_PER_CHAR;
+    uartWaitUs += (uint64_t)(waitUs + 0.999);
+    uartDrain();
+  }
+  uartFifoUsed += 1;
+  uartSent += (char)c;
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  return Print::write(buffer,size);
+}
+
+// A record keeps the format's address in 4 bytes, as on the board. Host
+// binaries are loaded above 4 GB, so the formats are copied below it first
+const char* lowString(const char* text) {
+  static char* arena = (char*)mmap(nullptr,65536,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT,-1,0);
+  static size_t used = 0;
+  char* copy = arena + used;
+  strcpy(copy,text);
+  used += strlen(text) + 1;
+  return copy;
+}
+
+#undef F
+#define F(s) ((const __FlashStringHelper*)lowString(s))
+
+// the scheduler as the log task sees it: loop() runs it whenever it's due
+bool logTaskDue = false;
+
+void taskWakeNow(const uint8_t task) { logTaskDue = true; }
+void taskWakeIn(const uint8_t task, const uint32_t delayMs) { logTaskDue = true; }
+bool taskScheduled(const uint8_t task) { return logTaskDue; }
+
+void setUp() {}
+
+void tearDown() {}
+
+// What a poll of a live game logs: the game lines and the verbose JSON dump
+void logPoll() {
+  dPrintln(F("Getting current game data"));
+  dPrintf(F("gameID: %d\n"),2021020345);
+  dPrintf(F("awayID: %d (%s)\n"),10,"TOR");
+  dPrintf(F("homeID: %d (%s)\n"),8,"MTL");
+  dPrintf(F("Score: %d - %d\n"),3,2);
+  dPrintf(F("Period: %s  Time: %s\n"),"3rd","04:12");
+  dPrintf(F("Power play: away %d home %d\n"),0,1);
+  dPrintf(F("Next poll in %d ms, heap %d, frag %d%%\n"),10000,18344,12);
+  {
+    LogPrint out;
+    for (uint16_t i = 0; i < 24; i++) {
+      const char* piece = "{\"period\":3,\"clock\":\"04:12\",\"away\":{\"goals\":3}},";
+      while (*piece) {
+        out.write(*piece++);
+      }
+    }
+    out.write('\n');
+  }
+  dPrintf(F("Poll took %d ms\n"),412);
+}
+
+void test_poll_logging() {
+  uint64_t start = micros64();
+  logPoll();
+  const LogStats& stats = logStats();
+  uint32_t callerUs = stats.callerUs;
+  uint32_t maxCallerUs = stats.maxCallerUs;
+  uint32_t waits = stats.flushes;
+
+  // between polls the log task sends the rest as the FIFO empties
+  logCheck();
+  while (logTaskDue) {
+    logTaskDue = false;
+    uartWaitUs += LOG_DRAIN_MS * 1000;      // the idle time till the task runs again
+    logRun();
+    logCheck();
+  }
+
+  printf("LOGTIME,%s,%u,%u,%u,%u,%u\n",LOG_SYNC ? "sync" : "buffered",stats.records,(uint32_t)uartSent.size(),
+         callerUs,maxCallerUs,waits);
+  printf("# %u us for the poll, UART idle again after %u us\n",callerUs,(uint32_t)(micros64() - start));
+
+  TEST_ASSERT_TRUE(uartSent.find("awayID: 10 (TOR)\n") != std::string::npos);
+  TEST_ASSERT_TRUE(uartSent.find("frag 12%\n") != std::string::npos);
+  TEST_ASSERT_EQUAL_UINT32(0,stats.dropped);
+#if LOG_SYNC
+  // every character past the FIFO waits for the UART
+  uint32_t pastFifo = uartSent.size() - UART_FIFO_SIZE;
+  TEST_ASSERT_TRUE(callerUs >= pastFifo * UART_US_PER_CHAR * 0.9);
+#else
+  // a poll fits in the ring, nothing waits for the UART
+  TEST_ASSERT_TRUE(stats.maxUsed < LOG_BUFFER_SIZE);
+  TEST_ASSERT_EQUAL_UINT32(0,waits);
+  TEST_ASSERT_TRUE(callerUs < 5000);
+#endif
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_poll_logging);
+  return UNITY_END();
+}
@@ -0,0 +1,127 @@
+#include <unity.h>
+#include "Simulation.h"
+#include "Scheduler.h"
+#include "LogBuffer.h"
+
+/*  The simulation script parser and report, run natively through
+    data/sim/doubleheader.txt. The poll state machine lives in main.cpp and
+    needs the board, so pollOnce() below stands in for it: one poll a minute,
+    the next game until it starts, then the current game until its final.
+    The report's figures are checked; its log lines are dropped.
+*/
+
+const uint32_t POLL_S = 60;
+
+extern uint16_t simNextQueries;
+extern uint16_t simCurrentQueries;
+extern uint32_t simStatusS[];
+extern uint8_t numSimTransitions;
+extern uint8_t numSimGames;
+extern uint8_t numSimLines;
+extern uint16_t simScoreChanges;
+extern uint32_t simScoreLagMaxS;
+
+uint64_t virtualMs = 0;
+
+uint64_t schedulerMillis() {
+  return virtualMs;
+}
+
+void schedulerVirtualTime(const bool enable) {}
+
+uint64_t micros64() {
+  return virtualMs * 1000;
+}
+
+uint32_t micros() {
+  return (uint32_t)micros64();
+}
+
+uint32_t millis() {
+  return (uint32_t)virtualMs;
+}
+
+void logWrite(const uint8_t flags, PGM_P format) {}
+void LogRecord::commit() {}
+
+GameStatus status = NEW_TEAM;
+NextGameData nextGame;
+
+void pollOnce() {
+  if ((status == NEW_TEAM) || (status == NO_GAMES) || (status == SCHEDULED) || (status == AFTER_GAME)) {
+    simNextGame(nextGame);
+    if (nextGame.gameID == 0) {
+      status = NO_GAMES;
+    }
+    else {
+      status = (simTime() >= nextGame.startTime) ? STARTED : SCHEDULED;
+    }
+  }
+  else if (status == STARTED) {
+    CurrentGameData game;
+    bool isGameOver = false;
+    TEST_ASSERT_TRUE(simCurrentGame(nextGame.gameID,game,isGameOver));
+    simScoreSeen(game);
+    if (isGameOver) {
+      status = FINISHED;
+    }
+  }
+  else {
+    status = AFTER_GAME;
+  }
+  simStatus(status,nextGame);
+}
+
+void setUp() {
+  virtualMs = 0;
+  status = NEW_TEAM;
+  nextGame = NextGameData();
+}
+
+void tearDown() {
+  simStop();
+}
+
+void test_missing_script() {
+  TEST_ASSERT_FALSE(simLoad("/sim/none.txt"));
+}
+
+void test_doubleheader() {
+  TEST_ASSERT_TRUE(simLoad("/sim/doubleheader.txt"));
+  TEST_ASSERT_EQUAL_UINT32(2,numSimGames);
+  TEST_ASSERT_EQUAL_UINT32(8,numSimLines);
+
+  simStart(1);
+  TEST_ASSERT_EQUAL_UINT32(1623499200,simTime());
+  TEST_ASSERT_EQUAL_UINT32(57600000,simRemainingMs());
+
+  while (simRemainingMs() > 0) {
+    pollOnce();
+    virtualMs += POLL_S * 1000;
+  }
+  simReport();
+
+  // SCHEDULED, STARTED, FINISHED, AFTER_GAME for each game, then NO_GAMES
+  TEST_ASSERT_EQUAL_UINT32(9,numSimTransitions);
+  TEST_ASSERT_EQUAL_UINT32(6,simScoreChanges);      // the finals repeat the last score
+  TEST_ASSERT_TRUE(simScoreLagMaxS < POLL_S);
+  TEST_ASSERT_TRUE(simCurrentQueries > 0);
+  TEST_ASSERT_TRUE(simNextQueries > 0);
+
+  // game 1 from 18000 to its final at 27000, game 2 from 34200 to 41400
+  uint32_t startedS = simStatusS[STARTED];
+  TEST_ASSERT_TRUE(startedS >= 9000 + 7200 - 2 * POLL_S);
+  TEST_ASSERT_TRUE(startedS <= 9000 + 7200 + 2 * POLL_S);
+  uint32_t totalS = 0;
+  for (uint8_t i = 0; i <= AFTER_GAME; i++) {
+    totalS += simStatusS[i];
+  }
+  TEST_ASSERT_EQUAL_UINT32(57600,totalS);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_missing_script);
+  RUN_TEST(test_doubleheader);
+  return UNITY_END();
+}
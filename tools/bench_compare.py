@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""Checks a microbenchmark run against the stored baseline.
+
+The input is a captured serial log of the "bench" console command
+(src/Bench.h), from a file or stdin. Only the BENCH lines are used:
+  BENCH,<case>,<iterations>,<best ns>,<mean ns>
+The best time of each case is compared with tools/bench_baseline.csv, which
+has the columns case,best_ns and an optional threshold_percent. Cases without
+their own threshold use --threshold. A case slower than its baseline by more
+than its threshold is a regression. So is a case that ran but has no time to
+compare with: new to the baseline, or its best_ns still empty (unrecorded).
+Either makes the exit status 1. Baseline cases missing from the run (bench
+with a prefix) are reported, but don't fail the check.
+
+--update writes the run as the new baseline, keeping the per case thresholds.
+The baseline has to come from the same kind of machine as the runs it's
+compared with:
+  tools/bench_baseline.csv         the board: same build flags, CPU clock
+                                   (80 or 160 MHz) and fixture files. The
+                                   committed file lists the cases and their
+                                   thresholds, its times are filled in by
+                                   the first --update on the reference board
+  tools/bench_baseline_native.csv  the pure cases built natively
+                                   (test/test_bench, pio test -e native)
+
+usage: bench_compare.py [options] [log]
+"""
+
+import argparse
+import csv
+import json
+import os
+import sys
+
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "bench_baseline.csv")
+DEFAULT_THRESHOLD_PERCENT = 10.0
+FAILING = ("regression", "new", "unrecorded")    # a case that ran without a time to compare with fails too
+
+
+def read_run(lines):
+    """{case: (iterations, best_ns, mean_ns)} from the BENCH lines of a log"""
+    run = {}
+    for line in lines:
+        fields = line.strip().split(",")
+        if len(fields) != 5 or fields[0] != "BENCH" or fields[1] == "case":
+            continue
+        try:
+            run[fields[1]] = (int(fields[2]), int(fields[3]), int(fields[4]))
+        except ValueError:
+            print("bad line: " + line.strip(), file=sys.stderr)
+    return run
+
+
+def read_baseline(path):
+    """{case: (best_ns or None if unrecorded, threshold percent or None)}"""
+    baseline = {}
+    if not os.path.exists(path):
+        return baseline
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            best = row.get("best_ns") or ""
+            threshold = row.get("threshold_percent") or ""
+            baseline[row["case"]] = (int(best) if best else None, float(threshold) if threshold else None)
+    return baseline
+
+
+def write_baseline(path, run, old):
+    """cases left out of the run (bench with a prefix) keep their old row"""
+    with open(path, "w", newline="") as f:
+        out = csv.writer(f)
+        out.writerow(["case", "best_ns", "threshold_percent"])
+        for case in sorted(set(run) | set(old)):
+            best = run[case][1] if case in run else old[case][0]
+            threshold = old[case][1] if case in old else None
+            out.writerow([case, "" if best is None else best, "" if threshold is None else "%g" % threshold])
+
+
+def compare(run, baseline, default_threshold):
+    results = []
+    for case in sorted(set(run) | set(baseline)):
+        result = {"case": case}
+        if case not in baseline:
+            result.update(status="new", best_ns=run[case][1])
+        elif case not in run:
+            result.update(status="missing", baseline_ns=baseline[case][0])
+        elif baseline[case][0] is None:
+            result.update(status="unrecorded", best_ns=run[case][1])
+        else:
+            base_ns, threshold = baseline[case]
+            threshold = default_threshold if threshold is None else threshold
+            best_ns = run[case][1]
+            change = 100.0 * (best_ns - base_ns) / base_ns if base_ns else 0.0
+            result.update(best_ns=best_ns, baseline_ns=base_ns, change_percent=round(change, 1),
+                          threshold_percent=threshold,
+                          status="regression" if change > threshold else ("faster" if change < -threshold else "ok"))
+        results.append(result)
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", help="captured serial log, stdin if left out")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE, help="baseline CSV (default: %(default)s)")
+    parser.add_argument("--threshold", type=float, default=DEFAULT_THRESHOLD_PERCENT,
+                        help="allowed slowdown in percent, for cases without their own (default: %(default)s)")
+    parser.add_argument("--update", action="store_true", help="store this run as the baseline")
+    parser.add_argument("--json", action="store_true", help="results as JSON")
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log, errors="replace") as f:
+            run = read_run(f)
+    else:
+        run = read_run(sys.stdin)
+    if not run:
+        print("no BENCH lines in the input", file=sys.stderr)
+        return 2
+
+    baseline = read_baseline(args.baseline)
+    if args.update:
+        write_baseline(args.baseline, run, baseline)
+        print("baseline %s: %d cases updated" % (args.baseline, len(run)))
+        return 0
+
+    results = compare(run, baseline, args.threshold)
+    failed = [r for r in results if r["status"] in FAILING]
+    if args.json:
+        print(json.dumps({"failed": len(failed), "cases": results}, indent=2))
+    else:
+        for r in results:
+            if "change_percent" in r:
+                print("%-20s %10d ns  baseline %10d ns  %+6.1f%%  %s" % (r["case"], r["best_ns"], r["baseline_ns"],
+                                                                        r["change_percent"], r["status"]))
+            else:
+                print("%-20s %s" % (r["case"], r["status"]))
+        print("%d cases, %d failed" % (len(results), len(failed)))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
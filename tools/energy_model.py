@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Estimate battery use from a serial log of the scoreboard.
+
+The firmware prints a summary line every 10 minutes (see src/Power.h):
+
+    PWR,<uptime ms>,<idle ms>,<light sleep ms>,<wifi restore ms>,<backlight on ms>,<wakeups>
+
+All fields are running totals. The time between two lines is split into
+active / modem sleep idle / light sleep / wifi restore, each state gets a
+current, the backlight adds its own current on top. Idle doesn't include the
+time spent waiting for WiFi to reconnect, that is wifi restore, so the states
+don't overlap and active is what is left. The result is scaled to
+mAh per 24 hours ("game day").
+
+usage: energy_model.py [options] serial.log
+"""
+
+import argparse
+import sys
+
+FIELDS = ("uptime", "idle", "light_sleep", "wifi_restore", "backlight", "wakeups")
+
+
+def read_samples(path):
+    samples = []
+    with open(path, errors="replace") as log:
+        for line in log:
+            pos = line.find("PWR,")
+            if pos < 0:
+                continue
+            parts = line[pos:].strip().split(",")[1:]
+            if len(parts) != len(FIELDS):
+                continue
+            try:
+                samples.append(dict(zip(FIELDS, (int(p) for p in parts))))
+            except ValueError:
+                continue
+    return samples
+
+
+def state_times(samples):
+    """Totals in ms over the log. A reset (uptime going back) starts a new run."""
+    totals = dict.fromkeys(FIELDS, 0)
+    for prev, cur in zip(samples, samples[1:]):
+        if cur["uptime"] < prev["uptime"]:
+            continue
+        for field in FIELDS:
+            totals[field] += cur[field] - prev[field]
+    totals["active"] = max(0, totals["uptime"] - totals["idle"] - totals["light_sleep"] - totals["wifi_restore"])
+    return totals
+
+
+def main():
+    parser = argparse.ArgumentParser(description="mAh per game day from PWR log lines")
+    parser.add_argument("log")
+    parser.add_argument("--active-ma", type=float, default=75.0, help="CPU and radio on")
+    parser.add_argument("--idle-ma", type=float, default=15.0, help="modem sleep between slices")
+    parser.add_argument("--light-sleep-ma", type=float, default=1.0)
+    parser.add_argument("--wifi-restore-ma", type=float, default=80.0, help="reconnecting after light sleep")
+    parser.add_argument("--backlight-ma", type=float, default=20.0)
+    parser.add_argument("--battery-mah", type=float, default=0.0, help="print runtime for this capacity")
+    args = parser.parse_args()
+
+    samples = read_samples(args.log)
+    if len(samples) < 2:
+        sys.exit("need at least two PWR lines, found %d" % len(samples))
+
+    t = state_times(samples)
+    if t["uptime"] <= 0:
+        sys.exit("no usable interval in log")
+
+    currents = {
+        "active": args.active_ma,
+        "idle": args.idle_ma,
+        "light_sleep": args.light_sleep_ma,
+        "wifi_restore": args.wifi_restore_ma,
+        "backlight": args.backlight_ma,
+    }
+
+    hours = t["uptime"] / 3600000.0
+    mah = 0.0
+    print("%-14s %10s %7s %8s" % ("state", "minutes", "share", "mAh"))
+    for state, ma in currents.items():
+        state_mah = ma * t[state] / 3600000.0
+        mah += state_mah
+        print("%-14s %10.1f %6.1f%% %8.2f" % (state, t[state] / 60000.0, 100.0 * t[state] / t["uptime"], state_mah))
+
+    print()
+    print("logged:        %.2f h, %d light sleep wakeups" % (hours, t["wakeups"]))
+    print("average:       %.2f mA" % (mah / hours))
+    print("per game day:  %.1f mAh" % (mah / hours * 24))
+    if args.battery_mah > 0:
+        print("battery:       %.1f days" % (args.battery_mah / (mah / hours * 24)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,491 @@
+#!/usr/bin/env python3
+"""Fault injecting score API, and a client that polls it like the firmware.
+
+The server answers every GET with a current game JSON, except while the
+scenario says otherwise. Fault modes:
+  ok        normal answer
+  500       HTTP 500
+  429       HTTP 429, rate limited
+  timeout   no answer until after the client has given up
+  truncate  HTTP 200 with the body cut in half
+  down      the connection is closed without an answer
+  drop      the connection is closed part way through the body
+A phase can apply its fault to only part of the requests (--scenario, see
+DEFAULT_SCENARIO for the format).
+
+The client models the selected team's poll in src/main.cpp with the retry and
+breaker rules of src/Upstream.cpp. It's run twice, against the same scenario:
+once with backoff and once retrying at the normal poll interval. For each run
+it prints the request count, the availability and the recovery time after
+each fault phase. Availability is the share of the run the screen had a fresh
+score, one no older than STALE_AFTER_POLLS intervals. Recovery is the time
+from the end of a fault phase to the next good answer.
+
+Time is scaled down by --speed, so an hour of scenario takes 18 s at the
+default. With --serve only the server runs, in real time, for pointing a
+development build at.
+
+Image downloads (src/Download.h), --download image.bin: the server serves the
+image with Range requests at --kbps, and a client downloads it the way the
+firmware does: one manifest chunk per request, DOWNLOAD_RETRIES retries per
+chunk with doubling delays, and a restart RESTART_S after an attempt gives up.
+It's run twice: resuming at the last verified chunk after a restart (the
+firmware) and starting over. Each run prints the requests, retries, restarts,
+bytes downloaded against the image size and the time taken, and checks the
+result against the image SHA-256. The default scenario drops a quarter of
+the responses part way and has the server down for long enough to use up
+the retries:
+
+    tools/fault_server.py --download .pio/build/d1_mini/firmware.bin
+
+For a board, serve the update directory made with make_manifest.py over
+HTTPS and point FW_URL at it. The firmware doesn't check the certificate, so
+a self-signed one does:
+
+    openssl req -x509 -newkey rsa:2048 -nodes -subj /CN=updates -keyout key.pem -out cert.pem
+    tools/fault_server.py --serve 8443 --files updates --cert cert.pem --key key.pem --scenario "0 drop 30"
+
+usage: fault_server.py [options]
+"""
+
+import argparse
+import hashlib
+import http.client
+import http.server
+import json
+import os
+import random
+import re
+import ssl
+import threading
+import time
+
+from make_manifest import entry as manifest_entry
+
+# firmware constants, src/main.cpp and src/Upstream.h
+GAME_UPDATE_INTERVAL_S = 65
+STALE_AFTER_POLLS = 3
+RETRY_BASE_S = 5
+RETRY_MAX_S = 2 * 60
+RATE_LIMIT_S = 60
+JITTER_PERCENT = 25
+BREAKER_FAILURES = 3
+HTTP_TIMEOUT_S = 5       # HTTPClient default
+
+# src/Download.h
+DOWNLOAD_RETRIES = 5
+DOWNLOAD_RETRY_DELAY_S = 1
+DOWNLOAD_STREAM_TIMEOUT_S = 10
+RESTART_S = 60           # until the board is restarted after a failed download
+MAX_RESTARTS = 10
+
+# "<start minute> <mode> [<share of requests, percent>]" per phase, until the next
+DEFAULT_SCENARIO = "0 ok, 10 500, 20 ok, 25 down, 35 ok, 40 truncate 30, 45 ok, 48 429, 52 ok"
+DEFAULT_DOWNLOAD_SCENARIO = "0 drop 25, 0.3 down, 1.5 drop 25"
+DEFAULT_LENGTH_MIN = 60
+DEFAULT_KBPS = 40
+
+GAME = {"gameData": {"status": {"abstractGameState": "Live"}},
+        "liveData": {"linescore": {"currentPeriodOrdinal": "2nd", "currentPeriodTimeRemaining": "12:34",
+                                   "teams": {"home": {"goals": 2}, "away": {"goals": 1}}}}}
+
+
+def parse_scenario(text):
+    phases = []
+    for item in text.split(","):
+        parts = item.split()
+        share = int(parts[2]) if len(parts) > 2 else 100
+        phases.append((float(parts[0]) * 60, parts[1], share))
+    return sorted(phases)
+
+
+class Scenario:
+    def __init__(self, phases, speed):
+        self.phases = phases
+        self.speed = speed
+        self.start = time.monotonic()
+        self.random = random.Random(1)
+        self.lock = threading.Lock()
+
+    def now(self):
+        """Scenario seconds since start"""
+        return (time.monotonic() - self.start) * self.speed
+
+    def fault(self):
+        now = self.now()
+        mode, share = "ok", 100
+        for start, phase_mode, phase_share in self.phases:
+            if start <= now:
+                mode, share = phase_mode, phase_share
+        with self.lock:
+            return mode if self.random.randrange(100) < share else "ok"
+
+
+def make_handler(scenario, files=None, kbps=0):
+    """files: {path: bytes} to serve instead of the score API, with Range support"""
+    class Handler(http.server.BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"     # keep-alive, like the firmware's downloads
+
+        def do_GET(self):
+            mode = scenario.fault()
+            status = 200
+            headers = {"Content-Type": "application/json"}
+            body = json.dumps(GAME).encode()
+            if files is not None:
+                data = files.get(self.path.split("?")[0])
+                if data is None:
+                    mode = "404"
+                else:
+                    body, status, headers = self.file_range(data)
+            if mode == "down":
+                self.close_connection = True
+                self.connection.close()
+                return
+            if mode == "timeout":
+                time.sleep(HTTP_TIMEOUT_S * 2 / scenario.speed)
+            if mode in ("500", "429", "404"):
+                self.send_response(int(mode))
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+            length = len(body)
+            if mode == "truncate":
+                body = body[:len(body) // 2]
+                length = len(body)
+            if mode == "drop":
+                with scenario.lock:
+                    body = body[:int(len(body) * scenario.random.uniform(0.1, 0.9))]
+            self.send_response(status)
+            for name, value in headers.items():
+                self.send_header(name, value)
+            self.send_header("Content-Length", str(length))
+            self.end_headers()
+            try:
+                self.send_body(body)
+            except ConnectionError:
+                self.close_connection = True    # the client gave up on it
+                return
+            if mode == "drop":
+                self.close_connection = True
+                self.connection.close()
+
+        def file_range(self, data):
+            match = re.match(r"bytes=(\d+)-(\d*)$", self.headers.get("Range", ""))
+            if not match:
+                return data, 200, {"Content-Type": "application/octet-stream"}
+            start = int(match.group(1))
+            end = min(int(match.group(2)) if match.group(2) else len(data) - 1, len(data) - 1)
+            return data[start:end + 1], 206, {"Content-Type": "application/octet-stream",
+                                              "Content-Range": "bytes %d-%d/%d" % (start, end, len(data))}
+
+        def send_body(self, body):
+            """at kbps in scenario time, in 4 KB pieces"""
+            for pos in range(0, len(body), 4096):
+                piece = body[pos:pos + 4096]
+                if kbps:
+                    time.sleep(len(piece) / (kbps * 1024.0) / scenario.speed)
+                self.wfile.write(piece)
+
+        def log_message(self, *args):
+            pass
+
+    return Handler
+
+
+class Breaker:
+    """src/Upstream.cpp for one host"""
+
+    def __init__(self, rng):
+        self.rng = rng
+        self.state = "closed"
+        self.failures = 0
+        self.retry_at = 0.0
+        self.opened = 0
+
+    def allowed(self, now):
+        if self.state != "open":
+            return True
+        if now >= self.retry_at:
+            self.state = "half open"
+            return True
+        return False
+
+    def result(self, now, error):
+        if error is None:
+            self.state, self.failures, self.retry_at = "closed", 0, 0.0
+            return
+        self.failures += 1
+        delay = min(RETRY_BASE_S * 2 ** (self.failures - 1), RETRY_MAX_S)
+        jitter = delay * JITTER_PERCENT / 100
+        delay += self.rng.uniform(-jitter, jitter)
+        if error == "rate limited":
+            delay = max(delay, RATE_LIMIT_S)
+        self.retry_at = now + delay
+        if self.state == "half open" or self.failures >= BREAKER_FAILURES:
+            if self.state != "open":
+                self.opened += 1
+            self.state = "open"
+
+    def retry_in(self, now):
+        return max(0.0, self.retry_at - now)
+
+
+def fetch(port, speed):
+    """One current game query, None or the error class"""
+    try:
+        conn = http.client.HTTPConnection("127.0.0.1", port, timeout=HTTP_TIMEOUT_S / speed)
+        conn.request("GET", "/api/v1/game/2021020001/feed/live")
+        response = conn.getresponse()
+        body = response.read()
+        conn.close()
+    except TimeoutError:
+        return "timeout"
+    except (OSError, http.client.HTTPException):
+        return "connect"
+    if response.status == 429:
+        return "rate limited"
+    if response.status != 200:
+        return "http %dxx" % (response.status // 100)
+    try:
+        json.loads(body)
+    except ValueError:
+        return "parse"
+    return None
+
+
+def run_client(args, phases, backoff):
+    scenario = Scenario(phases, args.speed)
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), make_handler(scenario))
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    port = server.server_address[1]
+
+    breaker = Breaker(random.Random(args.seed))
+    length = args.length * 60
+    good = []
+    requests = 0
+    errors = {}
+    while True:
+        now = scenario.now()
+        if now >= length:
+            break
+        if breaker.allowed(now):
+            requests += 1
+            error = fetch(port, args.speed)
+            now = scenario.now()
+            if error is None:
+                good.append(now)
+            else:
+                errors[error] = errors.get(error, 0) + 1
+            if backoff:
+                breaker.result(now, error)
+        else:
+            error = "circuit open"
+        if error is None or not backoff:
+            wait = GAME_UPDATE_INTERVAL_S
+        else:
+            wait = max(breaker.retry_in(now), 0.25)
+        time.sleep(max(0.0, now + wait - scenario.now()) / args.speed)
+    server.shutdown()
+    return requests, errors, good, breaker.opened
+
+
+def availability(good, length):
+    """share of [0, length) with a score no older than STALE_AFTER_POLLS intervals"""
+    fresh_for = STALE_AFTER_POLLS * GAME_UPDATE_INTERVAL_S
+    covered = 0.0
+    covered_to = 0.0
+    for t in good:
+        start = max(t, covered_to)
+        end = min(t + fresh_for, length)
+        if end > start:
+            covered += end - start
+            covered_to = end
+    return covered / length
+
+
+def recoveries(phases, good, length):
+    """(phase, seconds from its end to the next good answer) for each fault phase"""
+    result = []
+    for i, (start, mode, share) in enumerate(phases):
+        if mode == "ok":
+            continue
+        end = phases[i + 1][0] if i + 1 < len(phases) else length
+        after = [t for t in good if t >= end]
+        result.append(("%s %d%% @%dm" % (mode, share, start / 60), (after[0] - end) if after else None))
+    return result
+
+
+class Download:
+    """src/Download.cpp for one image, over a keep-alive connection"""
+
+    def __init__(self, port, speed, entry):
+        self.port = port
+        self.speed = speed
+        self.entry = entry
+        self.conn = None
+        self.requests = 0
+        self.downloaded = 0
+        self.errors = {}
+
+    def error(self, kind):
+        self.errors[kind] = self.errors.get(kind, 0) + 1
+        if self.conn:
+            self.conn.close()
+        self.conn = None
+
+    def fetch_chunk(self, chunk):
+        """the chunk's bytes, or None when the request failed or the hash didn't match"""
+        start = chunk * self.entry["chunk"]
+        end = min(start + self.entry["chunk"], self.entry["size"]) - 1
+        self.requests += 1
+        try:
+            if self.conn is None:
+                self.conn = http.client.HTTPConnection("127.0.0.1", self.port,
+                                                       timeout=DOWNLOAD_STREAM_TIMEOUT_S / self.speed)
+            self.conn.request("GET", "/image.bin", headers={"Range": "bytes=%d-%d" % (start, end)})
+            response = self.conn.getresponse()
+            if response.status != 206:
+                response.read()
+                self.error("http %d" % response.status)
+                return None
+            data = b""
+            while len(data) < end + 1 - start:
+                piece = response.read1(4096)
+                if not piece:
+                    break
+                data += piece
+                self.downloaded += len(piece)
+            response.read()         # done with it, so the connection can be used again
+        except TimeoutError:
+            self.error("timeout")
+            return None
+        except http.client.IncompleteRead as e:
+            self.downloaded += len(e.partial)
+            self.error("dropped")
+            return None
+        except (OSError, http.client.HTTPException):
+            self.error("connect")
+            return None
+        if len(data) != end + 1 - start:
+            self.error("dropped")
+            return None
+        digest = hashlib.sha256(data).digest()[:len(self.entry["chunks"][chunk]) // 2].hex()
+        if digest != self.entry["chunks"][chunk]:
+            self.error("hash")
+            return None
+        return data
+
+
+def run_download(args, phases, data, resume):
+    entry = manifest_entry(1, args.download)
+    scenario = Scenario(phases, args.speed)
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", 0),
+                                             make_handler(scenario, {"/image.bin": data}, args.kbps))
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    download = Download(server.server_address[1], args.speed, entry)
+
+    image = bytearray(len(data))
+    verified = 0            # /download.dat
+    retries = 0
+    restarts = 0
+    while True:
+        ok = True
+        first = verified // entry["chunk"] if resume else 0
+        for chunk in range(first, len(entry["chunks"])):
+            delay = DOWNLOAD_RETRY_DELAY_S
+            attempt = 0
+            while True:
+                got = download.fetch_chunk(chunk)
+                if got is not None:
+                    break
+                attempt += 1
+                if attempt > DOWNLOAD_RETRIES:
+                    ok = False
+                    break
+                retries += 1
+                time.sleep(delay / args.speed)
+                delay *= 2
+            if not ok:
+                break
+            image[chunk * entry["chunk"]:chunk * entry["chunk"] + len(got)] = got
+            verified = min((chunk + 1) * entry["chunk"], entry["size"])
+        if ok or restarts >= MAX_RESTARTS:
+            break
+        restarts += 1
+        time.sleep(RESTART_S / args.speed)
+    took = scenario.now()
+    server.shutdown()
+    installed = ok and hashlib.sha256(image).hexdigest() == entry["sha256"]
+    return download, retries, restarts, took, installed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="fault injecting score API and a firmware poll model")
+    parser.add_argument("--scenario", help="default: %s, for --download: %s" % (DEFAULT_SCENARIO,
+                                                                                 DEFAULT_DOWNLOAD_SCENARIO))
+    parser.add_argument("--length", type=float, default=DEFAULT_LENGTH_MIN, help="scenario minutes")
+    parser.add_argument("--speed", type=float, default=200.0, help="scenario seconds per real second")
+    parser.add_argument("--seed", type=int, default=1, help="retry jitter")
+    parser.add_argument("--serve", type=int, metavar="PORT", help="only run the server, in real time")
+    parser.add_argument("--files", metavar="DIR", help="with --serve: serve this directory instead of the score API")
+    parser.add_argument("--cert", help="with --serve: serve HTTPS with this certificate")
+    parser.add_argument("--key", help="private key of --cert")
+    parser.add_argument("--download", metavar="IMAGE", help="model a chunked download of this image")
+    parser.add_argument("--kbps", type=float, default=DEFAULT_KBPS, help="KB/s for files (default: %(default)s)")
+    args = parser.parse_args()
+    if args.scenario is None:
+        args.scenario = DEFAULT_DOWNLOAD_SCENARIO if args.download else DEFAULT_SCENARIO
+    phases = parse_scenario(args.scenario)
+
+    if args.serve:
+        files = None
+        if args.files:
+            files = {}
+            for root, _, names in os.walk(args.files):
+                for name in names:
+                    path = os.path.join(root, name)
+                    with open(path, "rb") as f:
+                        files["/" + os.path.relpath(path, args.files).replace(os.sep, "/")] = f.read()
+        server = http.server.ThreadingHTTPServer(("", args.serve),
+                                                 make_handler(Scenario(phases, 1.0), files, args.kbps if files else 0))
+        if args.cert:
+            context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+            context.load_cert_chain(args.cert, args.key)
+            server.socket = context.wrap_socket(server.socket, server_side=True)
+        print("serving %s on port %d: %s" % (args.files if files is not None else "the score API", args.serve,
+                                             args.scenario))
+        server.serve_forever()
+        return
+
+    if args.download:
+        with open(args.download, "rb") as f:
+            data = f.read()
+        print("scenario: %s, %d byte image at %g KB/s" % (args.scenario, len(data), args.kbps))
+        for resume in (True, False):
+            download, retries, restarts, took, installed = run_download(args, phases, data, resume)
+            print("\n%s" % ("resume at the last verified chunk (firmware)" if resume else "start over after a restart"))
+            print("  requests:     %d, %d retries, %d restarts" % (download.requests, retries, restarts))
+            print("  errors:       %s" % (", ".join("%s x%d" % item for item in sorted(download.errors.items()))
+                                          or "none"))
+            print("  downloaded:   %d bytes, %.0f%% of the image" % (download.downloaded,
+                                                                    100.0 * download.downloaded / len(data)))
+            print("  time:         %.0f s" % took)
+            print("  installed:    %s" % ("yes, SHA-256 matches" if installed else "no"))
+        return
+
+    length = args.length * 60
+    print("scenario: %s, %d min" % (args.scenario, args.length))
+    for backoff in (True, False):
+        requests, errors, good, opened = run_client(args, phases, backoff)
+        print("\n%s" % ("backoff and breaker (firmware)" if backoff else "fixed interval retry"))
+        print("  requests:     %d, %d good" % (requests, len(good)))
+        print("  errors:       %s" % (", ".join("%s x%d" % item for item in sorted(errors.items())) or "none"))
+        if backoff:
+            print("  breaker:      opened %d times" % opened)
+        print("  availability: %.1f%%" % (100.0 * availability(good, length)))
+        for phase, seconds in recoveries(phases, good, length):
+            print("  recovery:     %-18s %s" % (phase, "%.0f s" % seconds if seconds is not None else "never"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""Make and check binary delta firmware updates (see src/DeltaUpdate.h).
+
+    fw_delta.py diff  old.bin new.bin firmware_<old>_<new>.delta
+    fw_delta.py apply old.bin patch.delta out.bin
+
+old.bin has to be the exact image the devices are running, the device checks
+its size and MD5 (ESP.getSketchSize / getSketchMD5) before applying anything.
+"diff" applies the patch it wrote and compares the result before returning.
+
+Matching is bsdiff style: regions of the new image are paired with the most
+similar region of the old one and stored as bytewise differences, which stay
+mostly zero when code only moved. Zero runs cost one byte per 128.
+"""
+
+import hashlib
+import struct
+import sys
+
+MAGIC = b"TFTD"
+OP_END, OP_COPY, OP_ADD, OP_INSERT = 0, 1, 2, 3
+
+KEY_LEN = 8             # bytes used to find candidate matches
+MAX_CANDIDATES = 8      # old positions remembered per key
+MIN_SCORE = 24          # match quality needed to beat literal bytes
+GIVE_UP = 64            # stop extending once the score is this far below the best
+
+
+def build_index(old):
+    index = {}
+    for i in range(len(old) - KEY_LEN + 1):
+        positions = index.setdefault(old[i:i + KEY_LEN], [])
+        if len(positions) < MAX_CANDIDATES:
+            positions.append(i)
+    return index
+
+
+def extend(old, new, o, n):
+    """Best length of the old[o:] / new[n:] pairing, scored 2*matches - length."""
+    best_len = best_score = score = 0
+    limit = min(len(old) - o, len(new) - n)
+    k = 0
+    while k < limit:
+        score += 1 if old[o + k] == new[n + k] else -1
+        k += 1
+        if score > best_score:
+            best_score, best_len = score, k
+        elif score < best_score - GIVE_UP:
+            break
+    return best_len, best_score
+
+
+def encode_add(diff):
+    out = bytearray()
+    i = 0
+    while i < len(diff):
+        if diff[i] == 0:
+            run = 1
+            while i + run < len(diff) and run < 128 and diff[i + run] == 0:
+                run += 1
+            out.append(0x7F + run)
+        else:
+            run = 1
+            while i + run < len(diff) and run < 128:
+                # keep going through single zeros, two in a row end the run
+                if diff[i + run] == 0 and (i + run + 1 >= len(diff) or diff[i + run + 1] == 0):
+                    break
+                run += 1
+            out.append(run - 1)
+            out += diff[i:i + run]
+        i += run
+    return out
+
+
+def make_patch(old, new):
+    index = build_index(old)
+    out = bytearray(struct.pack("<4sII16s16s", MAGIC, len(old), len(new),
+                                hashlib.md5(old).digest(), hashlib.md5(new).digest()))
+    literal = bytearray()
+    offset = 0      # old - new position of the last match, usually still good
+    n = 0
+
+    def flush_literal():
+        if literal:
+            out.extend(struct.pack("<BI", OP_INSERT, len(literal)))
+            out.extend(literal)
+            literal.clear()
+
+    while n < len(new):
+        candidates = []
+        if 0 <= n + offset < len(old):
+            candidates.append(n + offset)
+        candidates += index.get(new[n:n + KEY_LEN], [])
+
+        best = (0, 0, 0)
+        for o in candidates:
+            length, score = extend(old, new, o, n)
+            if score > best[1]:
+                best = (length, score, o)
+
+        length, score, o = best
+        if score < MIN_SCORE:
+            literal.append(new[n])
+            n += 1
+            continue
+
+        flush_literal()
+        diff = bytes((new[n + k] - old[o + k]) & 0xFF for k in range(length))
+        if any(diff):
+            out.extend(struct.pack("<BII", OP_ADD, o, length))
+            out.extend(encode_add(diff))
+        else:
+            out.extend(struct.pack("<BII", OP_COPY, o, length))
+        offset = o - n
+        n += length
+
+    flush_literal()
+    out.append(OP_END)
+    return bytes(out)
+
+
+def apply_patch(old, patch):
+    magic, old_size, new_size, old_md5, new_md5 = struct.unpack_from("<4sII16s16s", patch)
+    if magic != MAGIC:
+        raise ValueError("not a delta file")
+    if old_size != len(old) or hashlib.md5(old).digest() != old_md5:
+        raise ValueError("patch is for a different old image")
+    pos = struct.calcsize("<4sII16s16s")
+    new = bytearray()
+    while True:
+        op = patch[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            o, length = struct.unpack_from("<II", patch, pos)
+            pos += 8
+            new += old[o:o + length]
+        elif op == OP_ADD:
+            o, length = struct.unpack_from("<II", patch, pos)
+            pos += 8
+            end = o + length
+            while o < end:
+                control = patch[pos]
+                pos += 1
+                if control < 0x80:
+                    run = control + 1
+                    new += bytes((old[o + k] + patch[pos + k]) & 0xFF for k in range(run))
+                    pos += run
+                else:
+                    run = control - 0x7F
+                    new += old[o:o + run]
+                o += run
+        elif op == OP_INSERT:
+            (length,) = struct.unpack_from("<I", patch, pos)
+            pos += 4
+            new += patch[pos:pos + length]
+            pos += length
+        else:
+            raise ValueError("bad op %d at %d" % (op, pos - 1))
+    if len(new) != new_size or hashlib.md5(new).digest() != new_md5:
+        raise ValueError("patched image does not match")
+    return bytes(new)
+
+
+def read(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def main():
+    if len(sys.argv) != 5 or sys.argv[1] not in ("diff", "apply"):
+        sys.exit(__doc__)
+    mode, a, b, out_path = sys.argv[1:]
+    old = read(a)
+
+    if mode == "diff":
+        new = read(b)
+        patch = make_patch(old, new)
+        if apply_patch(old, patch) != new:
+            sys.exit("round trip failed, not writing patch")
+        with open(out_path, "wb") as f:
+            f.write(patch)
+        print("old %d bytes, new %d bytes, patch %d bytes (%.1f%% of full image)"
+              % (len(old), len(new), len(patch), 100.0 * len(patch) / len(new)))
+    else:
+        new = apply_patch(old, read(b))
+        with open(out_path, "wb") as f:
+            f.write(new)
+        print("wrote %d bytes, MD5 %s" % (len(new), hashlib.md5(new).hexdigest()))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""Decodes the binary log output of the firmware (src/LogBuffer.h) to text.
+
+With "log binary" on the serial console, the board sends each log record as
+it was stored: LOG_FRAME_START (0x1E), the size of the rest, millis(), the
+flash address of the format string, flags, then the arguments, each a type
+byte and its value. The format strings come from the firmware ELF the board
+is running (.pio/build/d1_mini/firmware.elf). Text between records, such as
+boot messages, is passed through.
+
+The input is a raw capture (cat /dev/ttyUSB0 > capture.bin, or a monitor's
+binary log), stdin, or the serial port itself with --port (needs pyserial).
+
+usage: log_decode.py [options] elf [capture]
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+FRAME_START = 0x1E
+HEADER_SIZE = 11
+NEWLINE, LITERAL, TRUNCATED = 0x01, 0x02, 0x04
+ARG_INT, ARG_LONG, ARG_DOUBLE, ARG_STRING = range(4)
+
+CONVERSION = re.compile(r"%([-+ #0-9.]*)(?:hh|h|ll|l|L|q|j|z|t)?([diouxXcsfFeEgGp%])")
+
+
+class Elf:
+    """Reads NUL terminated strings by load address from the allocated sections"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF":
+            raise ValueError("%s is not an ELF file" % path)
+        is64 = self.data[4] == 2
+        if is64:
+            shoff, = struct.unpack_from("<Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from("<HH", self.data, 0x3A)
+        else:
+            shoff, = struct.unpack_from("<I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            base = shoff + i * shentsize
+            if is64:
+                _, kind, flags, addr, offset, size = struct.unpack_from("<IIQQQQ", self.data, base)
+            else:
+                _, kind, flags, addr, offset, size = struct.unpack_from("<IIIIII", self.data, base)
+            if kind == 1 and flags & 0x2 and size:      # PROGBITS, allocated
+                self.sections.append((addr, offset, size))
+
+    def string(self, address):
+        for addr, offset, size in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.find(b"\0", start, offset + size)
+                if end >= 0:
+                    return self.data[start:end].decode("latin-1")
+        return None
+
+
+def read_args(payload):
+    args = []
+    pos = 0
+    while pos < len(payload):
+        kind = payload[pos]
+        pos += 1
+        if kind == ARG_INT and pos + 4 <= len(payload):
+            args.append(struct.unpack_from("<i", payload, pos)[0])
+            pos += 4
+        elif kind == ARG_LONG and pos + 8 <= len(payload):
+            args.append(struct.unpack_from("<q", payload, pos)[0])
+            pos += 8
+        elif kind == ARG_DOUBLE and pos + 8 <= len(payload):
+            args.append(struct.unpack_from("<d", payload, pos)[0])
+            pos += 8
+        elif kind == ARG_STRING and pos < len(payload):
+            length = payload[pos]
+            args.append(payload[pos + 1:pos + 1 + length].decode("latin-1"))
+            pos += 1 + length
+        else:
+            break
+    return args
+
+
+def format_arg(spec, conversion, value):
+    """One printf conversion in Python, the stored type wins over the format"""
+    if isinstance(value, str):
+        return ("%" + spec + "s") % value if conversion == "s" else value
+    if isinstance(value, float):
+        return ("%" + spec + conversion) % value if conversion in "fFeEgG" else "%f" % value
+    if conversion == "c":
+        return ("%" + spec + "c") % chr(value & 0xFF)
+    if conversion == "u":
+        bits = 64 if not -2 ** 31 <= value < 2 ** 31 else 32
+        return ("%" + spec + "d") % (value % (1 << bits))
+    if conversion in "xXo":
+        return ("%" + spec + conversion) % (value % (1 << 64 if not -2 ** 31 <= value < 2 ** 31 else 1 << 32))
+    if conversion in "di":
+        return ("%" + spec + "d") % value
+    return str(value)
+
+
+def format_record(elf, record):
+    millis, address, flags = struct.unpack_from("<IIB", record, 2)
+    args = read_args(record[HEADER_SIZE:])
+    if address == 0:
+        text = "".join(format_arg("", "s", a) for a in args)
+    else:
+        fmt = elf.string(address)
+        if fmt is None:
+            text = "<format 0x%08x> %s" % (address, " ".join(str(a) for a in args))
+        elif flags & LITERAL:
+            text = fmt
+        else:
+            queue = list(args)
+
+            def convert(m):
+                if m.group(2) == "%":
+                    return "%"
+                return format_arg(m.group(1), m.group(2), queue.pop(0)) if queue else "?"
+            text = CONVERSION.sub(convert, fmt)
+    if flags & NEWLINE:
+        text += "\n"
+    return millis, text
+
+
+def decode(elf, chunks, out, show_time):
+    """Chunks of captured bytes in, text out. Returns the number of records"""
+    buffer = bytearray()
+    records = 0
+    line_start = True
+    for chunk in chunks:
+        buffer += chunk
+        while buffer:
+            start = buffer.find(FRAME_START)
+            text = buffer if start < 0 else buffer[:start]
+            if text:
+                out.write(text.decode("latin-1"))
+                line_start = text.endswith(b"\n")
+                del buffer[:len(text)]
+                continue
+            if len(buffer) < 2 or len(buffer) < buffer[1] + 2:
+                break                   # the rest of the record is still to come
+            size = buffer[1] + 2
+            if size < HEADER_SIZE:
+                out.write(chr(buffer.pop(0)))
+                continue
+            millis, text = format_record(elf, bytes(buffer[:size]))
+            del buffer[:size]
+            records += 1
+            if show_time and line_start:
+                text = "%10.3f  %s" % (millis / 1000.0, text)
+            out.write(text)
+            line_start = text.endswith("\n")
+        out.flush()
+    if buffer:
+        out.write(buffer.decode("latin-1"))
+    return records
+
+
+def read_chunks(f):
+    while True:
+        chunk = f.read1(4096) if hasattr(f, "read1") else f.read(4096)
+        if not chunk:
+            return
+        yield chunk
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="firmware ELF the board runs")
+    parser.add_argument("capture", nargs="?", help="raw capture, stdin if left out")
+    parser.add_argument("--port", help="read the serial port instead, e.g. /dev/ttyUSB0")
+    parser.add_argument("--baud", type=int, default=115200, help="(default: %(default)s)")
+    parser.add_argument("--time", action="store_true", help="prefix lines with the board's millis() in seconds")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    try:
+        if args.port:
+            import serial
+            port = serial.Serial(args.port, args.baud, timeout=0.1)
+            records = decode(elf, iter(lambda: port.read(4096), None), sys.stdout, args.time)
+        elif args.capture:
+            with open(args.capture, "rb") as f:
+                records = decode(elf, read_chunks(f), sys.stdout, args.time)
+        else:
+            records = decode(elf, read_chunks(sys.stdin.buffer), sys.stdout, args.time)
+    except KeyboardInterrupt:
+        return 0
+    print("%d records" % records, file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
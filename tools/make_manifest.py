@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""Write manifest.json for the update server (see src/UpdateManifest.h).
+
+    make_manifest.py <fw version> firmware.bin <fs version> littlefs.bin [manifest.json]
+                     --key private.key [--files data]
+    make_manifest.py --key-header public.key
+
+Upload the images as firmware_<fw version>.bin and littlefs_<fs version>.bin
+next to the manifest. Devices download them in CHUNK_SIZE Range requests and
+check each chunk against the truncated SHA-256 listed here, then the whole
+image against its full SHA-256 and MD5.
+
+Every hash devices check an update with comes from the manifest, so it is
+signed: the RSA signature of the JSON and its length are appended, as the
+core's signing.py does for signed images. The key pair is made with openssl
+(keep private.key off the update server and out of the repository):
+
+    openssl genrsa -out private.key 2048
+    openssl rsa -in private.key -outform PEM -pubout -out public.key
+
+--key-header writes the public key into src/ManifestKey.h for the firmware.
+Without --key the manifest is unsigned, only builds with -DMANIFEST_UNSIGNED=1
+take it.
+
+With --files the data directory is also listed in files.txt (src/FileSync.h)
+so devices can fetch only the files that changed. Upload files.txt and the
+contents of the data directory as files_<fs version>/. Files the device keeps
+for itself (USER_FILES) are left out so a sync never replaces them.
+"""
+
+import hashlib
+import json
+import os
+import subprocess
+import struct
+import sys
+
+CHUNK_SIZE = 64 * 1024  # whole 4 KB flash sectors, devices check
+CHUNK_HASH_SIZE = 8     # bytes, MANIFEST_CHUNK_HASH_SIZE
+MAX_CHUNKS = 32         # MANIFEST_MAX_CHUNKS
+MAX_SIZE = 4096         # MANIFEST_MAX_SIZE
+MAX_FILES = 256         # FILE_SYNC_MAX_FILES
+MAX_PATH = 63           # FILE_SYNC_PATH_SIZE - 1, room for ".tmp" is on the device
+KEY_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "ManifestKey.h")
+VERSION_FILE = "/fs_ver.txt"
+USER_FILES = {"/myteam.dat"}
+
+
+def entry(version, path):
+    with open(path, "rb") as f:
+        data = f.read()
+    chunks = [hashlib.sha256(data[i:i + CHUNK_SIZE]).digest()[:CHUNK_HASH_SIZE].hex()
+              for i in range(0, len(data), CHUNK_SIZE)]
+    if len(chunks) > MAX_CHUNKS:
+        sys.exit("%s needs %d chunks, devices take %d" % (path, len(chunks), MAX_CHUNKS))
+    return {"version": int(version), "size": len(data), "sha256": hashlib.sha256(data).hexdigest(),
+            "md5": hashlib.md5(data).hexdigest(), "chunk": CHUNK_SIZE, "chunks": chunks}
+
+
+def file_list(data_dir):
+    """files.txt contents, one "<sha256> <size> <path>" line per file, version file last."""
+    lines = []
+    for root, dirs, files in os.walk(data_dir):
+        dirs.sort()
+        for name in sorted(files):
+            full = os.path.join(root, name)
+            path = "/" + os.path.relpath(full, data_dir).replace(os.sep, "/")
+            if path in USER_FILES:
+                continue
+            if len(path) > MAX_PATH or " " in path:
+                sys.exit("%s: path too long or has a space" % path)
+            with open(full, "rb") as f:
+                data = f.read()
+            lines.append((path == VERSION_FILE, "%s %d %s\n" % (hashlib.sha256(data).hexdigest(), len(data), path)))
+    if len(lines) > MAX_FILES:
+        sys.exit("%d files, devices take %d" % (len(lines), MAX_FILES))
+    if not any(last for last, _ in lines):
+        sys.exit("%s missing from %s" % (VERSION_FILE, data_dir))
+    return "".join(line for _, line in sorted(lines, key=lambda l: l[0])).encode()
+
+
+def sign(data, private_key):
+    """data with its signature and the signature length appended"""
+    proc = subprocess.run(["openssl", "dgst", "-sha256", "-sign", private_key], input=data,
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if proc.returncode != 0 or not proc.stdout:
+        sys.exit("signing failed: %s" % proc.stderr.decode(errors="replace").strip())
+    return data + proc.stdout + struct.pack("<I", len(proc.stdout))
+
+
+def write_key_header(public_key):
+    with open(public_key) as f:
+        pem = f.read().strip()
+    if "PUBLIC KEY" not in pem:
+        sys.exit("%s is not a PEM public key" % public_key)
+    with open(KEY_HEADER) as f:
+        header = f.read()
+    start = header.index("MANIFEST_PUBLIC_KEY[] PROGMEM = ")
+    end = header.index(";\n", start)
+    key = "R\"KEY(\n%s\n)KEY\"" % pem
+    with open(KEY_HEADER, "w") as f:
+        f.write(header[:start] + "MANIFEST_PUBLIC_KEY[] PROGMEM = " + key + header[end:])
+    print("%s: key from %s" % (os.path.normpath(KEY_HEADER), public_key))
+
+
+def take_option(args, name):
+    if name not in args:
+        return None
+    pos = args.index(name)
+    if pos + 1 >= len(args):
+        sys.exit(__doc__)
+    value = args[pos + 1]
+    del args[pos:pos + 2]
+    return value
+
+
+def main():
+    args = sys.argv[1:]
+    public_key = take_option(args, "--key-header")
+    if public_key:
+        write_key_header(public_key)
+        return
+    data_dir = take_option(args, "--files")
+    private_key = take_option(args, "--key")
+    if len(args) not in (4, 5):
+        sys.exit(__doc__)
+    manifest = {
+        "fw": entry(args[0], args[1]),
+        "fs": entry(args[2], args[3]),
+    }
+    out_path = args[4] if len(args) == 5 else "manifest.json"
+
+    if data_dir:
+        listing = file_list(data_dir)
+        list_path = os.path.join(os.path.dirname(out_path), "files.txt")
+        with open(list_path, "wb") as f:
+            f.write(listing)
+        manifest["files"] = {"size": len(listing), "sha256": hashlib.sha256(listing).hexdigest()}
+        print("files.txt: %d files" % listing.count(b"\n"))
+
+    body = json.dumps(manifest, separators=(",", ":")).encode()
+    if private_key:
+        body = sign(body, private_key)
+    else:
+        print("manifest not signed, only -DMANIFEST_UNSIGNED=1 builds take it")
+    if len(body) > MAX_SIZE:
+        sys.exit("manifest is %d bytes, devices take %d" % (len(body), MAX_SIZE))
+    with open(out_path, "wb") as f:
+        f.write(body)
+    print("%s: FW %d (%d bytes), FS %d (%d bytes)%s" % (os.path.basename(out_path),
+          manifest["fw"]["version"], manifest["fw"]["size"], manifest["fs"]["version"], manifest["fs"]["size"],
+          ", signed" if private_key else ""))
+
+
+if __name__ == "__main__":
+    main()
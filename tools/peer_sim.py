@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""Simulate scoreboards sharing one live game over LAN multicast.
+
+Each device is its own process. It runs the same leader/follower rules as
+src/Peers.cpp and sends the same packets over real UDP multicast on the
+loopback interface. "Upstream" is a scripted game that every poll reads and
+counts, so the run shows how many upstream requests the whole group makes.
+
+Time is scaled down. One poll interval of the firmware (65 s) is --interval
+seconds here. For every group size from 1 to --devices, the group runs for
+--polls intervals and the upstream count is printed. Without peers the count
+would be devices * polls. With --kill-leader, the device that leads is
+stopped halfway. The run then shows which device took over.
+
+usage: peer_sim.py [options]
+"""
+
+import argparse
+import multiprocessing
+import random
+import socket
+import struct
+import time
+
+GROUP = "239.77.12.3"
+PORT = 4210
+MAGIC = 0x5353
+VERSION = 1
+HEADER = struct.Struct("<HBBIBBHIHHH")     # PeerHeader
+PEER_GAME, PEER_SYNC = 1, 2
+KEYFRAME, GAME_OVER = 0x01, 0x02
+ALL_FIELDS = 0x03FF
+KEYFRAME_EVERY = 8
+LEADER_TIMEOUTS = 3
+LEAGUE = 1
+GAME_ID = 662570
+
+# field bit, name, struct format; in wire order
+FIELDS = (
+    (0x0001, "awayID", "B"), (0x0002, "homeID", "B"), (0x0004, "awayScore", "B"), (0x0008, "homeScore", "B"),
+    (0x0010, "awayOther", "B"), (0x0020, "homeOther", "B"), (0x0040, "division", "5s"), (0x0080, "clock", "6s"),
+    (0x0100, "outs", "B"), (0x0200, "bases", "B"),
+)
+
+
+def upstream_game(elapsed, interval):
+    """The scripted game: a run every 7 polls, a new inning every 3."""
+    polls = max(0, int(elapsed / interval))
+    return {"awayID": 141, "homeID": 147, "awayScore": polls // 7, "homeScore": polls // 11, "awayOther": 0,
+            "homeOther": 0, "division": b"%d" % (1 + polls // 3), "clock": b"top" if polls % 2 else b"bot",
+            "outs": polls % 3, "bases": polls % 8}
+
+
+def encode(game, fields):
+    out = b""
+    for bit, name, fmt in FIELDS:
+        if fields & bit:
+            out += struct.pack(fmt, game[name])
+    return out
+
+
+def decode(body, game, fields):
+    pos = 0
+    for bit, name, fmt in FIELDS:
+        if fields & bit:
+            size = struct.calcsize(fmt)
+            if pos + size > len(body):
+                return False
+            game[name] = struct.unpack_from(fmt, body, pos)[0]
+            pos += size
+    return True
+
+
+def changed(prev, curr):
+    return sum(bit for bit, name, _ in FIELDS if prev.get(name) != curr[name])
+
+
+class Device:
+    def __init__(self, chip, interval):
+        self.chip = chip
+        self.interval = interval
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(("", PORT))
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP,
+                             struct.pack("4s4s", socket.inet_aton(GROUP), socket.inet_aton("127.0.0.1")))
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton("127.0.0.1"))
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+        self.leader = 0
+        self.leader_heard = 0.0
+        self.leader_interval = 0.0
+        self.rx = None
+        self.rx_sender = 0
+        self.rx_seq = 0
+        self.tx = {}
+        self.tx_seq = 0
+        self.tx_since_keyframe = 0
+        self.last_publish = 0.0
+        self.stats = dict.fromkeys(("upstream", "sent", "received", "applied", "syncs", "step_downs", "saved"), 0)
+
+    def alive(self, heard, interval):
+        return heard and (time.monotonic() - heard) < LEADER_TIMEOUTS * interval
+
+    def leading(self):
+        return self.alive(self.last_publish, self.interval)
+
+    def send(self, ptype, flags, seq, base, fields, body=b""):
+        interval_s = int(self.interval * 1000)      # the sim runs sub second intervals, so ms here
+        packet = HEADER.pack(MAGIC, VERSION, ptype, self.chip, LEAGUE, flags, interval_s, GAME_ID, seq, base, fields) + body
+        self.sock.sendto(packet, (GROUP, PORT))
+        self.stats["sent"] += 1
+
+    def send_game(self, fields, keyframe):
+        self.tx_seq += 1
+        self.send(PEER_GAME, KEYFRAME if keyframe else 0, self.tx_seq, self.tx_seq - 1, fields, encode(self.tx, fields))
+
+    def publish(self, game):
+        keyframe = not self.leading() or self.tx_since_keyframe >= KEYFRAME_EVERY
+        fields = ALL_FIELDS if keyframe else changed(self.tx, game)
+        self.tx = dict(game)
+        self.last_publish = time.monotonic()
+        self.tx_since_keyframe = 1 if keyframe else self.tx_since_keyframe + 1
+        self.send_game(fields, keyframe)
+
+    def following(self):
+        if self.leader and self.alive(self.leader_heard, self.leader_interval):
+            self.stats["saved"] += 1
+            return True
+        return False
+
+    def handle(self, packet):
+        if len(packet) < HEADER.size:
+            return
+        magic, version, ptype, sender, league, flags, interval_s, game_id, seq, base, fields = HEADER.unpack_from(packet)
+        if magic != MAGIC or version != VERSION or sender == self.chip:
+            return
+        self.stats["received"] += 1
+        if ptype == PEER_SYNC:
+            if self.leading():
+                self.send_game(ALL_FIELDS, True)
+            return
+        if self.leading():
+            if sender > self.chip:
+                return
+            self.last_publish = 0.0
+            self.stats["step_downs"] += 1
+        if self.leader and sender != self.leader and self.alive(self.leader_heard, self.leader_interval) \
+                and sender > self.leader:
+            return
+        self.leader = sender
+        self.leader_heard = time.monotonic()
+        self.leader_interval = interval_s / 1000.0
+        keyframe = flags & KEYFRAME
+        if not keyframe and (self.rx is None or self.rx_sender != sender or self.rx_seq != base):
+            self.stats["syncs"] += 1
+            self.rx = None
+            self.send(PEER_SYNC, 0, 0, 0, 0)
+            return
+        game = {} if keyframe else dict(self.rx)
+        if decode(packet[HEADER.size:], game, fields):
+            self.rx, self.rx_sender, self.rx_seq = game, sender, seq
+            self.stats["applied"] += 1
+
+    def run(self, start, duration, counter, results, stop_at):
+        time.sleep(max(0.0, start - time.monotonic()) + random.uniform(0, self.interval))   # boot at different times
+        next_poll = time.monotonic()
+        end = start + duration
+        while time.monotonic() < min(end, stop_at):
+            self.sock.settimeout(max(0.001, next_poll - time.monotonic()))
+            try:
+                self.handle(self.sock.recv(128))
+            except socket.timeout:
+                pass
+            now = time.monotonic()
+            if now >= next_poll:
+                if not self.following():
+                    with counter.get_lock():
+                        counter.value += 1
+                    self.stats["upstream"] += 1
+                    self.publish(upstream_game(now - start, self.interval))
+                next_poll += self.interval
+        self.stats["leading"] = self.leading()
+        self.stats["score"] = None if self.rx is None else (self.rx["awayScore"], self.rx["homeScore"])
+        results.put((self.chip, self.stats))
+
+
+def device_main(chip, interval, start, duration, counter, results, stop_at):
+    Device(chip, interval).run(start, duration, counter, results, stop_at)
+
+
+def run_group(count, args, kill_leader):
+    counter = multiprocessing.Value("i", 0)
+    results = multiprocessing.Queue()
+    start = time.monotonic() + 0.2
+    duration = args.polls * args.interval
+    chips = random.sample(range(0x100000, 0xFFFFFF), count)
+    lowest = min(chips)
+    procs = []
+    for chip in chips:
+        stop_at = start + duration / 2 if (kill_leader and chip == lowest) else float("inf")
+        proc = multiprocessing.Process(target=device_main,
+                                       args=(chip, args.interval, start, duration, counter, results, stop_at))
+        proc.start()
+        procs.append(proc)
+    stats = dict(results.get(timeout=args.polls * args.interval + 30) for _ in procs)
+    for proc in procs:
+        proc.join()
+    return counter.value, stats, lowest
+
+
+def main():
+    parser = argparse.ArgumentParser(description="upstream requests as LAN peers are added")
+    parser.add_argument("--devices", type=int, default=6, help="largest group")
+    parser.add_argument("--polls", type=int, default=40, help="poll intervals per run")
+    parser.add_argument("--interval", type=float, default=0.1, help="seconds per simulated poll interval")
+    parser.add_argument("--kill-leader", action="store_true", help="stop the leader halfway through")
+    args = parser.parse_args()
+
+    print("%-8s %9s %9s %8s %8s %6s %10s" % ("devices", "upstream", "no peers", "packets", "applied", "syncs",
+                                           "step downs"))
+    for count in range(1, args.devices + 1):
+        upstream, stats, lowest = run_group(count, args, args.kill_leader)
+        total = lambda key: sum(s[key] for s in stats.values())
+        print("%-8d %9d %9d %8d %8d %6d %10d" % (count, upstream, count * args.polls, total("sent"), total("applied"),
+                                                total("syncs"), total("step_downs")))
+        if args.kill_leader and count > 1:
+            leaders = [chip for chip, s in stats.items() if s["leading"] and chip != lowest]
+            print("         leader %06x stopped halfway, new leader: %s" % (
+                lowest, ", ".join("%06x" % chip for chip in leaders) or "none"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,340 @@
+#!/usr/bin/env python3
+"""Flash, IRAM, DRAM and stack use of the firmware, per source file and library.
+
+Reads the linker map for the static sizes. Each input section is counted
+against its object file, in the output section it ended up in:
+  flash   .irom0.text          code and PROGMEM data run from flash
+  iram    .text .lit4          IRAM_ATTR code and the core's own IRAM code
+  data    .data .rodata        initialised RAM, its image is in flash too
+  bss     .bss .noinit         zeroed RAM
+Objects are grouped into libraries: src, each library in lib_deps, the
+Arduino core (framework), and the SDK and toolchain archives by name.
+
+Peak stack is read from the disassembly. The frame of each function is its
+prologue's stack adjustment (the lx106 uses the call0 ABI, so a1 is the
+stack pointer). The peak of a root is the deepest chain of direct calls
+from it. Indirect calls (function pointers, virtuals, std::function) can't
+be followed and are listed, so a peak is a lower bound for a root with any.
+A recursive call ends its chain. Functions with a variable frame (VLA,
+alloca) are marked with "+".
+
+Budgets fail the build: flash image (flash + iram + data), iram, dram
+(data + bss), and peak stack of each root.
+
+As a PlatformIO extra script (platformio.ini) it adds -Map to the link,
+checks the budgets after every link and prints a one line summary. The
+full tables come from the size_report target:
+  pio run -t size_report
+Budgets and roots are project options:
+  custom_budget_flash, custom_budget_iram, custom_budget_dram,
+  custom_budget_stack   bytes, 0 for no limit
+  custom_stack_roots    function name patterns (fnmatch, demangled)
+
+Standalone, for a map and ELF from elsewhere:
+  size_report.py <map> [--elf <elf> --objdump <objdump>] [options]
+
+usage: size_report.py [options] map
+"""
+
+import argparse
+import collections
+import fnmatch
+import json
+import re
+import subprocess
+import sys
+
+# eagle.flash.4m2m.ld: 1 MB sketch slot, less the header sector
+DEFAULT_BUDGETS = {"flash": 1044464, "iram": 32768, "dram": 81920, "stack": 3072}
+DEFAULT_ROOTS = ["getAndDisplayCurrent*Game(*", "*fetchCurrentGame<*"]
+DEFAULT_TOP = 25
+
+REGIONS = {".irom0.text": "flash", ".text": "iram", ".lit4": "iram", ".data": "data", ".rodata": "data",
+           ".dport0.rodata": "data", ".dport0.data": "data", ".bss": "bss", ".noinit": "bss"}
+
+OUTPUT_SECTION = re.compile(r"^(\.\S+)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+))?")
+INPUT_SECTION = re.compile(r"^ (\S+)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(.+))?$")
+CONTINUATION = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(.+)$")
+
+
+def owner(path):
+    """(library, file) of an object in the map"""
+    path = path.strip().replace("\\", "/")
+    member = None
+    m = re.match(r"^(.*)\((.+)\)$", path)
+    if m:
+        path, member = m.group(1), m.group(2)
+    parts = path.split("/")
+    name = parts[-1]
+
+    if member:
+        library = name[3:] if name.startswith("lib") else name
+        library = library[:-2] if library.endswith(".a") else library
+        if library == "FrameworkArduino":
+            library = "framework"
+        return library, library + "/" + member
+    if "src" in parts[:-1] and ".pio" in parts:
+        return "src", "src/" + name[:-2] if name.endswith(".o") else "src/" + name
+    for i, part in enumerate(parts[:-2]):
+        if re.match(r"^lib[0-9a-f]+$", part):
+            return parts[i + 1], "/".join(parts[i + 1:])[:-2]
+    return "other", name
+
+
+def read_map(lines):
+    """{(library, file): {column: bytes}}"""
+    sizes = collections.defaultdict(lambda: collections.Counter())
+    started = False
+    region = None
+    pending = None
+    for line in lines:
+        line = line.rstrip("\n")
+        if not started:
+            started = line.startswith("Linker script and memory map")
+            continue
+        if pending:
+            m = CONTINUATION.match(line)
+            if m and region:
+                sizes[owner(m.group(3))][region] += int(m.group(2), 16)
+            pending = None
+            continue
+        if line.startswith("."):
+            region = REGIONS.get(OUTPUT_SECTION.match(line).group(1))
+            continue
+        m = INPUT_SECTION.match(line)
+        if not m or not region or m.group(1).startswith("*"):
+            continue
+        if m.group(2) is None:
+            pending = m.group(1)     # long section name, the rest is on the next line
+        elif m.group(4) and not m.group(4).startswith("0x"):
+            sizes[owner(m.group(4))][region] += int(m.group(3), 16)
+    return sizes
+
+
+def totals(sizes):
+    total = collections.Counter()
+    for counts in sizes.values():
+        total.update(counts)
+    return total
+
+
+def by_library(sizes):
+    libraries = collections.defaultdict(lambda: collections.Counter())
+    for (library, _), counts in sizes.items():
+        libraries[library].update(counts)
+    return libraries
+
+
+def image_size(counts):
+    return counts["flash"] + counts["iram"] + counts["data"]
+
+
+FUNCTION = re.compile(r"^([0-9a-f]+) <(.+)>:$")
+INSTRUCTION = re.compile(r"^\s*[0-9a-f]+:\s+(?:[0-9a-f]{2}\s?)+\s+(\S+)\s*(.*)$")
+TARGET = re.compile(r"^[0-9a-f]+ <(.+?)(\+0x[0-9a-f]+)?>$")
+PROLOGUE_LENGTH = 8
+
+
+def read_functions(lines):
+    """{name: {"frame": bytes, "dynamic": bool, "calls": set, "tails": set, "indirect": int}}"""
+    functions = {}
+    current = None
+    constants = {}
+    count = 0
+    for line in lines:
+        m = FUNCTION.match(line.rstrip("\n"))
+        if m:
+            current = {"frame": 0, "dynamic": False, "calls": set(), "tails": set(), "indirect": 0}
+            functions[m.group(2)] = current
+            name = m.group(2)
+            constants = {}
+            count = 0
+            continue
+        m = INSTRUCTION.match(line.rstrip("\n"))
+        if not m or current is None:
+            continue
+        op, args = m.group(1), [a.strip() for a in m.group(2).split(",")]
+        count += 1
+        if op in ("movi", "movi.n") and len(args) == 2:
+            try:
+                value = int(args[1], 0)
+                constants[args[0]] = value - (1 << 32) if value >= (1 << 31) else value
+            except ValueError:
+                pass
+        elif op in ("addi", "addmi", "addi.n") and args[:2] == ["a1", "a1"]:
+            adjust = int(args[2], 0)
+            if adjust < 0 and count <= PROLOGUE_LENGTH:
+                current["frame"] -= adjust
+        elif op in ("add", "add.n", "sub") and args[:2] == ["a1", "a1"] and len(args) == 3:
+            adjust = constants.get(args[2])
+            if adjust is not None and count <= PROLOGUE_LENGTH:
+                current["frame"] += -adjust if op != "sub" else adjust
+            elif op == "sub" or adjust is None:
+                current["dynamic"] = True
+        elif op == "call0":
+            t = TARGET.match(m.group(2).strip())
+            if t and not t.group(2):
+                current["calls"].add(t.group(1))
+        elif op in ("callx0", "jx"):
+            current["indirect"] += op == "callx0"
+        elif op in ("j", "j.l"):
+            t = TARGET.match(m.group(2).strip())
+            if t and not t.group(2) and t.group(1) != name:
+                current["tails"].add(t.group(1))
+    return functions
+
+
+def peak_stack(functions, root):
+    """(bytes, chain, indirect call sites and variable frames on the chain's subtree)"""
+    memo = {}
+
+    def walk(name, active):
+        if name in memo:
+            return memo[name]
+        f = functions.get(name)
+        if f is None or name in active:
+            return 0, [name], set()
+        active.add(name)
+        best, chain = 0, []
+        notes = set()
+        if f["indirect"]:
+            notes.add("%s: %d indirect" % (name, f["indirect"]))
+        if f["dynamic"]:
+            notes.add("%s: variable frame" % name)
+        for callee in f["calls"]:
+            depth, sub, subnotes = walk(callee, active)
+            notes |= subnotes
+            if depth > best:
+                best, chain = depth, sub
+        own = f["frame"] + best
+        tail_best, tail_chain = 0, []
+        for callee in f["tails"]:
+            depth, sub, subnotes = walk(callee, active)
+            notes |= subnotes
+            if depth > tail_best:
+                tail_best, tail_chain = depth, sub
+        active.discard(name)
+        result = (own, [name] + chain, notes) if own >= tail_best else (tail_best, [name] + tail_chain, notes)
+        memo[name] = result
+        return result
+
+    return walk(root, set())
+
+
+def stack_report(functions, patterns):
+    report = []
+    for name in sorted(functions):
+        if any(fnmatch.fnmatchcase(name, p) for p in patterns):
+            depth, chain, notes = peak_stack(functions, name)
+            frames = ["%s %d%s" % (n, functions[n]["frame"], "+" if functions[n]["dynamic"] else "")
+                      for n in chain if n in functions]
+            report.append({"root": name, "peak": depth, "chain": frames, "unbounded": sorted(notes)})
+    return report
+
+
+def check_budgets(total, stacks, budgets):
+    over = []
+    used = {"flash": image_size(total), "iram": total["iram"], "dram": total["data"] + total["bss"]}
+    for name, value in used.items():
+        if budgets.get(name) and value > budgets[name]:
+            over.append("%s %d > %d" % (name, value, budgets[name]))
+    for s in stacks:
+        if budgets.get("stack") and s["peak"] > budgets["stack"]:
+            over.append("stack of %s %d > %d" % (s["root"], s["peak"], budgets["stack"]))
+    return used, over
+
+
+def print_table(title, rows, top):
+    print("\n%-40s %9s %7s %7s %7s" % (title, "flash", "iram", "data", "bss"))
+    for key, counts in sorted(rows.items(), key=lambda r: -image_size(r[1]) - r[1]["bss"])[:top or None]:
+        print("%-40s %9d %7d %7d %7d" % (key[:40], counts["flash"], counts["iram"], counts["data"], counts["bss"]))
+
+
+def report(map_path, disassembly, budgets, roots, top=DEFAULT_TOP, json_path=None, quiet=False):
+    """Prints the report, returns the budget overruns"""
+    with open(map_path, errors="replace") as f:
+        sizes = read_map(f)
+    total = totals(sizes)
+    stacks = stack_report(read_functions(disassembly), roots) if disassembly else []
+    used, over = check_budgets(total, stacks, budgets)
+
+    if not quiet:
+        print_table("library", by_library(sizes), 0)
+        print_table("file", {f: c for (_, f), c in sizes.items()}, top)
+        for s in stacks:
+            print("\nstack %s: %d bytes" % (s["root"], s["peak"]))
+            for frame in s["chain"]:
+                print("  " + frame)
+            for note in s["unbounded"]:
+                print("  not counted: " + note)
+    summary = ", ".join("%s %d/%s" % (n, used[n], budgets.get(n) or "-") for n in ("flash", "iram", "dram"))
+    if stacks:
+        summary += ", stack %d/%s" % (max(s["peak"] for s in stacks), budgets.get("stack") or "-")
+    print("Size: " + summary)
+    for o in over:
+        print("Over budget: " + o)
+
+    if json_path:
+        with open(json_path, "w") as f:
+            json.dump({"total": dict(total), "used": used, "budgets": budgets, "over": over, "stacks": stacks,
+                       "libraries": {k: dict(v) for k, v in by_library(sizes).items()},
+                       "files": {f: dict(c) for (_, f), c in sizes.items()}}, f, indent=1)
+    return over
+
+
+def disassemble(objdump, elf):
+    return subprocess.run([objdump, "-d", "-C", elf], stdout=subprocess.PIPE, universal_newlines=True,
+                          check=True).stdout.splitlines()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="linker map")
+    parser.add_argument("--elf", help="firmware ELF, for the stack peaks")
+    parser.add_argument("--objdump", default="xtensa-lx106-elf-objdump", help="(default: %(default)s)")
+    parser.add_argument("--disassembly", help="saved objdump -d -C output, in place of --elf")
+    parser.add_argument("--root", action="append", help="stack root pattern, repeatable (default: %s)" %
+                        " ".join(DEFAULT_ROOTS))
+    for name, value in DEFAULT_BUDGETS.items():
+        parser.add_argument("--" + name, type=int, default=value, help="%s budget (default: %%(default)s)" % name)
+    parser.add_argument("--top", type=int, default=DEFAULT_TOP, help="files listed, 0 for all (default: %(default)s)")
+    parser.add_argument("--json", help="write the full report here")
+    args = parser.parse_args()
+
+    disassembly = None
+    if args.disassembly:
+        with open(args.disassembly, errors="replace") as f:
+            disassembly = f.read().splitlines()
+    elif args.elf:
+        disassembly = disassemble(args.objdump, args.elf)
+    budgets = {name: getattr(args, name) for name in DEFAULT_BUDGETS}
+    over = report(args.map, disassembly, budgets, args.root or DEFAULT_ROOTS, args.top, args.json)
+    return 1 if over else 0
+
+
+def platformio(env):
+    map_path = "$BUILD_DIR/${PROGNAME}.map"
+    env.Append(LINKFLAGS=["-Wl,-Map," + map_path])
+
+    budgets = {name: int(env.GetProjectOption("custom_budget_" + name, str(value)))
+               for name, value in DEFAULT_BUDGETS.items()}
+    roots = env.GetProjectOption("custom_stack_roots", " ".join(DEFAULT_ROOTS)).split()
+
+    def run(target, source, env, quiet):
+        elf = env.subst("$BUILD_DIR/${PROGNAME}.elf")
+        objdump = env.subst("$OBJCOPY").replace("objcopy", "objdump")
+        over = report(env.subst(map_path), disassemble(objdump, elf), budgets, roots,
+                      json_path=env.subst("$BUILD_DIR/size_report.json"), quiet=quiet)
+        return 1 if over else 0
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", lambda target, source, env: run(target, source, env, True))
+    env.AddCustomTarget("size_report", "$BUILD_DIR/${PROGNAME}.elf",
+                        lambda target, source, env: run(target, source, env, False),
+                        title="Size report", description="Flash, IRAM, DRAM and stack use per file and library")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+else:
+    Import("env")       # noqa: F821, run by PlatformIO as an extra script
+    platformio(env)     # noqa: F821
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Load test the scoreboard's LAN status server (see src/StatusServer.h).
+
+Requests a path over and over, from one or more threads, and reports
+requests per second and latency percentiles. With --etag every request after
+the first sends If-None-Match, the way a polling dashboard would, and the
+share of 304 answers is printed too. The server closes the connection after
+every response, so each request pays for its own TCP connect like a real
+client would.
+
+usage: status_bench.py [options] host
+"""
+
+import argparse
+import http.client
+import json
+import sys
+import threading
+import time
+
+
+def worker(args, results, lock):
+    etag = None
+    latencies = []
+    codes = {}
+    errors = 0
+    for _ in range(args.count):
+        headers = {"If-None-Match": etag} if (args.etag and etag) else {}
+        start = time.perf_counter()
+        try:
+            conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+            conn.request("GET", args.path, headers=headers)
+            response = conn.getresponse()
+            body = response.read()
+            conn.close()
+        except (OSError, http.client.HTTPException):
+            errors += 1
+            continue
+        latencies.append((time.perf_counter() - start) * 1000.0)
+        codes[response.status] = codes.get(response.status, 0) + 1
+        if response.status == 200:
+            etag = response.getheader("ETag")
+            if args.check:
+                json.loads(body)
+    with lock:
+        results["latencies"].extend(latencies)
+        results["errors"] += errors
+        for code, count in codes.items():
+            results["codes"][code] = results["codes"].get(code, 0) + count
+
+
+def percentile(values, share):
+    return values[min(len(values) - 1, int(share * len(values)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="requests per second and latency of the status server")
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--path", default="/game")
+    parser.add_argument("--count", type=int, default=100, help="requests per thread")
+    parser.add_argument("--threads", type=int, default=1)
+    parser.add_argument("--etag", action="store_true", help="send If-None-Match from the last 200")
+    parser.add_argument("--check", action="store_true", help="fail on a body that isn't JSON")
+    parser.add_argument("--timeout", type=float, default=5.0)
+    args = parser.parse_args()
+
+    results = {"latencies": [], "errors": 0, "codes": {}}
+    lock = threading.Lock()
+    threads = [threading.Thread(target=worker, args=(args, results, lock)) for _ in range(args.threads)]
+    start = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    elapsed = time.perf_counter() - start
+
+    latencies = sorted(results["latencies"])
+    if not latencies:
+        sys.exit("no successful requests, %d errors" % results["errors"])
+
+    total = len(latencies)
+    print("requests:   %d ok, %d errors in %.2f s" % (total, results["errors"], elapsed))
+    print("rate:       %.1f requests/s" % (total / elapsed))
+    print("latency ms: min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f" % (
+        latencies[0], percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99), latencies[-1]))
+    print("status:     %s" % ", ".join("%d x%d" % (code, count) for code, count in sorted(results["codes"].items())))
+    if args.etag:
+        print("304 share:  %.1f%%" % (100.0 * results["codes"].get(304, 0) / total))
+
+
+if __name__ == "__main__":
+    main()